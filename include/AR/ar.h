@@ -176,6 +176,18 @@ typedef struct {
     int     vertex[5];
 } ARMarkerInfo2;
 
+/** \struct ARPattSpec
+* \brief physical description of a square marker.
+*
+* Used by arGetTransMatBatch() to give the geometry of each marker.
+* \param center the physical center of the marker (in mm)
+* \param width the size of the marker (in mm)
+*/
+typedef struct {
+    double  center[2];
+    double  width;
+} ARPattSpec;
+
 // ============================================================================
 //	Public globals.
 // ============================================================================
@@ -264,6 +276,80 @@ extern int      arTemplateMatchingMode;
 */
 extern int      arMatchingPCAMode;
 
+/** \var int arPrecisionMode
+* \brief arithmetic precision of the detection and pose kernels.
+*
+* Selects the implementation of the per-marker kernels (contour line
+* fitting and undistortion, pattern homography, pose refinement).
+* Inputs and outputs stay in double; only the internal arithmetic changes.
+* the possible values are :
+* -AR_PRECISION_DOUBLE: double precision (reference)
+* -AR_PRECISION_FLOAT: single precision fast path
+* by default: DEFAULT_PRECISION_MODE in config.h
+*/
+extern int      arPrecisionMode;
+
+/** \var int arThresholdMode
+* \brief how arDetectMarker chooses its threshold.
+*
+* In the automatic modes the labeling gathers a histogram of the
+* luminance, and the threshold of each frame is derived from the
+* histogram of the previous one (see arUpdateThreshold). The thresh
+* argument of arDetectMarker is only used for the first frame.
+* the possible values are :
+* -AR_THRESHOLD_MODE_MANUAL: the thresh argument of arDetectMarker
+* -AR_THRESHOLD_MODE_AUTO_OTSU: Otsu's threshold of the whole frame
+* -AR_THRESHOLD_MODE_AUTO_MARKER: Otsu's threshold around the markers
+*  found in the previous frame, of the whole frame when there is none
+* by default: DEFAULT_THRESHOLD_MODE in config.h
+*/
+extern int      arThresholdMode;
+
+/** \var int arIncrementalMode
+* \brief reuse of the labeling of the previous frame.
+*
+* With a fixed camera, arDetectMarker and arDetectMarkerLite can compare
+* the frame with the previous one by tiles of AR_TILE_SIZE pixels and
+* label again only around the tiles that changed (see
+* arDetectMarker2Incremental). The markers found are the same. Not used
+* in debug mode.
+* the possible values are :
+* -AR_INCREMENTAL_DISABLE: label every frame
+* -AR_INCREMENTAL_ENABLE: label the changes only
+* by default: DEFAULT_INCREMENTAL_MODE in config.h
+*/
+extern int      arIncrementalMode;
+
+/** \var int arLumaMode
+* \brief whether arDetectMarker works on the luminance of the frame.
+*
+* In AR_LUMA_SHARED mode arDetectMarker and arDetectMarkerLite extract the
+* luminance of the frame once (see arGetLumaImage), and the labeling, the
+* histogram of the automatic threshold and, in black and white template
+* matching, the pattern sampling read it instead of the frame. The
+* labeling is the same; the black and white patterns may differ by the
+* rounding of the luminance. The extra pass pays when the application
+* reads the plane too; on its own it costs more than it saves. MONO frames,
+* being their own luminance, always go this way. The incremental labeling
+* (arIncrementalMode), the color pattern sampling and the frame pipeline
+* (arPipeline.h) keep reading the frame.
+* the possible values are :
+* -AR_LUMA_ON_DEMAND: the plane is made on the first arGetLumaImage()
+* -AR_LUMA_SHARED: the plane is made by the detection and read by it
+* by default: DEFAULT_LUMA_MODE in config.h
+*/
+extern int      arLumaMode;
+
+/** \var int arTrackInterval
+* \brief frames between two full detections of arTrackMarker.
+*
+* arTrackMarker runs arDetectMarker once every arTrackInterval frames and
+* follows the corners of the markers found in between. 1 detects every
+* frame.
+* by default: DEFAULT_TRACK_INTERVAL in config.h
+*/
+extern int      arTrackInterval;
+
 // ============================================================================
 //	Public functions.
 // ============================================================================
@@ -382,6 +468,117 @@ int arDetectMarker( ARUint8 *dataPtr, int thresh,
 int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                         ARMarkerInfo **marker_info, int *marker_num );
 
+/**
+* \brief detect the square markers in the luminance plane of a video frame.
+*
+* Same as arDetectMarker, but the frame is given as planar YUV, e.g. the planes
+* of a YUV420P (I420) frame straight from the device, so that no conversion to
+* the default pixel format is needed before detection. The labeling thresholds
+* the luminance directly; the chroma planes are only read inside the marker
+* patterns, for color pattern matching.
+*
+* \param luma  8 bit luminance plane, arImXsize x arImYsize bytes.
+* \param chroma_u U plane at half resolution in both directions (4:2:0),
+*                 or NULL to match the patterns in gray levels (black and
+*                 white patterns are not affected).
+* \param chroma_v V plane, as chroma_u.
+* \param thresh  specifies the threshold value (between 0-255) on the luminance.
+* \param marker_info a pointer to an array of ARMarkerInfo structures returned
+*                    which contain all the information about the detected squares in the image
+* \param marker_num the number of detected markers in the image.
+* \return 0 when the function completes normally, -1 otherwise
+*/
+int arDetectMarkerLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v, int thresh,
+                        ARMarkerInfo **marker_info, int *marker_num );
+
+/**
+* \brief detect the markers, or follow the ones of the previous frames.
+*
+* Runs arDetectMarker every arTrackInterval frames. In between, the four
+* corners of the markers identified (id >= 0) by the last detection are
+* followed from frame to frame with a pyramidal Lucas-Kanade tracker on
+* the luminance, and their vertex, line, pos and area are updated; id,
+* dir and cf are the ones of the detection. The result can be given to
+* arGetTransMatCont as is. Only the luminance around the markers is
+* computed. A full detection is done as soon as a corner is lost (too
+* little texture, residual above AR_TRACK_ERROR_MAX, not found again
+* within AR_TRACK_BACK_ERROR_MAX pixels when tracked back to the previous
+* frame, moved by more than about AR_TRACK_SEARCH pixels) or a square
+* folds, and when no marker was identified.
+* Markers entering the view are only found by the detections.
+* \param dataPtr a pointer to the color image which is to be searched
+*                for square markers.
+* \param thresh threshold of the detections
+* \param marker_info the markers, as arDetectMarker
+* \param marker_num the number of markers
+* \return 1 if the markers were tracked, 0 if they come from a detection,
+*         -1 if error
+*/
+int arTrackMarker( ARUint8 *dataPtr, int thresh,
+                   ARMarkerInfo **marker_info, int *marker_num );
+
+/**
+* \brief make the next arTrackMarker call a full detection.
+*
+* \return 0
+*/
+int arTrackReset( void );
+
+/**
+* \brief detect rapidly the square markers in the luminance plane of a video frame.
+*
+* The luminance version of arDetectMarkerLite, see arDetectMarkerLuma.
+* \param luma  8 bit luminance plane, arImXsize x arImYsize bytes.
+* \param chroma_u U plane (4:2:0) or NULL.
+* \param chroma_v V plane (4:2:0) or NULL.
+* \param thresh  specifies the threshold value (between 0-255) on the luminance.
+* \param marker_info a pointer to an array of ARMarkerInfo structures returned
+*                    which contain all the information about the detected squares in the image
+* \param marker_num the number of detected markers in the image.
+* \return 0 when the function completes normally, -1 otherwise
+*/
+int arDetectMarkerLumaLite( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v, int thresh,
+                            ARMarkerInfo **marker_info, int *marker_num );
+
+/**
+* \brief luminance of the frame last processed by arDetectMarker.
+*
+* The luminance (see arColorConvertLuma) of the frame given to
+* arDetectMarker or arDetectMarkerLite, made on the first call for that
+* frame (by the detection itself in AR_LUMA_SHARED mode, see arLumaMode)
+* and then shared by all the callers, so that the frame is read only once
+* whatever the number of stages working on grey levels. With
+* arDetectMarkerLuma it is the plane passed in. The frame must still be
+* valid on the first call; the planes are valid until the next detection.
+* \param half 0 for the arImXsize x arImYsize plane, 1 for the
+*             (arImXsize/2) x (arImYsize/2) one (even pixels of the even rows)
+* \return the plane, or NULL if no frame has been processed
+*/
+ARUint8 *arGetLumaImage( int half );
+
+/**
+* \brief threshold chosen for the next frame in automatic mode.
+*
+* The arDetectMarker functions use it instead of their thresh argument
+* when arThresholdMode is not AR_THRESHOLD_MODE_MANUAL.
+* \return the threshold, -1 if none has been chosen yet
+*/
+int arGetThreshold( void );
+
+/**
+* \brief choose the threshold of the next frame.
+*
+* Called by the arDetectMarker functions after the detection. From the
+* histograms of the last labeling (see arGetImgHistogram), picks Otsu's
+* threshold and, in AR_THRESHOLD_MODE_AUTO_MARKER, sets the regions
+* around the markers found as the ones of the next histogram. Only
+* needed by applications calling arLabeling themselves.
+* \param marker_info markers found in the frame
+* \param marker_num number of markers
+* \return the threshold, -1 in AR_THRESHOLD_MODE_MANUAL or without histogram
+*/
+int arUpdateThreshold( ARMarkerInfo *marker_info, int marker_num );
+
 /**
 * \brief compute camera position in function of detected markers.
 *
@@ -425,6 +622,23 @@ double arGetTransMat( ARMarkerInfo *marker_info,
 double arGetTransMatCont( ARMarkerInfo *marker_info, double prev_conv[3][4],
                           double center[2], double width, double conv[3][4] );
 
+/**
+* \brief compute camera position for a set of detected markers in parallel.
+*
+* Equivalent to calling arGetTransMat() on every marker, but the markers
+* are distributed over the shared worker pool (see arThread.h). The call
+* is thread-safe and returns once all the poses are available.
+* \param marker_info array of marker_num detected markers.
+* \param marker_num number of markers to process.
+* \param spec array of marker_num marker geometries, spec[i] describes marker_info[i].
+* \param conv array of marker_num transformation matrices (output).
+* \param err array of marker_num fitting errors (output), -1 for a marker
+*            whose pose could not be computed.
+* \return 0 if success, -1 if error.
+*/
+int arGetTransMatBatch( ARMarkerInfo *marker_info, int marker_num,
+                        const ARPattSpec *spec, double (*conv)[3][4], double *err );
+
 double arGetTransMat2( double rot[3][3], double pos2d[][2],
                        double pos3d[][2], int num, double conv[3][4] );
 double arGetTransMat3( double rot[3][3], double ppos2d[][2],
@@ -436,6 +650,21 @@ double arGetTransMat5( double rot[3][3], double ppos2d[][2],
                        double ppos3d[][3], int num, double conv[3][4],
                        double *dist_factor, double cpara[3][4] );
 
+/**
+* \brief arGetTransMat5 with caller-supplied scratch buffers.
+*
+* Same computation as arGetTransMat5, for callers that solve the pose of
+* many points every frame (e.g. multi-marker boards) and want to avoid
+* any allocation. The buffers are overwritten.
+* \param pos2d scratch buffer of num entries.
+* \param pos3d scratch buffer of num entries.
+* \return the fitting error.
+*/
+double arGetTransMat5Work( double rot[3][3], double ppos2d[][2],
+                           double ppos3d[][3], int num, double conv[3][4],
+                           double *dist_factor, double cpara[3][4],
+                           double pos2d[][2], double pos3d[][3] );
+
 /**
 * \brief remove a pattern from memory.
 *
@@ -471,6 +700,8 @@ int arDeactivatePatt( int pat_no );
 *
 * used in mk_patt to save a bitmap of the pattern of the currently detected marker.
 * The saved image is a table of the normalized viewed pattern.
+* The marker must come from the last arDetectMarker() or arDetectMarkerLite(),
+* or from the last arsDetectMarker() or arsDetectMarkerLite() of either eye.
 * \param image a pointer to the image containing the marker pattern to be trained.
 * \param marker_info a pointer to the ARMarkerInfo structure of the pattern to be trained.
 * \param filename The name of the file where the bitmap image is to be saved.
@@ -578,6 +809,46 @@ ARInt16 *arLabeling( ARUint8 *image, int thresh,
                      int *label_num, int **area, double **pos, int **clip,
                      int **label_ref );
 
+/**
+* \brief extract connected components from a luminance plane.
+*
+* Same as arLabeling, for an 8 bit luminance plane of arImXsize x arImYsize
+* bytes (see arDetectMarkerLuma).
+* \param luma input luminance plane
+* \param thresh lighting threshold
+* \param label_num Ouput- number of detected components
+* \param area as arLabeling
+* \param pos as arLabeling
+* \param clip as arLabeling
+* \param label_ref as arLabeling
+* \return returns a pointer to the labeled output image.
+*/
+ARInt16 *arLabelingLuma( ARUint8 *luma, int thresh,
+                         int *label_num, int **area, double **pos, int **clip,
+                         int **label_ref );
+
+/**
+* \brief extract connected components in a region of the image only.
+*
+* As arLabeling, but the pixels outside the region are taken as
+* background and the label image is only written inside the region and
+* on the pixels around it. Coordinates are the ones of the labeling
+* (halved in AR_IMAGE_PROC_IN_HALF mode). No histogram is gathered.
+* \param image input image
+* \param thresh lighting threshold
+* \param region xmin, xmax, ymin, ymax of the region (inclusive), inside
+*               the border of one pixel of the image
+* \param label_num Ouput- number of detected components
+* \param area as arLabeling
+* \param pos as arLabeling
+* \param clip as arLabeling
+* \param label_ref as arLabeling
+* \return returns a pointer to the labeled output image.
+*/
+ARInt16 *arLabelingRegion( ARUint8 *image, int thresh, int region[4],
+                           int *label_num, int **area, double **pos, int **clip,
+                           int **label_ref );
+
 /**
  * \brief clean up static data allocated by arLabeling.
  *
@@ -598,6 +869,29 @@ ARInt16 *arLabeling( ARUint8 *image, int thresh,
 */
 void arGetImgFeature( int *num, int **area, int **clip, double **pos );
 
+/**
+* \brief histograms gathered by the last arLabeling.
+*
+* Outside AR_THRESHOLD_MODE_MANUAL, arLabeling and arLabelingLuma count
+* the value of the threshold test (sum of the 3 color components, 3 times
+* the luminance) of one pixel out of AR_THRESH_HIST_STEP in both
+* directions, over the whole frame and inside the regions set by
+* arSetImgHistogramROI.
+* \param hist Output- AR_THRESH_HIST_SIZE counts of the whole frame
+* \param hist_num Output- number of pixels counted in hist, 0 if none
+* \param hist_roi Output- AR_THRESH_HIST_SIZE counts of the regions
+* \param hist_roi_num Output- number of pixels counted in hist_roi
+*/
+void arGetImgHistogram( int **hist, int *hist_num, int **hist_roi, int *hist_roi_num );
+
+/**
+* \brief regions of the next labeling counted in the region histogram.
+*
+* \param roi xmin, xmax, ymin, ymax of each region, in image coordinates
+* \param roi_num number of regions, at most AR_SQUARE_MAX
+*/
+void arSetImgHistogramROI( int *roi, int roi_num );
+
 /**
 * \brief   XXXBK
 *
@@ -620,17 +914,75 @@ ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage,
                                 int area_max, int area_min, double factor, int *marker_num );
 
 /**
-* \brief information on 
+* \brief arLabeling and arDetectMarker2, reusing the previous frame.
 *
-*  XXXBK
-* \param image XXXBK
-* \param marker_info2 XXXBK
-* \param marker_num XXXBK
-* \return XXXBK
+* Compares the frame with the one of the previous call by tiles of
+* AR_TILE_SIZE pixels. The candidates away from the changed tiles are
+* kept; the labeling is done again only over the changed tiles and the
+* components that touch them. The candidates are the ones arLabeling and
+* arDetectMarker2 would give, in the same order. The whole frame is
+* labeled again when the threshold, the size or arImageProcMode change,
+* when the changes cover more than half of the frame, and in the
+* automatic threshold modes (the histogram needs the whole frame).
+* After a partial labeling, the label image and arGetImgFeature only
+* describe the region labeled.
+* \param image input image
+* \param thresh threshold of the labeling
+* \param area_max maximum area of a marker (in pixels)
+* \param area_min minimum area of a marker (in pixels)
+* \param factor as arDetectMarker2
+* \param marker_num Output- number of candidates
+* \return the candidates, NULL if error
+*/
+ARMarkerInfo2 *arDetectMarker2Incremental( ARUint8 *image, int thresh,
+                                           int area_max, int area_min, double factor, int *marker_num );
+
+/**
+* \brief identify the candidate squares.
+*
+* Fits the four lines of each candidate and matches its pattern. With
+* AR_MARKER_INFO_THREAD_MIN candidates or more, they are spread over the
+* shared worker pool (see arThread.h); the result is the same.
+* \param image the frame the candidates were found in
+* \param marker_info2 the candidates, as arDetectMarker2
+* \param marker_num number of candidates (input), of markers (output):
+*                   candidates whose lines cannot be fitted are dropped
+* \return the markers, in the order of the candidates, in a buffer of the
+*         library valid until the next call
 */
 ARMarkerInfo *arGetMarkerInfo( ARUint8 *image,
                                ARMarkerInfo2 *marker_info2, int *marker_num );
 
+/**
+* \brief identify the candidate squares in parallel, into a caller's buffer.
+*
+* Same as arGetMarkerInfo, but the candidates are always spread over the
+* shared worker pool, each idle thread taking the next candidate not yet
+* taken, and the markers are written to the caller's buffer. The call is
+* thread-safe as long as the patterns are not loaded, freed or
+* (de)activated meanwhile.
+* \param image as arGetMarkerInfo
+* \param marker_info2 as arGetMarkerInfo
+* \param marker_num as arGetMarkerInfo
+* \param marker_info buffer of at least *marker_num entries (output)
+* \return marker_info
+*/
+ARMarkerInfo *arGetMarkerInfoParallel( ARUint8 *image, ARMarkerInfo2 *marker_info2,
+                                       int *marker_num, ARMarkerInfo *marker_info );
+
+/**
+* \brief arGetMarkerInfo on a luminance plane.
+*
+* \param luma luminance plane
+* \param chroma_u U plane (4:2:0) or NULL
+* \param chroma_v V plane (4:2:0) or NULL
+* \param marker_info2 as arGetMarkerInfo
+* \param marker_num as arGetMarkerInfo
+* \return as arGetMarkerInfo
+*/
+ARMarkerInfo *arGetMarkerInfoLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v,
+                                   ARMarkerInfo2 *marker_info2, int *marker_num );
+
 /**
 * \brief  XXXBK
 *
@@ -647,6 +999,24 @@ ARMarkerInfo *arGetMarkerInfo( ARUint8 *image,
 int arGetCode( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
                int *code, int *dir, double *cf );
 
+/**
+* \brief arGetCode on a luminance plane.
+*
+* \param luma luminance plane
+* \param chroma_u U plane (4:2:0) or NULL
+* \param chroma_v V plane (4:2:0) or NULL
+* \param x_coord as arGetCode
+* \param y_coord as arGetCode
+* \param vertex as arGetCode
+* \param code as arGetCode
+* \param dir as arGetCode
+* \param cf as arGetCode
+* \return as arGetCode
+*/
+int arGetCodeLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v,
+                   int *x_coord, int *y_coord, int *vertex,
+                   int *code, int *dir, double *cf );
+
 /**
 * \brief Get a normalized pattern from a video image.
 *
@@ -662,6 +1032,24 @@ int arGetCode( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
 int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
                ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] );
 
+/**
+* \brief Get a normalized pattern from a luminance plane.
+*
+* As arGetPatt. The chroma samples are converted to B, G, R as by
+* arColorConvert; without chroma the three components are the luminance.
+* \param luma luminance plane
+* \param chroma_u U plane (4:2:0) or NULL
+* \param chroma_v V plane (4:2:0) or NULL
+* \param x_coord as arGetPatt
+* \param y_coord as arGetPatt
+* \param vertex as arGetPatt
+* \param ext_pat detected pattern.
+* \return 0 if success, -1 otherwise
+*/
+int arGetPattLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v,
+                   int *x_coord, int *y_coord, int *vertex,
+                   ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] );
+
 /**
 * \brief estimate a line from a list of point.
 *
@@ -783,12 +1171,38 @@ ARInt16      *arsLabeling        ( ARUint8 *image, int thresh,
                                    int **label_ref, int LorR );
 int           arsGetLine         ( int x_coord[], int y_coord[], int coord_num,
                                    int vertex[], double line[4][3], double v[4][2], int LorR);
+ARMarkerInfo2 *arsDetectMarker2  ( ARInt16 *limage,
+                                   int label_num, int *label_ref,
+                                   int *warea, double *wpos, int *wclip,
+                                   int area_max, int area_min, double factor, int *marker_num,
+                                   int LorR );
 ARMarkerInfo *arsGetMarkerInfo   ( ARUint8 *image,
                                    ARMarkerInfo2 *marker_info2, int *marker_num, int LorR );
 int           arsDetectMarker    ( ARUint8 *dataPtr, int thresh,
                                    ARMarkerInfo **marker_info, int *marker_num, int LorR );
 int           arsDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                                    ARMarkerInfo **marker_info, int *marker_num, int LorR );
+
+/**
+* \brief main function to detect the square markers in a stereo pair.
+*
+* Same as arsDetectMarker() on the left image then on the right image,
+* but the two eyes (labeling, contour extraction and marker
+* identification) are processed concurrently on the shared worker pool
+* (see arThread.h). The call returns once both eyes are done, so the
+* results can be passed directly to arsGetTransMat().
+* \param dataPtrL left image
+* \param dataPtrR right image
+* \param thresh binarization threshold, used for both images
+* \param marker_infoL markers detected in the left image (output)
+* \param marker_numL number of markers in marker_infoL (output)
+* \param marker_infoR markers detected in the right image (output)
+* \param marker_numR number of markers in marker_infoR (output)
+* \return 0 if success, -1 if error in either image
+*/
+int           arsDetectMarkerPair( ARUint8 *dataPtrL, ARUint8 *dataPtrR, int thresh,
+                                   ARMarkerInfo **marker_infoL, int *marker_numL,
+                                   ARMarkerInfo **marker_infoR, int *marker_numR );
 double        arsGetTransMat     ( ARMarkerInfo *marker_infoL, ARMarkerInfo *marker_infoR,
                                    double center[2], double width,
                                    double transL[3][4], double transR[3][4] );
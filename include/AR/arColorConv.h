@@ -0,0 +1,125 @@
+/*  --------------------------------------------------------------------------
+*   Copyright (C) 2004 Hitlab NZ.
+*   The distribution policy is describe on the Copyright.txt furnish
+*    with this library.
+*   -------------------------------------------------------------------------*/
+/**
+*  \file arColorConv.h
+*  \brief ARToolkit color conversion subroutines.
+*
+*  This file converts the frame formats delivered by the capture devices
+*  (YUV 4:2:0, 4:2:2, 4:1:1, 4:4:4 and grey) to any AR_PIXEL_FORMAT.
+*  It replaces the conversions of the video drivers (ccvt, IIDC).
+*  It also extracts the luminance plane the marker detection works on.
+*
+*  The inner loops use SSE2, AVX2 or NEON when the compiler targets them
+*  (e.g. -mavx2, -mssse3), and plain C otherwise; all variants give the
+*  same result to the bit. Large frames are split into bands of rows
+*  processed on the shared worker pool (see arThread.h).
+*
+*  The YUV to RGB conversion is full range (JPEG, as ccvt):
+*    R = Y + 1.402 (V-128)
+*    G = Y - 0.344 (U-128) - 0.714 (V-128)
+*    B = Y + 1.772 (U-128)
+*  computed with 6 fractional bits.
+*
+*   History :
+*
+*  \version 1.0
+*  \date 26/10/18
+**/
+/*  --------------------------------------------------------------------------
+*   History :
+*   Rev		Date		Who		Changes
+*
+*----------------------------------------------------------------------------*/
+
+#ifndef AR_COLOR_CONV_H
+#define AR_COLOR_CONV_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+//	Public includes.
+// ============================================================================
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+// ============================================================================
+//	Public types and defines.
+// ============================================================================
+
+/* source formats */
+#define  AR_COLOR_YUV420P       0   /* planes Y, U, V one after the other (I420)  */
+#define  AR_COLOR_YUV420I       1   /* ccvt "420i": YYYY UU / YYYY VV lines       */
+#define  AR_COLOR_YUYV          2   /* 4:2:2 Y U Y V (yuvs, YUY2)                 */
+#define  AR_COLOR_UYVY          3   /* 4:2:2 U Y V Y (2vuy, IIDC YUV422)          */
+#define  AR_COLOR_YUV411        4   /* 4:1:1 U Y Y V Y Y (IIDC YUV411)            */
+#define  AR_COLOR_YUV444        5   /* 4:4:4 U Y V (IIDC YUV444)                  */
+#define  AR_COLOR_MONO          6   /* 8 bit grey                                 */
+
+/* coefficients of the YUV to RGB conversion, 6 fractional bits */
+#define  AR_COLOR_CONV_RV       90
+#define  AR_COLOR_CONV_GU       22
+#define  AR_COLOR_CONV_GV       46
+#define  AR_COLOR_CONV_BU       113
+
+/* frames smaller than this (in pixels) are converted on the calling thread */
+#define  AR_COLOR_CONV_THREAD_MIN   (320*240)
+
+// ============================================================================
+//	Public functions.
+// ============================================================================
+
+/**
+* \brief convert a frame to an AR_PIXEL_FORMAT.
+*
+* The width must be a multiple of 4 for AR_COLOR_YUV411 and
+* AR_COLOR_YUV420I, and of 2 for the other YUV formats; AR_COLOR_YUV420P
+* and AR_COLOR_YUV420I also need an even height. The alpha bytes of
+* 32 bit formats are set to 255.
+* \param src source frame
+* \param src_format source format (AR_COLOR_*)
+* \param width width of the frame in pixels
+* \param height height of the frame in pixels
+* \param dst destination frame, width*height pixels
+* \param dst_format destination format (AR_PIXEL_FORMAT_*)
+* \return 0 if success, -1 if the conversion is not supported
+*/
+int arColorConvert( ARUint8 *src, int src_format, int width, int height,
+                    ARUint8 *dst, int dst_format );
+
+/**
+* \brief luminance of a frame in an AR_PIXEL_FORMAT, in one pass.
+*
+* The luminance is the one the marker detection thresholds: the sum of
+* the three color components divided by 3 and rounded up (so that
+* luma <= thresh exactly when R+G+B <= 3*thresh), or the Y component of
+* the YUV formats. luma_half is the luminance of the even pixels of the
+* even rows, (width/2) x (height/2), i.e. what the labeling reads in
+* AR_IMAGE_PROC_IN_HALF mode. Either output may be NULL; without luma
+* only the even rows are read.
+* \param src source frame
+* \param src_format source format (AR_PIXEL_FORMAT_*)
+* \param width width of the frame in pixels
+* \param height height of the frame in pixels
+* \param luma luminance, width*height bytes, or NULL
+* \param luma_half half resolution luminance, or NULL
+* \return 0 if success, -1 if error
+*/
+int arColorConvertLuma( ARUint8 *src, int src_format, int width, int height,
+                        ARUint8 *luma, ARUint8 *luma_half );
+
+/**
+* \brief name of the instruction set used by arColorConvert().
+*
+* \return "AVX2", "SSSE3", "SSE2", "NEON" or "C"
+*/
+const char *arColorConvGetSIMD( void );
+
+#ifdef __cplusplus
+}
+#endif
+#endif
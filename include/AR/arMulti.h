@@ -58,6 +58,7 @@ extern "C" {
 * \param pos3d final position of the pattern
 * \param visible boolean flag for visibility
 * \param visibleR last state visibility
+* \param patt_next next marker of the board using the same pattern, -1 if none
 */
 typedef struct {
     int     patt_id;
@@ -69,18 +70,35 @@ typedef struct {
     int     visible;
 /*---*/
     int     visibleR;
+/*---*/
+    int     patt_next;
 } ARMultiEachMarkerInfoT;
 
 /** \struct ARMultiMarkerInfoT
 * \brief global multi-marker structure
 *
 * Main structure for multi-marker tracking.
+*
+* A structure filled by the application instead of arMultiReadConfigFile()
+* must have the fields it does not set (work, work_num, patt_index,
+* patt_index_num) zeroed, e.g. with memset, since the library allocates
+* and frees work itself.
 * 
 * \param marker list of markers of the multi-marker pattern
 * \param marker_num number of markers used
 * \param trans position of the multi-marker pattern (more precisely, the camera position in the multi-marker CS)
 * \param prevF boolean flag for visibility
 * \param transR last position
+* \param work scratch memory of arMultiGetTransMat (allocated on first use,
+*             released by arMultiFreeConfig); must be NULL in a structure
+*             not from arMultiReadConfigFile
+* \param work_num number of markers the scratch memory is sized for
+* \param patt_index pattern id to index of the first board marker using
+*             it (-1 if none), built by arMultiReadConfigFile; a structure
+*             built by hand leaves it NULL, and the markers are then
+*             looked up by a scan of the board. A non-NULL table is freed
+*             by arMultiFreeConfig
+* \param patt_index_num number of entries of patt_index
 */
 typedef struct {
     ARMultiEachMarkerInfoT  *marker;
@@ -89,6 +107,11 @@ typedef struct {
     int                     prevF;
 /*---*/
     double                  transR[3][4];
+/*---*/
+    void                    *work;
+    int                     work_num;
+    int                     *patt_index;
+    int                     patt_index_num;
 } ARMultiMarkerInfoT;
 
 // ============================================================================
@@ -124,6 +147,59 @@ ARMultiMarkerInfoT *arMultiReadConfigFile( const char *filename );
 double  arMultiGetTransMat(ARMarkerInfo *marker_info, int marker_num,
                            ARMultiMarkerInfoT *config);
 
+/**
+* \brief compute the positions of several multi-marker boards at once.
+*
+* Equivalent, up to rounding, to calling arMultiGetTransMat() on each
+* board in turn with the same detection list, but the single-marker pose
+* of a detection used by several boards is computed only once, and both
+* the single-marker poses and the boards are solved in parallel on the
+* shared worker pool (see arThread.h). A board that gives the pattern
+* another width or center than the first one gets that pose scaled and
+* shifted rather than solved again, so its result may differ from the
+* sequential one in the last digits.
+*
+* Boards may share patterns. As with successive calls, the verification
+* of a board tracked in the previous frame may relabel or turn detections
+* for the boards after it, and each board is solved with the detections
+* as they were after its own verification.
+*
+* \param marker_info list of detected markers (from arDetectMarker)
+* \param marker_num number of detected markers
+* \param config array of config_num boards
+* \param config_num number of boards
+* \param err array of config_num fitting errors (output), -1 for a board
+*            that was not found
+* \param visible array of config_num counts of board markers used for
+*            the pose (output, may be NULL)
+* \return 0 if success, -1 if error
+*/
+int     arMultiGetTransMatSet(ARMarkerInfo *marker_info, int marker_num,
+                              ARMultiMarkerInfoT **config, int config_num,
+                              double *err, int *visible);
+
+/**
+* \brief outlier-robust version of arMultiGetTransMat.
+*
+* Each visible marker of the board (largest first, at most a fixed
+* number of them) gives a board pose hypothesis through its single-marker
+* pose; the previous board pose is tried first when available. A
+* hypothesis is scored by reprojecting all visible board markers, the
+* ones within a few pixels being its inliers, and the search stops early
+* once most markers agree. The best hypothesis is then refined on its
+* inliers only. Misidentified markers are thus ignored instead of
+* skewing the pose, and the cost per frame is bounded.
+*
+* On return config->marker[i].visible is -1 for markers that were not
+* detected or rejected as outliers.
+* \param marker_info list of detected markers (from arDetectMarker)
+* \param marker_num number of detected markers
+* \param config the multi-marker board
+* \return the fitting error of the refined pose, -1 if the board was not found
+*/
+double  arMultiGetTransMatRobust(ARMarkerInfo *marker_info, int marker_num,
+                                 ARMultiMarkerInfoT *config);
+
 /**
 * \brief activate a multi-marker pattern on the recognition procedure.
 *
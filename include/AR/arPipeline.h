@@ -0,0 +1,188 @@
+/*  --------------------------------------------------------------------------
+*   Copyright (C) 2004 Hitlab NZ.
+*   The distribution policy is describe on the Copyright.txt furnish
+*    with this library.
+*   -------------------------------------------------------------------------*/
+/**
+*  \file arPipeline.h
+*  \brief ARToolkit frame pipeline over several threads.
+*
+*  This file runs the detection of a stream of frames as a pipeline, for
+*  throughput rather than latency (offline processing of recordings,
+*  servers). Each frame goes through four stages:
+*  - capture:  the application's source fills the frame (capture, color
+*              conversion)
+*  - label:    arLabeling and arDetectMarker2, i.e. the candidate squares
+*  - identify: arGetMarkerInfoParallel, lines and pattern matching
+*  - pose:     arGetTransMat of the best marker of every pattern, then the
+*              application's sink
+*
+*  The stages are spread over the threads of a private pool (see
+*  arThread.h), so that while frame N is labeled, frame N+1 is captured
+*  and frame N-1 identified. The frames in flight are held in a ring of
+*  buffers: a stage waits for the previous one to hand a frame over, and
+*  the source waits for a buffer to be free again, so a slow stage holds
+*  the others back instead of letting frames pile up.
+*
+*  Every stage processes the frames in order, so the sink sees them in
+*  the order of the source, and the result of a frame is the one of
+*  arDetectMarkerLite and arGetTransMat on that frame alone, whatever the
+*  number of threads.
+*
+*   \remark the threshold given to arPipelineRun() is used for every
+*   frame: arThresholdMode is not applied, the automatic threshold of a
+*   frame depending on the markers of the previous one. The pipeline uses
+*   the library's detection buffers: while it runs, the application must
+*   not detect markers on other threads, nor change the global modes.
+*
+*   History :
+*
+*  \version 1.0
+*  \date 26/10/18
+**/
+/*  --------------------------------------------------------------------------
+*   History :
+*   Rev		Date		Who		Changes
+*
+*----------------------------------------------------------------------------*/
+
+#ifndef AR_PIPELINE_H
+#define AR_PIPELINE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+//	Public includes.
+// ============================================================================
+
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/arPoseStore.h>
+
+// ============================================================================
+//	Public types and defines.
+// ============================================================================
+
+/* stages */
+#define  AR_PIPELINE_STAGE_CAPTURE    0
+#define  AR_PIPELINE_STAGE_LABEL      1
+#define  AR_PIPELINE_STAGE_IDENTIFY   2
+#define  AR_PIPELINE_STAGE_POSE       3
+#define  AR_PIPELINE_STAGE_NUM        4
+
+/** \struct ARPipelineFrame
+* \brief a frame going through the pipeline.
+*
+* \param seq frame number, from 0 in each arPipelineRun()
+* \param time capture time, left to the source (e.g. in seconds, as
+*             ARPoseFrame.time)
+* \param image the frame in the default pixel format. Points to a buffer
+*              of the pipeline of arImXsize*arImYsize*AR_PIX_SIZE_DEFAULT
+*              bytes, that the source fills; the source may instead point
+*              it to its own frame, which must then stay valid until the
+*              sink has been called with it
+* \param user free for the source and the sink
+* \param status 0, -1 if the detection failed (no markers)
+* \param marker_info the markers, as arDetectMarkerLite
+* \param marker_num number of markers
+* \param pose_num number of poses, the number of patterns of the pipeline
+* \param pose pose of each pattern, from its best marker
+* \param stage_time time spent in each stage in milliseconds
+*/
+typedef struct {
+    unsigned long   seq;
+    double          time;
+    ARUint8         *image;
+    void            *user;
+    int             status;
+    ARMarkerInfo    *marker_info;
+    int             marker_num;
+    int             pose_num;
+    ARPose          *pose;
+    double          stage_time[AR_PIPELINE_STAGE_NUM];
+} ARPipelineFrame;
+
+/** \typedef ARPipelineSource
+* \brief capture stage, called for each frame in order.
+*
+* \param arg user argument given to arPipelineRun()
+* \param frame the frame to fill
+* \return 1 if the frame is filled, 0 at the end of the stream, -1 if error
+*/
+typedef int (*ARPipelineSource)( void *arg, ARPipelineFrame *frame );
+
+/** \typedef ARPipelineSink
+* \brief end of the pose stage, called for each frame in order.
+*
+* The frame and its buffers are reused once the sink returns.
+* \param arg user argument given to arPipelineRun()
+* \param frame the frame
+*/
+typedef void (*ARPipelineSink)( void *arg, ARPipelineFrame *frame );
+
+/** \typedef ARPipeline
+* \brief opaque handle to a frame pipeline.
+*/
+typedef struct _ARPipeline ARPipeline;
+
+// ============================================================================
+//	Public functions.
+// ============================================================================
+
+/**
+* \brief create a frame pipeline.
+*
+* Must be called after arInitCparam(), the frame buffers having the size
+* of the camera. With fewer threads than stages, neighbouring stages share
+* a thread; with one thread the frames are processed one after the other.
+* \param thread_num number of threads, calling thread included (1 to
+*                   AR_PIPELINE_STAGE_NUM), or a negative value for one
+*                   per processor
+* \param depth number of frames in flight, at least thread_num; 0 for
+*              thread_num + 1
+* \param patt_num number of patterns to compute the pose of
+* \param patt_id the patterns, as returned by arLoadPatt; copied
+* \param spec center and width of each pattern; copied
+* \return the pipeline, NULL if error
+*/
+ARPipeline *arPipelineCreate( int thread_num, int depth,
+                              int patt_num, int *patt_id, ARPattSpec *spec );
+
+/**
+* \brief release a frame pipeline.
+*
+* \param pipe the pipeline
+* \return 0 if success, -1 if error
+*/
+int arPipelineDestroy( ARPipeline *pipe );
+
+/**
+* \brief number of threads of a pipeline.
+*
+* \param pipe the pipeline
+* \return number of threads, calling thread included, -1 if error
+*/
+int arPipelineGetThreadNum( ARPipeline *pipe );
+
+/**
+* \brief run the frames of a source through the pipeline.
+*
+* Returns once the source has ended and the sink has been called with
+* every frame. The calling thread runs one of the stages. A pipeline runs
+* one stream at a time.
+* \param pipe the pipeline
+* \param thresh binarization threshold
+* \param source capture stage
+* \param sink called with each frame once detected, or NULL
+* \param arg user argument passed to source and sink
+* \return number of frames, -1 if error (the frames before the error
+*         have gone through)
+*/
+long arPipelineRun( ARPipeline *pipe, int thresh,
+                    ARPipelineSource source, ARPipelineSink sink, void *arg );
+
+#ifdef __cplusplus
+}
+#endif
+#endif
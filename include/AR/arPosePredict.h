@@ -0,0 +1,147 @@
+/*  --------------------------------------------------------------------------
+*   Copyright (C) 2004 Hitlab NZ.
+*   The distribution policy is describe on the Copyright.txt furnish
+*    with this library.
+*   -------------------------------------------------------------------------*/
+/**
+*  \file arPosePredict.h
+*  \brief ARToolkit pose prediction.
+*
+*  This file extrapolates the poses found by arGetTransMat or
+*  arMultiGetTransMat to a later time, typically the time the frame being
+*  rendered will reach the display. A pose is tens of milliseconds old
+*  when it is drawn (capture, detection, pose, rendering, buffer swap);
+*  on a moving marker the object then trails the marker by that much.
+*
+*  A predictor keeps, for each pose, the last poses with their capture
+*  times: AR_POSE_PREDICT_CV_WINDOW of them for the constant velocity
+*  model, AR_POSE_PREDICT_CA_WINDOW for the constant acceleration one.
+*  The motion between them is expressed as twists (angular and linear
+*  velocity, in the camera frame) relative to the latest pose, and fitted
+*  by least squares with the model. The prediction is the
+*  latest pose moved along the fitted twist, i.e. a screw motion on SE(3):
+*  rotation and translation stay coupled, and the result is a rotation
+*  matrix again.
+*
+*  The history of a pose is restarted when it has not been seen for
+*  AR_POSE_PREDICT_GAP_MAX seconds, and predictions are not made further
+*  than AR_POSE_PREDICT_MAX_TIME seconds ahead of the latest pose.
+*
+*   \remark with a video see-through display the video frame is as late as
+*   the pose it was tracked in; predicting the pose alone moves the object
+*   ahead of the video. Prediction pays off when the background is newer
+*   than the tracked frame, or with optical see-through displays.
+*
+*   History :
+*
+*  \version 1.0
+*  \date 26/10/18
+**/
+/*  --------------------------------------------------------------------------
+*   History :
+*   Rev		Date		Who		Changes
+*
+*----------------------------------------------------------------------------*/
+
+#ifndef AR_POSE_PREDICT_H
+#define AR_POSE_PREDICT_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+//	Public includes.
+// ============================================================================
+
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/arPoseStore.h>
+
+// ============================================================================
+//	Public types and defines.
+// ============================================================================
+
+/* motion models */
+#define  AR_POSE_PREDICT_CONSTANT_VELOCITY       0
+#define  AR_POSE_PREDICT_CONSTANT_ACCELERATION   1
+
+/** \typedef ARPosePredict
+* \brief opaque handle to a pose predictor.
+*/
+typedef struct _ARPosePredict ARPosePredict;
+
+// ============================================================================
+//	Public functions.
+// ============================================================================
+
+/**
+* \brief create a pose predictor.
+*
+* \param pose_num number of poses predicted (patterns, boards or objects,
+*                 numbered as in the application's ARPoseFrame)
+* \param model AR_POSE_PREDICT_CONSTANT_VELOCITY or
+*              AR_POSE_PREDICT_CONSTANT_ACCELERATION
+* \return the predictor, NULL if error
+*/
+ARPosePredict *arPosePredictCreate( int pose_num, int model );
+
+/**
+* \brief release a pose predictor.
+*
+* \param pred the predictor
+* \return 0 if success, -1 if error
+*/
+int arPosePredictDestroy( ARPosePredict *pred );
+
+/**
+* \brief add a measured pose to the history.
+*
+* Poses not newer than the latest one of the history are ignored.
+* \param pred the predictor
+* \param index number of the pose
+* \param conv the pose, as given by arGetTransMat
+* \param time capture time of the frame in seconds
+* \return 0 if success, -1 if error
+*/
+int arPosePredictAdd( ARPosePredict *pred, int index, double conv[3][4], double time );
+
+/**
+* \brief add the visible poses of a frame to the history.
+*
+* Pose i of the frame is added as pose i of the predictor. A frame
+* already added is ignored, so that a rendering loop may call this with
+* every frame returned by arPoseStoreGetLatest().
+* \param pred the predictor
+* \param frame the frame
+* \return 0 if success, -1 if error
+*/
+int arPosePredictAddFrame( ARPosePredict *pred, ARPoseFrame *frame );
+
+/**
+* \brief forget the history of a pose.
+*
+* \param pred the predictor
+* \param index number of the pose, -1 for all of them
+* \return 0 if success, -1 if error
+*/
+int arPosePredictReset( ARPosePredict *pred, int index );
+
+/**
+* \brief pose predicted at a given time.
+*
+* With a single pose in the history, or fewer than three for the constant
+* acceleration model, the lower order model is used.
+* \param pred the predictor
+* \param index number of the pose
+* \param time time of the prediction in seconds, on the clock of the
+*             capture times (e.g. arStatsGetTime()*1.0e-9 plus the
+*             expected display latency)
+* \param conv the predicted pose
+* \return 0 if success, -1 if there is no history of the pose
+*/
+int arPosePredictGet( ARPosePredict *pred, int index, double time, double conv[3][4] );
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,148 @@
+/*  --------------------------------------------------------------------------
+*   Copyright (C) 2004 Hitlab NZ.
+*   The distribution policy is describe on the Copyright.txt furnish
+*    with this library.
+*   -------------------------------------------------------------------------*/
+/**
+*  \file arPoseStore.h
+*  \brief ARToolkit pose publication between threads.
+*
+*  This file lets a tracking thread (capture, arDetectMarker,
+*  arGetTransMat, arMultiGetTransMat) hand its results to a rendering
+*  thread without either of them waiting for the other. A store holds
+*  the poses of one frame (one per pattern, board or object, as the
+*  application numbers them), the frame number and capture time, and
+*  optionally a copy of the frame itself, so that the video background
+*  and the objects drawn over it always come from the same frame.
+*
+*  The store is a triple buffer: the tracking thread fills one frame
+*  while the rendering thread draws another, and the third holds the
+*  latest one published. Publishing and getting the latest frame are one
+*  atomic exchange each; neither call blocks or retries.
+*
+*   \remark one thread writes, one thread reads. The frame returned to
+*   the reader stays valid until its next call of arPoseStoreGetLatest().
+*
+*   History :
+*
+*  \version 1.0
+*  \date 26/10/18
+**/
+/*  --------------------------------------------------------------------------
+*   History :
+*   Rev		Date		Who		Changes
+*
+*----------------------------------------------------------------------------*/
+
+#ifndef AR_POSE_STORE_H
+#define AR_POSE_STORE_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+//	Public includes.
+// ============================================================================
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+// ============================================================================
+//	Public types and defines.
+// ============================================================================
+
+/** \struct ARPose
+* \brief pose of one pattern or board in a frame.
+*
+* \param conv transformation from the pattern (or board) to the camera
+* \param cf confidence, as ARMarkerInfo.cf (for boards, as the
+*           application defines it)
+* \param err fitting error returned by arGetTransMat or arMultiGetTransMat
+* \param visible 1 if found in the frame, 0 otherwise (the other fields
+*                are then meaningless)
+*/
+typedef struct {
+    double      conv[3][4];
+    double      cf;
+    double      err;
+    int         visible;
+} ARPose;
+
+/** \struct ARPoseFrame
+* \brief poses of one frame.
+*
+* \param seq frame number
+* \param time capture time of the frame in seconds, on the clock of
+*             arStatsGetTime() (as ARVideoFrameInfoT.time)
+* \param pose_num number of poses
+* \param pose the poses
+* \param image copy of the frame, NULL if the store keeps none
+*/
+typedef struct {
+    unsigned long   seq;
+    double          time;
+    int             pose_num;
+    ARPose          *pose;
+    ARUint8         *image;
+} ARPoseFrame;
+
+/** \typedef ARPoseStore
+* \brief opaque handle to a pose store.
+*/
+typedef struct _ARPoseStore ARPoseStore;
+
+// ============================================================================
+//	Public functions.
+// ============================================================================
+
+/**
+* \brief create a pose store.
+*
+* \param pose_num number of poses per frame
+* \param image_size size in bytes of the frames to keep with the poses
+*                   (e.g. xsize*ysize*AR_PIX_SIZE_DEFAULT), 0 for none
+* \return the store, NULL if error
+*/
+ARPoseStore *arPoseStoreCreate( int pose_num, int image_size );
+
+/**
+* \brief release a pose store.
+*
+* \param store the store
+* \return 0 if success, -1 if error
+*/
+int arPoseStoreDestroy( ARPoseStore *store );
+
+/**
+* \brief frame for the writer to fill.
+*
+* The poses are marked not visible; seq, time and the image are left to
+* the writer. The frame belongs to the writer until arPoseStorePublish().
+* \param store the store
+* \return the frame, NULL if error
+*/
+ARPoseFrame *arPoseStoreGetBuffer( ARPoseStore *store );
+
+/**
+* \brief make the frame of arPoseStoreGetBuffer() the latest one.
+*
+* A frame published before and not yet read is dropped.
+* \param store the store
+* \return 0 if success, -1 if error
+*/
+int arPoseStorePublish( ARPoseStore *store );
+
+/**
+* \brief latest frame published, for the reader.
+*
+* Returns the frame last published, or the same frame as the previous
+* call when nothing has been published since. Never waits for the writer.
+* \param store the store
+* \return the frame, NULL if nothing has been published yet
+*/
+ARPoseFrame *arPoseStoreGetLatest( ARPoseStore *store );
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,180 @@
+/*  --------------------------------------------------------------------------
+*   Copyright (C) 2004 Hitlab NZ.
+*   The distribution policy is describe on the Copyright.txt furnish
+*    with this library.
+*   -------------------------------------------------------------------------*/
+/**
+*  \file arQuality.h
+*  \brief ARToolkit detection quality control under a frame time budget.
+*
+*  This file switches the detection settings at run time so that the
+*  processing of a frame (detection, pose, whatever the application puts
+*  between arQualityFrameStart() and arQualityFrameEnd()) stays within a
+*  time budget, and uses the most accurate settings the budget allows.
+*
+*  The settings form a ladder of levels, from the most accurate (0) to
+*  the cheapest. The default ladder is:
+*  - 0 "full/color":      full resolution, color matching
+*  - 1 "full/bw":         full resolution, black and white matching
+*  - 2 "half/bw":         half resolution, black and white matching
+*  - 3 "half/bw/roi":     as 2, with a full detection every
+*                         AR_QUALITY_TRACK_INTERVAL frames only and the
+*                         markers tracked around their last position in
+*                         between (arTrackMarker)
+*
+*  There is no PCA level: arLoadPatt() does not build the eigenvectors
+*  of the patterns, so AR_MATCHING_WITH_PCA matches as without it.
+*
+*  The controller keeps the frame time of each level, smoothed by
+*  AR_QUALITY_COST_SMOOTH. It goes one level down when
+*  AR_QUALITY_DOWN_FRAMES frames in a row are over the budget, unless the
+*  level below has been slower than the current one (tracking, for
+*  instance, costs more than it saves when the markers are often lost);
+*  it then goes back up if the level above was faster.
+*  It goes one level up when AR_QUALITY_UP_FRAMES frames in a row take
+*  less than AR_QUALITY_UP_RATIO of the budget and the level above was
+*  within the budget. A level passed over for its cost has that cost
+*  multiplied by AR_QUALITY_COST_DECAY every AR_QUALITY_UP_FRAMES frames,
+*  so that it is tried again once the scene has changed. The gap between
+*  the two thresholds keeps the controller from switching back and forth.
+*
+*   \remark the levels are applied through the global modes
+*   (arImageProcMode, arTemplateMatchingMode, arMatchingPCAMode,
+*   arThresholdMode, arTrackInterval): one controller per thread doing
+*   detection. The application detects with arTrackMarker for the
+*   tracked levels to have an effect; with arDetectMarker they are the
+*   same as the level above.
+*
+*   History :
+*
+*  \version 1.0
+*  \date 26/10/18
+**/
+/*  --------------------------------------------------------------------------
+*   History :
+*   Rev		Date		Who		Changes
+*
+*----------------------------------------------------------------------------*/
+
+#ifndef AR_QUALITY_H
+#define AR_QUALITY_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+//	Public includes.
+// ============================================================================
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+// ============================================================================
+//	Public types and defines.
+// ============================================================================
+
+/** \struct ARQualityConfig
+* \brief detection settings of a level.
+*
+* \param name name of the level, for reports
+* \param image_proc_mode value of arImageProcMode
+* \param template_matching_mode value of arTemplateMatchingMode
+* \param matching_pca_mode value of arMatchingPCAMode
+* \param threshold_mode value of arThresholdMode, -1 to leave it as it is
+* \param track_interval value of arTrackInterval (1: full detection of
+*                       every frame)
+*/
+typedef struct {
+    char    *name;
+    int     image_proc_mode;
+    int     template_matching_mode;
+    int     matching_pca_mode;
+    int     threshold_mode;
+    int     track_interval;
+} ARQualityConfig;
+
+/** \struct ARQualityFrame
+* \brief report of one frame.
+*
+* \param level level the frame ran with
+* \param config settings the frame ran with, threshold_mode as applied
+* \param time time between arQualityFrameStart() and arQualityFrameEnd()
+*             in milliseconds
+* \param next level of the next frame
+*/
+typedef struct {
+    int               level;
+    ARQualityConfig   config;
+    double            time;
+    int               next;
+} ARQualityFrame;
+
+/** \typedef ARQuality
+* \brief opaque handle to a quality controller.
+*/
+typedef struct _ARQuality ARQuality;
+
+// ============================================================================
+//	Public functions.
+// ============================================================================
+
+/**
+* \brief create a quality controller.
+*
+* The first frame runs with level 0.
+* \param budget time budget of a frame in milliseconds
+* \param level the levels, most accurate first, or NULL for the default
+*              ladder; copied
+* \param level_num number of levels (ignored if level is NULL)
+* \return the controller, NULL if error
+*/
+ARQuality *arQualityCreate( double budget, ARQualityConfig *level, int level_num );
+
+/**
+* \brief release a quality controller.
+*
+* The global modes keep the values of the last level applied.
+* \param q the controller
+* \return 0 if success, -1 if error
+*/
+int arQualityDestroy( ARQuality *q );
+
+/**
+* \brief change the time budget.
+*
+* \param q the controller
+* \param budget time budget of a frame in milliseconds
+* \return 0 if success, -1 if error
+*/
+int arQualitySetBudget( ARQuality *q, double budget );
+
+/**
+* \brief apply the settings of the current level and start timing a frame.
+*
+* \param q the controller
+* \return the level applied, -1 if error
+*/
+int arQualityFrameStart( ARQuality *q );
+
+/**
+* \brief stop timing the frame and choose the level of the next one.
+*
+* \param q the controller
+* \param frame report of the frame, or NULL
+* \return the level of the next frame, -1 if error
+*/
+int arQualityFrameEnd( ARQuality *q, ARQualityFrame *frame );
+
+/**
+* \brief settings of a level.
+*
+* \param q the controller
+* \param level the level
+* \return the settings, NULL if there is no such level
+*/
+ARQualityConfig *arQualityGetConfig( ARQuality *q, int level );
+
+#ifdef __cplusplus
+}
+#endif
+#endif
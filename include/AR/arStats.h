@@ -0,0 +1,180 @@
+/*  --------------------------------------------------------------------------
+*   Copyright (C) 2004 Hitlab NZ.
+*   The distribution policy is describe on the Copyright.txt furnish
+*    with this library.
+*   -------------------------------------------------------------------------*/
+/**
+*  \file arStats.h
+*  \brief ARToolkit per-stage instrumentation.
+*
+*  This file provides timing and event counters for the stages of the
+*  detection and pose pipeline. Each thread records into its own ring of
+*  the last AR_STATS_RING_SIZE timings per stage, without locks;
+*  arGetStats() merges the rings of all threads and reports rolling
+*  percentiles over that window.
+*
+*  The instrumentation is compiled in when AR_STATS is defined in
+*  config.h, and records only while arStatsMode is AR_STATS_ENABLE.
+*  When disabled, each probe costs a test of arStatsMode.
+*
+*   History :
+*
+*  \version 1.0
+*  \date 26/10/18
+**/
+/*  --------------------------------------------------------------------------
+*   History :
+*   Rev		Date		Who		Changes
+*
+*----------------------------------------------------------------------------*/
+
+#ifndef AR_STATS_H
+#define AR_STATS_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+//	Public includes.
+// ============================================================================
+
+#include <AR/config.h>
+
+// ============================================================================
+//	Public types and defines.
+// ============================================================================
+
+/* timing stages */
+#define  AR_STATS_LABELING          0   /* thresholding and labeling         */
+#define  AR_STATS_CANDIDATE         1   /* candidate filtering (arDetectMarker2,
+                                           includes contour and square check;
+                                           the whole pass, labeling included,
+                                           of arDetectMarker2Incremental) */
+#define  AR_STATS_CONTOUR           2   /* arGetContour                      */
+#define  AR_STATS_CHECK_SQUARE      3   /* corner extraction (check_square)  */
+#define  AR_STATS_GET_LINE          4   /* arGetLine / arsGetLine            */
+#define  AR_STATS_GET_PATT          5   /* arGetPatt                         */
+#define  AR_STATS_PATTERN_MATCH     6   /* template matching                 */
+#define  AR_STATS_POSE              7   /* arGetTransMat                     */
+#define  AR_STATS_STAGE_NUM         8
+
+/* event counters */
+#define  AR_STATS_CONTOUR_NO_START  0   /* no start pixel on the clip line   */
+#define  AR_STATS_CONTOUR_OPEN      1   /* contour tracing hit a dead end    */
+#define  AR_STATS_CONTOUR_TOO_LONG  2   /* contour longer than AR_CHAIN_MAX  */
+#define  AR_STATS_COUNTER_NUM       3
+
+/* number of timings kept per stage and per thread */
+#define  AR_STATS_RING_SIZE         1024
+
+#ifdef _WIN32
+typedef unsigned __int64    ARStatsTime;
+#else
+typedef unsigned long long  ARStatsTime;
+#endif
+
+/** \struct ARStatsStage
+* \brief timing summary of one stage.
+*
+* All times are in nanoseconds, over the last AR_STATS_RING_SIZE calls
+* of the stage on each thread.
+* \param count number of timings in the window
+* \param total total number of calls since the last reset
+* \param mean mean time
+* \param p50 median time
+* \param p95 95th percentile
+* \param p99 99th percentile
+* \param max maximum time
+*/
+typedef struct {
+    int            count;
+    unsigned long  total;
+    double         mean;
+    double         p50;
+    double         p95;
+    double         p99;
+    double         max;
+} ARStatsStage;
+
+/** \struct ARStats
+* \brief snapshot returned by arGetStats().
+*
+* \param stage timing summary per stage (AR_STATS_LABELING...)
+* \param counter event counts since the last reset (AR_STATS_CONTOUR_NO_START...)
+*/
+typedef struct {
+    ARStatsStage   stage[AR_STATS_STAGE_NUM];
+    unsigned long  counter[AR_STATS_COUNTER_NUM];
+} ARStats;
+
+/** \var int arStatsMode
+* \brief enable the instrumentation.
+*
+* the possible values are :
+* -AR_STATS_DISABLE: probes return immediately
+* -AR_STATS_ENABLE: probes record timings and counts
+* by default: DEFAULT_STATS_MODE in config.h
+*/
+extern int      arStatsMode;
+
+#ifdef AR_STATS
+#  define AR_STATS_VAR(t)           ARStatsTime t = 0
+#  define AR_STATS_START(t)         ((t) = (arStatsMode? arStatsGetTime(): 0))
+#  define AR_STATS_STOP(stage,t)    do { if( arStatsMode && (t) ) arStatsAddTime( (stage), arStatsGetTime() - (t) ); } while(0)
+#  define AR_STATS_COUNT(counter)   do { if( arStatsMode ) arStatsAddCount( (counter) ); } while(0)
+#else
+#  define AR_STATS_VAR(t)           int t
+#  define AR_STATS_START(t)         ((t) = 0)
+#  define AR_STATS_STOP(stage,t)    do { } while(0)
+#  define AR_STATS_COUNT(counter)   do { } while(0)
+#endif
+
+// ============================================================================
+//	Public functions.
+// ============================================================================
+
+/**
+* \brief current time of a monotonic clock.
+*
+* \return time in nanoseconds from an arbitrary origin
+*/
+ARStatsTime arStatsGetTime( void );
+
+/**
+* \brief record one timing of a stage on the calling thread.
+*
+* Normally called through AR_STATS_STOP().
+* \param stage stage (AR_STATS_LABELING...)
+* \param time elapsed time in nanoseconds
+*/
+void arStatsAddTime( int stage, ARStatsTime time );
+
+/**
+* \brief increment an event counter on the calling thread.
+*
+* Normally called through AR_STATS_COUNT().
+* \param counter counter (AR_STATS_CONTOUR_NO_START...)
+*/
+void arStatsAddCount( int counter );
+
+/**
+* \brief get the statistics of all threads.
+*
+* Rings are read while other threads may be writing to them, so a
+* snapshot can mix timings from consecutive calls of a stage.
+* \param stats the snapshot (output)
+* \return 0 if success, -1 if the instrumentation is not compiled in
+*/
+int arGetStats( ARStats *stats );
+
+/**
+* \brief clear the timings and counters of all threads.
+*
+* Must not be called while detection runs on another thread.
+*/
+void arResetStats( void );
+
+#ifdef __cplusplus
+}
+#endif
+#endif
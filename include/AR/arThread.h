@@ -0,0 +1,122 @@
+/*  --------------------------------------------------------------------------
+*   Copyright (C) 2004 Hitlab NZ.
+*   The distribution policy is describe on the Copyright.txt furnish
+*    with this library.
+*   -------------------------------------------------------------------------*/
+/**
+*  \file arThread.h
+*  \brief ARToolkit worker thread subroutines.
+*
+*  This file provides a small persistent worker pool used by the
+*  parallel entry points of the AR libraries (e.g. arGetTransMatBatch()).
+*  Work is expressed as a parallel loop over an index range: the calling
+*  thread and the pool workers pull indices until the range is exhausted,
+*  and the call returns once every index has been processed.
+*
+*   \remark a pool executes one loop at a time. A loop started while the
+*   pool is busy (including from inside one of its own workers) is run
+*   serially on the calling thread.
+*
+*   History :
+*
+*  \version 1.0
+*  \date 26/10/18
+**/
+/*  --------------------------------------------------------------------------
+*   History :
+*   Rev		Date		Who		Changes
+*
+*----------------------------------------------------------------------------*/
+
+#ifndef AR_THREAD_H
+#define AR_THREAD_H
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+//	Public includes.
+// ============================================================================
+
+#include <AR/config.h>
+
+// ============================================================================
+//	Public types and defines.
+// ============================================================================
+
+/** \typedef ARThreadPool
+* \brief opaque handle to a persistent worker pool.
+*/
+typedef struct _ARThreadPool ARThreadPool;
+
+/** \typedef ARThreadPoolFunc
+* \brief loop body executed by arThreadPoolRun().
+*
+* \param arg user argument given to arThreadPoolRun()
+* \param index index of the item to process, in [0, num)
+*/
+typedef void (*ARThreadPoolFunc)( void *arg, int index );
+
+// ============================================================================
+//	Public functions.
+// ============================================================================
+
+/**
+* \brief number of processors available to the process.
+*
+* \return number of online processors (at least 1)
+*/
+int arThreadGetCPUNum( void );
+
+/**
+* \brief create a persistent worker pool.
+*
+* The calling thread of arThreadPoolRun() always takes part in the loop,
+* so a pool created with thread_num threads runs thread_num+1 items in
+* parallel.
+* \param thread_num number of worker threads, or a negative value to
+*                   use (number of processors - 1)
+* \return the pool, NULL if error
+*/
+ARThreadPool *arThreadPoolCreate( int thread_num );
+
+/**
+* \brief get the shared pool used by the library entry points.
+*
+* The pool is created on first use with one worker per additional
+* processor and lives until the process exits.
+* \return the shared pool, NULL if it could not be created
+*/
+ARThreadPool *arThreadPoolGetDefault( void );
+
+/**
+* \brief number of worker threads in a pool.
+*
+* \param pool the pool (NULL is accepted and counts as 0)
+* \return number of worker threads, not counting the calling thread
+*/
+int arThreadPoolGetThreadNum( ARThreadPool *pool );
+
+/**
+* \brief run func(arg, i) for every i in [0, num) and wait for completion.
+*
+* \param pool the pool, or NULL to run serially on the calling thread
+* \param func loop body
+* \param arg user argument passed to every call
+* \param num number of items
+* \return 0 if the loop ran on the pool, 1 if it ran serially, -1 if error
+*/
+int arThreadPoolRun( ARThreadPool *pool, ARThreadPoolFunc func, void *arg, int num );
+
+/**
+* \brief stop the workers of a pool and release it.
+*
+* \param pool the pool to destroy
+* \return 0 if success, -1 if error
+*/
+int arThreadPoolDestroy( ARThreadPool *pool );
+
+#ifdef __cplusplus
+}
+#endif
+#endif
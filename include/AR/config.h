@@ -61,11 +61,12 @@
 
 /*--------------------------------------------------------------*/
 /*                                                              */
-/*  For Linux, you should define one of below 4 input method    */
+/*  For Linux, you should define one of below 5 input method    */
 /*    AR_INPUT_V4L:       use of standard Video4Linux Library   */
 /*    AR_INPUT_GSTREAMER: use of GStreamer Media Framework      */
 /*    AR_INPUT_DV:        use of DV Camera                      */
 /*    AR_INPUT_1394CAM:   use of 1394 Digital Camera            */
+/*    AR_INPUT_FILE:      use of recorded frames (raw/Y4M/PPM)  */
 /*                                                              */
 /*--------------------------------------------------------------*/
 #ifdef __linux
@@ -73,6 +74,7 @@
 #undef  AR_INPUT_DV
 #undef  AR_INPUT_1394CAM
 #undef  AR_INPUT_GSTREAMER
+#undef  AR_INPUT_FILE
 
 #  ifdef AR_INPUT_V4L
 #    ifdef USE_EYETOY
@@ -94,6 +96,10 @@
 #    define  AR_DEFAULT_PIXEL_FORMAT AR_PIXEL_FORMAT_RGB
 #  endif
 
+#  ifdef AR_INPUT_FILE
+#    define  AR_DEFAULT_PIXEL_FORMAT AR_PIXEL_FORMAT_RGB
+#  endif
+
 #  undef   AR_BIG_ENDIAN
 #  define  AR_LITTLE_ENDIAN
 #endif
@@ -149,6 +155,26 @@
 #define  AR_MATCHING_WITH_PCA         1
 #define  DEFAULT_TEMPLATE_MATCHING_MODE     AR_TEMPLATE_MATCHING_COLOR
 #define  DEFAULT_MATCHING_PCA_MODE          AR_MATCHING_WITHOUT_PCA
+#define  AR_PRECISION_DOUBLE          0
+#define  AR_PRECISION_FLOAT           1
+#define  DEFAULT_PRECISION_MODE             AR_PRECISION_DOUBLE
+#define  AR_STATS_DISABLE             0
+#define  AR_STATS_ENABLE              1
+#define  DEFAULT_STATS_MODE                 AR_STATS_DISABLE
+#define  AR_THRESHOLD_MODE_MANUAL       0
+#define  AR_THRESHOLD_MODE_AUTO_OTSU    1
+#define  AR_THRESHOLD_MODE_AUTO_MARKER  2
+#define  DEFAULT_THRESHOLD_MODE             AR_THRESHOLD_MODE_MANUAL
+#define  AR_INCREMENTAL_DISABLE       0
+#define  AR_INCREMENTAL_ENABLE        1
+#define  DEFAULT_INCREMENTAL_MODE           AR_INCREMENTAL_DISABLE
+#define  AR_LUMA_ON_DEMAND            0
+#define  AR_LUMA_SHARED               1
+#define  DEFAULT_LUMA_MODE                  AR_LUMA_ON_DEMAND
+#define  DEFAULT_TRACK_INTERVAL             10
+
+/* compile in the per-stage instrumentation of arStats.h */
+#define  AR_STATS
 
 
 #ifdef __linux
@@ -230,6 +256,34 @@
 #define   AR_AREA_MAX      100000
 #define   AR_AREA_MIN          70
 
+#define   AR_THRESH_HIST_SIZE         (255*3+1)
+#define   AR_THRESH_HIST_STEP           4
+#define   AR_THRESH_ROI_SAMPLE_MIN    100
+
+#define   AR_MARKER_INFO_THREAD_MIN     4
+
+#define   AR_TILE_SIZE         32
+
+#define   AR_TRACK_LEVEL_NUM            3
+#define   AR_TRACK_WINDOW               5
+#define   AR_TRACK_SEARCH              48
+#define   AR_TRACK_ITERATION_MAX       10
+#define   AR_TRACK_EIGEN_MIN          4.0
+#define   AR_TRACK_ERROR_MAX         24.0
+#define   AR_TRACK_BACK_ERROR_MAX     1.0
+
+#define   AR_POSE_PREDICT_CV_WINDOW     4
+#define   AR_POSE_PREDICT_CA_WINDOW     8
+#define   AR_POSE_PREDICT_MAX_TIME    0.1
+#define   AR_POSE_PREDICT_GAP_MAX     0.2
+
+#define   AR_QUALITY_DOWN_FRAMES        2
+#define   AR_QUALITY_UP_FRAMES         30
+#define   AR_QUALITY_UP_RATIO         0.7
+#define   AR_QUALITY_COST_SMOOTH      0.25
+#define   AR_QUALITY_COST_DECAY       0.9
+#define   AR_QUALITY_TRACK_INTERVAL     5
+
 
 #define   AR_SQUARE_MAX        30
 #define   AR_CHAIN_MAX      10000
@@ -156,6 +156,21 @@ int arParamIdeal2Observ( const double dist_factor[4], const double ix, const dou
 int arParamObserv2Ideal( const double dist_factor[4], const double ox, const double oy,
                          double *ix, double *iy );
 
+/** \fn int arParamObserv2Idealf( const float dist_factor[4], const float ox, const float oy,
+                         float *ix, float *iy )
+* \brief single precision version of arParamObserv2Ideal.
+*
+* Used by the contour fitting when arPrecisionMode is AR_PRECISION_FLOAT.
+* \param dist_factor distorsion factors of used camera
+* \param ox x in observed screen coordinates
+* \param oy y in observed screen coordinates
+* \param ix resulted x in ideal screen coordinates
+* \param iy resulted y in ideal screen coordinates
+* \return 0 if success, -1 otherwise
+*/
+int arParamObserv2Idealf( const float dist_factor[4], const float ox, const float oy,
+                          float *ix, float *iy );
+
 /** \fn int arParamChangeSize( ARParam *source, int xsize, int ysize, ARParam *newparam )
 * \brief change the camera size parameters.
 *
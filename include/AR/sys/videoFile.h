@@ -0,0 +1,67 @@
+/*******************************************************
+ *
+ * Video input from recorded frames: raw frame dumps,
+ * YUV4MPEG2 (.y4m) streams and PPM/PGM files or
+ * numbered sequences of them.
+ *
+ * Revision: 1.0
+ * Date: 2026/10/18
+ *
+*******************************************************/
+#ifndef AR_VIDEO_FILE_H
+#define AR_VIDEO_FILE_H
+#ifdef  __cplusplus
+extern "C" {
+#endif
+
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include <AR/config.h>
+#include <AR/ar.h>
+
+#define   AR_VIDEO_FILE_RAW         0
+#define   AR_VIDEO_FILE_Y4M         1
+#define   AR_VIDEO_FILE_PNM         2
+
+#define   AR_VIDEO_FILE_Y4M_420     0
+#define   AR_VIDEO_FILE_Y4M_422     1
+#define   AR_VIDEO_FILE_Y4M_444     2
+#define   AR_VIDEO_FILE_Y4M_MONO    3
+
+typedef struct {
+  //file controls
+    char                file[256];
+    int                 type;
+    int                 width;
+    int                 height;
+    int                 format;         /* pixel format of raw frames */
+    int                 y4m_chroma;
+    double              fps;
+    int                 loop;
+    int                 realtime;
+    int                 debug;
+
+  //mapped file (the current file of a PNM sequence)
+    int                 fd;
+    ARUint8             *map;
+    size_t              map_size;
+    int                 map_index;
+    size_t              map_offset;
+
+  //frames
+    int                 frame_num;
+    size_t              frame_size;
+    size_t              *frame_offset;  /* raw and Y4M: offset of each frame in the file */
+    int                 seq_start;      /* PNM sequence: number of the first file */
+    int                 frame_index;    /* next frame to hand out */
+    int                 status;
+    struct timeval      start;
+    ARUint8             *videoBuffer;   /* conversion buffer when not zero copy */
+    ARUint8             *rowBuffer;
+} AR2VideoParamT;
+
+#ifdef  __cplusplus
+}
+#endif
+#endif
@@ -49,6 +49,8 @@ typedef struct {
     int                 video_cont_num;
     ARUint8             *map;
     ARUint8             *videoBuffer;
+    ARUint8             *yuvFrame;      /* YUV420P frame held, not converted yet */
+    int                 yuvConverted;
     struct video_mbuf   vm;
     struct video_mmap   vmm;
 } AR2VideoParamT;
@@ -26,7 +26,8 @@
  *
  *  The actual supported platforms (and the driver/library used) are:
  *  - Windows: with Microsoft DirectShow (VFW obsolete).
- *  - Linux: with Video4Linux library, GStreamer, IEEE1394 camera library and DV camera library.
+ *  - Linux: with Video4Linux library, GStreamer, IEEE1394 camera library and DV camera library,
+ *    or from recorded frames (raw, YUV4MPEG2 and PPM/PGM files).
  *  - Macintosh: with QuickTime.
  *  - SGI: with VL.
  *
@@ -110,6 +111,9 @@ extern "C" {
 #  ifdef  AR_INPUT_GSTREAMER
 #    include <AR/sys/videoGStreamer.h>
 #  endif
+#  ifdef  AR_INPUT_FILE
+#    include <AR/sys/videoFile.h>
+#  endif
 #endif
 
 #ifdef __sgi
@@ -120,6 +124,27 @@ extern "C" {
 #  include <AR/sys/videoMacOSX.h>
 #endif
 
+/**
+ * \brief information on a captured frame.
+ *
+ * \param seq number of the frame since the capture started (first is 1)
+ * \param time capture time in seconds, on a monotonic clock
+ * \param dropped number of captured frames skipped since the previous
+ *        frame returned to the application
+ */
+typedef struct {
+    unsigned long   seq;
+    double          time;
+    int             dropped;
+} ARVideoFrameInfoT;
+
+/**
+ * \brief handle of an asynchronous capture (opaque).
+ */
+typedef struct _AR2VideoAsyncT AR2VideoAsyncT;
+
+#define AR_VIDEO_ASYNC_DEFAULT_BUFFER_NUM   4
+
 // ============================================================================
 //	Public globals.
 // ============================================================================
@@ -332,6 +357,90 @@ AR_DLL_API  ARUint8			*ar2VideoGetImage(AR2VideoParamT *vid);
  */
 AR_DLL_API  int				ar2VideoInqSize(AR2VideoParamT *vid, int *x, int *y);
 
+/*
+	asynchronous capture
+
+	A capture thread pulls frames from the video source into a ring of
+	buffers; the application takes them without waiting on the device.
+	While the asynchronous capture runs, arVideoGetImage()/arVideoCapNext()
+	(or ar2VideoGetImage()/ar2VideoCapNext()) are called by the capture
+	thread only and must not be called by the application.
+	Not available with the Windows DirectShow library.
+*/
+
+/**
+ * \brief start the capture thread on the arVideo* stream.
+ *
+ * Calls arVideoCapStart() and starts capturing into a ring of buffers.
+ * \param buffer_num number of buffers (at least 3), or 0 for
+ *        AR_VIDEO_ASYNC_DEFAULT_BUFFER_NUM
+ * \return 0 if successful, -1 otherwise
+ */
+AR_DLL_API  int				arVideoCapStartAsync(int buffer_num);
+
+/**
+ * \brief stop the capture thread started by arVideoCapStartAsync().
+ *
+ * Also calls arVideoCapStop(). Images returned before are invalidated.
+ * \return 0 if successful, -1 otherwise
+ */
+AR_DLL_API  int				arVideoCapStopAsync(void);
+
+/**
+ * \brief get the most recent captured frame.
+ *
+ * Older frames not yet taken are dropped. Never waits on the device.
+ * The image stays valid until the next successful call of
+ * arVideoGetLatestImage() or arVideoGetNextImage().
+ * \param info frame information (output), may be NULL
+ * \return the image, or NULL if no frame arrived since the last call
+ */
+AR_DLL_API  ARUint8			*arVideoGetLatestImage(ARVideoFrameInfoT *info);
+
+/**
+ * \brief get the oldest captured frame not yet taken.
+ *
+ * Frames are returned in order without drops: once the ring is full,
+ * the capture thread waits for a free buffer instead of overwriting
+ * frames (a live device may then drop frames on its side).
+ * Never waits on the device.
+ * \param info frame information (output), may be NULL
+ * \return the image, or NULL if no frame is waiting
+ */
+AR_DLL_API  ARUint8			*arVideoGetNextImage(ARVideoFrameInfoT *info);
+
+/**
+ * \brief start a capture thread on a video source (multiple video inputs)
+ *
+ * Companion function to arVideoCapStartAsync for multiple video sources.
+ * \param vid a video handle structure for multi-camera grabbing
+ * \param buffer_num number of buffers (at least 3), or 0 for the default
+ * \return the asynchronous capture handle, NULL if error
+ */
+AR_DLL_API  AR2VideoAsyncT	*ar2VideoCapStartAsync(AR2VideoParamT *vid, int buffer_num);
+
+/**
+ * \brief stop a capture thread (multiple video inputs)
+ *
+ * Companion function to arVideoCapStopAsync for multiple video sources.
+ * \param async the asynchronous capture handle, freed by this call
+ */
+AR_DLL_API  int				ar2VideoCapStopAsync(AR2VideoAsyncT *async);
+
+/**
+ * \brief get the most recent captured frame (multiple video inputs)
+ *
+ * Companion function to arVideoGetLatestImage for multiple video sources.
+ */
+AR_DLL_API  ARUint8			*ar2VideoGetLatestImage(AR2VideoAsyncT *async, ARVideoFrameInfoT *info);
+
+/**
+ * \brief get the oldest captured frame not yet taken (multiple video inputs)
+ *
+ * Companion function to arVideoGetNextImage for multiple video sources.
+ */
+AR_DLL_API  ARUint8			*ar2VideoGetNextImage(AR2VideoAsyncT *async, ARVideoFrameInfoT *info);
+
 // Functions added for Studierstube/OpenTracker.
 #ifdef _WIN32
 #  ifndef __MEMORY_BUFFER_HANDLE__
@@ -349,6 +458,64 @@ AR_DLL_API  unsigned char	*ar2VideoLockBuffer(AR2VideoParamT *vid, MemoryBufferH
 AR_DLL_API  int				ar2VideoUnlockBuffer(AR2VideoParamT *vid, MemoryBufferHandle Handle);
 #endif // _WIN32
 
+#ifdef AR_INPUT_V4L
+/**
+ * \brief get the next frame without converting it (YUV420P palette).
+ *
+ * Returns the planes of the frame as captured, to be passed to
+ * arDetectMarkerLuma(). Use arVideoConvertImage() to get the frame in
+ * the default pixel format, e.g. only when it is displayed. The planes
+ * are valid until arVideoCapNext().
+ * \param u U plane, width/2 x height/2 (output, may be NULL)
+ * \param v V plane, width/2 x height/2 (output, may be NULL)
+ * \return the Y plane, width x height, or NULL if no frame is available
+ *         or the palette is not YUV420P
+ */
+AR_DLL_API  ARUint8			*arVideoGetImageYUV(ARUint8 **u, ARUint8 **v);
+
+/**
+ * \brief convert the frame returned by arVideoGetImageYUV().
+ *
+ * The frame is converted to the default pixel format on the first call
+ * only; valid until arVideoCapNext().
+ * \return the converted frame, or NULL if no frame is held
+ */
+AR_DLL_API  ARUint8			*arVideoConvertImage(void);
+
+/**
+ * \brief get the next frame without converting it (YUV420P palette).
+ *
+ * Companion function to arVideoGetImageYUV for multiple video sources.
+ */
+AR_DLL_API  ARUint8			*ar2VideoGetImageYUV(AR2VideoParamT *vid, ARUint8 **u, ARUint8 **v);
+
+/**
+ * \brief convert the frame returned by ar2VideoGetImageYUV().
+ *
+ * Companion function to arVideoConvertImage for multiple video sources.
+ */
+AR_DLL_API  ARUint8			*ar2VideoConvertImage(AR2VideoParamT *vid);
+#endif // AR_INPUT_V4L
+
+#ifdef AR_INPUT_GSTREAMER
+/**
+ * \brief get information on the image returned by arVideoGetImage().
+ *
+ * Valid until arVideoCapNext(). The sequence number counts the buffers
+ * received from the pipeline, time is their arrival time.
+ * \param info frame information (output)
+ * \return 0 if successful, -1 if no image is held
+ */
+AR_DLL_API  int				arVideoInqFrameInfo(ARVideoFrameInfoT *info);
+
+/**
+ * \brief get information on the image returned by ar2VideoGetImage().
+ *
+ * Companion function to arVideoInqFrameInfo for multiple video sources.
+ */
+AR_DLL_API  int				ar2VideoInqFrameInfo(AR2VideoParamT *vid, ARVideoFrameInfoT *info);
+#endif // AR_INPUT_GSTREAMER
+
 #ifdef  __cplusplus
 }
 #endif
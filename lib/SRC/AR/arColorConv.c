@@ -0,0 +1,948 @@
+/*******************************************************
+ *
+ * Color conversion of captured frames.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <AR/ar.h>
+#include <AR/arThread.h>
+#include <AR/arColorConv.h>
+
+#if defined(__AVX2__)
+#  define AR_CC_AVX2
+#  define AR_CC_SSSE3
+#  define AR_CC_SSE2
+#  include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define AR_CC_SSE2
+#  ifdef __SSSE3__
+#    define AR_CC_SSSE3
+#    include <tmmintrin.h>
+#  else
+#    include <emmintrin.h>
+#  endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define AR_CC_NEON
+#  include <arm_neon.h>
+#endif
+
+/* rows are converted in chunks of this many pixels (multiple of 16) */
+#define   CHUNK         256
+
+#define   C_RV          AR_COLOR_CONV_RV
+#define   C_GU          AR_COLOR_CONV_GU
+#define   C_GV          AR_COLOR_CONV_GV
+#define   C_BU          AR_COLOR_CONV_BU
+
+typedef struct {
+    ARUint8     *src;
+    int         src_format;
+    int         width;
+    int         height;
+    ARUint8     *dst;
+    int         dst_format;
+    int         dst_pix;
+    int         band_rows;
+} ConvArg;
+
+typedef struct {
+    ARUint8     *src;
+    int         src_format;
+    int         src_pix;
+    int         width;
+    int         height;
+    ARUint8     *luma;
+    ARUint8     *luma_half;
+    int         band_rows;
+} LumaArg;
+
+static int   get_pix_size( int format );
+static void  convert_band( void *arg, int index );
+static void  convert_row( ConvArg *a, int y );
+static void  put_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst );
+static void  put_rgb_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst );
+static void  put_grey_row( int format, ARUint8 *yp, int n, ARUint8 *dst );
+static void  put_yuv_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst );
+static void  split_422( ARUint8 *src, int yfirst, int n, ARUint8 *yp, ARUint8 *up, ARUint8 *vp );
+static void  luma_band( void *arg, int index );
+static void  luma_row( int format, ARUint8 *src, int n, ARUint8 *dst );
+static void  luma_row_c( int format, ARUint8 *src, int n, ARUint8 *dst );
+static void  even_bytes( ARUint8 *src, int n, ARUint8 *dst );
+
+int arColorConvert( ARUint8 *src, int src_format, int width, int height,
+                    ARUint8 *dst, int dst_format )
+{
+    ConvArg         a;
+    ARThreadPool    *pool;
+    int             band_num;
+
+    if( src_format < AR_COLOR_YUV420P || src_format > AR_COLOR_MONO ) return -1;
+    if( (a.dst_pix = get_pix_size( dst_format )) == 0 ) return -1;
+    if( width <= 0 || height <= 0 ) return -1;
+    if( src_format != AR_COLOR_MONO && (width & 1) ) return -1;
+    if( (src_format == AR_COLOR_YUV411 || src_format == AR_COLOR_YUV420I) && (width & 3) ) return -1;
+    if( (src_format == AR_COLOR_YUV420P || src_format == AR_COLOR_YUV420I) && (height & 1) ) return -1;
+
+    a.src        = src;
+    a.src_format = src_format;
+    a.width      = width;
+    a.height     = height;
+    a.dst        = dst;
+    a.dst_format = dst_format;
+
+    pool = NULL;
+    band_num = 1;
+    if( width * height >= AR_COLOR_CONV_THREAD_MIN ) {
+        pool = arThreadPoolGetDefault();
+        band_num = (arThreadPoolGetThreadNum( pool ) + 1) * 4;
+    }
+    /* bands of an even number of rows, so that 4:2:0 chroma rows are not shared */
+    a.band_rows = ((height + band_num - 1) / band_num + 1) & ~1;
+    band_num = (height + a.band_rows - 1) / a.band_rows;
+
+    if( arThreadPoolRun( pool, convert_band, &a, band_num ) < 0 ) return -1;
+
+    return 0;
+}
+
+int arColorConvertLuma( ARUint8 *src, int src_format, int width, int height,
+                        ARUint8 *luma, ARUint8 *luma_half )
+{
+    LumaArg         a;
+    ARThreadPool    *pool;
+    int             band_num;
+
+    if( (a.src_pix = get_pix_size( src_format )) == 0 ) return -1;
+    if( width <= 0 || height <= 0 ) return -1;
+    if( luma == NULL && luma_half == NULL ) return -1;
+
+    a.src        = src;
+    a.src_format = src_format;
+    a.width      = width;
+    a.height     = height;
+    a.luma       = luma;
+    a.luma_half  = luma_half;
+
+    pool = NULL;
+    band_num = 1;
+    if( width * height >= AR_COLOR_CONV_THREAD_MIN ) {
+        pool = arThreadPoolGetDefault();
+        band_num = (arThreadPoolGetThreadNum( pool ) + 1) * 4;
+    }
+    /* even number of rows, so that every band starts on a row of luma_half */
+    a.band_rows = ((height + band_num - 1) / band_num + 1) & ~1;
+    band_num = (height + a.band_rows - 1) / a.band_rows;
+
+    if( arThreadPoolRun( pool, luma_band, &a, band_num ) < 0 ) return -1;
+
+    return 0;
+}
+
+const char *arColorConvGetSIMD( void )
+{
+#if defined(AR_CC_AVX2)
+    return "AVX2";
+#elif defined(AR_CC_SSSE3)
+    return "SSSE3";
+#elif defined(AR_CC_SSE2)
+    return "SSE2";
+#elif defined(AR_CC_NEON)
+    return "NEON";
+#else
+    return "C";
+#endif
+}
+
+static int get_pix_size( int format )
+{
+    switch( format ) {
+        case AR_PIXEL_FORMAT_RGB:
+        case AR_PIXEL_FORMAT_BGR:
+            return 3;
+        case AR_PIXEL_FORMAT_RGBA:
+        case AR_PIXEL_FORMAT_BGRA:
+        case AR_PIXEL_FORMAT_ABGR:
+        case AR_PIXEL_FORMAT_ARGB:
+            return 4;
+        case AR_PIXEL_FORMAT_2vuy:
+        case AR_PIXEL_FORMAT_yuvs:
+            return 2;
+        case AR_PIXEL_FORMAT_MONO:
+            return 1;
+    }
+    return 0;
+}
+
+static void convert_band( void *arg, int index )
+{
+    ConvArg     *a = (ConvArg *)arg;
+    int         y, y1;
+
+    y1 = (index + 1) * a->band_rows;
+    if( y1 > a->height ) y1 = a->height;
+    for( y = index * a->band_rows; y < y1; y++ ) convert_row( a, y );
+}
+
+/*
+ * Split one source row into Y and chroma (half or full horizontal
+ * resolution), a chunk at a time, and write it out.
+ */
+static void convert_row( ConvArg *a, int y )
+{
+    ARUint8     ybuf[CHUNK], ubuf[CHUNK], vbuf[CHUNK];
+    ARUint8     *row, *yp, *up, *vp, *p, *q;
+    ARUint8     *dst;
+    int         w = a->width;
+    int         x, n, i, full;
+
+    dst = a->dst + (size_t)y * w * a->dst_pix;
+    for( x = 0; x < w; x += n ) {
+        n = (w - x < CHUNK)? w - x: CHUNK;
+        yp = ybuf;
+        up = ubuf;
+        vp = vbuf;
+        full = 0;
+
+        switch( a->src_format ) {
+          case AR_COLOR_YUV420P:
+            row = a->src + (size_t)y * w;
+            yp = row + x;
+            up = a->src + (size_t)w * a->height + (size_t)(y >> 1) * (w >> 1) + (x >> 1);
+            vp = up + (size_t)(w >> 1) * (a->height >> 1);
+            break;
+
+          case AR_COLOR_YUV420I:
+            /* groups of YYYY CC; chroma is U on even lines, V on odd lines */
+            row = a->src + (size_t)y * (w + (w >> 1));
+            p = a->src + (size_t)(y & ~1) * (w + (w >> 1));
+            q = p + w + (w >> 1);
+            for( i = 0; i < n; i += 4 ) {
+                memcpy( ybuf + i, row + (x + i) / 4 * 6, 4 );
+                ubuf[i>>1]     = p[(x + i) / 4 * 6 + 4];
+                ubuf[(i>>1)+1] = p[(x + i) / 4 * 6 + 5];
+                vbuf[i>>1]     = q[(x + i) / 4 * 6 + 4];
+                vbuf[(i>>1)+1] = q[(x + i) / 4 * 6 + 5];
+            }
+            break;
+
+          case AR_COLOR_YUYV:
+            split_422( a->src + ((size_t)y * w + x) * 2, 1, n, ybuf, ubuf, vbuf );
+            break;
+
+          case AR_COLOR_UYVY:
+            split_422( a->src + ((size_t)y * w + x) * 2, 0, n, ybuf, ubuf, vbuf );
+            break;
+
+          case AR_COLOR_YUV411:
+            p = a->src + ((size_t)y * w + x) * 3 / 2;
+            for( i = 0; i < n; i += 4, p += 6 ) {
+                ybuf[i]   = p[1];
+                ybuf[i+1] = p[2];
+                ybuf[i+2] = p[4];
+                ybuf[i+3] = p[5];
+                ubuf[i>>1] = ubuf[(i>>1)+1] = p[0];
+                vbuf[i>>1] = vbuf[(i>>1)+1] = p[3];
+            }
+            break;
+
+          case AR_COLOR_YUV444:
+            p = a->src + ((size_t)y * w + x) * 3;
+            for( i = 0; i < n; i++, p += 3 ) {
+                ubuf[i] = p[0];
+                ybuf[i] = p[1];
+                vbuf[i] = p[2];
+            }
+            full = 1;
+            break;
+
+          case AR_COLOR_MONO:
+            yp = a->src + (size_t)y * w + x;
+            if( a->dst_format != AR_PIXEL_FORMAT_MONO ) {
+                put_grey_row( a->dst_format, yp, n, dst + (size_t)x * a->dst_pix );
+                continue;
+            }
+            break;
+        }
+
+        put_row( a->dst_format, yp, up, vp, full, n, dst + (size_t)x * a->dst_pix );
+    }
+}
+
+static void put_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst )
+{
+    switch( format ) {
+        case AR_PIXEL_FORMAT_MONO:
+            memcpy( dst, yp, n );
+            break;
+        case AR_PIXEL_FORMAT_2vuy:
+        case AR_PIXEL_FORMAT_yuvs:
+            put_yuv_row( format, yp, up, vp, full, n, dst );
+            break;
+        default:
+            put_rgb_row( format, yp, up, vp, full, n, dst );
+            break;
+    }
+}
+
+static void put_yuv_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst )
+{
+    int     i, u, v;
+
+    for( i = 0; i < n; i += 2, dst += 4 ) {
+        if( full ) {
+            u = (up[i] + up[i+1] + 1) >> 1;
+            v = (vp[i] + vp[i+1] + 1) >> 1;
+        }
+        else {
+            u = up[i>>1];
+            v = vp[i>>1];
+        }
+        if( format == AR_PIXEL_FORMAT_2vuy ) {
+            dst[0] = u; dst[1] = yp[i]; dst[2] = v; dst[3] = yp[i+1];
+        }
+        else {
+            dst[0] = yp[i]; dst[1] = u; dst[2] = yp[i+1]; dst[3] = v;
+        }
+    }
+}
+
+/* grey needs no arithmetic: copy Y to every color byte */
+static void put_grey_row( int format, ARUint8 *yp, int n, ARUint8 *dst )
+{
+    int     i;
+
+    switch( format ) {
+        case AR_PIXEL_FORMAT_RGB:
+        case AR_PIXEL_FORMAT_BGR:
+            for( i = 0; i < n; i++, dst += 3 ) dst[0] = dst[1] = dst[2] = yp[i];
+            break;
+        case AR_PIXEL_FORMAT_RGBA:
+        case AR_PIXEL_FORMAT_BGRA:
+            for( i = 0; i < n; i++, dst += 4 ) {
+                dst[0] = dst[1] = dst[2] = yp[i];
+                dst[3] = 255;
+            }
+            break;
+        case AR_PIXEL_FORMAT_ABGR:
+        case AR_PIXEL_FORMAT_ARGB:
+            for( i = 0; i < n; i++, dst += 4 ) {
+                dst[0] = 255;
+                dst[1] = dst[2] = dst[3] = yp[i];
+            }
+            break;
+        case AR_PIXEL_FORMAT_2vuy:
+            for( i = 0; i < n; i++, dst += 2 ) {
+                dst[0] = 128;
+                dst[1] = yp[i];
+            }
+            break;
+        case AR_PIXEL_FORMAT_yuvs:
+            for( i = 0; i < n; i++, dst += 2 ) {
+                dst[0] = yp[i];
+                dst[1] = 128;
+            }
+            break;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+
+static void put_pixel( int format, int y, int u, int v, ARUint8 *dst )
+{
+    int     r, g, b;
+
+    u -= 128;
+    v -= 128;
+    y <<= 6;
+    r = (y + C_RV * v + 32) >> 6;
+    g = (y - C_GU * u - C_GV * v + 32) >> 6;
+    b = (y + C_BU * u + 32) >> 6;
+    if( r < 0 ) r = 0; else if( r > 255 ) r = 255;
+    if( g < 0 ) g = 0; else if( g > 255 ) g = 255;
+    if( b < 0 ) b = 0; else if( b > 255 ) b = 255;
+
+    switch( format ) {
+        case AR_PIXEL_FORMAT_RGB:
+            dst[0] = r; dst[1] = g; dst[2] = b;
+            break;
+        case AR_PIXEL_FORMAT_BGR:
+            dst[0] = b; dst[1] = g; dst[2] = r;
+            break;
+        case AR_PIXEL_FORMAT_RGBA:
+            dst[0] = r; dst[1] = g; dst[2] = b; dst[3] = 255;
+            break;
+        case AR_PIXEL_FORMAT_BGRA:
+            dst[0] = b; dst[1] = g; dst[2] = r; dst[3] = 255;
+            break;
+        case AR_PIXEL_FORMAT_ABGR:
+            dst[0] = 255; dst[1] = b; dst[2] = g; dst[3] = r;
+            break;
+        case AR_PIXEL_FORMAT_ARGB:
+            dst[0] = 255; dst[1] = r; dst[2] = g; dst[3] = b;
+            break;
+    }
+}
+
+/*-------------------------------------------------------------------------*/
+
+static void luma_band( void *arg, int index )
+{
+    LumaArg     *a = (LumaArg *)arg;
+    ARUint8     buf[CHUNK];
+    ARUint8     *row, *half;
+    int         w = a->width;
+    int         y, y1, x, n;
+
+    y1 = (index + 1) * a->band_rows;
+    if( y1 > a->height ) y1 = a->height;
+    for( y = index * a->band_rows; y < y1; y++ ) {
+        row  = a->src + (size_t)y * w * a->src_pix;
+        half = NULL;
+        if( a->luma_half != NULL && !(y & 1) && (y >> 1) < (a->height >> 1) ) {
+            half = a->luma_half + (size_t)(y >> 1) * (w >> 1);
+        }
+
+        if( a->luma != NULL ) {
+            luma_row( a->src_format, row, w, a->luma + (size_t)y * w );
+            if( half != NULL ) even_bytes( a->luma + (size_t)y * w, w >> 1, half );
+        }
+        else if( half != NULL ) {
+            for( x = 0; x < w; x += n ) {
+                n = (w - x < CHUNK)? w - x: CHUNK;
+                luma_row( a->src_format, row + (size_t)x * a->src_pix, n, buf );
+                even_bytes( buf, n >> 1, half + (x >> 1) );
+            }
+        }
+    }
+}
+
+/*
+ * Luminance as seen by the labeling: the threshold test on three color
+ * components is sum <= 3 * thresh, so the luminance is the sum / 3
+ * rounded up, and luma <= thresh gives the same binary image.
+ */
+static void luma_row_c( int format, ARUint8 *src, int n, ARUint8 *dst )
+{
+    int     pix, o, i;
+
+    switch( format ) {
+        case AR_PIXEL_FORMAT_MONO:
+            memcpy( dst, src, n );
+            return;
+        case AR_PIXEL_FORMAT_2vuy:
+            for( i = 0; i < n; i++ ) dst[i] = src[i*2+1];
+            return;
+        case AR_PIXEL_FORMAT_yuvs:
+            for( i = 0; i < n; i++ ) dst[i] = src[i*2];
+            return;
+        case AR_PIXEL_FORMAT_ABGR:
+        case AR_PIXEL_FORMAT_ARGB:
+            o = 1;
+            break;
+        default:
+            o = 0;
+            break;
+    }
+    pix = get_pix_size( format );
+    for( i = 0; i < n; i++, src += pix ) {
+        dst[i] = (src[o] + src[o+1] + src[o+2] + 2) / 3;
+    }
+}
+
+#if defined(AR_CC_SSE2)
+
+/* 16 pixels: Y (16 bytes) and U, V (16 bytes, one per pixel) to R, G, B */
+static void yuv16( __m128i y8, __m128i u8, __m128i v8, __m128i *r, __m128i *g, __m128i *b )
+{
+#ifdef AR_CC_AVX2
+    __m256i     y, u, v, t;
+    __m256i     c128 = _mm256_set1_epi16( 128 );
+    __m256i     c32  = _mm256_set1_epi16( 32 );
+
+    y = _mm256_add_epi16( _mm256_slli_epi16( _mm256_cvtepu8_epi16( y8 ), 6 ), c32 );
+    u = _mm256_sub_epi16( _mm256_cvtepu8_epi16( u8 ), c128 );
+    v = _mm256_sub_epi16( _mm256_cvtepu8_epi16( v8 ), c128 );
+
+    t = _mm256_srai_epi16( _mm256_add_epi16( y, _mm256_mullo_epi16( v, _mm256_set1_epi16( C_RV ) ) ), 6 );
+    *r = _mm256_castsi256_si128( _mm256_permute4x64_epi64( _mm256_packus_epi16( t, t ), 0x08 ) );
+    t = _mm256_sub_epi16( y, _mm256_add_epi16( _mm256_mullo_epi16( u, _mm256_set1_epi16( C_GU ) ),
+                                               _mm256_mullo_epi16( v, _mm256_set1_epi16( C_GV ) ) ) );
+    t = _mm256_srai_epi16( t, 6 );
+    *g = _mm256_castsi256_si128( _mm256_permute4x64_epi64( _mm256_packus_epi16( t, t ), 0x08 ) );
+    t = _mm256_srai_epi16( _mm256_add_epi16( y, _mm256_mullo_epi16( u, _mm256_set1_epi16( C_BU ) ) ), 6 );
+    *b = _mm256_castsi256_si128( _mm256_permute4x64_epi64( _mm256_packus_epi16( t, t ), 0x08 ) );
+#else
+    __m128i     zero = _mm_setzero_si128();
+    __m128i     c128 = _mm_set1_epi16( 128 );
+    __m128i     c32  = _mm_set1_epi16( 32 );
+    __m128i     crv  = _mm_set1_epi16( C_RV );
+    __m128i     cgu  = _mm_set1_epi16( C_GU );
+    __m128i     cgv  = _mm_set1_epi16( C_GV );
+    __m128i     cbu  = _mm_set1_epi16( C_BU );
+    __m128i     y0, y1, u0, u1, v0, v1, t0, t1;
+
+    y0 = _mm_add_epi16( _mm_slli_epi16( _mm_unpacklo_epi8( y8, zero ), 6 ), c32 );
+    y1 = _mm_add_epi16( _mm_slli_epi16( _mm_unpackhi_epi8( y8, zero ), 6 ), c32 );
+    u0 = _mm_sub_epi16( _mm_unpacklo_epi8( u8, zero ), c128 );
+    u1 = _mm_sub_epi16( _mm_unpackhi_epi8( u8, zero ), c128 );
+    v0 = _mm_sub_epi16( _mm_unpacklo_epi8( v8, zero ), c128 );
+    v1 = _mm_sub_epi16( _mm_unpackhi_epi8( v8, zero ), c128 );
+
+    t0 = _mm_srai_epi16( _mm_add_epi16( y0, _mm_mullo_epi16( v0, crv ) ), 6 );
+    t1 = _mm_srai_epi16( _mm_add_epi16( y1, _mm_mullo_epi16( v1, crv ) ), 6 );
+    *r = _mm_packus_epi16( t0, t1 );
+    t0 = _mm_srai_epi16( _mm_sub_epi16( y0, _mm_add_epi16( _mm_mullo_epi16( u0, cgu ), _mm_mullo_epi16( v0, cgv ) ) ), 6 );
+    t1 = _mm_srai_epi16( _mm_sub_epi16( y1, _mm_add_epi16( _mm_mullo_epi16( u1, cgu ), _mm_mullo_epi16( v1, cgv ) ) ), 6 );
+    *g = _mm_packus_epi16( t0, t1 );
+    t0 = _mm_srai_epi16( _mm_add_epi16( y0, _mm_mullo_epi16( u0, cbu ) ), 6 );
+    t1 = _mm_srai_epi16( _mm_add_epi16( y1, _mm_mullo_epi16( u1, cbu ) ), 6 );
+    *b = _mm_packus_epi16( t0, t1 );
+#endif
+}
+
+/* interleave 4 planes of 16 bytes into 64 bytes */
+static void store4( __m128i c0, __m128i c1, __m128i c2, __m128i c3, ARUint8 *dst )
+{
+    __m128i     lo01 = _mm_unpacklo_epi8( c0, c1 );
+    __m128i     hi01 = _mm_unpackhi_epi8( c0, c1 );
+    __m128i     lo23 = _mm_unpacklo_epi8( c2, c3 );
+    __m128i     hi23 = _mm_unpackhi_epi8( c2, c3 );
+
+    _mm_storeu_si128( (__m128i *)(dst),      _mm_unpacklo_epi16( lo01, lo23 ) );
+    _mm_storeu_si128( (__m128i *)(dst + 16), _mm_unpackhi_epi16( lo01, lo23 ) );
+    _mm_storeu_si128( (__m128i *)(dst + 32), _mm_unpacklo_epi16( hi01, hi23 ) );
+    _mm_storeu_si128( (__m128i *)(dst + 48), _mm_unpackhi_epi16( hi01, hi23 ) );
+}
+
+/* interleave 3 planes of 16 bytes into 48 bytes */
+static void store3( __m128i c0, __m128i c1, __m128i c2, ARUint8 *dst )
+{
+#ifdef AR_CC_SSSE3
+    __m128i     zero = _mm_setzero_si128();
+    __m128i     lo01 = _mm_unpacklo_epi8( c0, c1 );
+    __m128i     hi01 = _mm_unpackhi_epi8( c0, c1 );
+    __m128i     lo2  = _mm_unpacklo_epi8( c2, zero );
+    __m128i     hi2  = _mm_unpackhi_epi8( c2, zero );
+    __m128i     m    = _mm_setr_epi8( 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1 );
+    __m128i     p0, p1, p2, p3;
+
+    p0 = _mm_shuffle_epi8( _mm_unpacklo_epi16( lo01, lo2 ), m );
+    p1 = _mm_shuffle_epi8( _mm_unpackhi_epi16( lo01, lo2 ), m );
+    p2 = _mm_shuffle_epi8( _mm_unpacklo_epi16( hi01, hi2 ), m );
+    p3 = _mm_shuffle_epi8( _mm_unpackhi_epi16( hi01, hi2 ), m );
+    _mm_storeu_si128( (__m128i *)(dst),      _mm_or_si128( p0, _mm_slli_si128( p1, 12 ) ) );
+    _mm_storeu_si128( (__m128i *)(dst + 16), _mm_or_si128( _mm_srli_si128( p1, 4 ), _mm_slli_si128( p2, 8 ) ) );
+    _mm_storeu_si128( (__m128i *)(dst + 32), _mm_or_si128( _mm_srli_si128( p2, 8 ), _mm_slli_si128( p3, 4 ) ) );
+#else
+    ARUint8     p[3][16];
+    int         i;
+
+    _mm_storeu_si128( (__m128i *)p[0], c0 );
+    _mm_storeu_si128( (__m128i *)p[1], c1 );
+    _mm_storeu_si128( (__m128i *)p[2], c2 );
+    for( i = 0; i < 16; i++, dst += 3 ) {
+        dst[0] = p[0][i];
+        dst[1] = p[1][i];
+        dst[2] = p[2][i];
+    }
+#endif
+}
+
+static void put_rgb_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst )
+{
+    __m128i     ff = _mm_set1_epi8( (char)0xff );
+    __m128i     y8, u8, v8, r, g, b;
+    int         pix = get_pix_size( format );
+    int         i;
+
+    for( i = 0; i + 16 <= n; i += 16, dst += 16 * pix ) {
+        y8 = _mm_loadu_si128( (__m128i *)(yp + i) );
+        if( full ) {
+            u8 = _mm_loadu_si128( (__m128i *)(up + i) );
+            v8 = _mm_loadu_si128( (__m128i *)(vp + i) );
+        }
+        else {
+            u8 = _mm_loadl_epi64( (__m128i *)(up + (i >> 1)) );
+            v8 = _mm_loadl_epi64( (__m128i *)(vp + (i >> 1)) );
+            u8 = _mm_unpacklo_epi8( u8, u8 );
+            v8 = _mm_unpacklo_epi8( v8, v8 );
+        }
+        yuv16( y8, u8, v8, &r, &g, &b );
+
+        switch( format ) {
+            case AR_PIXEL_FORMAT_RGB:  store3( r, g, b, dst );      break;
+            case AR_PIXEL_FORMAT_BGR:  store3( b, g, r, dst );      break;
+            case AR_PIXEL_FORMAT_RGBA: store4( r, g, b, ff, dst );  break;
+            case AR_PIXEL_FORMAT_BGRA: store4( b, g, r, ff, dst );  break;
+            case AR_PIXEL_FORMAT_ABGR: store4( ff, b, g, r, dst );  break;
+            case AR_PIXEL_FORMAT_ARGB: store4( ff, r, g, b, dst );  break;
+        }
+    }
+    for( ; i < n; i++, dst += pix ) {
+        if( full ) put_pixel( format, yp[i], up[i], vp[i], dst );
+        else       put_pixel( format, yp[i], up[i>>1], vp[i>>1], dst );
+    }
+}
+
+static void split_422( ARUint8 *src, int yfirst, int n, ARUint8 *yp, ARUint8 *up, ARUint8 *vp )
+{
+    __m128i     mask = _mm_set1_epi16( 0x00ff );
+    __m128i     zero = _mm_setzero_si128();
+    __m128i     a, b, y, c;
+    int         i;
+
+    for( i = 0; i + 16 <= n; i += 16, src += 32 ) {
+        a = _mm_loadu_si128( (__m128i *)(src) );
+        b = _mm_loadu_si128( (__m128i *)(src + 16) );
+        if( yfirst ) {
+            y = _mm_packus_epi16( _mm_and_si128( a, mask ), _mm_and_si128( b, mask ) );
+            c = _mm_packus_epi16( _mm_srli_epi16( a, 8 ), _mm_srli_epi16( b, 8 ) );
+        }
+        else {
+            y = _mm_packus_epi16( _mm_srli_epi16( a, 8 ), _mm_srli_epi16( b, 8 ) );
+            c = _mm_packus_epi16( _mm_and_si128( a, mask ), _mm_and_si128( b, mask ) );
+        }
+        _mm_storeu_si128( (__m128i *)(yp + i), y );
+        _mm_storel_epi64( (__m128i *)(up + (i >> 1)), _mm_packus_epi16( _mm_and_si128( c, mask ), zero ) );
+        _mm_storel_epi64( (__m128i *)(vp + (i >> 1)), _mm_packus_epi16( _mm_srli_epi16( c, 8 ), zero ) );
+    }
+    for( ; i < n; i += 2, src += 4 ) {
+        if( yfirst ) {
+            yp[i] = src[0]; up[i>>1] = src[1]; yp[i+1] = src[2]; vp[i>>1] = src[3];
+        }
+        else {
+            up[i>>1] = src[0]; yp[i] = src[1]; vp[i>>1] = src[2]; yp[i+1] = src[3];
+        }
+    }
+}
+
+/* sum of the 3 color bytes of each 32 bit pixel (alpha masked), as 32 bit */
+static __m128i sum4( __m128i v, __m128i amask )
+{
+    __m128i     t;
+
+    v = _mm_and_si128( v, amask );
+    t = _mm_add_epi16( _mm_and_si128( v, _mm_set1_epi16( 0x00ff ) ), _mm_srli_epi16( v, 8 ) );
+    return _mm_add_epi32( _mm_and_si128( t, _mm_set1_epi32( 0xffff ) ), _mm_srli_epi32( t, 16 ) );
+}
+
+/* (sum + 2) / 3 for sums up to 765: (x * 21846) >> 16 is exact there */
+static __m128i div3( __m128i s0, __m128i s1, __m128i s2, __m128i s3 )
+{
+    __m128i     c2 = _mm_set1_epi16( 2 );
+    __m128i     c3 = _mm_set1_epi16( 21846 );
+    __m128i     w0, w1;
+
+    w0 = _mm_mulhi_epu16( _mm_add_epi16( _mm_packs_epi32( s0, s1 ), c2 ), c3 );
+    w1 = _mm_mulhi_epu16( _mm_add_epi16( _mm_packs_epi32( s2, s3 ), c2 ), c3 );
+    return _mm_packus_epi16( w0, w1 );
+}
+
+static void luma_row( int format, ARUint8 *src, int n, ARUint8 *dst )
+{
+    __m128i     m8 = _mm_set1_epi16( 0x00ff );
+    __m128i     amask, a, b;
+#ifdef AR_CC_SSSE3
+    __m128i     c, m3;
+#endif
+    int         i = 0;
+
+    switch( format ) {
+        case AR_PIXEL_FORMAT_ABGR:
+        case AR_PIXEL_FORMAT_ARGB:
+        case AR_PIXEL_FORMAT_RGBA:
+        case AR_PIXEL_FORMAT_BGRA:
+            if( format == AR_PIXEL_FORMAT_ABGR || format == AR_PIXEL_FORMAT_ARGB ) {
+                amask = _mm_set1_epi32( (int)0xffffff00 );
+            }
+            else {
+                amask = _mm_set1_epi32( 0x00ffffff );
+            }
+            for( ; i + 16 <= n; i += 16, src += 64 ) {
+                _mm_storeu_si128( (__m128i *)(dst + i),
+                    div3( sum4( _mm_loadu_si128( (__m128i *)(src) ), amask ),
+                          sum4( _mm_loadu_si128( (__m128i *)(src + 16) ), amask ),
+                          sum4( _mm_loadu_si128( (__m128i *)(src + 32) ), amask ),
+                          sum4( _mm_loadu_si128( (__m128i *)(src + 48) ), amask ) ) );
+            }
+            break;
+
+#ifdef AR_CC_SSSE3
+        case AR_PIXEL_FORMAT_RGB:
+        case AR_PIXEL_FORMAT_BGR:
+            /* spread 4 pixels of 3 bytes over 4 bytes, then as above */
+            amask = _mm_set1_epi32( 0x00ffffff );
+            m3 = _mm_setr_epi8( 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1 );
+            for( ; i + 16 <= n; i += 16, src += 48 ) {
+                a = _mm_loadu_si128( (__m128i *)(src) );
+                b = _mm_loadu_si128( (__m128i *)(src + 16) );
+                c = _mm_loadu_si128( (__m128i *)(src + 32) );
+                _mm_storeu_si128( (__m128i *)(dst + i),
+                    div3( sum4( _mm_shuffle_epi8( a, m3 ), amask ),
+                          sum4( _mm_shuffle_epi8( _mm_alignr_epi8( b, a, 12 ), m3 ), amask ),
+                          sum4( _mm_shuffle_epi8( _mm_alignr_epi8( c, b, 8 ), m3 ), amask ),
+                          sum4( _mm_shuffle_epi8( _mm_srli_si128( c, 4 ), m3 ), amask ) ) );
+            }
+            break;
+#endif
+
+        case AR_PIXEL_FORMAT_2vuy:
+        case AR_PIXEL_FORMAT_yuvs:
+            for( ; i + 16 <= n; i += 16, src += 32 ) {
+                a = _mm_loadu_si128( (__m128i *)(src) );
+                b = _mm_loadu_si128( (__m128i *)(src + 16) );
+                if( format == AR_PIXEL_FORMAT_2vuy ) {
+                    a = _mm_packus_epi16( _mm_srli_epi16( a, 8 ), _mm_srli_epi16( b, 8 ) );
+                }
+                else {
+                    a = _mm_packus_epi16( _mm_and_si128( a, m8 ), _mm_and_si128( b, m8 ) );
+                }
+                _mm_storeu_si128( (__m128i *)(dst + i), a );
+            }
+            break;
+    }
+    if( i < n ) luma_row_c( format, src, n - i, dst + i );
+}
+
+static void even_bytes( ARUint8 *src, int n, ARUint8 *dst )
+{
+    __m128i     m8 = _mm_set1_epi16( 0x00ff );
+    int         i;
+
+    for( i = 0; i + 16 <= n; i += 16 ) {
+        _mm_storeu_si128( (__m128i *)(dst + i),
+            _mm_packus_epi16( _mm_and_si128( _mm_loadu_si128( (__m128i *)(src + i*2) ), m8 ),
+                              _mm_and_si128( _mm_loadu_si128( (__m128i *)(src + i*2 + 16) ), m8 ) ) );
+    }
+    for( ; i < n; i++ ) dst[i] = src[i*2];
+}
+
+#elif defined(AR_CC_NEON)
+
+static void put_rgb_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst )
+{
+    uint8x16_t      y8, u8, v8, ff;
+    uint8x8x2_t     d;
+    int16x8_t       y, u, v, t;
+    uint8x8_t       r[2], g[2], b[2];
+    uint8x16x3_t    p3;
+    uint8x16x4_t    p4;
+    int             pix = get_pix_size( format );
+    int             i, h;
+
+    ff = vdupq_n_u8( 0xff );
+    for( i = 0; i + 16 <= n; i += 16, dst += 16 * pix ) {
+        y8 = vld1q_u8( yp + i );
+        if( full ) {
+            u8 = vld1q_u8( up + i );
+            v8 = vld1q_u8( vp + i );
+        }
+        else {
+            d = vzip_u8( vld1_u8( up + (i >> 1) ), vld1_u8( up + (i >> 1) ) );
+            u8 = vcombine_u8( d.val[0], d.val[1] );
+            d = vzip_u8( vld1_u8( vp + (i >> 1) ), vld1_u8( vp + (i >> 1) ) );
+            v8 = vcombine_u8( d.val[0], d.val[1] );
+        }
+        for( h = 0; h < 2; h++ ) {
+            y = vreinterpretq_s16_u16( vshll_n_u8( h? vget_high_u8( y8 ): vget_low_u8( y8 ), 6 ) );
+            y = vaddq_s16( y, vdupq_n_s16( 32 ) );
+            u = vsubq_s16( vreinterpretq_s16_u16( vmovl_u8( h? vget_high_u8( u8 ): vget_low_u8( u8 ) ) ), vdupq_n_s16( 128 ) );
+            v = vsubq_s16( vreinterpretq_s16_u16( vmovl_u8( h? vget_high_u8( v8 ): vget_low_u8( v8 ) ) ), vdupq_n_s16( 128 ) );
+            r[h] = vqshrun_n_s16( vmlaq_n_s16( y, v, C_RV ), 6 );
+            t = vmlsq_n_s16( vmlsq_n_s16( y, u, C_GU ), v, C_GV );
+            g[h] = vqshrun_n_s16( t, 6 );
+            b[h] = vqshrun_n_s16( vmlaq_n_s16( y, u, C_BU ), 6 );
+        }
+
+        switch( format ) {
+            case AR_PIXEL_FORMAT_RGB:
+                p3.val[0] = vcombine_u8( r[0], r[1] );
+                p3.val[1] = vcombine_u8( g[0], g[1] );
+                p3.val[2] = vcombine_u8( b[0], b[1] );
+                vst3q_u8( dst, p3 );
+                break;
+            case AR_PIXEL_FORMAT_BGR:
+                p3.val[0] = vcombine_u8( b[0], b[1] );
+                p3.val[1] = vcombine_u8( g[0], g[1] );
+                p3.val[2] = vcombine_u8( r[0], r[1] );
+                vst3q_u8( dst, p3 );
+                break;
+            case AR_PIXEL_FORMAT_RGBA:
+                p4.val[0] = vcombine_u8( r[0], r[1] );
+                p4.val[1] = vcombine_u8( g[0], g[1] );
+                p4.val[2] = vcombine_u8( b[0], b[1] );
+                p4.val[3] = ff;
+                vst4q_u8( dst, p4 );
+                break;
+            case AR_PIXEL_FORMAT_BGRA:
+                p4.val[0] = vcombine_u8( b[0], b[1] );
+                p4.val[1] = vcombine_u8( g[0], g[1] );
+                p4.val[2] = vcombine_u8( r[0], r[1] );
+                p4.val[3] = ff;
+                vst4q_u8( dst, p4 );
+                break;
+            case AR_PIXEL_FORMAT_ABGR:
+                p4.val[0] = ff;
+                p4.val[1] = vcombine_u8( b[0], b[1] );
+                p4.val[2] = vcombine_u8( g[0], g[1] );
+                p4.val[3] = vcombine_u8( r[0], r[1] );
+                vst4q_u8( dst, p4 );
+                break;
+            case AR_PIXEL_FORMAT_ARGB:
+                p4.val[0] = ff;
+                p4.val[1] = vcombine_u8( r[0], r[1] );
+                p4.val[2] = vcombine_u8( g[0], g[1] );
+                p4.val[3] = vcombine_u8( b[0], b[1] );
+                vst4q_u8( dst, p4 );
+                break;
+        }
+    }
+    for( ; i < n; i++, dst += pix ) {
+        if( full ) put_pixel( format, yp[i], up[i], vp[i], dst );
+        else       put_pixel( format, yp[i], up[i>>1], vp[i>>1], dst );
+    }
+}
+
+static void split_422( ARUint8 *src, int yfirst, int n, ARUint8 *yp, ARUint8 *up, ARUint8 *vp )
+{
+    uint8x16x2_t    s;
+    uint8x16_t      c;
+    uint8x8x2_t     uv;
+    int             i;
+
+    for( i = 0; i + 16 <= n; i += 16, src += 32 ) {
+        s = vld2q_u8( src );
+        vst1q_u8( yp + i, s.val[yfirst? 0: 1] );
+        c = s.val[yfirst? 1: 0];
+        uv = vuzp_u8( vget_low_u8( c ), vget_high_u8( c ) );
+        vst1_u8( up + (i >> 1), uv.val[0] );
+        vst1_u8( vp + (i >> 1), uv.val[1] );
+    }
+    for( ; i < n; i += 2, src += 4 ) {
+        if( yfirst ) {
+            yp[i] = src[0]; up[i>>1] = src[1]; yp[i+1] = src[2]; vp[i>>1] = src[3];
+        }
+        else {
+            up[i>>1] = src[0]; yp[i] = src[1]; vp[i>>1] = src[2]; yp[i+1] = src[3];
+        }
+    }
+}
+
+/* (sum + 2) / 3 of 16 sums up to 765 */
+static uint8x16_t div3( uint16x8_t s0, uint16x8_t s1 )
+{
+    uint16x8_t      c2 = vdupq_n_u16( 2 );
+    uint16x4_t      c3 = vdup_n_u16( 21846 );
+    uint16x8_t      w0, w1;
+
+    s0 = vaddq_u16( s0, c2 );
+    s1 = vaddq_u16( s1, c2 );
+    w0 = vcombine_u16( vshrn_n_u32( vmull_u16( vget_low_u16( s0 ), c3 ), 16 ),
+                       vshrn_n_u32( vmull_u16( vget_high_u16( s0 ), c3 ), 16 ) );
+    w1 = vcombine_u16( vshrn_n_u32( vmull_u16( vget_low_u16( s1 ), c3 ), 16 ),
+                       vshrn_n_u32( vmull_u16( vget_high_u16( s1 ), c3 ), 16 ) );
+    return vcombine_u8( vmovn_u16( w0 ), vmovn_u16( w1 ) );
+}
+
+static uint8x16_t sum3( uint8x16_t a, uint8x16_t b, uint8x16_t c )
+{
+    return div3( vaddw_u8( vaddl_u8( vget_low_u8( a ), vget_low_u8( b ) ), vget_low_u8( c ) ),
+                 vaddw_u8( vaddl_u8( vget_high_u8( a ), vget_high_u8( b ) ), vget_high_u8( c ) ) );
+}
+
+static void luma_row( int format, ARUint8 *src, int n, ARUint8 *dst )
+{
+    uint8x16x4_t    p4;
+    uint8x16x3_t    p3;
+    uint8x16x2_t    p2;
+    int             i = 0;
+
+    switch( format ) {
+        case AR_PIXEL_FORMAT_ABGR:
+        case AR_PIXEL_FORMAT_ARGB:
+            for( ; i + 16 <= n; i += 16, src += 64 ) {
+                p4 = vld4q_u8( src );
+                vst1q_u8( dst + i, sum3( p4.val[1], p4.val[2], p4.val[3] ) );
+            }
+            break;
+        case AR_PIXEL_FORMAT_RGBA:
+        case AR_PIXEL_FORMAT_BGRA:
+            for( ; i + 16 <= n; i += 16, src += 64 ) {
+                p4 = vld4q_u8( src );
+                vst1q_u8( dst + i, sum3( p4.val[0], p4.val[1], p4.val[2] ) );
+            }
+            break;
+        case AR_PIXEL_FORMAT_RGB:
+        case AR_PIXEL_FORMAT_BGR:
+            for( ; i + 16 <= n; i += 16, src += 48 ) {
+                p3 = vld3q_u8( src );
+                vst1q_u8( dst + i, sum3( p3.val[0], p3.val[1], p3.val[2] ) );
+            }
+            break;
+        case AR_PIXEL_FORMAT_2vuy:
+        case AR_PIXEL_FORMAT_yuvs:
+            for( ; i + 16 <= n; i += 16, src += 32 ) {
+                p2 = vld2q_u8( src );
+                vst1q_u8( dst + i, p2.val[(format == AR_PIXEL_FORMAT_2vuy)? 1: 0] );
+            }
+            break;
+    }
+    if( i < n ) luma_row_c( format, src, n - i, dst + i );
+}
+
+static void even_bytes( ARUint8 *src, int n, ARUint8 *dst )
+{
+    int     i;
+
+    for( i = 0; i + 16 <= n; i += 16 ) vst1q_u8( dst + i, vld2q_u8( src + i*2 ).val[0] );
+    for( ; i < n; i++ ) dst[i] = src[i*2];
+}
+
+#else
+
+static void put_rgb_row( int format, ARUint8 *yp, ARUint8 *up, ARUint8 *vp, int full, int n, ARUint8 *dst )
+{
+    int     pix = get_pix_size( format );
+    int     i;
+
+    if( full ) {
+        for( i = 0; i < n; i++, dst += pix ) put_pixel( format, yp[i], up[i], vp[i], dst );
+    }
+    else {
+        for( i = 0; i < n; i++, dst += pix ) put_pixel( format, yp[i], up[i>>1], vp[i>>1], dst );
+    }
+}
+
+static void split_422( ARUint8 *src, int yfirst, int n, ARUint8 *yp, ARUint8 *up, ARUint8 *vp )
+{
+    int     i;
+
+    for( i = 0; i < n; i += 2, src += 4 ) {
+        if( yfirst ) {
+            yp[i] = src[0]; up[i>>1] = src[1]; yp[i+1] = src[2]; vp[i>>1] = src[3];
+        }
+        else {
+            up[i>>1] = src[0]; yp[i] = src[1]; vp[i>>1] = src[2]; yp[i+1] = src[3];
+        }
+    }
+}
+
+static void luma_row( int format, ARUint8 *src, int n, ARUint8 *dst )
+{
+    luma_row_c( format, src, n, dst );
+}
+
+static void even_bytes( ARUint8 *src, int n, ARUint8 *dst )
+{
+    int     i;
+
+    for( i = 0; i < n; i++ ) dst[i] = src[i*2];
+}
+
+#endif
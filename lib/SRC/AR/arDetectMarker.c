@@ -1,5 +1,8 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <AR/ar.h>
+#include <AR/arThread.h>
+#include <AR/arColorConv.h>
 
 static ARMarkerInfo2          *marker_info2;
 static ARMarkerInfo           *wmarker_info;
@@ -11,27 +14,54 @@ static int                    prev_num = 0;
 static arPrevInfo             sprev_info[2][AR_SQUARE_MAX];
 static int                    sprev_num[2] = {0,0};
 
+/* last stereo detection of each eye, for arSavePatt; written by that eye only */
+static ARMarkerInfo2          *eye_info2[2] = {NULL,NULL};
+static int                    eye_num[2] = {0,0};
+
+/* frame of the last detection and its luminance, made on demand */
+static ARUint8                *frame_image = NULL;
+static ARUint8                *frame_luma = NULL;
+static ARUint8                *frame_luma_half = NULL;
+static ARUint8                *luma_buffer = NULL;
+static ARUint8                *luma_half_buffer = NULL;
+static int                    luma_buffer_size = 0;
+
+static int                    check_history( ARMarkerInfo **marker_info, int *marker_num );
+static void                   set_frame( ARUint8 *image, ARUint8 *luma );
+static int                    get_threshold( int thresh );
+static ARMarkerInfo2          *get_candidates( ARUint8 *dataPtr, int thresh, int *candidate_num );
+static ARMarkerInfo           *get_marker_info( ARUint8 *dataPtr, ARMarkerInfo2 *marker_info2,
+                                                int *marker_num );
+
 int arSavePatt( ARUint8 *image, ARMarkerInfo *marker_info, char *filename )
 {
-    FILE      *fp;
-    ARUint8   ext_pat[4][AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
-    int       vertex[4];
-    int       i, j, k, x, y;
-
-	// Match supplied info against previously recognised marker.
-    for( i = 0; i < wmarker_num; i++ ) {
-        if( marker_info->area   == marker_info2[i].area
-         && marker_info->pos[0] == marker_info2[i].pos[0]
-         && marker_info->pos[1] == marker_info2[i].pos[1] ) break;
+    FILE           *fp;
+    ARMarkerInfo2  *info2;
+    ARUint8        ext_pat[4][AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
+    int            vertex[4];
+    int            num;
+    int            i, j, k, x, y;
+
+	// Match supplied info against previously recognised marker,
+	// of the last mono detection or of either eye of the stereo one.
+    for( j = 0; j < 3; j++ ) {
+        info2 = (j == 0)? marker_info2: eye_info2[j-1];
+        num   = (j == 0)? wmarker_num:  eye_num[j-1];
+        for( i = 0; i < num; i++ ) {
+            if( marker_info->area   == info2[i].area
+             && marker_info->pos[0] == info2[i].pos[0]
+             && marker_info->pos[1] == info2[i].pos[1] ) break;
+        }
+        if( i < num ) break;
     }
-    if( i == wmarker_num ) return -1;
+    if( j == 3 ) return -1;
 
     for( j = 0; j < 4; j++ ) {
         for( k = 0; k < 4; k++ ) {
-            vertex[k] = marker_info2[i].vertex[(k+j+2)%4];
+            vertex[k] = info2[i].vertex[(k+j+2)%4];
         }
-        arGetPatt( image, marker_info2[i].x_coord,
-                   marker_info2[i].y_coord, vertex, ext_pat[j] );
+        arGetPatt( image, info2[i].x_coord,
+                   info2[i].y_coord, vertex, ext_pat[j] );
     }
 
     fp = fopen( filename, "w" );
@@ -57,20 +87,37 @@ int arSavePatt( ARUint8 *image, ARMarkerInfo *marker_info, char *filename )
 
 int arDetectMarker( ARUint8 *dataPtr, int thresh,
                     ARMarkerInfo **marker_info, int *marker_num )
+{
+    *marker_num = 0;
+    set_frame( dataPtr, NULL );
+    thresh = get_threshold( thresh );
+
+    marker_info2 = get_candidates( dataPtr, thresh, &wmarker_num );
+    if( marker_info2 == 0 ) return -1;
+
+    wmarker_info = get_marker_info( dataPtr, marker_info2, &wmarker_num );
+    if( wmarker_info == 0 ) return -1;
+
+    if( check_history( marker_info, marker_num ) < 0 ) return -1;
+    arUpdateThreshold( *marker_info, *marker_num );
+
+    return 0;
+}
+
+int arDetectMarkerLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v, int thresh,
+                        ARMarkerInfo **marker_info, int *marker_num )
 {
     ARInt16                *limage;
     int                    label_num;
     int                    *area, *clip, *label_ref;
     double                 *pos;
-    double                 rarea, rlen, rlenmin;
-    double                 diff, diffmin;
-    int                    cid, cdir;
-    int                    i, j, k;
 
     *marker_num = 0;
+    set_frame( NULL, luma );
+    thresh = get_threshold( thresh );
 
-    limage = arLabeling( dataPtr, thresh,
-                         &label_num, &area, &pos, &clip, &label_ref );
+    limage = arLabelingLuma( luma, thresh,
+                             &label_num, &area, &pos, &clip, &label_ref );
     if( limage == 0 )    return -1;
 
     marker_info2 = arDetectMarker2( limage, label_num, label_ref,
@@ -78,9 +125,27 @@ int arDetectMarker( ARUint8 *dataPtr, int thresh,
                                     1.0, &wmarker_num);
     if( marker_info2 == 0 ) return -1;
 
-    wmarker_info = arGetMarkerInfo( dataPtr, marker_info2, &wmarker_num );
+    wmarker_info = arGetMarkerInfoLuma( luma, chroma_u, chroma_v, marker_info2, &wmarker_num );
     if( wmarker_info == 0 ) return -1;
 
+    if( check_history( marker_info, marker_num ) < 0 ) return -1;
+    arUpdateThreshold( *marker_info, *marker_num );
+
+    return 0;
+}
+
+/*
+ * Keep the identity of the markers seen in the last frames when the
+ * match of this frame is less confident, and carry them over for a few
+ * frames if they are missed.
+ */
+static int check_history( ARMarkerInfo **marker_info, int *marker_num )
+{
+    double                 rarea, rlen, rlenmin;
+    double                 diff, diffmin;
+    int                    cid, cdir;
+    int                    i, j, k;
+
     for( i = 0; i < prev_num; i++ ) {
         rlenmin = 10.0;
         cid = -1;
@@ -171,9 +236,135 @@ int arDetectMarker( ARUint8 *dataPtr, int thresh,
     return 0;
 }
 
+ARUint8 *arGetLumaImage( int half )
+{
+    int         size = arImXsize * arImYsize;
+
+    if( frame_image == NULL && frame_luma == NULL ) return NULL;
+
+    if( size > luma_buffer_size ) {
+        free( luma_buffer );
+        free( luma_half_buffer );
+        arMalloc( luma_buffer, ARUint8, size );
+        arMalloc( luma_half_buffer, ARUint8, size/4 );
+        luma_buffer_size = size;
+    }
+
+    if( !half ) {
+        if( frame_luma == NULL ) {
+            if( arColorConvertLuma( frame_image, AR_DEFAULT_PIXEL_FORMAT, arImXsize, arImYsize,
+                                    luma_buffer, NULL ) < 0 ) return NULL;
+            frame_luma = luma_buffer;
+        }
+        return frame_luma;
+    }
+
+    if( frame_luma_half == NULL ) {
+        if( frame_luma != NULL ) {
+            if( arColorConvertLuma( frame_luma, AR_PIXEL_FORMAT_MONO, arImXsize, arImYsize,
+                                    NULL, luma_half_buffer ) < 0 ) return NULL;
+        }
+        else {
+            if( arColorConvertLuma( frame_image, AR_DEFAULT_PIXEL_FORMAT, arImXsize, arImYsize,
+                                    NULL, luma_half_buffer ) < 0 ) return NULL;
+        }
+        frame_luma_half = luma_half_buffer;
+    }
+    return frame_luma_half;
+}
+
+/*
+ * The luminance planes are made on the first arGetLumaImage() of a frame
+ * and then shared by everything that reads them. The labeling is no
+ * faster on a plane than on the frame, so the detection only makes the
+ * plane in AR_LUMA_SHARED mode, where the application reads it too; once
+ * it exists, the detection reads it instead of the frame.
+ */
+static void set_frame( ARUint8 *image, ARUint8 *luma )
+{
+    frame_image     = image;
+    frame_luma      = luma;
+    frame_luma_half = NULL;
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO)
+    if( frame_luma == NULL ) frame_luma = image;
+#endif
+    if( frame_luma == NULL && image != NULL && arLumaMode == AR_LUMA_SHARED ) arGetLumaImage( 0 );
+}
+
+/* in automatic mode the application's threshold only serves for the first frame */
+static int get_threshold( int thresh )
+{
+    if( arThresholdMode == AR_THRESHOLD_MODE_MANUAL || arGetThreshold() < 0 ) return thresh;
+    return arGetThreshold();
+}
+
+static ARMarkerInfo2 *get_candidates( ARUint8 *dataPtr, int thresh, int *candidate_num )
+{
+    ARInt16                *limage;
+    int                    label_num;
+    int                    *area, *clip, *label_ref;
+    double                 *pos;
+
+    if( arIncrementalMode == AR_INCREMENTAL_ENABLE && !arDebug ) {
+        return arDetectMarker2Incremental( dataPtr, thresh, AR_AREA_MAX, AR_AREA_MIN,
+                                           1.0, candidate_num );
+    }
+
+    if( frame_luma != NULL ) {
+        limage = arLabelingLuma( frame_luma, thresh,
+                                 &label_num, &area, &pos, &clip, &label_ref );
+    }
+    else {
+        limage = arLabeling( dataPtr, thresh,
+                             &label_num, &area, &pos, &clip, &label_ref );
+    }
+    if( limage == 0 )    return NULL;
+
+    return arDetectMarker2( limage, label_num, label_ref,
+                            area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                            1.0, candidate_num );
+}
+
+/* black and white patterns are sampled from the luminance when there is one */
+static ARMarkerInfo *get_marker_info( ARUint8 *dataPtr, ARMarkerInfo2 *marker_info2,
+                                      int *marker_num )
+{
+    if( frame_luma != NULL && arTemplateMatchingMode == AR_TEMPLATE_MATCHING_BW ) {
+        return arGetMarkerInfoLuma( frame_luma, NULL, NULL, marker_info2, marker_num );
+    }
+    return arGetMarkerInfo( dataPtr, marker_info2, marker_num );
+}
+
 
 int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                         ARMarkerInfo **marker_info, int *marker_num )
+{
+    int                    i;
+
+    *marker_num = 0;
+    set_frame( dataPtr, NULL );
+    thresh = get_threshold( thresh );
+
+    marker_info2 = get_candidates( dataPtr, thresh, &wmarker_num );
+    if( marker_info2 == 0 ) return -1;
+
+    wmarker_info = get_marker_info( dataPtr, marker_info2, &wmarker_num );
+    if( wmarker_info == 0 ) return -1;
+
+    for( i = 0; i < wmarker_num; i++ ) {
+        if( wmarker_info[i].cf < 0.5 ) wmarker_info[i].id = -1;
+    }
+
+
+    *marker_num  = wmarker_num;
+    *marker_info = wmarker_info;
+    arUpdateThreshold( *marker_info, *marker_num );
+
+    return 0;
+}
+
+int arDetectMarkerLumaLite( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v, int thresh,
+                            ARMarkerInfo **marker_info, int *marker_num )
 {
     ARInt16                *limage;
     int                    label_num;
@@ -182,9 +373,11 @@ int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
     int                    i;
 
     *marker_num = 0;
+    set_frame( NULL, luma );
+    thresh = get_threshold( thresh );
 
-    limage = arLabeling( dataPtr, thresh,
-                         &label_num, &area, &pos, &clip, &label_ref );
+    limage = arLabelingLuma( luma, thresh,
+                             &label_num, &area, &pos, &clip, &label_ref );
     if( limage == 0 )    return -1;
 
     marker_info2 = arDetectMarker2( limage, label_num, label_ref,
@@ -192,16 +385,16 @@ int arDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                                     1.0, &wmarker_num);
     if( marker_info2 == 0 ) return -1;
 
-    wmarker_info = arGetMarkerInfo( dataPtr, marker_info2, &wmarker_num );
+    wmarker_info = arGetMarkerInfoLuma( luma, chroma_u, chroma_v, marker_info2, &wmarker_num );
     if( wmarker_info == 0 ) return -1;
 
     for( i = 0; i < wmarker_num; i++ ) {
         if( wmarker_info[i].cf < 0.5 ) wmarker_info[i].id = -1;
     }
 
-
     *marker_num  = wmarker_num;
     *marker_info = wmarker_info;
+    arUpdateThreshold( *marker_info, *marker_num );
 
     return 0;
 }
@@ -213,6 +406,9 @@ int arsDetectMarker( ARUint8 *dataPtr, int thresh,
     int                    label_num;
     int                    *area, *clip, *label_ref;
     double                 *pos;
+    ARMarkerInfo2          *smarker_info2;
+    ARMarkerInfo           *swmarker_info;
+    int                    swmarker_num;
     double                 rarea, rlen, rlenmin;
     double                 diff, diffmin;
     int                    cid, cdir;
@@ -224,66 +420,69 @@ int arsDetectMarker( ARUint8 *dataPtr, int thresh,
                           &label_num, &area, &pos, &clip, &label_ref, LorR );
     if( limage == 0 )    return -1;
 
-    marker_info2 = arDetectMarker2( limage, label_num, label_ref,
-                                    area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
-                                    1.0, &wmarker_num);
-    if( marker_info2 == 0 ) return -1;
+    smarker_info2 = arsDetectMarker2( limage, label_num, label_ref,
+                                      area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                                      1.0, &swmarker_num, LorR );
+    if( smarker_info2 == 0 ) return -1;
 
-    wmarker_info = arsGetMarkerInfo( dataPtr, marker_info2, &wmarker_num, LorR );
-    if( wmarker_info == 0 ) return -1;
+    swmarker_info = arsGetMarkerInfo( dataPtr, smarker_info2, &swmarker_num, LorR );
+    if( swmarker_info == 0 ) return -1;
 
     for( i = 0; i < sprev_num[LorR]; i++ ) {
         rlenmin = 10.0;
         cid = -1;
-        for( j = 0; j < wmarker_num; j++ ) {
-            rarea = (double)sprev_info[LorR][i].marker.area / (double)wmarker_info[j].area;
+        for( j = 0; j < swmarker_num; j++ ) {
+            rarea = (double)sprev_info[LorR][i].marker.area / (double)swmarker_info[j].area;
             if( rarea < 0.7 || rarea > 1.43 ) continue;
-            rlen = ( (wmarker_info[j].pos[0] - sprev_info[LorR][i].marker.pos[0])
-                   * (wmarker_info[j].pos[0] - sprev_info[LorR][i].marker.pos[0])
-                   + (wmarker_info[j].pos[1] - sprev_info[LorR][i].marker.pos[1])
-                   * (wmarker_info[j].pos[1] - sprev_info[LorR][i].marker.pos[1]) ) / wmarker_info[j].area;
+            rlen = ( (swmarker_info[j].pos[0] - sprev_info[LorR][i].marker.pos[0])
+                   * (swmarker_info[j].pos[0] - sprev_info[LorR][i].marker.pos[0])
+                   + (swmarker_info[j].pos[1] - sprev_info[LorR][i].marker.pos[1])
+                   * (swmarker_info[j].pos[1] - sprev_info[LorR][i].marker.pos[1]) ) / swmarker_info[j].area;
             if( rlen < 0.5 && rlen < rlenmin ) {
                 rlenmin = rlen;
                 cid = j;
             }
         }
-        if( cid >= 0 && wmarker_info[cid].cf < sprev_info[LorR][i].marker.cf ) {
-            wmarker_info[cid].cf = sprev_info[LorR][i].marker.cf;
-            wmarker_info[cid].id = sprev_info[LorR][i].marker.id;
+        if( cid >= 0 && swmarker_info[cid].cf < sprev_info[LorR][i].marker.cf ) {
+            swmarker_info[cid].cf = sprev_info[LorR][i].marker.cf;
+            swmarker_info[cid].id = sprev_info[LorR][i].marker.id;
             diffmin = 10000.0 * 10000.0;
             cdir = -1;
             for( j = 0; j < 4; j++ ) {
                 diff = 0;
                 for( k = 0; k < 4; k++ ) {
-                    diff += (sprev_info[LorR][i].marker.vertex[k][0] - wmarker_info[cid].vertex[(j+k)%4][0])
-                          * (sprev_info[LorR][i].marker.vertex[k][0] - wmarker_info[cid].vertex[(j+k)%4][0])
-                          + (sprev_info[LorR][i].marker.vertex[k][1] - wmarker_info[cid].vertex[(j+k)%4][1])
-                          * (sprev_info[LorR][i].marker.vertex[k][1] - wmarker_info[cid].vertex[(j+k)%4][1]);
+                    diff += (sprev_info[LorR][i].marker.vertex[k][0] - swmarker_info[cid].vertex[(j+k)%4][0])
+                          * (sprev_info[LorR][i].marker.vertex[k][0] - swmarker_info[cid].vertex[(j+k)%4][0])
+                          + (sprev_info[LorR][i].marker.vertex[k][1] - swmarker_info[cid].vertex[(j+k)%4][1])
+                          * (sprev_info[LorR][i].marker.vertex[k][1] - swmarker_info[cid].vertex[(j+k)%4][1]);
                 }
                 if( diff < diffmin ) {
                     diffmin = diff;
                     cdir = (sprev_info[LorR][i].marker.dir - j + 4) % 4;
                 }
             }
-            wmarker_info[cid].dir = cdir;
+            swmarker_info[cid].dir = cdir;
         }
     }
 
-    for( i = 0; i < wmarker_num; i++ ) {
-        if( wmarker_info[i].cf < 0.5 ) wmarker_info[i].id = -1;
+    for( i = 0; i < swmarker_num; i++ ) {
+        if( swmarker_info[i].cf < 0.5 ) swmarker_info[i].id = -1;
     }
 
     j = 0;
-    for( i = 0; i < wmarker_num; i++ ) {
-        if( wmarker_info[i].id < 0 ) continue;
-        sprev_info[LorR][j].marker = wmarker_info[i];
+    for( i = 0; i < swmarker_num; i++ ) {
+        if( swmarker_info[i].id < 0 ) continue;
+        sprev_info[LorR][j].marker = swmarker_info[i];
         sprev_info[LorR][j].count  = 1;
         j++;
     }
     sprev_num[LorR] = j;
 
-    *marker_num  = wmarker_num;
-    *marker_info = wmarker_info;
+    eye_info2[LorR] = smarker_info2;
+    eye_num[LorR]   = swmarker_num;
+
+    *marker_num  = swmarker_num;
+    *marker_info = swmarker_info;
 
     return 0;
 }
@@ -295,6 +494,9 @@ int arsDetectMarkerLite( ARUint8 *dataPtr, int thresh,
     int                    label_num;
     int                    *area, *clip, *label_ref;
     double                 *pos;
+    ARMarkerInfo2          *smarker_info2;
+    ARMarkerInfo           *swmarker_info;
+    int                    swmarker_num;
     int                    i;
 
     *marker_num = 0;
@@ -303,21 +505,64 @@ int arsDetectMarkerLite( ARUint8 *dataPtr, int thresh,
                           &label_num, &area, &pos, &clip, &label_ref, LorR );
     if( limage == 0 )    return -1;
 
-    marker_info2 = arDetectMarker2( limage, label_num, label_ref,
-                                    area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
-                                    1.0, &wmarker_num);
-    if( marker_info2 == 0 ) return -1;
+    smarker_info2 = arsDetectMarker2( limage, label_num, label_ref,
+                                      area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                                      1.0, &swmarker_num, LorR );
+    if( smarker_info2 == 0 ) return -1;
 
-    wmarker_info = arsGetMarkerInfo( dataPtr, marker_info2, &wmarker_num, LorR );
-    if( wmarker_info == 0 ) return -1;
+    swmarker_info = arsGetMarkerInfo( dataPtr, smarker_info2, &swmarker_num, LorR );
+    if( swmarker_info == 0 ) return -1;
 
-    for( i = 0; i < wmarker_num; i++ ) {
-        if( wmarker_info[i].cf < 0.5 ) wmarker_info[i].id = -1;
+    for( i = 0; i < swmarker_num; i++ ) {
+        if( swmarker_info[i].cf < 0.5 ) swmarker_info[i].id = -1;
     }
 
 
-    *marker_num  = wmarker_num;
-    *marker_info = wmarker_info;
+    eye_info2[LorR] = smarker_info2;
+    eye_num[LorR]   = swmarker_num;
+
+    *marker_num  = swmarker_num;
+    *marker_info = swmarker_info;
+
+    return 0;
+}
+
+typedef struct {
+    ARUint8        *dataPtr;
+    int            thresh;
+    ARMarkerInfo   *marker_info;
+    int            marker_num;
+    int            ret;
+} ARSDetectArg;
+
+static void detect_pair_func( void *arg, int index )
+{
+    ARSDetectArg   *darg = &(((ARSDetectArg *)arg)[index]);
+
+    /* index 0 is the left eye (LorR = 1), index 1 the right eye */
+    darg->ret = arsDetectMarker( darg->dataPtr, darg->thresh,
+                                 &(darg->marker_info), &(darg->marker_num), 1 - index );
+}
+
+int arsDetectMarkerPair( ARUint8 *dataPtrL, ARUint8 *dataPtrR, int thresh,
+                         ARMarkerInfo **marker_infoL, int *marker_numL,
+                         ARMarkerInfo **marker_infoR, int *marker_numR )
+{
+    ARSDetectArg   arg[2];
+
+    *marker_numL = 0;
+    *marker_numR = 0;
+
+    arg[0].dataPtr = dataPtrL;
+    arg[1].dataPtr = dataPtrR;
+    arg[0].thresh  = arg[1].thresh = thresh;
+    if( arThreadPoolRun( arThreadPoolGetDefault(), detect_pair_func, arg, 2 ) < 0 ) return -1;
+    if( arg[0].ret < 0 || arg[1].ret < 0 ) return -1;
+
+    *marker_infoL = arg[0].marker_info;
+    *marker_numL  = arg[0].marker_num;
+    *marker_infoR = arg[1].marker_info;
+    *marker_numR  = arg[1].marker_num;
 
     return 0;
 }
@@ -9,24 +9,158 @@
  *
 *******************************************************/
 
+#include <stdlib.h>
+#include <string.h>
 #include <AR/ar.h>
+#include <AR/arStats.h>
+
+/*
+ * Incremental detection (arIncrementalMode). The frame is compared with
+ * the previous one by tiles of AR_TILE_SIZE pixels. A component whose
+ * pixels and their neighbours all lie in unchanged tiles is the same as
+ * in the previous frame, and so is its candidate square. The labeling is
+ * redone only in the changed tiles grown by the previous components that
+ * touch them: a component can only extend out of the changed tiles
+ * through pixels that were dark in the previous frame too. Candidates are
+ * kept with the raster position of their first pixel, i.e. the order of
+ * the labels, so the result is the one of arLabeling and arDetectMarker2.
+ */
+typedef struct {
+    int             key;
+    int             clip[4];
+    ARMarkerInfo2   info;
+} TileCandidate;
+
+static ARUint8          *tile_image = NULL;     /* previous frame */
+static int              tile_xsize, tile_ysize, tile_mode, tile_thresh;
+static int              tile_valid = 0;
+static int              *tile_clip = NULL;      /* clips of all the components */
+static int              tile_clip_num = 0;
+static int              tile_clip_max = 0;
+static TileCandidate    *tile_cand = NULL;
+static int              tile_cand_num = 0;
+
+static int get_candidate( ARInt16 *limage, int *label_ref, int i,
+                          int *warea, double *wpos, int *wclip,
+                          int area_max, int area_min, double factor,
+                          ARMarkerInfo2 *marker_info2 );
+static void filter_candidates( ARMarkerInfo2 *marker_info2, int *marker_num );
+
+static int tile_compare( ARUint8 *image, int rect[4] );
+static int tile_full( ARUint8 *image, int thresh, int area_max, int area_min, double factor,
+                      int copy );
+static int tile_update( ARUint8 *image, int thresh, int rect[4],
+                        int area_max, int area_min, double factor );
+static int tile_add_candidates( ARInt16 *limage, int label_num, int *label_ref,
+                                int *warea, double *wpos, int *wclip,
+                                int area_max, int area_min, double factor, int *rect );
+static void tile_add_clip( int *clip );
+static void copy_candidate( ARMarkerInfo2 *dst, ARMarkerInfo2 *src );
+static ARMarkerInfo2 *tile_output( int *marker_num );
 
 static int check_square( int area, ARMarkerInfo2 *marker_info2, double factor );
 
 static int get_vertex( int x_coord[], int y_coord[], int st, int ed,
                        double thresh, int vertex[], int *vnum );
 
-static ARMarkerInfo2    marker_info2[AR_SQUARE_MAX];
+static ARMarkerInfo2 *detect_marker2( ARInt16 *limage, int label_num, int *label_ref,
+                                      int *warea, double *wpos, int *wclip,
+                                      int area_max, int area_min, double factor, int *marker_num,
+                                      ARMarkerInfo2 *marker_info2 );
+static void reverse_coord( int x_coord[], int y_coord[], int st, int ed );
+
+static ARMarkerInfo2    marker_info2L[AR_SQUARE_MAX];
+static ARMarkerInfo2    marker_info2R[AR_SQUARE_MAX];
 
 ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
                                 int *warea, double *wpos, int *wclip,
                                 int area_max, int area_min, double factor, int *marker_num )
 {
-    ARMarkerInfo2     *pm;
-    int               xsize, ysize;
+    return detect_marker2( limage, label_num, label_ref, warea, wpos, wclip,
+                           area_max, area_min, factor, marker_num, marker_info2L );
+}
+
+ARMarkerInfo2 *arsDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
+                                 int *warea, double *wpos, int *wclip,
+                                 int area_max, int area_min, double factor, int *marker_num,
+                                 int LorR )
+{
+    return detect_marker2( limage, label_num, label_ref, warea, wpos, wclip,
+                           area_max, area_min, factor, marker_num,
+                           (LorR)? marker_info2L: marker_info2R );
+}
+
+ARMarkerInfo2 *arDetectMarker2Incremental( ARUint8 *image, int thresh,
+                                           int area_max, int area_min, double factor, int *marker_num )
+{
+    ARMarkerInfo2   *marker_info2;
+    int             rect[4];
+    int             ret;
+    AR_STATS_VAR(t0);
+
+    AR_STATS_START(t0);
+    if( tile_cand == NULL ) {
+        arMalloc( tile_cand, TileCandidate, AR_SQUARE_MAX );
+    }
+
+    if( !tile_valid || tile_xsize != arImXsize || tile_ysize != arImYsize
+     || tile_mode != arImageProcMode || tile_thresh != thresh ) {
+        ret = tile_full( image, thresh, area_max, area_min, factor, 1 );
+    }
+    else if( tile_compare( image, rect ) == 0 ) {
+        ret = 0;
+    }
+    else if( arThresholdMode != AR_THRESHOLD_MODE_MANUAL ) {
+        /* the histogram of the automatic threshold needs the whole frame */
+        ret = tile_full( image, thresh, area_max, area_min, factor, 0 );
+    }
+    else {
+        ret = tile_update( image, thresh, rect, area_max, area_min, factor );
+    }
+    if( ret < 0 ) return NULL;
+
+    /* one sample per frame, as arDetectMarker2 gives */
+    marker_info2 = tile_output( marker_num );
+    AR_STATS_STOP( AR_STATS_CANDIDATE, t0 );
+
+    return marker_info2;
+}
+
+static ARMarkerInfo2 *detect_marker2( ARInt16 *limage, int label_num, int *label_ref,
+                                      int *warea, double *wpos, int *wclip,
+                                      int area_max, int area_min, double factor, int *marker_num,
+                                      ARMarkerInfo2 *marker_info2 )
+{
     int               marker_num2;
-    int               i, j, ret;
-    double            d;
+    int               i;
+    AR_STATS_VAR(t0);
+
+    AR_STATS_START(t0);
+
+    marker_num2 = 0;
+    for(i=0; i<label_num; i++ ) {
+        if( get_candidate( limage, label_ref, i, warea, wpos, wclip,
+                           area_max, area_min, factor, &(marker_info2[marker_num2]) ) < 0 ) continue;
+        marker_num2++;
+        if( marker_num2 == AR_SQUARE_MAX ) break;
+    }
+
+    filter_candidates( marker_info2, &marker_num2 );
+
+    *marker_num = marker_num2;
+    AR_STATS_STOP( AR_STATS_CANDIDATE, t0 );
+    return( &(marker_info2[0]) );
+}
+
+/* candidate square of the component i; area_min and area_max in full image pixels */
+static int get_candidate( ARInt16 *limage, int *label_ref, int i,
+                          int *warea, double *wpos, int *wclip,
+                          int area_max, int area_min, double factor,
+                          ARMarkerInfo2 *marker_info2 )
+{
+    int               xsize, ysize;
+    int               ret;
+    AR_STATS_VAR(t1);
 
     if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
         area_min /= 4;
@@ -38,26 +172,38 @@ ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
         xsize = arImXsize;
         ysize = arImYsize;
     }
-    marker_num2 = 0;
-    for(i=0; i<label_num; i++ ) {
-        if( warea[i] < area_min || warea[i] > area_max ) continue;
-        if( wclip[i*4+0] == 1 || wclip[i*4+1] == xsize-2 ) continue;
-        if( wclip[i*4+2] == 1 || wclip[i*4+3] == ysize-2 ) continue;
 
-        ret = arGetContour( limage, label_ref, i+1,
-                            &(wclip[i*4]), &(marker_info2[marker_num2]));
-        if( ret < 0 ) continue;
+    if( warea[i] < area_min || warea[i] > area_max ) return -1;
+    if( wclip[i*4+0] == 1 || wclip[i*4+1] == xsize-2 ) return -1;
+    if( wclip[i*4+2] == 1 || wclip[i*4+3] == ysize-2 ) return -1;
 
-        ret = check_square( warea[i], &(marker_info2[marker_num2]), factor );
-        if( ret < 0 ) continue;
+    AR_STATS_START(t1);
+    ret = arGetContour( limage, label_ref, i+1,
+                        &(wclip[i*4]), marker_info2 );
+    AR_STATS_STOP( AR_STATS_CONTOUR, t1 );
+    if( ret < 0 ) return -1;
 
-        marker_info2[marker_num2].area   = warea[i];
-        marker_info2[marker_num2].pos[0] = wpos[i*2+0];
-        marker_info2[marker_num2].pos[1] = wpos[i*2+1];
-        marker_num2++;
-        if( marker_num2 == AR_SQUARE_MAX ) break;
-    }
+    AR_STATS_START(t1);
+    ret = check_square( warea[i], marker_info2, factor );
+    AR_STATS_STOP( AR_STATS_CHECK_SQUARE, t1 );
+    if( ret < 0 ) return -1;
+
+    marker_info2->area   = warea[i];
+    marker_info2->pos[0] = wpos[i*2+0];
+    marker_info2->pos[1] = wpos[i*2+1];
 
+    return 0;
+}
+
+/* drop the squares inside bigger ones, and back to full image coordinates */
+static void filter_candidates( ARMarkerInfo2 *marker_info2, int *marker_num )
+{
+    ARMarkerInfo2     *pm;
+    int               marker_num2;
+    int               i, j;
+    double            d;
+
+    marker_num2 = *marker_num;
     for( i=0; i < marker_num2; i++ ) {
         for( j=i+1; j < marker_num2; j++ ) {
             d = (marker_info2[i].pos[0] - marker_info2[j].pos[0])
@@ -100,16 +246,256 @@ ARMarkerInfo2 *arDetectMarker2( ARInt16 *limage, int label_num, int *label_ref,
     }
 
     *marker_num = marker_num2;
-    return( &(marker_info2[0]) );
+}
+
+/*
+ * Compare the frame with the previous one, and copy the tiles that
+ * changed. rect: bounding box of these tiles, in image coordinates.
+ */
+static int tile_compare( ARUint8 *image, int rect[4] )
+{
+    ARUint8     *p1, *p2;
+    int         tx, ty, x1, y1;
+    int         changed, num;
+    int         y;
+
+    num = 0;
+    for( ty = 0; ty < arImYsize; ty += AR_TILE_SIZE ) {
+        y1 = (ty + AR_TILE_SIZE < arImYsize)? ty + AR_TILE_SIZE: arImYsize;
+        for( tx = 0; tx < arImXsize; tx += AR_TILE_SIZE ) {
+            x1 = (tx + AR_TILE_SIZE < arImXsize)? tx + AR_TILE_SIZE: arImXsize;
+            changed = 0;
+            for( y = ty; y < y1; y++ ) {
+                p1 = image      + ((size_t)y * arImXsize + tx) * AR_PIX_SIZE_DEFAULT;
+                p2 = tile_image + ((size_t)y * arImXsize + tx) * AR_PIX_SIZE_DEFAULT;
+                if( !changed && memcmp( p1, p2, (x1-tx) * AR_PIX_SIZE_DEFAULT ) == 0 ) continue;
+                changed = 1;
+                memcpy( p2, p1, (x1-tx) * AR_PIX_SIZE_DEFAULT );
+            }
+            if( !changed ) continue;
+
+            if( num == 0 ) {
+                rect[0] = tx; rect[1] = x1-1;
+                rect[2] = ty; rect[3] = y1-1;
+            }
+            else {
+                if( rect[0] > tx )   rect[0] = tx;
+                if( rect[1] < x1-1 ) rect[1] = x1-1;
+                rect[3] = y1-1;
+            }
+            num++;
+        }
+    }
+
+    return num;
+}
+
+/* copy: 0 if tile_compare has already copied the frame */
+static int tile_full( ARUint8 *image, int thresh, int area_max, int area_min, double factor,
+                      int copy )
+{
+    ARInt16     *limage;
+    int         label_num;
+    int         *area, *clip, *label_ref;
+    double      *pos;
+    int         i;
+
+    tile_valid = 0;
+    if( tile_image == NULL || tile_xsize != arImXsize || tile_ysize != arImYsize ) {
+        free( tile_image );
+        arMalloc( tile_image, ARUint8, arImXsize*arImYsize*AR_PIX_SIZE_DEFAULT );
+        tile_xsize = arImXsize;
+        tile_ysize = arImYsize;
+        copy = 1;
+    }
+    if( copy ) memcpy( tile_image, image, arImXsize*arImYsize*AR_PIX_SIZE_DEFAULT );
+    tile_mode   = arImageProcMode;
+    tile_thresh = thresh;
+
+    limage = arLabeling( image, thresh, &label_num, &area, &pos, &clip, &label_ref );
+    if( limage == 0 ) return -1;
+
+    tile_clip_num = 0;
+    for( i = 0; i < label_num; i++ ) tile_add_clip( &clip[i*4] );
+    tile_cand_num = 0;
+    tile_add_candidates( limage, label_num, label_ref, area, pos, clip,
+                         area_max, area_min, factor, NULL );
+
+    /* beyond AR_SQUARE_MAX candidates some are unknown: no reuse */
+    tile_valid = (tile_cand_num < AR_SQUARE_MAX);
+
+    return 0;
+}
+
+static int tile_update( ARUint8 *image, int thresh, int rect[4],
+                        int area_max, int area_min, double factor )
+{
+    ARInt16     *limage;
+    int         label_num;
+    int         *area, *clip, *label_ref;
+    double      *pos;
+    int         lxsize, lysize;
+    int         e[4], r[4];
+    int         *c;
+    int         i, j;
+
+    if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
+        lxsize = arImXsize / 2;
+        lysize = arImYsize / 2;
+        rect[0] /= 2; rect[1] /= 2;
+        rect[2] /= 2; rect[3] /= 2;
+    }
+    else {
+        lxsize = arImXsize;
+        lysize = arImYsize;
+    }
+
+    /* changed pixels and their neighbours, in labeling coordinates */
+    e[0] = rect[0] - 2; e[1] = rect[1] + 2;
+    e[2] = rect[2] - 2; e[3] = rect[3] + 2;
+
+    /* region to label again: e and the components touching it */
+    r[0] = e[0]; r[1] = e[1]; r[2] = e[2]; r[3] = e[3];
+    for( i = 0, c = tile_clip; i < tile_clip_num; i++, c += 4 ) {
+        if( c[1] < e[0] || c[0] > e[1] || c[3] < e[2] || c[2] > e[3] ) continue;
+        if( r[0] > c[0] ) r[0] = c[0];
+        if( r[1] < c[1] ) r[1] = c[1];
+        if( r[2] > c[2] ) r[2] = c[2];
+        if( r[3] < c[3] ) r[3] = c[3];
+    }
+    if( r[0] < 1 )        r[0] = 1;
+    if( r[1] > lxsize-2 ) r[1] = lxsize-2;
+    if( r[2] < 1 )        r[2] = 1;
+    if( r[3] > lysize-2 ) r[3] = lysize-2;
+    if( (r[1]-r[0]+1) * (r[3]-r[2]+1) * 2 > lxsize * lysize ) {
+        return tile_full( image, thresh, area_max, area_min, factor, 0 );
+    }
+
+    limage = arLabelingRegion( image, thresh, r, &label_num, &area, &pos, &clip, &label_ref );
+    if( limage == 0 ) {
+        tile_valid = 0;
+        return -1;
+    }
+
+    /* components touching e are replaced by the ones of the new labeling */
+    for( i = j = 0; i < tile_clip_num; i++ ) {
+        c = &tile_clip[i*4];
+        if( c[1] >= e[0] && c[0] <= e[1] && c[3] >= e[2] && c[2] <= e[3] ) continue;
+        if( i != j ) memcpy( &tile_clip[j*4], c, 4*sizeof(int) );
+        j++;
+    }
+    tile_clip_num = j;
+    for( i = 0; i < label_num; i++ ) {
+        c = &clip[i*4];
+        if( c[1] < e[0] || c[0] > e[1] || c[3] < e[2] || c[2] > e[3] ) continue;
+        tile_add_clip( c );
+    }
+
+    for( i = j = 0; i < tile_cand_num; i++ ) {
+        c = tile_cand[i].clip;
+        if( c[1] >= e[0] && c[0] <= e[1] && c[3] >= e[2] && c[2] <= e[3] ) continue;
+        if( i != j ) {
+            tile_cand[j].key = tile_cand[i].key;
+            memcpy( tile_cand[j].clip, c, 4*sizeof(int) );
+            copy_candidate( &(tile_cand[j].info), &(tile_cand[i].info) );
+        }
+        j++;
+    }
+    tile_cand_num = j;
+    tile_add_candidates( limage, label_num, label_ref, area, pos, clip,
+                         area_max, area_min, factor, e );
+    if( tile_cand_num == AR_SQUARE_MAX ) {
+        return tile_full( image, thresh, area_max, area_min, factor, 0 );
+    }
+
+    return 0;
+}
+
+/* rect: only the components touching it, NULL for all */
+static int tile_add_candidates( ARInt16 *limage, int label_num, int *label_ref,
+                                int *warea, double *wpos, int *wclip,
+                                int area_max, int area_min, double factor, int *rect )
+{
+    TileCandidate   *tc;
+    ARInt16         *p;
+    int             *c;
+    int             lxsize;
+    int             i, x;
+
+    lxsize = (arImageProcMode == AR_IMAGE_PROC_IN_HALF)? arImXsize / 2: arImXsize;
+    for( i = 0; i < label_num && tile_cand_num < AR_SQUARE_MAX; i++ ) {
+        c = &wclip[i*4];
+        if( rect != NULL
+         && (c[1] < rect[0] || c[0] > rect[1] || c[3] < rect[2] || c[2] > rect[3]) ) continue;
+
+        tc = &tile_cand[tile_cand_num];
+        if( get_candidate( limage, label_ref, i, warea, wpos, wclip,
+                           area_max, area_min, factor, &(tc->info) ) < 0 ) continue;
+
+        /* first pixel of the top row, where the label was created */
+        p = &limage[c[2]*lxsize + c[0]];
+        for( x = c[0]; x <= c[1]; x++, p++ ) {
+            if( *p > 0 && label_ref[(*p)-1] == i+1 ) break;
+        }
+        tc->key = c[2]*lxsize + x;
+        memcpy( tc->clip, c, 4*sizeof(int) );
+        tile_cand_num++;
+    }
+
+    return 0;
+}
+
+/* the used part of the chain only: the arrays are AR_CHAIN_MAX long */
+static void copy_candidate( ARMarkerInfo2 *dst, ARMarkerInfo2 *src )
+{
+    dst->area      = src->area;
+    dst->pos[0]    = src->pos[0];
+    dst->pos[1]    = src->pos[1];
+    dst->coord_num = src->coord_num;
+    memcpy( dst->x_coord, src->x_coord, src->coord_num*sizeof(int) );
+    memcpy( dst->y_coord, src->y_coord, src->coord_num*sizeof(int) );
+    memcpy( dst->vertex, src->vertex, 5*sizeof(int) );
+}
+
+static void tile_add_clip( int *clip )
+{
+    int     *w;
+
+    if( tile_clip_num == tile_clip_max ) {
+        arMalloc( w, int, (tile_clip_max + 1024) * 4 );
+        if( tile_clip_num > 0 ) memcpy( w, tile_clip, tile_clip_num*4*sizeof(int) );
+        free( tile_clip );
+        tile_clip = w;
+        tile_clip_max += 1024;
+    }
+    memcpy( &tile_clip[tile_clip_num*4], clip, 4*sizeof(int) );
+    tile_clip_num++;
+}
+
+/* the candidates in label order, as arDetectMarker2 gives them */
+static ARMarkerInfo2 *tile_output( int *marker_num )
+{
+    int             order[AR_SQUARE_MAX];
+    int             i, j, k;
+
+    for( i = 0; i < tile_cand_num; i++ ) {
+        for( j = i; j > 0 && tile_cand[order[j-1]].key > tile_cand[i].key; j-- ) order[j] = order[j-1];
+        order[j] = i;
+    }
+    for( k = 0; k < tile_cand_num; k++ ) {
+        copy_candidate( &marker_info2L[k], &(tile_cand[order[k]].info) );
+    }
+    *marker_num = tile_cand_num;
+    filter_candidates( marker_info2L, marker_num );
+
+    return( &(marker_info2L[0]) );
 }
 
 int arGetContour( ARInt16 *limage, int *label_ref,
                   int label, int clip[4], ARMarkerInfo2 *marker_info2 )
 {
-    static int      xdir[8] = { 0, 1, 1, 1, 0,-1,-1,-1};
-    static int      ydir[8] = {-1,-1, 0, 1, 1, 1, 0,-1};
-    static int      wx[AR_CHAIN_MAX];
-    static int      wy[AR_CHAIN_MAX];
+    static const int xdir[8] = { 0, 1, 1, 1, 0,-1,-1,-1};
+    static const int ydir[8] = {-1,-1, 0, 1, 1, 1, 0,-1};
     ARInt16         *p1;
     int             xsize, ysize;
     int             sx, sy, dir;
@@ -132,7 +518,8 @@ int arGetContour( ARInt16 *limage, int *label_ref,
         }
     }
     if( i > clip[1] ) {
-        printf("??? 1\n"); return(-1);
+        AR_STATS_COUNT( AR_STATS_CONTOUR_NO_START );
+        return(-1);
     }
 
     marker_info2->coord_num = 1;
@@ -148,7 +535,8 @@ int arGetContour( ARInt16 *limage, int *label_ref,
             dir = (dir+1)%8;
         }
         if( i == 8 ) {
-            printf("??? 2\n"); return(-1);
+            AR_STATS_COUNT( AR_STATS_CONTOUR_OPEN );
+            return(-1);
         }
         marker_info2->x_coord[marker_info2->coord_num]
             = marker_info2->x_coord[marker_info2->coord_num-1] + xdir[dir];
@@ -158,7 +546,8 @@ int arGetContour( ARInt16 *limage, int *label_ref,
          && marker_info2->y_coord[marker_info2->coord_num] == sy ) break;
         marker_info2->coord_num++;
         if( marker_info2->coord_num == AR_CHAIN_MAX-1 ) {
-            printf("??? 3\n"); return(-1);
+            AR_STATS_COUNT( AR_STATS_CONTOUR_TOO_LONG );
+            return(-1);
         }
     }
 
@@ -172,18 +561,10 @@ int arGetContour( ARInt16 *limage, int *label_ref,
         }
     }
 
-    for(i=0;i<v1;i++) {
-        wx[i] = marker_info2->x_coord[i];
-        wy[i] = marker_info2->y_coord[i];
-    }
-    for(i=v1;i<marker_info2->coord_num;i++) {
-        marker_info2->x_coord[i-v1] = marker_info2->x_coord[i];
-        marker_info2->y_coord[i-v1] = marker_info2->y_coord[i];
-    }
-    for(i=0;i<v1;i++) {
-        marker_info2->x_coord[i-v1+marker_info2->coord_num] = wx[i];
-        marker_info2->y_coord[i-v1+marker_info2->coord_num] = wy[i];
-    }
+    /* rotate the chain in place so that it starts at v1 */
+    reverse_coord( marker_info2->x_coord, marker_info2->y_coord, 0, v1-1 );
+    reverse_coord( marker_info2->x_coord, marker_info2->y_coord, v1, marker_info2->coord_num-1 );
+    reverse_coord( marker_info2->x_coord, marker_info2->y_coord, 0, marker_info2->coord_num-1 );
     marker_info2->x_coord[marker_info2->coord_num] = marker_info2->x_coord[0];
     marker_info2->y_coord[marker_info2->coord_num] = marker_info2->y_coord[0];
     marker_info2->coord_num++;
@@ -191,6 +572,16 @@ int arGetContour( ARInt16 *limage, int *label_ref,
     return 0;
 }
 
+static void reverse_coord( int x_coord[], int y_coord[], int st, int ed )
+{
+    int     w;
+
+    for( ; st < ed; st++, ed-- ) {
+        w = x_coord[st]; x_coord[st] = x_coord[ed]; x_coord[ed] = w;
+        w = y_coord[st]; y_coord[st] = y_coord[ed]; y_coord[ed] = w;
+    }
+}
+
 static int check_square( int area, ARMarkerInfo2 *marker_info2, double factor )
 {
     int             sx, sy;
@@ -12,6 +12,8 @@
 #include <stdio.h>
 #include <math.h>
 #include <AR/ar.h>
+#include <AR/arStats.h>
+#include <AR/arColorConv.h>
 #include <AR/matrix.h>
 
 #define   DEBUG        0
@@ -35,6 +37,12 @@ static int    evecBWf = 0;
 
 static void   get_cpara( double world[4][2], double vertex[4][2],
                          double para[3][3] );
+static int    get_cpara_f( double world[4][2], double vertex[4][2],
+                           float para[3][3] );
+static int    get_patt( ARUint8 *image, ARUint8 *chroma_u, ARUint8 *chroma_v, int luma,
+                        int *x_coord, int *y_coord, int *vertex,
+                        ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] );
+static void   put_yuv( ARUint32 pat[3], int y, int u, int v );
 static int    pattern_match( ARUint8 *data, int *code, int *dir, double *cf );
 static void   put_zero( ARUint8 *p, int size );
 static void   gen_evec(void);
@@ -144,49 +152,62 @@ int arDeactivatePatt( int patno )
 int arGetCode( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
                int *code, int *dir, double *cf )
 {
-#if DEBUG
-static int count = 0;
-static double a1 = 0.0;
-static double a2 = 0.0;
-double b1, b2, b3;
-#endif
     ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
+    AR_STATS_VAR(t);
 
-#if DEBUG
-b1 = arUtilTimer();
-#endif
+    AR_STATS_START(t);
     arGetPatt(image, x_coord, y_coord, vertex, ext_pat);
-#if DEBUG
-b2 = arUtilTimer();
-#endif
+    AR_STATS_STOP( AR_STATS_GET_PATT, t );
 
+    AR_STATS_START(t);
     pattern_match((ARUint8 *)ext_pat, code, dir, cf);
-#if DEBUG
-b3 = arUtilTimer();
-#endif
+    AR_STATS_STOP( AR_STATS_PATTERN_MATCH, t );
 
-#if DEBUG
-a1 += (b2 - b1);
-a2 += (b3 - b2);
-count++;
-if( count == 60 ) {
-    printf("%10.5f[msec], %10.5f[msec]\n", a1*1000.0/60.0, a2*1000.0/60.0);
-    count = 0;
-    a1 = a2 = 0.0;
+    return(0);
 }
-#endif
+
+int arGetCodeLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v,
+                   int *x_coord, int *y_coord, int *vertex,
+                   int *code, int *dir, double *cf )
+{
+    ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
+    arGetPattLuma(luma, chroma_u, chroma_v, x_coord, y_coord, vertex, ext_pat);
+    AR_STATS_STOP( AR_STATS_GET_PATT, t );
+
+    AR_STATS_START(t);
+    pattern_match((ARUint8 *)ext_pat, code, dir, cf);
+    AR_STATS_STOP( AR_STATS_PATTERN_MATCH, t );
 
     return(0);
 }
 
+int arGetPattLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v,
+                   int *x_coord, int *y_coord, int *vertex,
+                   ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] )
+{
+    return get_patt( luma, chroma_u, chroma_v, 1, x_coord, y_coord, vertex, ext_pat );
+}
+
 #if 1
 int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
                ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] )
+{
+    return get_patt( image, NULL, NULL, 0, x_coord, y_coord, vertex, ext_pat );
+}
+
+static int get_patt( ARUint8 *image, ARUint8 *chroma_u, ARUint8 *chroma_v, int luma,
+                     int *x_coord, int *y_coord, int *vertex,
+                     ARUint8 ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3] )
 {
     ARUint32  ext_pat2[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
     double    world[4][2];
     double    local[4][2];
     double    para[3][3];
+    float     fpara[3][3];
+    float     fd;
     double    d, xw, yw;
     int       xc, yc;
     int       xdiv, ydiv;
@@ -199,7 +220,10 @@ int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
 	int       ext_pat2_x_index;
 	int       ext_pat2_y_index;
 	int       image_index;
+    int       chroma_index;
+    int       precision;
 
+    precision = arPrecisionMode;
     world[0][0] = 100.0;
     world[0][1] = 100.0;
     world[1][0] = 100.0 + 10.0;
@@ -212,7 +236,12 @@ int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
         local[i][0] = x_coord[vertex[i]];
         local[i][1] = y_coord[vertex[i]];
     }
-    get_cpara( world, local, para );
+    if( precision == AR_PRECISION_FLOAT ) {
+        if( get_cpara_f( world, local, fpara ) < 0 ) return(-1);
+    }
+    else {
+        get_cpara( world, local, para );
+    }
 
     lx1 = (int)((local[0][0] - local[1][0])*(local[0][0] - local[1][0])
         + (local[0][1] - local[1][1])*(local[0][1] - local[1][1]));
@@ -251,10 +280,18 @@ printf("%3d(%f), %3d(%f)\n", xdiv2, sqrt(lx1), ydiv2, sqrt(ly1));
         yw = 102.5 + 5.0 * (j+0.5) * ydiv2_reciprocal;
         for( i = 0; i < xdiv2; i++ ) {
             xw = 102.5 + 5.0 * (i+0.5) * xdiv2_reciprocal;
-            d = para[2][0]*xw + para[2][1]*yw + para[2][2];
-            if( d == 0 ) return(-1);
-            xc = (int)((para[0][0]*xw + para[0][1]*yw + para[0][2])/d);
-            yc = (int)((para[1][0]*xw + para[1][1]*yw + para[1][2])/d);
+            if( precision == AR_PRECISION_FLOAT ) {
+                fd = fpara[2][0]*(float)xw + fpara[2][1]*(float)yw + fpara[2][2];
+                if( fd == 0 ) return(-1);
+                xc = (int)((fpara[0][0]*(float)xw + fpara[0][1]*(float)yw + fpara[0][2])/fd);
+                yc = (int)((fpara[1][0]*(float)xw + fpara[1][1]*(float)yw + fpara[1][2])/fd);
+            }
+            else {
+                d = para[2][0]*xw + para[2][1]*yw + para[2][2];
+                if( d == 0 ) return(-1);
+                xc = (int)((para[0][0]*xw + para[0][1]*yw + para[0][2])/d);
+                yc = (int)((para[1][0]*xw + para[1][1]*yw + para[1][2])/d);
+            }
             if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
                 xc = ((xc+1)/2)*2;
                 yc = ((yc+1)/2)*2;
@@ -262,6 +299,21 @@ printf("%3d(%f), %3d(%f)\n", xdiv2, sqrt(lx1), ydiv2, sqrt(ly1));
             if( xc >= 0 && xc < arImXsize && yc >= 0 && yc < arImYsize ) {
 				ext_pat2_y_index = j/ydiv;
 				ext_pat2_x_index = i/xdiv;
+                if( luma ) {
+                    image_index = yc*arImXsize+xc;
+                    if( chroma_u != NULL ) {
+                        /* 4:2:0 chroma */
+                        chroma_index = (yc/2)*(arImXsize/2) + xc/2;
+                        put_yuv( ext_pat2[ext_pat2_y_index][ext_pat2_x_index], image[image_index],
+                                 chroma_u[chroma_index], chroma_v[chroma_index] );
+                    }
+                    else {
+                        ext_pat2[ext_pat2_y_index][ext_pat2_x_index][0] += image[image_index];
+                        ext_pat2[ext_pat2_y_index][ext_pat2_x_index][1] += image[image_index];
+                        ext_pat2[ext_pat2_y_index][ext_pat2_x_index][2] += image[image_index];
+                    }
+                    continue;
+                }
 				image_index = (yc*arImXsize+xc)*AR_PIX_SIZE_DEFAULT;
 #if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
                 ext_pat2[ext_pat2_y_index][ext_pat2_x_index][0] += image[image_index+3];
@@ -484,6 +536,22 @@ int arGetPatt( ARUint8 *image, int *x_coord, int *y_coord, int *vertex,
 }
 #endif
 
+/* add a YUV sample to a B, G, R pattern cell (same conversion as arColorConvert) */
+static void put_yuv( ARUint32 pat[3], int y, int u, int v )
+{
+    int     r, g, b;
+
+    u -= 128;
+    v -= 128;
+    y <<= 6;
+    r = (y + AR_COLOR_CONV_RV * v + 32) >> 6;
+    g = (y - AR_COLOR_CONV_GU * u - AR_COLOR_CONV_GV * v + 32) >> 6;
+    b = (y + AR_COLOR_CONV_BU * u + 32) >> 6;
+    pat[0] += (b < 0)? 0: (b > 255)? 255: b;
+    pat[1] += (g < 0)? 0: (g > 255)? 255: g;
+    pat[2] += (r < 0)? 0: (r > 255)? 255: r;
+}
+
 static void get_cpara( double world[4][2], double vertex[4][2],
                        double para[3][3] )
 {
@@ -528,6 +596,100 @@ static void get_cpara( double world[4][2], double vertex[4][2],
     arMatrixFree( c );
 }
 
+/*
+ * Single precision homography. Both point sets are normalized (centred
+ * and scaled to unit size) before the 8x8 system is solved by Gaussian
+ * elimination, which keeps the float solve as accurate as the ARMat one.
+ */
+static int get_cpara_f( double world[4][2], double vertex[4][2],
+                        float para[3][3] )
+{
+    float   a[8][9];
+    float   wx[4], wy[4], vx[4], vy[4];
+    float   wcx, wcy, ws, vcx, vcy, vs;
+    float   h[8], m[3][3];
+    float   w, p;
+    int     i, j, k, piv;
+
+    wcx = wcy = vcx = vcy = 0.0f;
+    for( i = 0; i < 4; i++ ) {
+        wcx += (float)world[i][0];  wcy += (float)world[i][1];
+        vcx += (float)vertex[i][0]; vcy += (float)vertex[i][1];
+    }
+    wcx *= 0.25f; wcy *= 0.25f;
+    vcx *= 0.25f; vcy *= 0.25f;
+    ws = vs = 0.0f;
+    for( i = 0; i < 4; i++ ) {
+        wx[i] = (float)world[i][0]  - wcx;  wy[i] = (float)world[i][1]  - wcy;
+        vx[i] = (float)vertex[i][0] - vcx;  vy[i] = (float)vertex[i][1] - vcy;
+        ws += sqrtf( wx[i]*wx[i] + wy[i]*wy[i] );
+        vs += sqrtf( vx[i]*vx[i] + vy[i]*vy[i] );
+    }
+    if( ws == 0.0f || vs == 0.0f ) return -1;
+    ws = 4.0f / ws;
+    vs = 4.0f / vs;
+    for( i = 0; i < 4; i++ ) {
+        wx[i] *= ws; wy[i] *= ws;
+        vx[i] *= vs; vy[i] *= vs;
+    }
+
+    for( i = 0; i < 4; i++ ) {
+        a[i*2+0][0] = wx[i];
+        a[i*2+0][1] = wy[i];
+        a[i*2+0][2] = 1.0f;
+        a[i*2+0][3] = 0.0f;
+        a[i*2+0][4] = 0.0f;
+        a[i*2+0][5] = 0.0f;
+        a[i*2+0][6] = -wx[i] * vx[i];
+        a[i*2+0][7] = -wy[i] * vx[i];
+        a[i*2+0][8] = vx[i];
+        a[i*2+1][0] = 0.0f;
+        a[i*2+1][1] = 0.0f;
+        a[i*2+1][2] = 0.0f;
+        a[i*2+1][3] = wx[i];
+        a[i*2+1][4] = wy[i];
+        a[i*2+1][5] = 1.0f;
+        a[i*2+1][6] = -wx[i] * vy[i];
+        a[i*2+1][7] = -wy[i] * vy[i];
+        a[i*2+1][8] = vy[i];
+    }
+    for( k = 0; k < 8; k++ ) {
+        piv = k;
+        for( j = k+1; j < 8; j++ ) {
+            if( fabs(a[j][k]) > fabs(a[piv][k]) ) piv = j;
+        }
+        if( a[piv][k] == 0.0f ) return -1;
+        if( piv != k ) {
+            for( i = k; i < 9; i++ ) {
+                w = a[k][i]; a[k][i] = a[piv][i]; a[piv][i] = w;
+            }
+        }
+        for( j = k+1; j < 8; j++ ) {
+            p = a[j][k] / a[k][k];
+            for( i = k; i < 9; i++ ) a[j][i] -= p * a[k][i];
+        }
+    }
+    for( k = 7; k >= 0; k-- ) {
+        w = a[k][8];
+        for( i = k+1; i < 8; i++ ) w -= a[k][i] * h[i];
+        h[k] = w / a[k][k];
+    }
+
+    /* para = N^-1 * H * T, T and N being the two normalizations */
+    for( j = 0; j < 3; j++ ) {
+        m[j][0] = h[j*3+0] * ws;
+        m[j][1] = h[j*3+1] * ws;
+        m[j][2] = ((j < 2)? h[j*3+2]: 1.0f) - ws * (h[j*3+0] * wcx + h[j*3+1] * wcy);
+    }
+    for( i = 0; i < 3; i++ ) {
+        para[0][i] = m[0][i] / vs + vcx * m[2][i];
+        para[1][i] = m[1][i] / vs + vcy * m[2][i];
+        para[2][i] = m[2][i];
+    }
+
+    return 0;
+}
+
 static int pattern_match( ARUint8 *data, int *code, int *dir, double *cf )
 {
     double invec[EVEC_MAX];
@@ -621,6 +783,8 @@ static int pattern_match( ARUint8 *data, int *code, int *dir, double *cf )
         }
     }
     else {
+        k = -1;
+        max = 0.0;
         for( l = 0; l < pattern_num; l++ ) {
             k++;
             while( patf[k] == 0 ) k++;
@@ -10,37 +10,78 @@
 *******************************************************/
 
 #include <AR/ar.h>
+#include <AR/arThread.h>
 
 static ARMarkerInfo    marker_infoL[AR_SQUARE_MAX];
 static ARMarkerInfo    marker_infoR[AR_SQUARE_MAX];
 
+/*
+ * The candidates are independent: each one only reads its contour, the
+ * frame, the camera parameters and the pattern tables, and writes its
+ * own entry of the output. A candidate whose lines cannot be fitted is
+ * flagged, and the entries are compacted in candidate order afterwards.
+ */
+typedef struct {
+    ARUint8        *image;
+    ARUint8        *chroma_u;
+    ARUint8        *chroma_v;
+    int            luma;
+    int            LorR;            /* -1: arParam, else the eye of arsParam */
+    ARMarkerInfo2  *marker_info2;
+    ARMarkerInfo   *marker_info;
+    int            ok[AR_SQUARE_MAX];
+} MarkerInfoArg;
+
+static void get_info_func( void *arg, int index );
+static int  get_marker_info( MarkerInfoArg *a, int marker_num, int parallel );
+
 ARMarkerInfo *arGetMarkerInfo( ARUint8 *image,
                                ARMarkerInfo2 *marker_info2, int *marker_num )
 {
-    int            id, dir;
-    double         cf;
-    int            i, j;
+    MarkerInfoArg  a;
 
-    for (i = j = 0; i < *marker_num; i++) {
-        marker_infoL[j].area   = marker_info2[i].area;
-        marker_infoL[j].pos[0] = marker_info2[i].pos[0];
-        marker_infoL[j].pos[1] = marker_info2[i].pos[1];
+    a.image        = image;
+    a.chroma_u     = NULL;
+    a.chroma_v     = NULL;
+    a.luma         = 0;
+    a.LorR         = -1;
+    a.marker_info2 = marker_info2;
+    a.marker_info  = marker_infoL;
+    *marker_num = get_marker_info( &a, *marker_num, (*marker_num >= AR_MARKER_INFO_THREAD_MIN) );
 
-        if (arGetLine(marker_info2[i].x_coord, marker_info2[i].y_coord,
-                      marker_info2[i].coord_num, marker_info2[i].vertex,
-                      marker_infoL[j].line, marker_infoL[j].vertex) < 0 ) continue;
+    return (marker_infoL);
+}
 
-        arGetCode(image,
-                  marker_info2[i].x_coord, marker_info2[i].y_coord,
-                  marker_info2[i].vertex, &id, &dir, &cf );
+ARMarkerInfo *arGetMarkerInfoParallel( ARUint8 *image, ARMarkerInfo2 *marker_info2,
+                                       int *marker_num, ARMarkerInfo *marker_info )
+{
+    MarkerInfoArg  a;
+
+    a.image        = image;
+    a.chroma_u     = NULL;
+    a.chroma_v     = NULL;
+    a.luma         = 0;
+    a.LorR         = -1;
+    a.marker_info2 = marker_info2;
+    a.marker_info  = marker_info;
+    *marker_num = get_marker_info( &a, *marker_num, 1 );
+
+    return (marker_info);
+}
 
-        marker_infoL[j].id  = id;
-        marker_infoL[j].dir = dir;
-        marker_infoL[j].cf  = cf;
+ARMarkerInfo *arGetMarkerInfoLuma( ARUint8 *luma, ARUint8 *chroma_u, ARUint8 *chroma_v,
+                                   ARMarkerInfo2 *marker_info2, int *marker_num )
+{
+    MarkerInfoArg  a;
 
-        j++;
-    }
-    *marker_num = j;
+    a.image        = luma;
+    a.chroma_u     = chroma_u;
+    a.chroma_v     = chroma_v;
+    a.luma         = 1;
+    a.LorR         = -1;
+    a.marker_info2 = marker_info2;
+    a.marker_info  = marker_infoL;
+    *marker_num = get_marker_info( &a, *marker_num, (*marker_num >= AR_MARKER_INFO_THREAD_MIN) );
 
     return (marker_infoL);
 }
@@ -48,35 +89,77 @@ ARMarkerInfo *arGetMarkerInfo( ARUint8 *image,
 ARMarkerInfo *arsGetMarkerInfo( ARUint8 *image,
                                 ARMarkerInfo2 *marker_info2, int *marker_num, int LorR )
 {
-    ARMarkerInfo   *info;
-    int            id, dir;
-    double         cf;
-    int            i, j;
+    MarkerInfoArg  a;
+
+    a.image        = image;
+    a.chroma_u     = NULL;
+    a.chroma_v     = NULL;
+    a.luma         = 0;
+    a.LorR         = (LorR)? 1: 0;
+    a.marker_info2 = marker_info2;
+    a.marker_info  = (LorR)? marker_infoL: marker_infoR;
+    *marker_num = get_marker_info( &a, *marker_num, (*marker_num >= AR_MARKER_INFO_THREAD_MIN) );
+
+    return (a.marker_info);
+}
 
-    if (LorR) info = &marker_infoL[0];
-	else      info = &marker_infoR[0];
+/* candidates by blocks of AR_SQUARE_MAX, each block on the shared pool if parallel */
+static int get_marker_info( MarkerInfoArg *a, int marker_num, int parallel )
+{
+    ARMarkerInfo2  *marker_info2 = a->marker_info2;
+    ARMarkerInfo   *marker_info  = a->marker_info;
+    ARThreadPool   *pool;
+    int            st, num;
+    int            i, j;
 
-    for (i = j = 0; i < *marker_num; i++) {
-        info[j].area   = marker_info2[i].area;
-        info[j].pos[0] = marker_info2[i].pos[0];
-        info[j].pos[1] = marker_info2[i].pos[1];
+    pool = (parallel)? arThreadPoolGetDefault(): NULL;
 
-        if (arsGetLine(marker_info2[i].x_coord, marker_info2[i].y_coord,
-                       marker_info2[i].coord_num, marker_info2[i].vertex,
-                       info[j].line, info[j].vertex, LorR) < 0 ) continue;
+    for( st = j = 0; st < marker_num; st += AR_SQUARE_MAX ) {
+        num = (marker_num - st < AR_SQUARE_MAX)? marker_num - st: AR_SQUARE_MAX;
+        a->marker_info2 = &(marker_info2[st]);
+        a->marker_info  = &(marker_info[st]);
+        arThreadPoolRun( pool, get_info_func, a, num );
 
-        arGetCode(image,
-                  marker_info2[i].x_coord, marker_info2[i].y_coord,
-                  marker_info2[i].vertex, &id, &dir, &cf );
+        for( i = 0; i < num; i++ ) {
+            if( !a->ok[i] ) continue;
+            if( j != st+i ) marker_info[j] = marker_info[st+i];
+            j++;
+        }
+    }
+    a->marker_info2 = marker_info2;
+    a->marker_info  = marker_info;
 
-        info[j].id  = id;
-        info[j].dir = dir;
-        info[j].cf  = cf;
+    return j;
+}
 
-        j++;
+static void get_info_func( void *arg, int index )
+{
+    MarkerInfoArg  *a = (MarkerInfoArg *)arg;
+    ARMarkerInfo2  *m2 = &(a->marker_info2[index]);
+    ARMarkerInfo   *m = &(a->marker_info[index]);
+    int            ret;
+
+    m->area   = m2->area;
+    m->pos[0] = m2->pos[0];
+    m->pos[1] = m2->pos[1];
+
+    if( a->LorR < 0 ) {
+        ret = arGetLine( m2->x_coord, m2->y_coord, m2->coord_num, m2->vertex,
+                         m->line, m->vertex );
     }
-    *marker_num = j;
+    else {
+        ret = arsGetLine( m2->x_coord, m2->y_coord, m2->coord_num, m2->vertex,
+                          m->line, m->vertex, a->LorR );
+    }
+    a->ok[index] = (ret >= 0);
+    if( ret < 0 ) return;
 
-    return (info);
+    if( a->luma ) {
+        arGetCodeLuma( a->image, a->chroma_u, a->chroma_v,
+                       m2->x_coord, m2->y_coord, m2->vertex, &(m->id), &(m->dir), &(m->cf) );
+    }
+    else {
+        arGetCode( a->image,
+                   m2->x_coord, m2->y_coord, m2->vertex, &(m->id), &(m->dir), &(m->cf) );
+    }
 }
-
@@ -13,15 +13,15 @@
 #include <math.h>
 #include <AR/ar.h>
 #include <AR/matrix.h>
+#include <AR/arStats.h>
 
 #define P_MAX       500
 
-static double  pos2d[P_MAX][2];
-static double  pos3d[P_MAX][3];
-
 static double arGetTransMatSub( double rot[3][3], double ppos2d[][2],
-                                double pos3d[][3], int num, double conv[3][4],
+                                double pos3d[][3], double pos2d[][2], int num, double conv[3][4],
                                 double *dist_factor, double cpara[3][4] );
+static void   arGetTransMatTrans( double rot[3][3], double pos3d[][3], double pos2d[][2],
+                                  int num, double cpara[3][4], double trans[3] );
 
 double arGetTransMat( ARMarkerInfo *marker_info,
                       double center[2], double width, double conv[3][4] )
@@ -32,7 +32,9 @@ double arGetTransMat( ARMarkerInfo *marker_info,
     int     dir;
     double  err;
     int     i;
+    AR_STATS_VAR(t);
 
+    AR_STATS_START(t);
     if( arGetInitRot( marker_info, arParam.mat, rot ) < 0 ) return -1;
 
     dir = marker_info->dir;
@@ -58,6 +60,7 @@ double arGetTransMat( ARMarkerInfo *marker_info,
                                    arParam.dist_factor, arParam.mat );
         if( err < AR_GET_TRANS_MAT_MAX_FIT_ERROR ) break;
     }
+    AR_STATS_STOP( AR_STATS_POSE, t );
     return err;
 }
 
@@ -72,10 +75,25 @@ double arGetTransMat3( double rot[3][3], double ppos2d[][2],
                        double ppos3d[][2], int num, double conv[3][4],
                        double *dist_factor, double cpara[3][4] )
 {
+    double  wpos2d[P_MAX][2];
+    double  wpos3d[P_MAX][3];
+    double  *mpos2d, *mpos3d;
+    double  (*pos2d)[2], (*pos3d)[3];
     double  off[3], pmax[3], pmin[3];
     double  ret;
     int     i;
 
+    if( num <= P_MAX ) {
+        pos2d = wpos2d;
+        pos3d = wpos3d;
+    }
+    else {
+        arMalloc( mpos2d, double, num*2 );
+        arMalloc( mpos3d, double, num*3 );
+        pos2d = (double (*)[2])mpos2d;
+        pos3d = (double (*)[3])mpos3d;
+    }
+
     pmax[0]=pmax[1]=pmax[2] = -10000000000.0;
     pmin[0]=pmin[1]=pmin[2] =  10000000000.0;
     for( i = 0; i < num; i++ ) {
@@ -100,13 +118,18 @@ double arGetTransMat3( double rot[3][3], double ppos2d[][2],
         pos3d[i][2] = 0.0;
     }
 
-    ret = arGetTransMatSub( rot, ppos2d, pos3d, num, conv,
+    ret = arGetTransMatSub( rot, ppos2d, pos3d, pos2d, num, conv,
                             dist_factor, cpara );
 
     conv[0][3] = conv[0][0]*off[0] + conv[0][1]*off[1] + conv[0][2]*off[2] + conv[0][3];
     conv[1][3] = conv[1][0]*off[0] + conv[1][1]*off[1] + conv[1][2]*off[2] + conv[1][3];
     conv[2][3] = conv[2][0]*off[0] + conv[2][1]*off[1] + conv[2][2]*off[2] + conv[2][3];
 
+    if( num > P_MAX ) {
+        free( mpos3d );
+        free( mpos2d );
+    }
+
     return ret;
 }
 
@@ -120,6 +143,31 @@ double arGetTransMat4( double rot[3][3], double ppos2d[][2],
 double arGetTransMat5( double rot[3][3], double ppos2d[][2],
                        double ppos3d[][3], int num, double conv[3][4],
                        double *dist_factor, double cpara[3][4] )
+{
+    double  wpos2d[P_MAX][2];
+    double  wpos3d[P_MAX][3];
+    double  *pos2d, *pos3d;
+    double  ret;
+
+    if( num <= P_MAX ) {
+        return arGetTransMat5Work( rot, ppos2d, ppos3d, num, conv,
+                                   dist_factor, cpara, wpos2d, wpos3d );
+    }
+
+    arMalloc( pos2d, double, num*2 );
+    arMalloc( pos3d, double, num*3 );
+    ret = arGetTransMat5Work( rot, ppos2d, ppos3d, num, conv, dist_factor, cpara,
+                              (double (*)[2])pos2d, (double (*)[3])pos3d );
+    free( pos3d );
+    free( pos2d );
+
+    return ret;
+}
+
+double arGetTransMat5Work( double rot[3][3], double ppos2d[][2],
+                           double ppos3d[][3], int num, double conv[3][4],
+                           double *dist_factor, double cpara[3][4],
+                           double pos2d[][2], double pos3d[][3] )
 {
     double  off[3], pmax[3], pmin[3];
     double  ret;
@@ -144,7 +192,7 @@ double arGetTransMat5( double rot[3][3], double ppos2d[][2],
         pos3d[i][2] = ppos3d[i][2] + off[2];
     }
 
-    ret = arGetTransMatSub( rot, ppos2d, pos3d, num, conv,
+    ret = arGetTransMatSub( rot, ppos2d, pos3d, pos2d, num, conv,
                             dist_factor, cpara );
 
     conv[0][3] = conv[0][0]*off[0] + conv[0][1]*off[1] + conv[0][2]*off[2] + conv[0][3];
@@ -155,22 +203,13 @@ double arGetTransMat5( double rot[3][3], double ppos2d[][2],
 }
 
 static double arGetTransMatSub( double rot[3][3], double ppos2d[][2],
-                                double pos3d[][3], int num, double conv[3][4],
+                                double pos3d[][3], double pos2d[][2], int num, double conv[3][4],
                                 double *dist_factor, double cpara[3][4] )
 {
-    ARMat   *mat_a, *mat_b, *mat_c, *mat_d, *mat_e, *mat_f;
     double  trans[3];
-    double  wx, wy, wz;
     double  ret;
     int     i, j;
 
-    mat_a = arMatrixAlloc( num*2, 3 );
-    mat_b = arMatrixAlloc( 3, num*2 );
-    mat_c = arMatrixAlloc( num*2, 1 );
-    mat_d = arMatrixAlloc( 3, 3 );
-    mat_e = arMatrixAlloc( 3, 1 );
-    mat_f = arMatrixAlloc( 3, 1 );
-
     if( arFittingMode == AR_FITTING_TO_INPUT ) {
         for( i = 0; i < num; i++ ) {
             arParamIdeal2Observ(dist_factor, ppos2d[i][0], ppos2d[i][1],
@@ -184,37 +223,38 @@ static double arGetTransMatSub( double rot[3][3], double ppos2d[][2],
         }
     }
 
-    for( j = 0; j < num; j++ ) {
-        wx = rot[0][0] * pos3d[j][0]
-           + rot[0][1] * pos3d[j][1]
-           + rot[0][2] * pos3d[j][2];
-        wy = rot[1][0] * pos3d[j][0]
-           + rot[1][1] * pos3d[j][1]
-           + rot[1][2] * pos3d[j][2];
-        wz = rot[2][0] * pos3d[j][0]
-           + rot[2][1] * pos3d[j][1]
-           + rot[2][2] * pos3d[j][2];
-        mat_a->m[j*6+0] = mat_b->m[num*0+j*2] = cpara[0][0];
-        mat_a->m[j*6+1] = mat_b->m[num*2+j*2] = cpara[0][1];
-        mat_a->m[j*6+2] = mat_b->m[num*4+j*2] = cpara[0][2] - pos2d[j][0];
-        mat_c->m[j*2+0] = wz * pos2d[j][0]
-               - cpara[0][0]*wx - cpara[0][1]*wy - cpara[0][2]*wz;
-        mat_a->m[j*6+3] = mat_b->m[num*0+j*2+1] = 0.0;
-        mat_a->m[j*6+4] = mat_b->m[num*2+j*2+1] = cpara[1][1];
-        mat_a->m[j*6+5] = mat_b->m[num*4+j*2+1] = cpara[1][2] - pos2d[j][1];
-        mat_c->m[j*2+1] = wz * pos2d[j][1]
-               - cpara[1][1]*wy - cpara[1][2]*wz;
-    }
-    arMatrixMul( mat_d, mat_b, mat_a );
-    arMatrixMul( mat_e, mat_b, mat_c );
-    arMatrixSelfInv( mat_d );
-    arMatrixMul( mat_f, mat_d, mat_e );
-    trans[0] = mat_f->m[0];
-    trans[1] = mat_f->m[1];
-    trans[2] = mat_f->m[2];
+    arGetTransMatTrans( rot, pos3d, pos2d, num, cpara, trans );
+    ret = arModifyMatrix( rot, trans, cpara, pos3d, pos2d, num );
 
+    arGetTransMatTrans( rot, pos3d, pos2d, num, cpara, trans );
     ret = arModifyMatrix( rot, trans, cpara, pos3d, pos2d, num );
 
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 3; i++ ) conv[j][i] = rot[j][i];
+        conv[j][3] = trans[j];
+    }
+
+    return ret;
+}
+
+/*
+ * Least-squares translation for a fixed rotation. The 3x3 normal
+ * equations (A^T A) t = A^T c are accumulated row by row instead of
+ * building the 2*num x 3 matrix A, in the same summation order as
+ * arMatrixMul(), so no memory is allocated whatever num is.
+ */
+static void arGetTransMatTrans( double rot[3][3], double pos3d[][3], double pos2d[][2],
+                                int num, double cpara[3][4], double trans[3] )
+{
+    ARMat   mat_d;
+    double  d[9], e[3];
+    double  a[2][3], c[2];
+    double  wx, wy, wz;
+    int     i, j, k;
+
+    for( i = 0; i < 9; i++ ) d[i] = 0.0;
+    for( i = 0; i < 3; i++ ) e[i] = 0.0;
+
     for( j = 0; j < num; j++ ) {
         wx = rot[0][0] * pos3d[j][0]
            + rot[0][1] * pos3d[j][1]
@@ -225,38 +265,34 @@ static double arGetTransMatSub( double rot[3][3], double ppos2d[][2],
         wz = rot[2][0] * pos3d[j][0]
            + rot[2][1] * pos3d[j][1]
            + rot[2][2] * pos3d[j][2];
-        mat_a->m[j*6+0] = mat_b->m[num*0+j*2] = cpara[0][0];
-        mat_a->m[j*6+1] = mat_b->m[num*2+j*2] = cpara[0][1];
-        mat_a->m[j*6+2] = mat_b->m[num*4+j*2] = cpara[0][2] - pos2d[j][0];
-        mat_c->m[j*2+0] = wz * pos2d[j][0]
-               - cpara[0][0]*wx - cpara[0][1]*wy - cpara[0][2]*wz;
-        mat_a->m[j*6+3] = mat_b->m[num*0+j*2+1] = 0.0;
-        mat_a->m[j*6+4] = mat_b->m[num*2+j*2+1] = cpara[1][1];
-        mat_a->m[j*6+5] = mat_b->m[num*4+j*2+1] = cpara[1][2] - pos2d[j][1];
-        mat_c->m[j*2+1] = wz * pos2d[j][1]
-               - cpara[1][1]*wy - cpara[1][2]*wz;
+        a[0][0] = cpara[0][0];
+        a[0][1] = cpara[0][1];
+        a[0][2] = cpara[0][2] - pos2d[j][0];
+        c[0]    = wz * pos2d[j][0]
+                - cpara[0][0]*wx - cpara[0][1]*wy - cpara[0][2]*wz;
+        a[1][0] = 0.0;
+        a[1][1] = cpara[1][1];
+        a[1][2] = cpara[1][2] - pos2d[j][1];
+        c[1]    = wz * pos2d[j][1]
+                - cpara[1][1]*wy - cpara[1][2]*wz;
+        for( k = 0; k < 2; k++ ) {
+            for( i = 0; i < 3; i++ ) {
+                d[i*3+0] += a[k][i] * a[k][0];
+                d[i*3+1] += a[k][i] * a[k][1];
+                d[i*3+2] += a[k][i] * a[k][2];
+                e[i]     += a[k][i] * c[k];
+            }
+        }
     }
-    arMatrixMul( mat_d, mat_b, mat_a );
-    arMatrixMul( mat_e, mat_b, mat_c );
-    arMatrixSelfInv( mat_d );
-    arMatrixMul( mat_f, mat_d, mat_e );
-    trans[0] = mat_f->m[0];
-    trans[1] = mat_f->m[1];
-    trans[2] = mat_f->m[2];
-
-    ret = arModifyMatrix( rot, trans, cpara, pos3d, pos2d, num );
 
-    arMatrixFree( mat_a );
-    arMatrixFree( mat_b );
-    arMatrixFree( mat_c );
-    arMatrixFree( mat_d );
-    arMatrixFree( mat_e );
-    arMatrixFree( mat_f );
-
-    for( j = 0; j < 3; j++ ) {
-        for( i = 0; i < 3; i++ ) conv[j][i] = rot[j][i];
-        conv[j][3] = trans[j];
+    mat_d.m   = d;
+    mat_d.row = 3;
+    mat_d.clm = 3;
+    arMatrixSelfInv( &mat_d );
+    for( i = 0; i < 3; i++ ) {
+        trans[i] = 0.0;
+        trans[i] += d[i*3+0] * e[0];
+        trans[i] += d[i*3+1] * e[1];
+        trans[i] += d[i*3+2] * e[2];
     }
-
-    return ret;
 }
@@ -15,6 +15,9 @@
 
 #define MD_PI         3.14159265358979323846
 
+static double arModifyMatrixf( double rot[3][3], double trans[3], double cpara[3][4],
+                               double vertex[][3], double pos2d[][2], int num );
+
 double arModifyMatrix( double rot[3][3], double trans[3], double cpara[3][4],
                              double vertex[][3], double pos2d[][2], int num )
 {
@@ -30,6 +33,10 @@ double arModifyMatrix( double rot[3][3], double trans[3], double cpara[3][4],
     int       s1 = 0, s2 = 0, s3 = 0;
     int       i, j;
 
+    if( arPrecisionMode == AR_PRECISION_FLOAT ) {
+        return arModifyMatrixf( rot, trans, cpara, vertex, pos2d, num );
+    }
+
     arGetAngle( rot, &a, &b, &c );
 
     a2 = a;
@@ -91,6 +98,119 @@ double arModifyMatrix( double rot[3][3], double trans[3], double cpara[3][4],
     return minerr/num;
 }
 
+/*
+ * Single precision version of the search above. The start and end
+ * rotations go through the double routines; the 270 candidate
+ * projections in between are evaluated in float.
+ */
+static double arModifyMatrixf( double rot[3][3], double trans[3], double cpara[3][4],
+                               double vertex[][3], double pos2d[][2], int num )
+{
+    float     cp[3][4];
+    float     t[3];
+    float     factor;
+    double    a, b, c;
+    float     a1, b1, c1;
+    float     a2, b2, c2;
+    float     ma = 0.0f, mb = 0.0f, mc = 0.0f;
+    float     sina, sinb, sinc, cosa, cosb, cosc;
+    float     r[3][3];
+    float     combo[3][4];
+    float     hx, hy, h, x, y;
+    float     err, minerr = 0.0f;
+    int       t1, t2, t3;
+    int       s1 = 0, s2 = 0, s3 = 0;
+    int       i, j, k;
+
+    if( num <= 0 ) return -1;
+
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 4; i++ ) cp[j][i] = (float)cpara[j][i];
+        t[j] = (float)trans[j];
+    }
+
+    arGetAngle( rot, &a, &b, &c );
+
+    a2 = (float)a;
+    b2 = (float)b;
+    c2 = (float)c;
+    factor = (float)(10.0*MD_PI/180.0);
+    for( j = 0; j < 10; j++ ) {
+        minerr = 1000000000.0f;
+        for(t1=-1;t1<=1;t1++) {
+        for(t2=-1;t2<=1;t2++) {
+        for(t3=-1;t3<=1;t3++) {
+            a1 = a2 + factor*t1;
+            b1 = b2 + factor*t2;
+            c1 = c2 + factor*t3;
+
+            sina = sinf(a1); cosa = cosf(a1);
+            sinb = sinf(b1); cosb = cosf(b1);
+            sinc = sinf(c1); cosc = cosf(c1);
+            r[0][0] = cosa*cosa*cosb*cosc+sina*sina*cosc+sina*cosa*cosb*sinc-sina*cosa*sinc;
+            r[0][1] = -cosa*cosa*cosb*sinc-sina*sina*sinc+sina*cosa*cosb*cosc-sina*cosa*cosc;
+            r[0][2] = cosa*sinb;
+            r[1][0] = sina*cosa*cosb*cosc-sina*cosa*cosc+sina*sina*cosb*sinc+cosa*cosa*sinc;
+            r[1][1] = -sina*cosa*cosb*sinc+sina*cosa*sinc+sina*sina*cosb*cosc+cosa*cosa*cosc;
+            r[1][2] = sina*sinb;
+            r[2][0] = -cosa*sinb*cosc-sina*sinb*sinc;
+            r[2][1] = cosa*sinb*sinc-sina*sinb*cosc;
+            r[2][2] = cosb;
+            for( k = 0; k < 3; k++ ) {
+                for( i = 0; i < 3; i++ ) {
+                    combo[k][i] = cp[k][0] * r[0][i]
+                                + cp[k][1] * r[1][i]
+                                + cp[k][2] * r[2][i];
+                }
+                combo[k][3] = cp[k][0] * t[0]
+                            + cp[k][1] * t[1]
+                            + cp[k][2] * t[2]
+                            + cp[k][3];
+            }
+
+            err = 0.0f;
+            for( i = 0; i < num; i++ ) {
+                hx = combo[0][0] * (float)vertex[i][0]
+                   + combo[0][1] * (float)vertex[i][1]
+                   + combo[0][2] * (float)vertex[i][2]
+                   + combo[0][3];
+                hy = combo[1][0] * (float)vertex[i][0]
+                   + combo[1][1] * (float)vertex[i][1]
+                   + combo[1][2] * (float)vertex[i][2]
+                   + combo[1][3];
+                h  = combo[2][0] * (float)vertex[i][0]
+                   + combo[2][1] * (float)vertex[i][1]
+                   + combo[2][2] * (float)vertex[i][2]
+                   + combo[2][3];
+                x = hx / h;
+                y = hy / h;
+
+                err += ((float)pos2d[i][0] - x) * ((float)pos2d[i][0] - x)
+                     + ((float)pos2d[i][1] - y) * ((float)pos2d[i][1] - y);
+            }
+
+            if( err < minerr ) {
+                minerr = err;
+                ma = a1;
+                mb = b1;
+                mc = c1;
+                s1 = t1; s2 = t2; s3 = t3;
+            }
+        }
+        }
+        }
+
+        if( s1 == 0 && s2 == 0 && s3 == 0 ) factor *= 0.5f;
+        a2 = ma;
+        b2 = mb;
+        c2 = mc;
+    }
+
+    arGetRot( ma, mb, mc, rot );
+
+    return (double)minerr/num;
+}
+
 double arsModifyMatrix( double rot[3][3], double trans[3], ARSParam *arsParam,
                         double pos3dL[][3], double pos2dL[][2], int numL,
                         double pos3dR[][3], double pos2dR[][2], int numR )
@@ -284,14 +284,18 @@ int arGetInitRot( ARMarkerInfo *marker_info, double cpara[3][4], double rot[3][3
 static int check_dir( double dir[3], double st[2], double ed[2],
                       double cpara[3][4] )
 {
-    ARMat     *mat_a;
+    ARMat     mat_a_buf, *mat_a;
+    double    m[9];
     double    world[2][3];
     double    camera[2][2];
     double    v[2][2];
     double    h;
     int       i, j;
 
-    mat_a = arMatrixAlloc( 3, 3 );
+    mat_a = &mat_a_buf;
+    mat_a->m   = m;
+    mat_a->row = 3;
+    mat_a->clm = 3;
     for(j=0;j<3;j++) for(i=0;i<3;i++) mat_a->m[j*3+i] = cpara[j][i];
     arMatrixSelfInv( mat_a );
     world[0][0] = mat_a->m[0]*st[0]*10.0
@@ -303,7 +307,6 @@ static int check_dir( double dir[3], double st[2], double ed[2],
     world[0][2] = mat_a->m[6]*st[0]*10.0
                 + mat_a->m[7]*st[1]*10.0
                 + mat_a->m[8]*10.0;
-    arMatrixFree( mat_a );
     world[1][0] = world[0][0] + dir[0];
     world[1][1] = world[0][1] + dir[1];
     world[1][2] = world[0][2] + dir[2];
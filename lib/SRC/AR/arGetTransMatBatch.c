@@ -0,0 +1,190 @@
+/*******************************************************
+ *
+ * Batch pose estimation over the shared worker pool.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include <AR/ar.h>
+#include <AR/arThread.h>
+#include <AR/arStats.h>
+
+/*
+ * Each marker is processed independently. Its four corners are kept as
+ * separate x/y arrays (structure of arrays) so that the per-corner loops
+ * of the translation solve have a fixed trip count and no gathers.
+ */
+typedef struct {
+    ARMarkerInfo       *marker_info;
+    const ARPattSpec   *spec;
+    double             (*conv)[3][4];
+    double             *err;
+} ARTransMatBatchArg;
+
+static void   batch_func( void *arg, int index );
+static double get_trans_mat_square( ARMarkerInfo *marker_info, const ARPattSpec *spec,
+                                    double conv[3][4] );
+static int    get_trans_soa( double rot[3][3], double cpara[3][4],
+                             const double ox[4], const double oy[4],
+                             const double mx[4], const double my[4], double trans[3] );
+
+int arGetTransMatBatch( ARMarkerInfo *marker_info, int marker_num,
+                        const ARPattSpec *spec, double (*conv)[3][4], double *err )
+{
+    ARTransMatBatchArg   arg;
+
+    if( marker_num < 0 ) return -1;
+    if( marker_num == 0 ) return 0;
+    if( marker_info == NULL || spec == NULL || conv == NULL || err == NULL ) return -1;
+
+    arg.marker_info = marker_info;
+    arg.spec        = spec;
+    arg.conv        = conv;
+    arg.err         = err;
+    if( arThreadPoolRun( arThreadPoolGetDefault(), batch_func, &arg, marker_num ) < 0 ) return -1;
+
+    return 0;
+}
+
+static void batch_func( void *arg, int index )
+{
+    ARTransMatBatchArg   *barg = (ARTransMatBatchArg *)arg;
+
+    barg->err[index] = get_trans_mat_square( &(barg->marker_info[index]),
+                                             &(barg->spec[index]), barg->conv[index] );
+}
+
+static double get_trans_mat_square( ARMarkerInfo *marker_info, const ARPattSpec *spec,
+                                    double conv[3][4] )
+{
+    double  rot[3][3];
+    double  trans[3];
+    double  px[4], py[4];
+    double  ox[4], oy[4];
+    double  mx[4], my[4];
+    double  vertex[4][3];
+    double  pos2d[4][2];
+    double  hw;
+    double  err;
+    int     dir;
+    int     i, j, k;
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
+    if( arGetInitRot( marker_info, arParam.mat, rot ) < 0 ) return -1;
+
+    dir = marker_info->dir;
+    hw  = spec->width / 2.0;
+    for( j = 0; j < 4; j++ ) {
+        px[j] = marker_info->vertex[(4-dir+j)%4][0];
+        py[j] = marker_info->vertex[(4-dir+j)%4][1];
+    }
+    mx[0] = -hw; my[0] =  hw;
+    mx[1] =  hw; my[1] =  hw;
+    mx[2] =  hw; my[2] = -hw;
+    mx[3] = -hw; my[3] = -hw;
+
+    if( arFittingMode == AR_FITTING_TO_INPUT ) {
+        for( j = 0; j < 4; j++ ) {
+            arParamIdeal2Observ( arParam.dist_factor, px[j], py[j], &ox[j], &oy[j] );
+        }
+    }
+    else {
+        for( j = 0; j < 4; j++ ) {
+            ox[j] = px[j];
+            oy[j] = py[j];
+        }
+    }
+    for( j = 0; j < 4; j++ ) {
+        vertex[j][0] = mx[j];
+        vertex[j][1] = my[j];
+        vertex[j][2] = 0.0;
+        pos2d[j][0]  = ox[j];
+        pos2d[j][1]  = oy[j];
+    }
+
+    err = -1;
+    for( i = 0; i < AR_GET_TRANS_MAT_MAX_LOOP_COUNT; i++ ) {
+        for( k = 0; k < 2; k++ ) {
+            if( get_trans_soa( rot, arParam.mat, ox, oy, mx, my, trans ) < 0 ) return -1;
+            err = arModifyMatrix( rot, trans, arParam.mat, vertex, pos2d, 4 );
+        }
+        if( err < AR_GET_TRANS_MAT_MAX_FIT_ERROR ) break;
+    }
+
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 3; i++ ) conv[j][i] = rot[j][i];
+        conv[j][3] = trans[j] - conv[j][0]*spec->center[0] - conv[j][1]*spec->center[1];
+    }
+    AR_STATS_STOP( AR_STATS_POSE, t );
+
+    return err;
+}
+
+/*
+ * Least-squares translation for a fixed rotation: the same normal equations
+ * as arGetTransMatSub(), accumulated directly for the four planar corners
+ * and solved in closed form.
+ */
+static int get_trans_soa( double rot[3][3], double cpara[3][4],
+                          const double ox[4], const double oy[4],
+                          const double mx[4], const double my[4], double trans[3] )
+{
+    double  ax[4], ay[4], bx[4], by[4];
+    double  wx, wy, wz;
+    double  sax, say, sbx, sby, saa, sab;
+    double  d00, d01, d02, d11, d12, d22;
+    double  e0, e1, e2;
+    double  i00, i01, i02, i11, i12, i22;
+    double  det;
+    int     j;
+
+    for( j = 0; j < 4; j++ ) {
+        wx = rot[0][0] * mx[j] + rot[0][1] * my[j];
+        wy = rot[1][0] * mx[j] + rot[1][1] * my[j];
+        wz = rot[2][0] * mx[j] + rot[2][1] * my[j];
+        ax[j] = cpara[0][2] - ox[j];
+        ay[j] = cpara[1][2] - oy[j];
+        bx[j] = wz * ox[j] - cpara[0][0]*wx - cpara[0][1]*wy - cpara[0][2]*wz;
+        by[j] = wz * oy[j] - cpara[1][1]*wy - cpara[1][2]*wz;
+    }
+
+    sax = say = sbx = sby = saa = sab = 0.0;
+    for( j = 0; j < 4; j++ ) {
+        sax += ax[j];
+        say += ay[j];
+        sbx += bx[j];
+        sby += by[j];
+        saa += ax[j]*ax[j] + ay[j]*ay[j];
+        sab += ax[j]*bx[j] + ay[j]*by[j];
+    }
+
+    d00 = 4.0 * cpara[0][0] * cpara[0][0];
+    d01 = 4.0 * cpara[0][0] * cpara[0][1];
+    d02 = cpara[0][0] * sax;
+    d11 = 4.0 * (cpara[0][1] * cpara[0][1] + cpara[1][1] * cpara[1][1]);
+    d12 = cpara[0][1] * sax + cpara[1][1] * say;
+    d22 = saa;
+    e0  = cpara[0][0] * sbx;
+    e1  = cpara[0][1] * sbx + cpara[1][1] * sby;
+    e2  = sab;
+
+    i00 = d11*d22 - d12*d12;
+    i01 = d02*d12 - d01*d22;
+    i02 = d01*d12 - d02*d11;
+    i11 = d00*d22 - d02*d02;
+    i12 = d01*d02 - d00*d12;
+    i22 = d00*d11 - d01*d01;
+    det = d00*i00 + d01*i01 + d02*i02;
+    if( det == 0.0 ) return -1;
+
+    trans[0] = (i00*e0 + i01*e1 + i02*e2) / det;
+    trans[1] = (i01*e0 + i11*e1 + i12*e2) / det;
+    trans[2] = (i02*e0 + i12*e1 + i22*e2) / det;
+
+    return 0;
+}
@@ -14,6 +14,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <AR/ar.h>
+#include <AR/arStats.h>
 
 #ifdef _WIN32
 #  include <windows.h>
@@ -57,12 +58,24 @@ static int          wclipR[WORK_SIZE*4];
 static double       wposL[WORK_SIZE*2];
 static double       wposR[WORK_SIZE*2];
 
+/* histograms of the threshold test value (sum of the 3 components) */
+static int          whist[AR_THRESH_HIST_SIZE];
+static int          whist_num;
+static int          whist_roi[AR_THRESH_HIST_SIZE];
+static int          whist_roi_num;
+static int          hist_roi[AR_SQUARE_MAX*4];
+static int          hist_roi_num = 0;
+static int          lroi[AR_SQUARE_MAX*4];
+
 static ARInt16 *labeling2( ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
-                           int **label_ref, int LorR );
+                           int **label_ref, int LorR, int mono, int luma, int *region );
 static ARInt16 *labeling3( ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
-                           int **label_ref, int LorR );
+                           int **label_ref, int LorR, int mono, int luma );
+static void     get_components( int luma, int *c0, int *c1, int *c2 );
+static int      histogram_start( int mono, int lxsize, int lysize );
+static void     histogram_row( ARUint8 *pnt, int poff, int n, int y, int luma );
 
 void arGetImgFeature( int *num, int **area, int **clip, double **pos )
 {
@@ -78,13 +91,76 @@ ARInt16 *arLabeling( ARUint8 *image, int thresh,
                      int *label_num, int **area, double **pos, int **clip,
                      int **label_ref )
 {
+    ARInt16   *limage;
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
     if( arDebug ) {
-        return( labeling3(image, thresh, label_num,
-                          area, pos, clip, label_ref, 1) );
+        limage = labeling3(image, thresh, label_num,
+                           area, pos, clip, label_ref, 1, 1, 0);
     } else {
-        return( labeling2(image, thresh, label_num,
-                          area, pos, clip, label_ref, 1) );
+        limage = labeling2(image, thresh, label_num,
+                           area, pos, clip, label_ref, 1, 1, 0, NULL);
     }
+    AR_STATS_STOP( AR_STATS_LABELING, t );
+
+    return( limage );
+}
+
+void arGetImgHistogram( int **hist, int *hist_num, int **hist_roi, int *hist_roi_num )
+{
+    *hist         = whist;
+    *hist_num     = whist_num;
+    *hist_roi     = whist_roi;
+    *hist_roi_num = whist_roi_num;
+
+    return;
+}
+
+void arSetImgHistogramROI( int *roi, int roi_num )
+{
+    int     i;
+
+    if( roi_num > AR_SQUARE_MAX ) roi_num = AR_SQUARE_MAX;
+    for( i = 0; i < roi_num*4; i++ ) hist_roi[i] = roi[i];
+    hist_roi_num = roi_num;
+
+    return;
+}
+
+ARInt16 *arLabelingLuma( ARUint8 *luma, int thresh,
+                         int *label_num, int **area, double **pos, int **clip,
+                         int **label_ref )
+{
+    ARInt16   *limage;
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
+    if( arDebug ) {
+        limage = labeling3(luma, thresh, label_num,
+                           area, pos, clip, label_ref, 1, 1, 1);
+    } else {
+        limage = labeling2(luma, thresh, label_num,
+                           area, pos, clip, label_ref, 1, 1, 1, NULL);
+    }
+    AR_STATS_STOP( AR_STATS_LABELING, t );
+
+    return( limage );
+}
+
+ARInt16 *arLabelingRegion( ARUint8 *image, int thresh, int region[4],
+                           int *label_num, int **area, double **pos, int **clip,
+                           int **label_ref )
+{
+    ARInt16   *limage;
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
+    limage = labeling2(image, thresh, label_num,
+                       area, pos, clip, label_ref, 1, 1, 0, region);
+    AR_STATS_STOP( AR_STATS_LABELING, t );
+
+    return( limage );
 }
 
 void arsGetImgFeature( int *num, int **area, int **clip, double **pos, int LorR )
@@ -108,18 +184,25 @@ ARInt16 *arsLabeling( ARUint8 *image, int thresh,
                       int *label_num, int **area, double **pos, int **clip,
                       int **label_ref, int LorR )
 {
+    ARInt16   *limage;
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
     if( arDebug ) {
-        return( labeling3(image, thresh, label_num,
-                          area, pos, clip, label_ref, LorR) );
+        limage = labeling3(image, thresh, label_num,
+                           area, pos, clip, label_ref, LorR, 0, 0);
     } else {
-        return( labeling2(image, thresh, label_num,
-                          area, pos, clip, label_ref, LorR) );
+        limage = labeling2(image, thresh, label_num,
+                           area, pos, clip, label_ref, LorR, 0, 0, NULL);
     }
+    AR_STATS_STOP( AR_STATS_LABELING, t );
+
+    return( limage );
 }
 
 static ARInt16 *labeling2( ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
-                           int **label_ref, int LorR )
+                           int **label_ref, int LorR, int mono, int luma, int *region )
 {
     ARUint8   *pnt;                     /*  image pointer       */
     ARInt16   *pnt1, *pnt2;             /*  image pointer       */
@@ -129,12 +212,17 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
     int       i,j,k;                    /*  for loop            */
     int       lxsize, lysize;
     int       poff;
+    int       psize;                    /*  bytes per pixel     */
+    int       c0, c1, c2;               /*  components to sum   */
     ARInt16   *l_image;
     int       *work, *work2;
     int       *wlabel_num;
     int       *warea;
     int       *wclip;
     double    *wpos;
+    int       hist;
+    int       x0, x1, y0, y1;           /*  labeled region      */
+    int       skip;
 #ifdef USE_OPTIMIZATIONS
 	int		  pnt2_index;   // [tp]
 #endif
@@ -212,35 +300,60 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
     }
 #endif
 
+    // Offsets of the components summed by the threshold test. A luminance
+    // plane goes through the same test, without a branch per pixel.
+    get_components( luma, &c0, &c1, &c2 );
+    if( region == NULL ) {
+        x0 = 1; x1 = lxsize - 2;
+        y0 = 1; y1 = lysize - 2;
+        hist = histogram_start( mono, lxsize, lysize );
+    }
+    else {
+        // Only the pixels of the region; the ones around it are background.
+        x0 = region[0]; x1 = region[1];
+        y0 = region[2]; y1 = region[3];
+        pnt1 = &l_image[(y0-1)*lxsize + x0-1];
+        pnt2 = &l_image[(y1+1)*lxsize + x0-1];
+        for(i = x0-1; i <= x1+1; i++) {
+            *(pnt1++) = *(pnt2++) = 0;
+        }
+        for(j = y0; j <= y1; j++) {
+            l_image[j*lxsize + x0-1] = l_image[j*lxsize + x1+1] = 0;
+        }
+        hist = 0;
+    }
+    psize = (luma)? 1: AR_PIX_SIZE_DEFAULT;
+    skip = lxsize - (x1 - x0 + 1);
     wk_max = 0;
-    pnt2 = &(l_image[lxsize+1]);
+    pnt2 = &(l_image[y0*lxsize+x0]);
     if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) {
-        pnt = &(image[(arImXsize*2+2)*AR_PIX_SIZE_DEFAULT]);
-        poff = AR_PIX_SIZE_DEFAULT*2;
+        pnt = &(image[(y0*arImXsize*2+x0*2)*psize]);
+        poff = psize*2;
     } else {
-        pnt = &(image[(arImXsize+1)*AR_PIX_SIZE_DEFAULT]);
-        poff = AR_PIX_SIZE_DEFAULT;
+        pnt = &(image[(y0*arImXsize+x0)*psize]);
+        poff = psize;
     }
-    for (j = 1; j < lysize - 1; j++, pnt += poff*2, pnt2 += 2) {
-        for(i = 1; i < lxsize-1; i++, pnt+=poff, pnt2++) {
+    for (j = y0; j <= y1; j++, pnt += poff*skip, pnt2 += skip) {
+        if( hist && j % AR_THRESH_HIST_STEP == 0 ) histogram_row( pnt, poff, lxsize-2, j, luma );
+        for(i = x0; i <= x1; i++, pnt+=poff, pnt2++) {
 #if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
-            if( *(pnt+1) + *(pnt+2) + *(pnt+3) <= thresht3 )
+            if( *(pnt+c0) + *(pnt+c1) + *(pnt+c2) <= thresht3 )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
-            if( *(pnt+1) + *(pnt+2) + *(pnt+3) <= thresht3 )
+            if( *(pnt+c0) + *(pnt+c1) + *(pnt+c2) <= thresht3 )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 )
+            if( *(pnt+c0) + *(pnt+c1) + *(pnt+c2) <= thresht3 )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGR)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 )
+            if( *(pnt+c0) + *(pnt+c1) + *(pnt+c2) <= thresht3 )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 )
+            if( *(pnt+c0) + *(pnt+c1) + *(pnt+c2) <= thresht3 )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGB)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 )
+            if( *(pnt+c0) + *(pnt+c1) + *(pnt+c2) <= thresht3 )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO)
 			if( *(pnt) <= thresh )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
-			if( *(pnt+1) <= thresh )
+			if( *(pnt+c0) <= thresh )
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
-			if( *(pnt+0) <= thresh )
+			if( *(pnt+c0) <= thresh )
 #else
 #  error Unknown default pixel format defined in config.h
 #endif
@@ -418,7 +531,7 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
                 *pnt2 = 0;
             }
         }
-        if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) pnt += arImXsize*AR_PIX_SIZE_DEFAULT;
+        if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) pnt += arImXsize*psize;
     }
 
     j = 1;
@@ -462,9 +575,86 @@ static ARInt16 *labeling2( ARUint8 *image, int thresh,
     return (l_image);
 }
 
+static void get_components( int luma, int *c0, int *c1, int *c2 )
+{
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB) || (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
+    *c0 = 1; *c1 = 2; *c2 = 3;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
+    *c0 = *c1 = *c2 = 1;
+#elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO) || (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
+    *c0 = *c1 = *c2 = 0;
+#else
+    *c0 = 0; *c1 = 1; *c2 = 2;
+#endif
+    if( luma ) *c0 = *c1 = *c2 = 0;
+}
+
+/*
+ * The histograms are gathered for the automatic threshold of the mono
+ * detection only (the stereo left eye shares the L buffers), on one
+ * pixel out of AR_THRESH_HIST_STEP in both directions, while the rows are
+ * read by the labeling anyway.
+ */
+static int histogram_start( int mono, int lxsize, int lysize )
+{
+    int     i;
+
+    if( !mono || arThresholdMode == AR_THRESHOLD_MODE_MANUAL ) return 0;
+
+    put_zero( whist,     AR_THRESH_HIST_SIZE * sizeof(int) );
+    put_zero( whist_roi, AR_THRESH_HIST_SIZE * sizeof(int) );
+    whist_num = whist_roi_num = 0;
+
+    /* regions of interest in labeling coordinates, inside the border */
+    for( i = 0; i < hist_roi_num; i++ ) {
+        if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
+            lroi[i*4+0] = hist_roi[i*4+0] / 2;
+            lroi[i*4+1] = hist_roi[i*4+1] / 2;
+            lroi[i*4+2] = hist_roi[i*4+2] / 2;
+            lroi[i*4+3] = hist_roi[i*4+3] / 2;
+        }
+        else {
+            lroi[i*4+0] = hist_roi[i*4+0];
+            lroi[i*4+1] = hist_roi[i*4+1];
+            lroi[i*4+2] = hist_roi[i*4+2];
+            lroi[i*4+3] = hist_roi[i*4+3];
+        }
+        if( lroi[i*4+0] < 1 )        lroi[i*4+0] = 1;
+        if( lroi[i*4+1] > lxsize-2 ) lroi[i*4+1] = lxsize-2;
+        if( lroi[i*4+2] < 1 )        lroi[i*4+2] = 1;
+        if( lroi[i*4+3] > lysize-2 ) lroi[i*4+3] = lysize-2;
+    }
+
+    return 1;
+}
+
+/* pnt: pixel 1 of row y, n: pixels in the row */
+static void histogram_row( ARUint8 *pnt, int poff, int n, int y, int luma )
+{
+    ARUint8   *p;
+    int       c0, c1, c2;
+    int       i, k;
+
+    get_components( luma, &c0, &c1, &c2 );
+
+    for( i = 0, p = pnt; i < n; i += AR_THRESH_HIST_STEP, p += poff*AR_THRESH_HIST_STEP ) {
+        whist[ *(p+c0) + *(p+c1) + *(p+c2) ]++;
+        whist_num++;
+    }
+
+    for( k = 0; k < hist_roi_num; k++ ) {
+        if( y < lroi[k*4+2] || y > lroi[k*4+3] ) continue;
+        p = pnt + (lroi[k*4+0]-1)*poff;
+        for( i = lroi[k*4+0]; i <= lroi[k*4+1]; i += AR_THRESH_HIST_STEP, p += poff*AR_THRESH_HIST_STEP ) {
+            whist_roi[ *(p+c0) + *(p+c1) + *(p+c2) ]++;
+            whist_roi_num++;
+        }
+    }
+}
+
 static ARInt16 *labeling3( ARUint8 *image, int thresh,
                            int *label_num, int **area, double **pos, int **clip,
-                           int **label_ref, int LorR )
+                           int **label_ref, int LorR, int mono, int luma )
 {
     ARUint8   *pnt;                     /*  image pointer       */
     ARInt16   *pnt1, *pnt2;             /*  image pointer       */
@@ -474,6 +664,7 @@ static ARInt16 *labeling3( ARUint8 *image, int thresh,
     int       i,j,k;                    /*  for loop            */
     int       lxsize, lysize;
     int       poff;
+    int       psize;                    /*  bytes per pixel     */
     ARUint8   *dpnt;
     ARInt16   *l_image;
     int       *work, *work2;
@@ -481,6 +672,7 @@ static ARInt16 *labeling3( ARUint8 *image, int thresh,
     int       *warea;
     int       *wclip;
     double    *wpos;
+    int       hist;
 	int		  thresht3 = thresh * 3;
 	static int imageProcModePrev = -1;
 	static int imXsizePrev = -1;
@@ -564,46 +756,49 @@ static ARInt16 *labeling3( ARUint8 *image, int thresh,
         pnt2 += lxsize;
     }
 
+    hist = histogram_start( mono, lxsize, lysize );
+    psize = (luma)? 1: AR_PIX_SIZE_DEFAULT;
     wk_max = 0;
     pnt2 = &(l_image[lxsize+1]);
     if( LorR ) dpnt = &(arImageL[(lxsize+1)*AR_PIX_SIZE_DEFAULT]);
     else       dpnt = &(arImageR[(lxsize+1)*AR_PIX_SIZE_DEFAULT]);
     if( arImageProcMode == AR_IMAGE_PROC_IN_HALF ) {
-        pnt = &(image[(arImXsize*2+2)*AR_PIX_SIZE_DEFAULT]);
-        poff = AR_PIX_SIZE_DEFAULT*2;
+        pnt = &(image[(arImXsize*2+2)*psize]);
+        poff = psize*2;
     }
     else {
-        pnt = &(image[(arImXsize+1)*AR_PIX_SIZE_DEFAULT]);
-        poff = AR_PIX_SIZE_DEFAULT;
+        pnt = &(image[(arImXsize+1)*psize]);
+        poff = psize;
     }
     for(j = 1; j < lysize-1; j++, pnt+=poff*2, pnt2+=2, dpnt+=AR_PIX_SIZE_DEFAULT*2) {
+        if( hist && j % AR_THRESH_HIST_STEP == 0 ) histogram_row( pnt, poff, lxsize-2, j, luma );
         for(i = 1; i < lxsize-1; i++, pnt+=poff, pnt2++, dpnt+=AR_PIX_SIZE_DEFAULT) {
 #if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
-            if( *(pnt+1) + *(pnt+2) + *(pnt+3) <= thresht3 ) {
+            if( luma? *pnt <= thresh: *(pnt+1) + *(pnt+2) + *(pnt+3) <= thresht3 ) {
                 *(dpnt+1) = *(dpnt+2) = *(dpnt+3) = 255;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
-            if( *(pnt+1) + *(pnt+2) + *(pnt+3) <= thresht3 ) {
+            if( luma? *pnt <= thresh: *(pnt+1) + *(pnt+2) + *(pnt+3) <= thresht3 ) {
                 *(dpnt+1) = *(dpnt+2) = *(dpnt+3) = 255;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
+            if( luma? *pnt <= thresh: *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
                 *(dpnt+0) = *(dpnt+1) = *(dpnt+2) = 255;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGR)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
+            if( luma? *pnt <= thresh: *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
                 *(dpnt+0) = *(dpnt+1) = *(dpnt+2) = 255;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
+            if( luma? *pnt <= thresh: *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
                 *(dpnt+0) = *(dpnt+1) = *(dpnt+2) = 255;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGB)
-            if( *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
+            if( luma? *pnt <= thresh: *(pnt+0) + *(pnt+1) + *(pnt+2) <= thresht3 ) {
                 *(dpnt+0) = *(dpnt+1) = *(dpnt+2) = 255;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO)
 			if( *(pnt) <= thresh ) {
 				*(dpnt) = 255;
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
-			if( *(pnt+1) <= thresh ) {
+			if( luma? *pnt <= thresh: *(pnt+1) <= thresh ) {
 				*(dpnt+0) = 128; *(dpnt+1) = 235; // *(dpnt+0) is chroma, set to 128 to maintain black & white debug image.
 #elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
-			if( *(pnt+0) <= thresh ) {
+			if( luma? *pnt <= thresh: *(pnt+0) <= thresh ) {
 				*(dpnt+0) = 235; *(dpnt+1) = 128; // *(dpnt+1) is chroma, set to 128 to maintain black & white debug image.
 #else
 #  error Unknown default pixel format defined in config.h
@@ -729,7 +924,7 @@ static ARInt16 *labeling3( ARUint8 *image, int thresh,
 #  error Unknown default pixel format defined in config.h
 #endif
         }
-        if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) pnt += arImXsize*AR_PIX_SIZE_DEFAULT;
+        if (arImageProcMode == AR_IMAGE_PROC_IN_HALF) pnt += arImXsize*psize;
     }
 
     j = 1;
@@ -0,0 +1,361 @@
+/*******************************************************
+ *
+ * Frame pipeline: capture, labeling, identification
+ * and pose of successive frames on different threads.
+ *
+ * The frames in flight live in a ring of slots. The
+ * state of a slot is the next stage to run on it; a
+ * thread runs a range of stages on the slots in turn,
+ * waiting for the state to reach its first stage, and
+ * hands the slot over by setting the state past its
+ * last one. After the pose stage the state wraps to
+ * the capture stage, i.e. the slot is free.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#endif
+#include <AR/ar.h>
+#include <AR/arStats.h>
+#include <AR/arThread.h>
+#include <AR/arPipeline.h>
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION        ar_mutex_t;
+typedef CONDITION_VARIABLE      ar_cond_t;
+#  define ar_mutex_init(m)      InitializeCriticalSection(m)
+#  define ar_mutex_destroy(m)   DeleteCriticalSection(m)
+#  define ar_mutex_lock(m)      EnterCriticalSection(m)
+#  define ar_mutex_unlock(m)    LeaveCriticalSection(m)
+#  define ar_cond_init(c)       InitializeConditionVariable(c)
+#  define ar_cond_destroy(c)
+#  define ar_cond_wait(c,m)     SleepConditionVariableCS(c, m, INFINITE)
+#  define ar_cond_broadcast(c)  WakeAllConditionVariable(c)
+#else
+typedef pthread_mutex_t         ar_mutex_t;
+typedef pthread_cond_t          ar_cond_t;
+#  define ar_mutex_init(m)      pthread_mutex_init(m, NULL)
+#  define ar_mutex_destroy(m)   pthread_mutex_destroy(m)
+#  define ar_mutex_lock(m)      pthread_mutex_lock(m)
+#  define ar_mutex_unlock(m)    pthread_mutex_unlock(m)
+#  define ar_cond_init(c)       pthread_cond_init(c, NULL)
+#  define ar_cond_destroy(c)    pthread_cond_destroy(c)
+#  define ar_cond_wait(c,m)     pthread_cond_wait(c, m)
+#  define ar_cond_broadcast(c)  pthread_cond_broadcast(c)
+#endif
+
+/*
+ * First stage of each thread, by number of threads. Labeling and
+ * identification are the heavy stages: they get a thread of their own
+ * first.
+ */
+static const int group_first[AR_PIPELINE_STAGE_NUM][AR_PIPELINE_STAGE_NUM] = {
+    { AR_PIPELINE_STAGE_CAPTURE },
+    { AR_PIPELINE_STAGE_CAPTURE, AR_PIPELINE_STAGE_IDENTIFY },
+    { AR_PIPELINE_STAGE_CAPTURE, AR_PIPELINE_STAGE_LABEL, AR_PIPELINE_STAGE_IDENTIFY },
+    { AR_PIPELINE_STAGE_CAPTURE, AR_PIPELINE_STAGE_LABEL, AR_PIPELINE_STAGE_IDENTIFY, AR_PIPELINE_STAGE_POSE }
+};
+
+typedef struct {
+    ARPipelineFrame   frame;
+    ARUint8           *image;           /* buffer of the pipeline */
+    ARMarkerInfo2     *marker_info2;
+    int               marker2_num;
+    int               end;              /* no frame: 1 end of the stream, -1 error */
+    volatile int      state;            /* next stage to run */
+} ARPipelineSlot;
+
+struct _ARPipeline {
+    int                 thread_num;
+    ARThreadPool        *pool;
+    int                 depth;
+    ARPipelineSlot      *slot;
+    int                 patt_num;
+    int                 *patt_id;
+    ARPattSpec          *spec;
+    ar_mutex_t          mutex;
+    ar_cond_t           cond;
+    /* arguments of the current run */
+    int                 thresh;
+    ARPipelineSource    source;
+    ARPipelineSink      sink;
+    void                *arg;
+    unsigned long       frame_num;
+    int                 end;
+};
+
+static void   run_stages( void *arg, int index );
+static int    capture( ARPipeline *pipe, ARPipelineSlot *slot, unsigned long seq );
+static void   label( ARPipeline *pipe, ARPipelineSlot *slot );
+static void   identify( ARPipeline *pipe, ARPipelineSlot *slot );
+static void   pose( ARPipeline *pipe, ARPipelineSlot *slot );
+static void   copy_marker_info2( ARMarkerInfo2 *dst, ARMarkerInfo2 *src );
+
+ARPipeline *arPipelineCreate( int thread_num, int depth,
+                              int patt_num, int *patt_id, ARPattSpec *spec )
+{
+    ARPipeline   *pipe;
+    int          i;
+
+    if( thread_num < 0 ) thread_num = arThreadGetCPUNum();
+    if( thread_num < 1 ) thread_num = 1;
+    if( thread_num > AR_PIPELINE_STAGE_NUM ) thread_num = AR_PIPELINE_STAGE_NUM;
+    if( depth == 0 ) depth = thread_num + 1;
+    if( depth < thread_num || patt_num < 0 ) return NULL;
+    if( patt_num > 0 && (patt_id == NULL || spec == NULL) ) return NULL;
+    if( arImXsize <= 0 || arImYsize <= 0 ) return NULL;
+
+    arMalloc( pipe, ARPipeline, 1 );
+    pipe->thread_num = thread_num;
+    pipe->pool = NULL;
+    if( thread_num > 1 ) {
+        if( (pipe->pool = arThreadPoolCreate( thread_num - 1 )) == NULL ) {
+            free( pipe );
+            return NULL;
+        }
+    }
+
+    pipe->patt_num = patt_num;
+    pipe->patt_id  = NULL;
+    pipe->spec     = NULL;
+    if( patt_num > 0 ) {
+        arMalloc( pipe->patt_id, int, patt_num );
+        arMalloc( pipe->spec, ARPattSpec, patt_num );
+        for( i = 0; i < patt_num; i++ ) {
+            pipe->patt_id[i] = patt_id[i];
+            pipe->spec[i]    = spec[i];
+        }
+    }
+
+    pipe->frame_num = 0;
+    pipe->end       = 0;
+
+    pipe->depth = depth;
+    arMalloc( pipe->slot, ARPipelineSlot, depth );
+    for( i = 0; i < depth; i++ ) {
+        arMalloc( pipe->slot[i].image, ARUint8, arImXsize*arImYsize*AR_PIX_SIZE_DEFAULT );
+        arMalloc( pipe->slot[i].marker_info2, ARMarkerInfo2, AR_SQUARE_MAX );
+        arMalloc( pipe->slot[i].frame.marker_info, ARMarkerInfo, AR_SQUARE_MAX );
+        pipe->slot[i].frame.pose = NULL;
+        if( patt_num > 0 ) arMalloc( pipe->slot[i].frame.pose, ARPose, patt_num );
+        pipe->slot[i].frame.pose_num = patt_num;
+        pipe->slot[i].end   = 0;
+        pipe->slot[i].state = AR_PIPELINE_STAGE_CAPTURE;
+    }
+
+    ar_mutex_init( &(pipe->mutex) );
+    ar_cond_init( &(pipe->cond) );
+
+    return pipe;
+}
+
+int arPipelineDestroy( ARPipeline *pipe )
+{
+    int     i;
+
+    if( pipe == NULL ) return -1;
+
+    if( pipe->pool ) arThreadPoolDestroy( pipe->pool );
+    for( i = 0; i < pipe->depth; i++ ) {
+        free( pipe->slot[i].image );
+        free( pipe->slot[i].marker_info2 );
+        free( pipe->slot[i].frame.marker_info );
+        free( pipe->slot[i].frame.pose );
+    }
+    free( pipe->slot );
+    free( pipe->patt_id );
+    free( pipe->spec );
+    ar_cond_destroy( &(pipe->cond) );
+    ar_mutex_destroy( &(pipe->mutex) );
+    free( pipe );
+
+    return 0;
+}
+
+int arPipelineGetThreadNum( ARPipeline *pipe )
+{
+    if( pipe == NULL ) return -1;
+
+    return pipe->thread_num;
+}
+
+long arPipelineRun( ARPipeline *pipe, int thresh,
+                    ARPipelineSource source, ARPipelineSink sink, void *arg )
+{
+    if( pipe == NULL || source == NULL ) return -1;
+
+    pipe->thresh = thresh;
+    pipe->source = source;
+    pipe->sink   = sink;
+    pipe->arg    = arg;
+
+    if( arThreadPoolRun( pipe->pool, run_stages, pipe, pipe->thread_num ) < 0 ) return -1;
+
+    return (pipe->end < 0)? -1: (long)pipe->frame_num;
+}
+
+/*
+ * Body of one thread: stages group_first[n][index] up to the first
+ * stage of the next thread, on every frame until the end of the stream.
+ */
+static void run_stages( void *arg, int index )
+{
+    ARPipeline       *pipe = (ARPipeline *)arg;
+    ARPipelineSlot   *slot;
+    const int        *first = group_first[pipe->thread_num-1];
+    int              st, ed, end;
+    unsigned long    seq;
+
+    st = first[index];
+    ed = (index+1 < pipe->thread_num)? first[index+1]: AR_PIPELINE_STAGE_NUM;
+
+    for( seq = 0; ; seq++ ) {
+        slot = &(pipe->slot[seq % pipe->depth]);
+
+        ar_mutex_lock( &(pipe->mutex) );
+        while( slot->state != st ) {
+            ar_cond_wait( &(pipe->cond), &(pipe->mutex) );
+        }
+        ar_mutex_unlock( &(pipe->mutex) );
+
+        if( st == AR_PIPELINE_STAGE_CAPTURE ) capture( pipe, slot, seq );
+        end = slot->end;
+        if( !end ) {
+            if( st <= AR_PIPELINE_STAGE_LABEL    && ed > AR_PIPELINE_STAGE_LABEL    ) label( pipe, slot );
+            if( st <= AR_PIPELINE_STAGE_IDENTIFY && ed > AR_PIPELINE_STAGE_IDENTIFY ) identify( pipe, slot );
+            if( st <= AR_PIPELINE_STAGE_POSE     && ed > AR_PIPELINE_STAGE_POSE     ) pose( pipe, slot );
+        }
+
+        ar_mutex_lock( &(pipe->mutex) );
+        slot->state = ed % AR_PIPELINE_STAGE_NUM;
+        ar_cond_broadcast( &(pipe->cond) );
+        ar_mutex_unlock( &(pipe->mutex) );
+
+        if( end ) break;
+    }
+}
+
+static int capture( ARPipeline *pipe, ARPipelineSlot *slot, unsigned long seq )
+{
+    ARPipelineFrame   *frame = &(slot->frame);
+    ARStatsTime       t0;
+    int               i, ret;
+
+    t0 = arStatsGetTime();
+    frame->seq        = seq;
+    frame->time       = 0.0;
+    frame->image      = slot->image;
+    frame->user       = NULL;
+    frame->status     = 0;
+    frame->marker_num = 0;
+    for( i = 0; i < frame->pose_num; i++ ) frame->pose[i].visible = 0;
+    for( i = 0; i < AR_PIPELINE_STAGE_NUM; i++ ) frame->stage_time[i] = 0.0;
+    slot->marker2_num = 0;
+
+    ret = (*pipe->source)( pipe->arg, frame );
+    slot->end = (ret > 0)? 0: (ret == 0)? 1: -1;
+    if( slot->end ) {
+        pipe->frame_num = seq;
+        pipe->end       = slot->end;
+    }
+    frame->stage_time[AR_PIPELINE_STAGE_CAPTURE] = (arStatsGetTime() - t0) * 1.0e-6;
+
+    return slot->end;
+}
+
+/* as arDetectMarkerLite, the candidates being copied out of the library's buffer */
+static void label( ARPipeline *pipe, ARPipelineSlot *slot )
+{
+    ARPipelineFrame   *frame = &(slot->frame);
+    ARStatsTime       t0;
+    ARInt16           *limage;
+    ARMarkerInfo2     *marker_info2;
+    int               label_num;
+    int               *area, *clip, *label_ref;
+    double            *pos;
+    int               i;
+
+    t0 = arStatsGetTime();
+    marker_info2 = NULL;
+    if( arIncrementalMode == AR_INCREMENTAL_ENABLE && !arDebug ) {
+        marker_info2 = arDetectMarker2Incremental( frame->image, pipe->thresh, AR_AREA_MAX, AR_AREA_MIN,
+                                                   1.0, &(slot->marker2_num) );
+    }
+    else {
+        limage = arLabeling( frame->image, pipe->thresh,
+                             &label_num, &area, &pos, &clip, &label_ref );
+        if( limage != NULL ) {
+            marker_info2 = arDetectMarker2( limage, label_num, label_ref,
+                                            area, pos, clip, AR_AREA_MAX, AR_AREA_MIN,
+                                            1.0, &(slot->marker2_num) );
+        }
+    }
+    if( marker_info2 == NULL ) {
+        slot->marker2_num = 0;
+        frame->status = -1;
+    }
+    for( i = 0; i < slot->marker2_num; i++ ) {
+        copy_marker_info2( &(slot->marker_info2[i]), &(marker_info2[i]) );
+    }
+    frame->stage_time[AR_PIPELINE_STAGE_LABEL] = (arStatsGetTime() - t0) * 1.0e-6;
+}
+
+static void identify( ARPipeline *pipe, ARPipelineSlot *slot )
+{
+    ARPipelineFrame   *frame = &(slot->frame);
+    ARStatsTime       t0;
+    int               i;
+
+    t0 = arStatsGetTime();
+    frame->marker_num = slot->marker2_num;
+    arGetMarkerInfoParallel( frame->image, slot->marker_info2, &(frame->marker_num), frame->marker_info );
+    for( i = 0; i < frame->marker_num; i++ ) {
+        if( frame->marker_info[i].cf < 0.5 ) frame->marker_info[i].id = -1;
+    }
+    frame->stage_time[AR_PIPELINE_STAGE_IDENTIFY] = (arStatsGetTime() - t0) * 1.0e-6;
+}
+
+static void pose( ARPipeline *pipe, ARPipelineSlot *slot )
+{
+    ARPipelineFrame   *frame = &(slot->frame);
+    ARMarkerInfo      *marker_info = frame->marker_info;
+    ARStatsTime       t0;
+    int               i, j, k;
+
+    t0 = arStatsGetTime();
+    for( i = 0; i < pipe->patt_num; i++ ) {
+        k = -1;
+        for( j = 0; j < frame->marker_num; j++ ) {
+            if( marker_info[j].id != pipe->patt_id[i] ) continue;
+            if( k == -1 || marker_info[j].cf > marker_info[k].cf ) k = j;
+        }
+        if( k == -1 ) continue;
+        frame->pose[i].err = arGetTransMat( &marker_info[k], pipe->spec[i].center,
+                                            pipe->spec[i].width, frame->pose[i].conv );
+        frame->pose[i].cf      = marker_info[k].cf;
+        frame->pose[i].visible = 1;
+    }
+    frame->stage_time[AR_PIPELINE_STAGE_POSE] = (arStatsGetTime() - t0) * 1.0e-6;
+
+    if( pipe->sink ) (*pipe->sink)( pipe->arg, frame );
+}
+
+static void copy_marker_info2( ARMarkerInfo2 *dst, ARMarkerInfo2 *src )
+{
+    dst->area      = src->area;
+    dst->pos[0]    = src->pos[0];
+    dst->pos[1]    = src->pos[1];
+    dst->coord_num = src->coord_num;
+    memcpy( dst->x_coord, src->x_coord, src->coord_num * sizeof(int) );
+    memcpy( dst->y_coord, src->y_coord, src->coord_num * sizeof(int) );
+    memcpy( dst->vertex, src->vertex, sizeof(dst->vertex) );
+}
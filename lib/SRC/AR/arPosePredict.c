@@ -0,0 +1,319 @@
+/*******************************************************
+ *
+ * Pose prediction on SE(3).
+ *
+ * The poses of the history are expressed relative to
+ * the latest one, T_k, as twists in the camera frame:
+ *
+ *   xi_i = log( T_i T_k^-1 ),  tau_i = t_i - t_k
+ *
+ * and fitted through xi_k = 0 by least squares:
+ *
+ *   constant velocity:      xi(tau) = v tau
+ *   constant acceleration:  xi(tau) = v tau + a tau^2 / 2
+ *
+ * over the last AR_POSE_PREDICT_CV_WINDOW or
+ * AR_POSE_PREDICT_CA_WINDOW poses: the acceleration
+ * needs the longer window to be fitted stably, the
+ * velocity alone follows changes better on a short one.
+ *
+ * The prediction at time t is exp( xi(t - t_k) ) T_k.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <AR/ar.h>
+#include <AR/arPosePredict.h>
+
+#define   SMALL_ANGLE   1.0e-4
+#define   HISTORY_MAX   ((AR_POSE_PREDICT_CV_WINDOW > AR_POSE_PREDICT_CA_WINDOW)? \
+                          AR_POSE_PREDICT_CV_WINDOW: AR_POSE_PREDICT_CA_WINDOW)
+
+typedef struct {
+    int       num;
+    double    time[HISTORY_MAX];
+    double    conv[HISTORY_MAX][3][4];    /* oldest first */
+} PoseHistory;
+
+struct _ARPosePredict {
+    int             pose_num;
+    int             model;
+    int             window;
+    PoseHistory     *hist;
+    int             seq_valid;
+    unsigned long   seq;
+};
+
+static void relative_pose( double conv[3][4], double latest[3][4], double rel[3][4] );
+static void log_se3( double conv[3][4], double xi[6] );
+static void exp_se3( double xi[6], double conv[3][4] );
+
+ARPosePredict *arPosePredictCreate( int pose_num, int model )
+{
+    ARPosePredict   *pred;
+
+    if( pose_num <= 0 ) return NULL;
+    if( model != AR_POSE_PREDICT_CONSTANT_VELOCITY
+     && model != AR_POSE_PREDICT_CONSTANT_ACCELERATION ) return NULL;
+
+    arMalloc( pred, ARPosePredict, 1 );
+    arMalloc( pred->hist, PoseHistory, pose_num );
+    pred->pose_num  = pose_num;
+    pred->model     = model;
+    pred->window    = (model == AR_POSE_PREDICT_CONSTANT_VELOCITY)?
+                      AR_POSE_PREDICT_CV_WINDOW: AR_POSE_PREDICT_CA_WINDOW;
+    pred->seq_valid = 0;
+    pred->seq       = 0;
+    arPosePredictReset( pred, -1 );
+
+    return pred;
+}
+
+int arPosePredictDestroy( ARPosePredict *pred )
+{
+    if( pred == NULL ) return -1;
+
+    free( pred->hist );
+    free( pred );
+
+    return 0;
+}
+
+int arPosePredictAdd( ARPosePredict *pred, int index, double conv[3][4], double time )
+{
+    PoseHistory     *h;
+    int             i, j, k;
+
+    if( pred == NULL || index < 0 || index >= pred->pose_num ) return -1;
+    h = &(pred->hist[index]);
+
+    if( h->num > 0 ) {
+        if( time <= h->time[h->num-1] ) return 0;
+        if( time - h->time[h->num-1] > AR_POSE_PREDICT_GAP_MAX ) h->num = 0;
+    }
+    if( h->num == pred->window ) {
+        for( i = 1; i < h->num; i++ ) {
+            h->time[i-1] = h->time[i];
+            for( j = 0; j < 3; j++ ) for( k = 0; k < 4; k++ ) h->conv[i-1][j][k] = h->conv[i][j][k];
+        }
+        h->num--;
+    }
+    h->time[h->num] = time;
+    for( j = 0; j < 3; j++ ) for( k = 0; k < 4; k++ ) h->conv[h->num][j][k] = conv[j][k];
+    h->num++;
+
+    return 0;
+}
+
+int arPosePredictAddFrame( ARPosePredict *pred, ARPoseFrame *frame )
+{
+    int     i;
+
+    if( pred == NULL || frame == NULL ) return -1;
+    if( pred->seq_valid && frame->seq == pred->seq ) return 0;
+
+    for( i = 0; i < frame->pose_num && i < pred->pose_num; i++ ) {
+        if( !frame->pose[i].visible ) continue;
+        arPosePredictAdd( pred, i, frame->pose[i].conv, frame->time );
+    }
+    pred->seq_valid = 1;
+    pred->seq       = frame->seq;
+
+    return 0;
+}
+
+int arPosePredictReset( ARPosePredict *pred, int index )
+{
+    int     i;
+
+    if( pred == NULL || index < -1 || index >= pred->pose_num ) return -1;
+
+    if( index >= 0 ) {
+        pred->hist[index].num = 0;
+        return 0;
+    }
+    for( i = 0; i < pred->pose_num; i++ ) pred->hist[i].num = 0;
+    pred->seq_valid = 0;
+
+    return 0;
+}
+
+int arPosePredictGet( ARPosePredict *pred, int index, double time, double conv[3][4] )
+{
+    PoseHistory     *h;
+    double          (*latest)[4];
+    double          rel[3][4], motion[3][4];
+    double          xi[6], v[6], a[6], b1[6], b2[6];
+    double          s11, s12, s22, det, tau, tau2;
+    int             start, i, j, k;
+
+    if( pred == NULL || index < 0 || index >= pred->pose_num ) return -1;
+    h = &(pred->hist[index]);
+    if( h->num == 0 ) return -1;
+    latest = h->conv[h->num-1];
+
+    /* normal equations of the fit over the window, tau_i < 0 */
+    start = h->num - pred->window;
+    if( start < 0 ) start = 0;
+    s11 = s12 = s22 = 0.0;
+    for( j = 0; j < 6; j++ ) b1[j] = b2[j] = 0.0;
+    for( i = start; i < h->num-1; i++ ) {
+        tau  = h->time[i] - h->time[h->num-1];
+        tau2 = tau * tau;
+        relative_pose( h->conv[i], latest, rel );
+        log_se3( rel, xi );
+        s11 += tau2;
+        s12 += tau2 * tau * 0.5;
+        s22 += tau2 * tau2 * 0.25;
+        for( j = 0; j < 6; j++ ) {
+            b1[j] += tau * xi[j];
+            b2[j] += tau2 * 0.5 * xi[j];
+        }
+    }
+
+    for( j = 0; j < 6; j++ ) v[j] = a[j] = 0.0;
+    det = s11 * s22 - s12 * s12;
+    if( pred->model == AR_POSE_PREDICT_CONSTANT_ACCELERATION
+     && h->num - start >= 3 && det > 1.0e-9 * s11 * s22 ) {
+        for( j = 0; j < 6; j++ ) {
+            v[j] = ( s22 * b1[j] - s12 * b2[j]) / det;
+            a[j] = (-s12 * b1[j] + s11 * b2[j]) / det;
+        }
+    }
+    else if( h->num - start >= 2 ) {
+        for( j = 0; j < 6; j++ ) v[j] = b1[j] / s11;
+    }
+
+    tau = time - h->time[h->num-1];
+    if( tau < 0.0 ) tau = 0.0;
+    if( tau > AR_POSE_PREDICT_MAX_TIME ) tau = AR_POSE_PREDICT_MAX_TIME;
+    for( j = 0; j < 6; j++ ) xi[j] = v[j] * tau + a[j] * tau * tau * 0.5;
+    exp_se3( xi, motion );
+
+    for( j = 0; j < 3; j++ ) {
+        for( k = 0; k < 4; k++ ) {
+            conv[j][k] = motion[j][0] * latest[0][k]
+                       + motion[j][1] * latest[1][k]
+                       + motion[j][2] * latest[2][k];
+        }
+        conv[j][3] += motion[j][3];
+    }
+
+    return 0;
+}
+
+/* rel = conv * latest^-1 */
+static void relative_pose( double conv[3][4], double latest[3][4], double rel[3][4] )
+{
+    int     j, k;
+
+    for( j = 0; j < 3; j++ ) {
+        for( k = 0; k < 3; k++ ) {
+            rel[j][k] = conv[j][0] * latest[k][0]
+                      + conv[j][1] * latest[k][1]
+                      + conv[j][2] * latest[k][2];
+        }
+    }
+    for( j = 0; j < 3; j++ ) {
+        rel[j][3] = conv[j][3] - rel[j][0] * latest[0][3]
+                               - rel[j][1] * latest[1][3]
+                               - rel[j][2] * latest[2][3];
+    }
+}
+
+/* xi = (w, v): rotation vector and V^-1 t */
+static void log_se3( double conv[3][4], double xi[6] )
+{
+    double    w[3], ww[3][3], c, s, theta, k, n;
+    int       i, j, m;
+
+    c = (conv[0][0] + conv[1][1] + conv[2][2] - 1.0) * 0.5;
+    if( c >  1.0 ) c =  1.0;
+    if( c < -1.0 ) c = -1.0;
+    theta = acos( c );
+    w[0] = (conv[2][1] - conv[1][2]) * 0.5;
+    w[1] = (conv[0][2] - conv[2][0]) * 0.5;
+    w[2] = (conv[1][0] - conv[0][1]) * 0.5;
+    s = sqrt( w[0]*w[0] + w[1]*w[1] + w[2]*w[2] );
+
+    if( theta < SMALL_ANGLE ) {
+        k = 1.0/12.0;
+    }
+    else if( c < 0.0 && s < 0.5 ) {
+        /* near pi the axis comes from the symmetric part */
+        m = 0;
+        if( conv[1][1] > conv[m][m] ) m = 1;
+        if( conv[2][2] > conv[m][m] ) m = 2;
+        n = sqrt( (conv[m][m] - c) / (1.0 - c) );
+        for( i = 0; i < 3; i++ ) {
+            if( i == m ) continue;
+            ww[0][i] = (conv[m][i] + conv[i][m]) / (2.0 * (1.0 - c) * n);
+        }
+        ww[0][m] = n;
+        if( ww[0][0]*w[0] + ww[0][1]*w[1] + ww[0][2]*w[2] < 0.0 ) theta = -theta;
+        for( i = 0; i < 3; i++ ) w[i] = theta * ww[0][i];
+        k = (1.0 - theta * sin(theta) / (2.0 * (1.0 - c))) / (theta * theta);
+    }
+    else {
+        for( i = 0; i < 3; i++ ) w[i] *= theta / s;
+        k = (1.0 - theta * s / (2.0 * (1.0 - c))) / (theta * theta);
+    }
+
+    /* V^-1 = I - W/2 + k W^2 */
+    ww[0][0] = -w[1]*w[1] - w[2]*w[2];
+    ww[1][1] = -w[0]*w[0] - w[2]*w[2];
+    ww[2][2] = -w[0]*w[0] - w[1]*w[1];
+    ww[0][1] = ww[1][0] = w[0]*w[1];
+    ww[0][2] = ww[2][0] = w[0]*w[2];
+    ww[1][2] = ww[2][1] = w[1]*w[2];
+    for( i = 0; i < 3; i++ ) {
+        xi[i]   = w[i];
+        xi[3+i] = conv[i][3];
+        for( j = 0; j < 3; j++ ) xi[3+i] += k * ww[i][j] * conv[j][3];
+    }
+    xi[3] -= 0.5 * (w[1]*conv[2][3] - w[2]*conv[1][3]);
+    xi[4] -= 0.5 * (w[2]*conv[0][3] - w[0]*conv[2][3]);
+    xi[5] -= 0.5 * (w[0]*conv[1][3] - w[1]*conv[0][3]);
+}
+
+static void exp_se3( double xi[6], double conv[3][4] )
+{
+    double    w[3][3], ww[3][3], theta2, theta, a, b, c;
+    int       i, j;
+
+    theta2 = xi[0]*xi[0] + xi[1]*xi[1] + xi[2]*xi[2];
+    theta  = sqrt( theta2 );
+    if( theta < SMALL_ANGLE ) {
+        a = 1.0 - theta2 / 6.0;
+        b = 0.5 - theta2 / 24.0;
+        c = 1.0/6.0 - theta2 / 120.0;
+    }
+    else {
+        a = sin(theta) / theta;
+        b = (1.0 - cos(theta)) / theta2;
+        c = (theta - sin(theta)) / (theta2 * theta);
+    }
+
+    w[0][0] = w[1][1] = w[2][2] = 0.0;
+    w[0][1] = -xi[2];  w[1][0] =  xi[2];
+    w[0][2] =  xi[1];  w[2][0] = -xi[1];
+    w[1][2] = -xi[0];  w[2][1] =  xi[0];
+    for( i = 0; i < 3; i++ ) {
+        for( j = 0; j < 3; j++ ) {
+            ww[i][j] = w[i][0]*w[0][j] + w[i][1]*w[1][j] + w[i][2]*w[2][j];
+        }
+    }
+
+    for( i = 0; i < 3; i++ ) {
+        conv[i][3] = 0.0;
+        for( j = 0; j < 3; j++ ) {
+            conv[i][j]  = ((i == j)? 1.0: 0.0) + a * w[i][j] + b * ww[i][j];
+            conv[i][3] += (((i == j)? 1.0: 0.0) + b * w[i][j] + c * ww[i][j]) * xi[3+j];
+        }
+    }
+}
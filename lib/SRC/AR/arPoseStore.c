@@ -0,0 +1,117 @@
+/*******************************************************
+ *
+ * Triple buffered pose store between a tracking thread
+ * and a rendering thread.
+ *
+ * The writer owns the back frame, the reader the front
+ * one. The third index, with a bit telling whether it
+ * holds a frame not read yet, is exchanged atomically
+ * by both sides:
+ *
+ *   publish: back  <-> latest, latest marked new
+ *   get:     front <-> latest, only if marked new
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+#include <AR/ar.h>
+#include <AR/arPoseStore.h>
+
+#ifdef _WIN32
+#  define ar_exchange(p,v)      InterlockedExchange((volatile LONG *)(p), (LONG)(v))
+#else
+/* __sync_lock_test_and_set is only an acquire barrier */
+#  define ar_exchange(p,v)      (__sync_synchronize(), __sync_lock_test_and_set(p, v))
+#endif
+
+#define   FRAME_NEW     4
+#define   FRAME_INDEX   3
+
+struct _ARPoseStore {
+    ARPoseFrame     frame[3];
+    volatile int    latest;         /* index | FRAME_NEW */
+    int             back;           /* used by the writer only */
+    int             front;          /* used by the reader only */
+    int             read;           /* the reader has got a frame */
+};
+
+ARPoseStore *arPoseStoreCreate( int pose_num, int image_size )
+{
+    ARPoseStore     *store;
+    int             i;
+
+    if( pose_num <= 0 || image_size < 0 ) return NULL;
+
+    arMalloc( store, ARPoseStore, 1 );
+    for( i = 0; i < 3; i++ ) {
+        store->frame[i].seq      = 0;
+        store->frame[i].time     = 0.0;
+        store->frame[i].pose_num = pose_num;
+        arMalloc( store->frame[i].pose, ARPose, pose_num );
+        store->frame[i].image = NULL;
+        if( image_size > 0 ) arMalloc( store->frame[i].image, ARUint8, image_size );
+    }
+    store->back   = 0;
+    store->latest = 1;
+    store->front  = 2;
+    store->read   = 0;
+
+    return store;
+}
+
+int arPoseStoreDestroy( ARPoseStore *store )
+{
+    int     i;
+
+    if( store == NULL ) return -1;
+
+    for( i = 0; i < 3; i++ ) {
+        free( store->frame[i].pose );
+        free( store->frame[i].image );
+    }
+    free( store );
+
+    return 0;
+}
+
+ARPoseFrame *arPoseStoreGetBuffer( ARPoseStore *store )
+{
+    ARPoseFrame     *frame;
+    int             i;
+
+    if( store == NULL ) return NULL;
+
+    frame = &(store->frame[store->back]);
+    for( i = 0; i < frame->pose_num; i++ ) frame->pose[i].visible = 0;
+
+    return frame;
+}
+
+int arPoseStorePublish( ARPoseStore *store )
+{
+    if( store == NULL ) return -1;
+
+    store->back = ar_exchange( &(store->latest), store->back | FRAME_NEW ) & FRAME_INDEX;
+
+    return 0;
+}
+
+ARPoseFrame *arPoseStoreGetLatest( ARPoseStore *store )
+{
+    if( store == NULL ) return NULL;
+
+    if( store->latest & FRAME_NEW ) {
+        store->front = ar_exchange( &(store->latest), store->front ) & FRAME_INDEX;
+        store->read  = 1;
+    }
+    if( !store->read ) return NULL;
+
+    return &(store->frame[store->front]);
+}
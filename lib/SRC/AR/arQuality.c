@@ -0,0 +1,171 @@
+/*******************************************************
+ *
+ * Detection quality controller holding a frame time
+ * budget, with hysteresis between going down and up
+ * the ladder of settings.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <AR/ar.h>
+#include <AR/arStats.h>
+#include <AR/arQuality.h>
+
+/* no PCA step: arLoadPatt() builds no eigenvectors, so PCA matching is plain matching */
+static ARQualityConfig default_level[] = {
+    { "full/color",      AR_IMAGE_PROC_IN_FULL, AR_TEMPLATE_MATCHING_COLOR, AR_MATCHING_WITHOUT_PCA, -1, 1 },
+    { "full/bw",         AR_IMAGE_PROC_IN_FULL, AR_TEMPLATE_MATCHING_BW,    AR_MATCHING_WITHOUT_PCA, -1, 1 },
+    { "half/bw",         AR_IMAGE_PROC_IN_HALF, AR_TEMPLATE_MATCHING_BW,    AR_MATCHING_WITHOUT_PCA, -1, 1 },
+    { "half/bw/roi",     AR_IMAGE_PROC_IN_HALF, AR_TEMPLATE_MATCHING_BW,    AR_MATCHING_WITHOUT_PCA, -1,
+      AR_QUALITY_TRACK_INTERVAL }
+};
+#define   DEFAULT_LEVEL_NUM   (int)(sizeof(default_level)/sizeof(default_level[0]))
+
+struct _ARQuality {
+    ARQualityConfig   *level;
+    double            *cost;        /* smoothed frame time of each level [ms], < 0 if not used yet */
+    int               level_num;
+    int               cur;
+    double            budget;
+    int               over;         /* frames in a row over the budget */
+    int               under;        /* frames in a row under budget * AR_QUALITY_UP_RATIO */
+    int               started;
+    ARStatsTime       start;
+};
+
+ARQuality *arQualityCreate( double budget, ARQualityConfig *level, int level_num )
+{
+    ARQuality   *q;
+    int         i;
+
+    if( budget <= 0.0 ) return NULL;
+    if( level == NULL ) {
+        level     = default_level;
+        level_num = DEFAULT_LEVEL_NUM;
+    }
+    if( level_num <= 0 ) return NULL;
+
+    arMalloc( q, ARQuality, 1 );
+    arMalloc( q->level, ARQualityConfig, level_num );
+    arMalloc( q->cost, double, level_num );
+    for( i = 0; i < level_num; i++ ) {
+        q->level[i] = level[i];
+        q->cost[i]  = -1.0;
+    }
+    q->level_num = level_num;
+    q->cur       = 0;
+    q->budget    = budget;
+    q->over      = 0;
+    q->under     = 0;
+    q->started   = 0;
+
+    return q;
+}
+
+int arQualityDestroy( ARQuality *q )
+{
+    if( q == NULL ) return -1;
+
+    free( q->level );
+    free( q->cost );
+    free( q );
+
+    return 0;
+}
+
+int arQualitySetBudget( ARQuality *q, double budget )
+{
+    if( q == NULL || budget <= 0.0 ) return -1;
+
+    q->budget = budget;
+    q->over   = 0;
+    q->under  = 0;
+
+    return 0;
+}
+
+int arQualityFrameStart( ARQuality *q )
+{
+    ARQualityConfig   *c;
+
+    if( q == NULL ) return -1;
+
+    c = &(q->level[q->cur]);
+    arImageProcMode        = c->image_proc_mode;
+    arTemplateMatchingMode = c->template_matching_mode;
+    arMatchingPCAMode      = c->matching_pca_mode;
+    if( c->threshold_mode >= 0 ) arThresholdMode = c->threshold_mode;
+    arTrackInterval        = c->track_interval;
+
+    q->started = 1;
+    q->start   = arStatsGetTime();
+
+    return q->cur;
+}
+
+int arQualityFrameEnd( ARQuality *q, ARQualityFrame *frame )
+{
+    double    t;
+    int       level;
+
+    if( q == NULL || !q->started ) return -1;
+    t = (arStatsGetTime() - q->start) * 1.0e-6;
+    q->started = 0;
+
+    level = q->cur;
+    if( q->cost[level] < 0.0 ) q->cost[level] = t;
+    else                       q->cost[level] += AR_QUALITY_COST_SMOOTH * (t - q->cost[level]);
+    if( t > q->budget ) q->over++;
+    else                q->over = 0;
+    if( t < q->budget * AR_QUALITY_UP_RATIO ) q->under++;
+    else                                      q->under = 0;
+
+    /*
+     * a level known to be slower than this one is not taken; its cost
+     * is forgotten little by little, so that it is tried again later.
+     * Over the budget, a level above that was faster is taken back.
+     */
+    if( q->over >= AR_QUALITY_DOWN_FRAMES ) {
+        if( level < q->level_num-1 && q->cost[level+1] < q->cost[level] ) {
+            q->cur++;
+            q->over = q->under = 0;
+        }
+        else if( level > 0 && q->cost[level-1] < q->cost[level] ) {
+            q->cur--;
+            q->over = q->under = 0;
+        }
+        else if( level < q->level_num-1 && q->over % AR_QUALITY_UP_FRAMES == 0 ) {
+            q->cost[level+1] *= AR_QUALITY_COST_DECAY;
+        }
+    }
+    else if( q->under >= AR_QUALITY_UP_FRAMES && level > 0 ) {
+        if( q->cost[level-1] <= q->budget ) {
+            q->cur--;
+            q->over = q->under = 0;
+        }
+        else if( q->under % AR_QUALITY_UP_FRAMES == 0 ) {
+            q->cost[level-1] *= AR_QUALITY_COST_DECAY;
+        }
+    }
+
+    if( frame ) {
+        frame->level  = level;
+        frame->config = q->level[level];
+        frame->config.threshold_mode = arThresholdMode;
+        frame->time   = t;
+        frame->next   = q->cur;
+    }
+
+    return q->cur;
+}
+
+ARQualityConfig *arQualityGetConfig( ARQuality *q, int level )
+{
+    if( q == NULL || level < 0 || level >= q->level_num ) return NULL;
+
+    return &(q->level[level]);
+}
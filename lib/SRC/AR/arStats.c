@@ -0,0 +1,182 @@
+/*******************************************************
+ *
+ * Per-stage instrumentation of the detection pipeline.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#  include <windows.h>
+#  define AR_TLS                __declspec(thread)
+#  define ar_cas_ptr(p,o,n)     (InterlockedCompareExchangePointer((PVOID volatile *)(p), (n), (o)) == (o))
+#else
+#  ifdef __APPLE__
+#    include <mach/mach_time.h>
+#  else
+#    include <time.h>
+#  endif
+#  define AR_TLS                __thread
+#  define ar_cas_ptr(p,o,n)     __sync_bool_compare_and_swap(p, o, n)
+#endif
+#include <AR/ar.h>
+#include <AR/arStats.h>
+
+/*
+ * One ring per thread, written only by its thread. The rings are chained
+ * into a list that only grows, so readers can walk it without locking.
+ */
+typedef struct _ARStatsRing {
+    ARUint32                  time[AR_STATS_STAGE_NUM][AR_STATS_RING_SIZE];
+    volatile unsigned long    head[AR_STATS_STAGE_NUM];
+    volatile unsigned long    counter[AR_STATS_COUNTER_NUM];
+    struct _ARStatsRing       *next;
+} ARStatsRing;
+
+static ARStatsRing * volatile   ring_list = NULL;
+static AR_TLS ARStatsRing       *thread_ring = NULL;
+
+static ARStatsRing *get_ring( void );
+static int          compare_time( const void *a, const void *b );
+
+ARStatsTime arStatsGetTime( void )
+{
+#ifdef _WIN32
+    static LARGE_INTEGER   freq = { 0 };
+    LARGE_INTEGER          count;
+
+    if( freq.QuadPart == 0 ) QueryPerformanceFrequency( &freq );
+    QueryPerformanceCounter( &count );
+    return (ARStatsTime)(count.QuadPart / freq.QuadPart) * 1000000000
+         + (ARStatsTime)(count.QuadPart % freq.QuadPart) * 1000000000 / freq.QuadPart;
+#elif defined(__APPLE__)
+    static mach_timebase_info_data_t   base = { 0, 0 };
+
+    if( base.denom == 0 ) mach_timebase_info( &base );
+    return (ARStatsTime)mach_absolute_time() * base.numer / base.denom;
+#else
+    struct timespec   ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (ARStatsTime)ts.tv_sec * 1000000000 + (ARStatsTime)ts.tv_nsec;
+#endif
+}
+
+void arStatsAddTime( int stage, ARStatsTime time )
+{
+    ARStatsRing     *ring;
+    unsigned long   h;
+
+    if( stage < 0 || stage >= AR_STATS_STAGE_NUM ) return;
+    if( (ring = get_ring()) == NULL ) return;
+
+    h = ring->head[stage];
+    ring->time[stage][h % AR_STATS_RING_SIZE] = (time > 0xffffffff)? 0xffffffff: (ARUint32)time;
+    ring->head[stage] = h + 1;
+}
+
+void arStatsAddCount( int counter )
+{
+    ARStatsRing     *ring;
+
+    if( counter < 0 || counter >= AR_STATS_COUNTER_NUM ) return;
+    if( (ring = get_ring()) == NULL ) return;
+
+    ring->counter[counter]++;
+}
+
+int arGetStats( ARStats *stats )
+{
+#ifdef AR_STATS
+    ARStatsRing     *list, *ring;
+    ARStatsStage    *st;
+    ARUint32        *buf;
+    unsigned long   h;
+    double          sum;
+    int             num, n;
+    int             i, j;
+
+    if( stats == NULL ) return -1;
+    memset( stats, 0, sizeof(ARStats) );
+
+    /* threads may push new rings meanwhile: walk the same list throughout */
+    list = ring_list;
+    num = 0;
+    for( ring = list; ring != NULL; ring = ring->next ) num++;
+    if( num == 0 ) return 0;
+    arMalloc( buf, ARUint32, num * AR_STATS_RING_SIZE );
+
+    for( i = 0; i < AR_STATS_STAGE_NUM; i++ ) {
+        st = &(stats->stage[i]);
+        n = 0;
+        for( ring = list; ring != NULL; ring = ring->next ) {
+            h = ring->head[i];
+            st->total += h;
+            if( h > AR_STATS_RING_SIZE ) h = AR_STATS_RING_SIZE;
+            memcpy( &buf[n], ring->time[i], h * sizeof(ARUint32) );
+            n += h;
+        }
+        st->count = n;
+        if( n == 0 ) continue;
+
+        qsort( buf, n, sizeof(ARUint32), compare_time );
+        sum = 0.0;
+        for( j = 0; j < n; j++ ) sum += buf[j];
+        st->mean = sum / n;
+        st->p50  = buf[(int)ceil(0.50 * n) - 1];
+        st->p95  = buf[(int)ceil(0.95 * n) - 1];
+        st->p99  = buf[(int)ceil(0.99 * n) - 1];
+        st->max  = buf[n-1];
+    }
+
+    for( ring = list; ring != NULL; ring = ring->next ) {
+        for( i = 0; i < AR_STATS_COUNTER_NUM; i++ ) stats->counter[i] += ring->counter[i];
+    }
+
+    free( buf );
+
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+void arResetStats( void )
+{
+    ARStatsRing     *ring;
+    int             i;
+
+    for( ring = ring_list; ring != NULL; ring = ring->next ) {
+        for( i = 0; i < AR_STATS_STAGE_NUM; i++ ) ring->head[i] = 0;
+        for( i = 0; i < AR_STATS_COUNTER_NUM; i++ ) ring->counter[i] = 0;
+    }
+}
+
+static ARStatsRing *get_ring( void )
+{
+    ARStatsRing     *ring;
+
+    if( thread_ring != NULL ) return thread_ring;
+
+    ring = (ARStatsRing *)calloc( 1, sizeof(ARStatsRing) );
+    if( ring == NULL ) return NULL;
+    do {
+        ring->next = ring_list;
+    } while( !ar_cas_ptr( &ring_list, ring->next, ring ) );
+    thread_ring = ring;
+
+    return ring;
+}
+
+static int compare_time( const void *a, const void *b )
+{
+    ARUint32   ta = *(const ARUint32 *)a;
+    ARUint32   tb = *(const ARUint32 *)b;
+
+    return (ta > tb) - (ta < tb);
+}
@@ -0,0 +1,270 @@
+/*******************************************************
+ *
+ * Persistent worker pool for the parallel entry points.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <unistd.h>
+#  include <pthread.h>
+#endif
+#include <AR/ar.h>
+#include <AR/arThread.h>
+
+#ifdef _WIN32
+typedef HANDLE                  ar_thread_t;
+typedef CRITICAL_SECTION        ar_mutex_t;
+typedef CONDITION_VARIABLE      ar_cond_t;
+#  define ar_mutex_init(m)      InitializeCriticalSection(m)
+#  define ar_mutex_destroy(m)   DeleteCriticalSection(m)
+#  define ar_mutex_lock(m)      EnterCriticalSection(m)
+#  define ar_mutex_trylock(m)   (TryEnterCriticalSection(m) ? 0 : -1)
+#  define ar_mutex_unlock(m)    LeaveCriticalSection(m)
+#  define ar_cond_init(c)       InitializeConditionVariable(c)
+#  define ar_cond_destroy(c)
+#  define ar_cond_wait(c,m)     SleepConditionVariableCS(c, m, INFINITE)
+#  define ar_cond_broadcast(c)  WakeAllConditionVariable(c)
+#  define ar_fetch_add(p,v)     InterlockedExchangeAdd((volatile LONG *)(p), (LONG)(v))
+#else
+typedef pthread_t               ar_thread_t;
+typedef pthread_mutex_t         ar_mutex_t;
+typedef pthread_cond_t          ar_cond_t;
+#  define ar_mutex_init(m)      pthread_mutex_init(m, NULL)
+#  define ar_mutex_destroy(m)   pthread_mutex_destroy(m)
+#  define ar_mutex_lock(m)      pthread_mutex_lock(m)
+#  define ar_mutex_trylock(m)   (pthread_mutex_trylock(m) == 0 ? 0 : -1)
+#  define ar_mutex_unlock(m)    pthread_mutex_unlock(m)
+#  define ar_cond_init(c)       pthread_cond_init(c, NULL)
+#  define ar_cond_destroy(c)    pthread_cond_destroy(c)
+#  define ar_cond_wait(c,m)     pthread_cond_wait(c, m)
+#  define ar_cond_broadcast(c)  pthread_cond_broadcast(c)
+#  define ar_fetch_add(p,v)     __sync_fetch_and_add(p, v)
+#endif
+
+struct _ARThreadPool {
+    int                 thread_num;
+    ar_thread_t         *thread;
+    ar_mutex_t          run_mutex;      /* one loop at a time            */
+    ar_mutex_t          mutex;          /* protects the fields below     */
+    ar_cond_t           start_cond;
+    ar_cond_t           done_cond;
+    int                 generation;
+    int                 busy;           /* workers still in current loop */
+    int                 quit;
+    ARThreadPoolFunc    func;
+    void                *arg;
+    int                 num;
+    volatile int        next;           /* next index to hand out        */
+};
+
+static ARThreadPool     *default_pool = NULL;
+
+static void run_items( ARThreadPool *pool )
+{
+    int     i;
+
+    for(;;) {
+        i = ar_fetch_add( &(pool->next), 1 );
+        if( i >= pool->num ) break;
+        (*pool->func)( pool->arg, i );
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI worker( LPVOID param )
+#else
+static void *worker( void *param )
+#endif
+{
+    ARThreadPool   *pool = (ARThreadPool *)param;
+    int            generation = 0;
+
+    for(;;) {
+        ar_mutex_lock( &(pool->mutex) );
+        while( pool->generation == generation && !pool->quit ) {
+            ar_cond_wait( &(pool->start_cond), &(pool->mutex) );
+        }
+        if( pool->quit ) {
+            ar_mutex_unlock( &(pool->mutex) );
+            break;
+        }
+        generation = pool->generation;
+        ar_mutex_unlock( &(pool->mutex) );
+
+        run_items( pool );
+
+        ar_mutex_lock( &(pool->mutex) );
+        if( --pool->busy == 0 ) ar_cond_broadcast( &(pool->done_cond) );
+        ar_mutex_unlock( &(pool->mutex) );
+    }
+
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+int arThreadGetCPUNum( void )
+{
+    int     num;
+#ifdef _WIN32
+    SYSTEM_INFO   info;
+
+    GetSystemInfo( &info );
+    num = (int)info.dwNumberOfProcessors;
+#else
+    num = (int)sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+    if( num < 1 ) num = 1;
+
+    return num;
+}
+
+ARThreadPool *arThreadPoolCreate( int thread_num )
+{
+    ARThreadPool   *pool;
+    int            i;
+
+    if( thread_num < 0 ) thread_num = arThreadGetCPUNum() - 1;
+
+    arMalloc( pool, ARThreadPool, 1 );
+    pool->thread_num = 0;
+    pool->thread     = NULL;
+    pool->generation = 0;
+    pool->busy       = 0;
+    pool->quit       = 0;
+    pool->func       = NULL;
+    pool->arg        = NULL;
+    pool->num        = 0;
+    pool->next       = 0;
+    ar_mutex_init( &(pool->run_mutex) );
+    ar_mutex_init( &(pool->mutex) );
+    ar_cond_init( &(pool->start_cond) );
+    ar_cond_init( &(pool->done_cond) );
+
+    if( thread_num > 0 ) arMalloc( pool->thread, ar_thread_t, thread_num );
+    for( i = 0; i < thread_num; i++ ) {
+#ifdef _WIN32
+        pool->thread[i] = CreateThread( NULL, 0, worker, pool, 0, NULL );
+        if( pool->thread[i] == NULL ) break;
+#else
+        if( pthread_create( &(pool->thread[i]), NULL, worker, pool ) != 0 ) break;
+#endif
+        pool->thread_num++;
+    }
+    if( pool->thread_num != thread_num ) {
+        arThreadPoolDestroy( pool );
+        return NULL;
+    }
+
+    return pool;
+}
+
+ARThreadPool *arThreadPoolGetDefault( void )
+{
+#ifdef _WIN32
+    static INIT_ONCE   once = INIT_ONCE_STATIC_INIT;
+    BOOL               pending;
+
+    if( !InitOnceBeginInitialize( &once, 0, &pending, NULL ) ) return NULL;
+    if( pending ) {
+        default_pool = arThreadPoolCreate( -1 );
+        InitOnceComplete( &once, 0, NULL );
+    }
+#else
+    static pthread_mutex_t   once = PTHREAD_MUTEX_INITIALIZER;
+    static int               initialized = 0;
+
+    pthread_mutex_lock( &once );
+    if( !initialized ) {
+        default_pool = arThreadPoolCreate( -1 );
+        initialized = 1;
+    }
+    pthread_mutex_unlock( &once );
+#endif
+
+    return default_pool;
+}
+
+int arThreadPoolGetThreadNum( ARThreadPool *pool )
+{
+    if( pool == NULL ) return 0;
+
+    return pool->thread_num;
+}
+
+int arThreadPoolRun( ARThreadPool *pool, ARThreadPoolFunc func, void *arg, int num )
+{
+    int     i;
+
+    if( func == NULL || num < 0 ) return -1;
+
+    if( pool == NULL || pool->thread_num == 0 || num < 2
+     || ar_mutex_trylock( &(pool->run_mutex) ) < 0 ) {
+        for( i = 0; i < num; i++ ) (*func)( arg, i );
+        return 1;
+    }
+
+    ar_mutex_lock( &(pool->mutex) );
+    pool->func = func;
+    pool->arg  = arg;
+    pool->num  = num;
+    pool->next = 0;
+    pool->busy = pool->thread_num;
+    pool->generation++;
+    ar_cond_broadcast( &(pool->start_cond) );
+    ar_mutex_unlock( &(pool->mutex) );
+
+    run_items( pool );
+
+    ar_mutex_lock( &(pool->mutex) );
+    while( pool->busy > 0 ) {
+        ar_cond_wait( &(pool->done_cond), &(pool->mutex) );
+    }
+    pool->func = NULL;
+    pool->arg  = NULL;
+    ar_mutex_unlock( &(pool->mutex) );
+
+    ar_mutex_unlock( &(pool->run_mutex) );
+
+    return 0;
+}
+
+int arThreadPoolDestroy( ARThreadPool *pool )
+{
+    int     i;
+
+    if( pool == NULL ) return -1;
+
+    ar_mutex_lock( &(pool->mutex) );
+    pool->quit = 1;
+    ar_cond_broadcast( &(pool->start_cond) );
+    ar_mutex_unlock( &(pool->mutex) );
+
+    for( i = 0; i < pool->thread_num; i++ ) {
+#ifdef _WIN32
+        WaitForSingleObject( pool->thread[i], INFINITE );
+        CloseHandle( pool->thread[i] );
+#else
+        pthread_join( pool->thread[i], NULL );
+#endif
+    }
+
+    ar_cond_destroy( &(pool->done_cond) );
+    ar_cond_destroy( &(pool->start_cond) );
+    ar_mutex_destroy( &(pool->mutex) );
+    ar_mutex_destroy( &(pool->run_mutex) );
+    if( pool->thread ) free( pool->thread );
+    if( pool == default_pool ) default_pool = NULL;
+    free( pool );
+
+    return 0;
+}
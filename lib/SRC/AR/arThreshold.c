@@ -0,0 +1,106 @@
+/*******************************************************
+ *
+ * Automatic threshold of the marker detection.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <AR/ar.h>
+
+static int      thresh_auto = -1;
+
+static int      otsu( int *hist, int hist_num );
+
+int arGetThreshold( void )
+{
+    return thresh_auto;
+}
+
+int arUpdateThreshold( ARMarkerInfo *marker_info, int marker_num )
+{
+    int     *hist, *hist_roi;
+    int     hist_num, hist_roi_num;
+    int     roi[AR_SQUARE_MAX*4];
+    int     roi_num;
+    double  xmin, xmax, ymin, ymax, mx, my;
+    int     i, j;
+
+    if( arThresholdMode == AR_THRESHOLD_MODE_MANUAL ) return -1;
+
+    arGetImgHistogram( &hist, &hist_num, &hist_roi, &hist_roi_num );
+    if( hist_num == 0 ) return -1;
+
+    if( arThresholdMode == AR_THRESHOLD_MODE_AUTO_MARKER
+     && hist_roi_num >= AR_THRESH_ROI_SAMPLE_MIN ) {
+        thresh_auto = otsu( hist_roi, hist_roi_num );
+    }
+    else {
+        thresh_auto = otsu( hist, hist_num );
+    }
+
+    /*
+     * Next frame: around the markers found in this one, with a margin
+     * wide enough to take in the white surround of the black square.
+     */
+    roi_num = 0;
+    if( arThresholdMode == AR_THRESHOLD_MODE_AUTO_MARKER ) {
+        for( i = 0; i < marker_num && roi_num < AR_SQUARE_MAX; i++ ) {
+            if( marker_info[i].id < 0 ) continue;
+            xmin = xmax = marker_info[i].vertex[0][0];
+            ymin = ymax = marker_info[i].vertex[0][1];
+            for( j = 1; j < 4; j++ ) {
+                if( marker_info[i].vertex[j][0] < xmin ) xmin = marker_info[i].vertex[j][0];
+                if( marker_info[i].vertex[j][0] > xmax ) xmax = marker_info[i].vertex[j][0];
+                if( marker_info[i].vertex[j][1] < ymin ) ymin = marker_info[i].vertex[j][1];
+                if( marker_info[i].vertex[j][1] > ymax ) ymax = marker_info[i].vertex[j][1];
+            }
+            mx = (xmax - xmin) / 4.0;
+            my = (ymax - ymin) / 4.0;
+            roi[roi_num*4+0] = (int)(xmin - mx);
+            roi[roi_num*4+1] = (int)(xmax + mx);
+            roi[roi_num*4+2] = (int)(ymin - my);
+            roi[roi_num*4+3] = (int)(ymax + my);
+            roi_num++;
+        }
+    }
+    arSetImgHistogramROI( roi, roi_num );
+
+    return thresh_auto;
+}
+
+/*
+ * Otsu's threshold on the sums of the 3 components. When the classes
+ * are separated by empty bins, the middle of the gap.
+ */
+static int otsu( int *hist, int hist_num )
+{
+    double  sum, sum_b, w_b, w_f, d, var, var_max;
+    int     t1, t2;
+    int     i;
+
+    sum = 0.0;
+    for( i = 0; i < AR_THRESH_HIST_SIZE; i++ ) sum += (double)i * hist[i];
+
+    sum_b = w_b = 0.0;
+    var_max = -1.0;
+    t1 = t2 = 0;
+    for( i = 0; i < AR_THRESH_HIST_SIZE; i++ ) {
+        w_b += hist[i];
+        if( w_b == 0.0 ) continue;
+        w_f = hist_num - w_b;
+        if( w_f == 0.0 ) break;
+        sum_b += (double)i * hist[i];
+        d = sum_b / w_b - (sum - sum_b) / w_f;
+        var = w_b * w_f * d * d;
+        if( var > var_max ) {
+            var_max = var;
+            t1 = t2 = i;
+        }
+        else if( var == var_max ) t2 = i;
+    }
+
+    return (t1 + t2) / 2 / 3;
+}
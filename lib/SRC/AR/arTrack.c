@@ -0,0 +1,415 @@
+/*******************************************************
+ *
+ * Tracking of the marker corners between two detections.
+ *
+ * The corners found by arDetectMarker are followed from frame to
+ * frame by pyramidal Lucas-Kanade on the luminance: at each level,
+ * from the coarsest, the window around the corner in the previous
+ * frame is matched in the current one by Gauss-Newton steps, and
+ * the displacement found is the start of the next finer level.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <AR/ar.h>
+#include <AR/arColorConv.h>
+
+#define   WINDOW_SIZE     (2*AR_TRACK_WINDOW+1)
+#define   WINDOW_PIXELS   (WINDOW_SIZE*WINDOW_SIZE)
+
+static ARUint8       *pyramid[2][AR_TRACK_LEVEL_NUM];
+static int           pyramid_rect[2][AR_SQUARE_MAX][AR_TRACK_LEVEL_NUM][4];  /* per marker: xmin, xmax+1, ymin, ymax+1 */
+static int           level_xsize[AR_TRACK_LEVEL_NUM];
+static int           level_ysize[AR_TRACK_LEVEL_NUM];
+static int           pyramid_cur = 0;
+static int           pyramid_num = 0;        /* frames in the pyramids, up to 2 */
+
+static ARMarkerInfo  track_info[AR_SQUARE_MAX];
+static double        track_vertex[AR_SQUARE_MAX][4][2];  /* observed coordinates */
+static int           track_num   = 0;
+static int           track_count = 0;
+
+static int     make_pyramid( ARUint8 *image, int next );
+static int     track_markers( void );
+static int     track_point( int marker, int from, double px, double py, double *qx, double *qy );
+static int     check_square( double v[4][2], double prev[4][2] );
+static void    set_marker( ARMarkerInfo *marker, double v[4][2] );
+
+int arTrackMarker( ARUint8 *dataPtr, int thresh,
+                   ARMarkerInfo **marker_info, int *marker_num )
+{
+    int       built;
+    int       i, j;
+
+    built = 0;
+    if( track_num > 0 && track_count < arTrackInterval ) {
+        if( make_pyramid( dataPtr, 1 ) < 0 ) return -1;
+        built = 1;
+        if( track_markers() == 0 ) {
+            track_count++;
+            *marker_info = track_info;
+            *marker_num  = track_num;
+            return 1;
+        }
+    }
+
+    if( arDetectMarker( dataPtr, thresh, marker_info, marker_num ) < 0 ) return -1;
+
+    track_num = 0;
+    for( i = 0; i < *marker_num && track_num < AR_SQUARE_MAX; i++ ) {
+        if( (*marker_info)[i].id < 0 ) continue;
+        track_info[track_num] = (*marker_info)[i];
+        for( j = 0; j < 4; j++ ) {
+            arParamIdeal2Observ( arParam.dist_factor,
+                                 (*marker_info)[i].vertex[j][0], (*marker_info)[i].vertex[j][1],
+                                 &track_vertex[track_num][j][0], &track_vertex[track_num][j][1] );
+        }
+        track_num++;
+    }
+    track_count = 1;
+    if( arTrackInterval <= 1 ) track_num = 0;
+
+    /* the corners of the next frame are searched from the markers found */
+    if( track_num > 0 && make_pyramid( dataPtr, !built ) < 0 ) return -1;
+
+    return 0;
+}
+
+int arTrackReset( void )
+{
+    track_num = 0;
+
+    return 0;
+}
+
+/*
+ * Luminance of the frame around each tracked marker, and its levels,
+ * each the 2x2 mean of the one below. The region of a marker is the
+ * bounding box of its corners grown by the largest motion followed plus
+ * the window of the coarsest level. next: the frame is a new one,
+ * otherwise the regions of the current one are made again.
+ */
+static int make_pyramid( ARUint8 *image, int next )
+{
+    ARUint8   *p0, *p1, *dst;
+    int       *r, *rp;
+    double    xmin, xmax, ymin, ymax;
+    int       margin, xsize;
+    int       m, l, i, j;
+
+    if( level_xsize[0] != arImXsize || level_ysize[0] != arImYsize ) {
+        for( l = 0; l < AR_TRACK_LEVEL_NUM; l++ ) {
+            free( pyramid[0][l] );
+            free( pyramid[1][l] );
+            level_xsize[l] = arImXsize >> l;
+            level_ysize[l] = arImYsize >> l;
+            arMalloc( pyramid[0][l], ARUint8, level_xsize[l]*level_ysize[l] );
+            arMalloc( pyramid[1][l], ARUint8, level_xsize[l]*level_ysize[l] );
+        }
+        pyramid_num = 0;
+    }
+
+    if( next ) {
+        pyramid_cur = 1 - pyramid_cur;
+        if( pyramid_num < 2 ) pyramid_num++;
+    }
+
+    margin = AR_TRACK_SEARCH + ((AR_TRACK_WINDOW + 2) << (AR_TRACK_LEVEL_NUM-1));
+    for( m = 0; m < track_num; m++ ) {
+        xmin = xmax = track_vertex[m][0][0];
+        ymin = ymax = track_vertex[m][0][1];
+        for( j = 1; j < 4; j++ ) {
+            if( track_vertex[m][j][0] < xmin ) xmin = track_vertex[m][j][0];
+            if( track_vertex[m][j][0] > xmax ) xmax = track_vertex[m][j][0];
+            if( track_vertex[m][j][1] < ymin ) ymin = track_vertex[m][j][1];
+            if( track_vertex[m][j][1] > ymax ) ymax = track_vertex[m][j][1];
+        }
+
+        /* multiples of 4 pixels for the packed YUV formats */
+        r = pyramid_rect[pyramid_cur][m][0];
+        r[0] = ((int)xmin - margin) & ~3;
+        r[1] = ((int)xmax + margin + 4) & ~3;
+        r[2] = (int)ymin - margin;
+        r[3] = (int)ymax + margin + 1;
+        if( r[0] < 0 ) r[0] = 0;
+        if( r[1] > arImXsize ) r[1] = arImXsize;
+        if( r[2] < 0 ) r[2] = 0;
+        if( r[3] > arImYsize ) r[3] = arImYsize;
+        if( r[1] < r[0] ) r[1] = r[0];     /* out of the frame: nothing to track */
+        if( r[3] < r[2] ) r[3] = r[2];
+
+        for( j = r[2]; j < r[3] && r[0] < r[1]; j++ ) {
+            if( arColorConvertLuma( image + (j*arImXsize + r[0])*AR_PIX_SIZE_DEFAULT,
+                                    AR_DEFAULT_PIXEL_FORMAT, r[1]-r[0], 1,
+                                    pyramid[pyramid_cur][0] + j*arImXsize + r[0], NULL ) < 0 ) {
+                return -1;
+            }
+        }
+
+        for( l = 1; l < AR_TRACK_LEVEL_NUM; l++ ) {
+            rp = pyramid_rect[pyramid_cur][m][l-1];
+            r  = pyramid_rect[pyramid_cur][m][l];
+            r[0] = (rp[0] + 1) / 2;
+            r[1] = rp[1] / 2;
+            r[2] = (rp[2] + 1) / 2;
+            r[3] = rp[3] / 2;
+            xsize = level_xsize[l-1];
+            for( j = r[2]; j < r[3]; j++ ) {
+                p0 = pyramid[pyramid_cur][l-1] + (j*2)*xsize + r[0]*2;
+                p1 = p0 + xsize;
+                dst = pyramid[pyramid_cur][l] + j*level_xsize[l] + r[0];
+                for( i = r[0]; i < r[1]; i++ ) {
+                    *(dst++) = (p0[0] + p0[1] + p1[0] + p1[1] + 2) >> 2;
+                    p0 += 2;
+                    p1 += 2;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * All the corners of all the markers, or none: the tracked markers are
+ * only updated when every one of them has been followed.
+ */
+static int track_markers( void )
+{
+    double    v[AR_SQUARE_MAX][4][2];
+    double    bx, by;
+    int       i, j;
+
+    if( pyramid_num < 2 ) return -1;
+
+    /*
+     * Forward, then back from where the corner was found: a window that
+     * slid along an edge or onto another corner does not come back.
+     */
+    for( i = 0; i < track_num; i++ ) {
+        for( j = 0; j < 4; j++ ) {
+            if( track_point( i, 1-pyramid_cur, track_vertex[i][j][0], track_vertex[i][j][1],
+                             &v[i][j][0], &v[i][j][1] ) < 0 ) return -1;
+            if( track_point( i, pyramid_cur, v[i][j][0], v[i][j][1], &bx, &by ) < 0 ) return -1;
+            bx -= track_vertex[i][j][0];
+            by -= track_vertex[i][j][1];
+            if( bx*bx + by*by > AR_TRACK_BACK_ERROR_MAX*AR_TRACK_BACK_ERROR_MAX ) return -1;
+        }
+        if( check_square( v[i], track_vertex[i] ) < 0 ) return -1;
+    }
+
+    for( i = 0; i < track_num; i++ ) {
+        memcpy( track_vertex[i], v[i], sizeof(v[i]) );
+        set_marker( &track_info[i], v[i] );
+    }
+
+    return 0;
+}
+
+/*
+ * The (2*half+1)^2 pixels around (x,y), bilinear: the fractional part
+ * is the same for all of them, so are the weights.
+ */
+static void sample_window( ARUint8 *image, int xsize, double x, double y, int half, float *w )
+{
+    ARUint8   *p;
+    float     w00, w01, w10, w11;
+    double    ax, ay;
+    int       ix, iy, size;
+    int       i, j;
+
+    ix = (int)floor( x );
+    iy = (int)floor( y );
+    ax = x - ix;
+    ay = y - iy;
+    w00 = (float)((1.0-ax) * (1.0-ay));
+    w01 = (float)(     ax  * (1.0-ay));
+    w10 = (float)((1.0-ax) *      ay );
+    w11 = (float)(     ax  *      ay );
+
+    size = 2*half + 1;
+    for( j = 0; j < size; j++ ) {
+        p = image + (iy - half + j)*xsize + ix - half;
+        for( i = 0; i < size; i++ ) {
+            *(w++) = w00*p[0] + w01*p[1] + w10*p[xsize] + w11*p[xsize+1];
+            p++;
+        }
+    }
+}
+
+/* the window and its gradient can be sampled around (x,y) */
+static int inside( double x, double y, int r[4] )
+{
+    return( x - AR_TRACK_WINDOW - 1 >= r[0] && x + AR_TRACK_WINDOW + 2 < r[1]
+         && y - AR_TRACK_WINDOW - 1 >= r[2] && y + AR_TRACK_WINDOW + 2 < r[3] );
+}
+
+/*
+ * (px,py) of pyramid from, in observed coordinates, in the other one.
+ */
+static int track_point( int marker, int from, double px, double py, double *qx, double *qy )
+{
+    float     ext[(WINDOW_SIZE+2)*(WINDOW_SIZE+2)];
+    float     tmpl[WINDOW_PIXELS], gradx[WINDOW_PIXELS], grady[WINDOW_PIXELS];
+    float     cur[WINDOW_PIXELS];
+    float     *e;
+    ARUint8   *img0, *img1;
+    int       *r0, *r1;
+    double    x, y, s, vx, vy, gx, gy, dx, dy;
+    double    gxx, gxy, gyy, det, lmin, bx, by, d, err;
+    int       xsize;
+    int       l, i, j, k, it;
+
+    gx = gy = 0.0;
+    for( l = AR_TRACK_LEVEL_NUM-1; l >= 0; l-- ) {
+        s = 1.0 / (1 << l);
+        x = (px + 0.5) * s - 0.5;
+        y = (py + 0.5) * s - 0.5;
+        xsize = level_xsize[l];
+        img0 = pyramid[from][l];
+        img1 = pyramid[1-from][l];
+        r0 = pyramid_rect[from][marker][l];
+        r1 = pyramid_rect[1-from][marker][l];
+
+        /* a coarse level that cannot hold the window is skipped */
+        if( !inside( x, y, r0 ) ) {
+            if( l == 0 ) return -1;
+            gx *= 2.0;
+            gy *= 2.0;
+            continue;
+        }
+
+        /* the window with a border of one pixel, for the gradient */
+        sample_window( img0, xsize, x, y, AR_TRACK_WINDOW+1, ext );
+        gxx = gxy = gyy = 0.0;
+        k = 0;
+        for( j = 0; j < WINDOW_SIZE; j++ ) {
+            e = ext + (j+1)*(WINDOW_SIZE+2) + 1;
+            for( i = 0; i < WINDOW_SIZE; i++ ) {
+                tmpl[k]  = e[i];
+                gradx[k] = (e[i+1] - e[i-1]) * 0.5f;
+                grady[k] = (e[i+WINDOW_SIZE+2] - e[i-WINDOW_SIZE-2]) * 0.5f;
+                gxx += gradx[k] * gradx[k];
+                gxy += gradx[k] * grady[k];
+                gyy += grady[k] * grady[k];
+                k++;
+            }
+        }
+
+        /* smallest eigenvalue: the window must be textured both ways */
+        det  = gxx*gyy - gxy*gxy;
+        lmin = ((gxx + gyy) - sqrt((gxx-gyy)*(gxx-gyy) + 4.0*gxy*gxy)) * 0.5;
+        if( lmin < AR_TRACK_EIGEN_MIN * WINDOW_PIXELS || det <= 0.0 ) {
+            if( l == 0 ) return -1;
+            gx *= 2.0;
+            gy *= 2.0;
+            continue;
+        }
+
+        vx = gx;
+        vy = gy;
+        for( it = 0; it < AR_TRACK_ITERATION_MAX; it++ ) {
+            if( !inside( x+vx, y+vy, r1 ) ) return -1;
+            sample_window( img1, xsize, x+vx, y+vy, AR_TRACK_WINDOW, cur );
+            bx = by = 0.0;
+            for( k = 0; k < WINDOW_PIXELS; k++ ) {
+                d = tmpl[k] - cur[k];
+                bx += d * gradx[k];
+                by += d * grady[k];
+            }
+            dx = (gyy*bx - gxy*by) / det;
+            dy = (gxx*by - gxy*bx) / det;
+            vx += dx;
+            vy += dy;
+            if( dx*dx + dy*dy < 0.0001 ) break;
+        }
+
+        if( l > 0 ) {
+            gx = vx * 2.0;
+            gy = vy * 2.0;
+        }
+    }
+    if( !inside( x+vx, y+vy, r1 ) ) return -1;
+
+    /* mean absolute difference of the windows once matched */
+    sample_window( img1, xsize, x+vx, y+vy, AR_TRACK_WINDOW, cur );
+    err = 0.0;
+    for( k = 0; k < WINDOW_PIXELS; k++ ) err += fabs( tmpl[k] - cur[k] );
+    if( err > AR_TRACK_ERROR_MAX * WINDOW_PIXELS ) return -1;
+
+    *qx = px + vx;
+    *qy = py + vy;
+
+    return 0;
+}
+
+static double square_area( double v[4][2] )
+{
+    double    a;
+    int       i;
+
+    a = 0.0;
+    for( i = 0; i < 4; i++ ) {
+        a += v[i][0] * v[(i+1)%4][1] - v[(i+1)%4][0] * v[i][1];
+    }
+
+    return a * 0.5;
+}
+
+/*
+ * The square must stay convex, keep its orientation, and not shrink or
+ * grow by more than half in one frame.
+ */
+static int check_square( double v[4][2], double prev[4][2] )
+{
+    double    a0, a1, c;
+    int       i;
+
+    a0 = square_area( prev );
+    a1 = square_area( v );
+    if( a1 * a0 <= 0.0 ) return -1;
+    if( fabs(a1) < AR_AREA_MIN ) return -1;
+    if( fabs(a1) < fabs(a0) * 0.5 || fabs(a1) > fabs(a0) * 1.5 ) return -1;
+
+    for( i = 0; i < 4; i++ ) {
+        c = (v[(i+1)%4][0] - v[i][0]) * (v[(i+2)%4][1] - v[(i+1)%4][1])
+          - (v[(i+1)%4][1] - v[i][1]) * (v[(i+2)%4][0] - v[(i+1)%4][0]);
+        if( c * a0 <= 0.0 ) return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * vertex in ideal coordinates as arGetMarkerInfo gives them, line[i]
+ * through vertex[i] and vertex[i+1].
+ */
+static void set_marker( ARMarkerInfo *marker, double v[4][2] )
+{
+    double    ex, ey, n;
+    int       i;
+
+    for( i = 0; i < 4; i++ ) {
+        arParamObserv2Ideal( arParam.dist_factor, v[i][0], v[i][1],
+                             &marker->vertex[i][0], &marker->vertex[i][1] );
+    }
+    for( i = 0; i < 4; i++ ) {
+        ex = marker->vertex[(i+1)%4][0] - marker->vertex[i][0];
+        ey = marker->vertex[(i+1)%4][1] - marker->vertex[i][1];
+        n = sqrt( ex*ex + ey*ey );
+        marker->line[i][0] =  ey / n;
+        marker->line[i][1] = -ex / n;
+        marker->line[i][2] = -(marker->line[i][0]*marker->vertex[i][0]
+                             + marker->line[i][1]*marker->vertex[i][1]);
+    }
+
+    marker->pos[0] = (v[0][0] + v[1][0] + v[2][0] + v[3][0]) * 0.25;
+    marker->pos[1] = (v[0][1] + v[1][1] + v[2][1] + v[3][1]) * 0.25;
+    marker->area   = (int)fabs( square_area( v ) );
+}
@@ -21,6 +21,7 @@
 #include <AR/param.h>
 #include <AR/matrix.h>
 #include <AR/ar.h>
+#include <AR/arStats.h>
 
 
 int        arDebug                 = 0;
@@ -31,6 +32,12 @@ ARParam    arParam;
 int        arImXsize, arImYsize;
 int        arTemplateMatchingMode  = DEFAULT_TEMPLATE_MATCHING_MODE;
 int        arMatchingPCAMode       = DEFAULT_MATCHING_PCA_MODE;
+int        arPrecisionMode         = DEFAULT_PRECISION_MODE;
+int        arStatsMode             = DEFAULT_STATS_MODE;
+int        arThresholdMode         = DEFAULT_THRESHOLD_MODE;
+int        arIncrementalMode       = DEFAULT_INCREMENTAL_MODE;
+int        arLumaMode              = DEFAULT_LUMA_MODE;
+int        arTrackInterval         = DEFAULT_TRACK_INTERVAL;
 
 ARUint8*   arImageL                = NULL;
 ARUint8*   arImageR                = NULL;
@@ -62,6 +69,8 @@ ARUint32 arGetVersion(char **versionStringRef)
 
 static int arGetLine2(int x_coord[], int y_coord[], int coord_num,
                       int vertex[], double line[4][3], double v[4][2], double *dist_factor);
+static int arGetLine2f(int x_coord[], int y_coord[], int coord_num,
+                       int vertex[], double line[4][3], double v[4][2], double *dist_factor);
 
 int arInitCparam( ARParam *param )
 {
@@ -86,16 +95,30 @@ int arsInitCparam( ARSParam *sparam )
 int arGetLine(int x_coord[], int y_coord[], int coord_num,
               int vertex[], double line[4][3], double v[4][2])
 {
-    return arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, arParam.dist_factor );
+    int     ret;
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
+    ret = arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, arParam.dist_factor );
+    AR_STATS_STOP( AR_STATS_GET_LINE, t );
+
+    return ret;
 }
 
 int arsGetLine(int x_coord[], int y_coord[], int coord_num,
                int vertex[], double line[4][3], double v[4][2], int LorR)
 {   
+    int     ret;
+    AR_STATS_VAR(t);
+
+    AR_STATS_START(t);
     if( LorR ) 
-        return arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, arsParam.dist_factorL );
+        ret = arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, arsParam.dist_factorL );
     else
-        return arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, arsParam.dist_factorR );
+        ret = arGetLine2( x_coord, y_coord, coord_num, vertex, line, v, arsParam.dist_factorR );
+    AR_STATS_STOP( AR_STATS_GET_LINE, t );
+
+    return ret;
 }
 
 static int arGetLine2(int x_coord[], int y_coord[], int coord_num,
@@ -107,6 +130,10 @@ static int arGetLine2(int x_coord[], int y_coord[], int coord_num,
     int      st, ed, n;
     int      i, j;
 
+    if( arPrecisionMode == AR_PRECISION_FLOAT ) {
+        return arGetLine2f( x_coord, y_coord, coord_num, vertex, line, v, dist_factor );
+    }
+
     ev     = arVecAlloc( 2 );
     mean   = arVecAlloc( 2 );
     evec   = arMatrixAlloc( 2, 2 );
@@ -148,6 +175,82 @@ static int arGetLine2(int x_coord[], int y_coord[], int coord_num,
     return(0);
 }
 
+/*
+ * Single precision contour fitting. The principal axis of each side is
+ * taken from the closed-form eigenvector of its 2x2 covariance, so no
+ * matrices are allocated. Sums are accumulated relative to the first
+ * point of the side to keep the float moments well conditioned.
+ */
+static int arGetLine2f(int x_coord[], int y_coord[], int coord_num,
+                       int vertex[], double line[4][3], double v[4][2], double *dist_factor)
+{
+    float    df[4];
+    float    x, y, x0, y0;
+    float    sx, sy, sxx, sxy, syy;
+    float    mx, my, cxx, cxy, cyy;
+    float    ex, ey, l1, w;
+    double   w1;
+    int      st, ed, n;
+    int      i, j;
+
+    for( i = 0; i < 4; i++ ) df[i] = (float)dist_factor[i];
+
+    for( i = 0; i < 4; i++ ) {
+        w1 = (double)(vertex[i+1]-vertex[i]+1) * 0.05 + 0.5;
+        st = (int)(vertex[i]   + w1);
+        ed = (int)(vertex[i+1] - w1);
+        n = ed - st + 1;
+        if( n < 2 ) return(-1);
+
+        arParamObserv2Idealf( df, (float)x_coord[st], (float)y_coord[st], &x0, &y0 );
+        sx = sy = sxx = sxy = syy = 0.0f;
+        for( j = 1; j < n; j++ ) {
+            arParamObserv2Idealf( df, (float)x_coord[st+j], (float)y_coord[st+j], &x, &y );
+            x -= x0;
+            y -= y0;
+            sx  += x;
+            sy  += y;
+            sxx += x*x;
+            sxy += x*y;
+            syy += y*y;
+        }
+        mx  = sx / n;
+        my  = sy / n;
+        cxx = sxx / n - mx*mx;
+        cxy = sxy / n - mx*my;
+        cyy = syy / n - my*my;
+
+        l1 = 0.5f*(cxx+cyy) + sqrtf( 0.25f*(cxx-cyy)*(cxx-cyy) + cxy*cxy );
+        if( cxx >= cyy ) {
+            ex = l1 - cyy;
+            ey = cxy;
+        }
+        else {
+            ex = cxy;
+            ey = l1 - cxx;
+        }
+        w = sqrtf( ex*ex + ey*ey );
+        if( w == 0.0f ) return(-1);
+        ex /= w;
+        ey /= w;
+
+        line[i][0] =  ey;
+        line[i][1] = -ex;
+        line[i][2] = -(line[i][0]*(mx+x0) + line[i][1]*(my+y0));
+    }
+
+    for( i = 0; i < 4; i++ ) {
+        w1 = line[(i+3)%4][0] * line[i][1] - line[i][0] * line[(i+3)%4][1];
+        if( w1 == 0.0 ) return(-1);
+        v[i][0] = (  line[(i+3)%4][1] * line[i][2]
+                   - line[i][1] * line[(i+3)%4][2] ) / w1;
+        v[i][1] = (  line[i][0] * line[(i+3)%4][2]
+                   - line[(i+3)%4][0] * line[i][2] ) / w1;
+    }
+
+    return(0);
+}
+
 int arUtilMatMul( double s1[3][4], double s2[3][4], double d[3][4] )
 {
     int     i, j;
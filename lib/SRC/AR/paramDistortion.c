@@ -69,3 +69,38 @@ int arParamIdeal2Observ( const double dist_factor[4], const double ix, const dou
 
     return(0);
 }
+
+int arParamObserv2Idealf( const float dist_factor[4], const float ox, const float oy,
+                          float *ix, float *iy )
+{
+    float   z02, z0, p, q, z, px, py;
+    int     i;
+
+    px = ox - dist_factor[0];
+    py = oy - dist_factor[1];
+    p = dist_factor[2]/100000000.0f;
+    z02 = px*px+ py*py;
+    q = z0 = sqrtf(z02);
+
+    for( i = 1; ; i++ ) {
+        if( z0 != 0.0f ) {
+            z = z0 - ((1.0f - p*z02)*z0 - q) / (1.0f - 3.0f*p*z02);
+            px = px * z / z0;
+            py = py * z / z0;
+        }
+        else {
+            px = 0.0f;
+            py = 0.0f;
+            break;
+        }
+        if( i == PD_LOOP ) break;
+
+        z02 = px*px+ py*py;
+        z0 = sqrtf(z02);
+    }
+
+    *ix = px / dist_factor[3] + dist_factor[0];
+    *iy = py / dist_factor[3] + dist_factor[1];
+
+    return(0);
+}
@@ -49,6 +49,8 @@ int arMultiFreeConfig(ARMultiMarkerInfoT *config)
         if (arFreePatt(config->marker[i].patt_id) != 1) return (-1);
     }
     free(config->marker);
+    if( config->work != NULL ) free(config->work);
+    if( config->patt_index != NULL ) free(config->patt_index);
     free(config);
     config = NULL;
 
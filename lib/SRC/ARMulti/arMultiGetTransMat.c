@@ -14,6 +14,7 @@
 #include <AR/ar.h>
 #include <AR/matrix.h>
 #include <AR/arMulti.h>
+#include <AR/arThread.h>
 
 #define  debug  0
 
@@ -23,21 +24,207 @@
 #define  AR_MULTI_GET_TRANS_MAT_MAX_LOOP_COUNT   2
 #define  AR_MULTI_GET_TRANS_MAT_MAX_FIT_ERROR    10.0
 
+#define  AR_MULTI_ROBUST_MAX_HYPOTHESIS   16
+#define  AR_MULTI_ROBUST_INLIER_THRESH     4.0   /* RMS corner error in pixels */
+#define  AR_MULTI_ROBUST_STOP_RATIO        0.9
+#define  AR_MULTI_ROBUST_REFINE_COUNT      2
+
 typedef struct {
     double   pos[4][2];
     double   thresh;
     double   err;
     int      marker;
     int      dir;
+    int      inlier;
+    int      vdir;          /* dir of the visible detection, as bucketed */
 } arMultiEachMarkerInternalInfoT;
 
+/*
+ * Single-marker pose of one detection in one of its 4 orientations,
+ * shared by all the boards of an arMultiGetTransMatSet() call; a board
+ * verified after another may turn a detection. center/width is the
+ * geometry the pose was computed with; width is 0 while no board asked
+ * for it.
+ */
+typedef struct {
+    double   trans[3][4];
+    double   err;
+    double   center[2];
+    double   width;
+} arMultiPoseCacheT;
+
+typedef struct {
+    ARMarkerInfo         *marker_info;
+    ARMultiMarkerInfoT   **config;
+    arMultiPoseCacheT    *cache;
+    int                  *job;
+    double               *err;
+} arMultiSetArgT;
+
+/*
+ * Scratch memory kept in config->work, sized for config->marker_num
+ * markers: the verify_markers() table followed by the 2D/3D point lists
+ * handed to arGetTransMat5Work() and its two work buffers.
+ */
+#define  WORK_WINFO(c)    ((arMultiEachMarkerInternalInfoT *)(c)->work)
+#define  WORK_POS2D(c)    ((double *)(WORK_WINFO(c) + (c)->work_num))
+#define  WORK_POS3D(c)    (WORK_POS2D(c) + (c)->work_num*4*2)
+#define  WORK_WPOS2D(c)   (WORK_POS3D(c) + (c)->work_num*4*3)
+#define  WORK_WPOS3D(c)   (WORK_WPOS2D(c) + (c)->work_num*4*2)
+
 static int verify_markers(ARMarkerInfo *marker_info, int marker_num,
                           ARMultiMarkerInfoT *config);
+static void alloc_work(ARMultiMarkerInfoT *config);
+static void bucket_markers(ARMarkerInfo *marker_info, int marker_num,
+                           ARMultiMarkerInfoT *config);
+static int  robust_score(ARMarkerInfo *marker_info, ARMultiMarkerInfoT *config,
+                         double trans[3][4], double *err);
+static double multi_solve(ARMarkerInfo *marker_info, ARMultiMarkerInfoT *config,
+                          arMultiPoseCacheT *cache);
+static double get_cached_trans(arMultiPoseCacheT *cache, double center[2], double width,
+                               double conv[3][4]);
+static void   set_pose_func(void *arg, int index);
+static void   set_board_func(void *arg, int index);
 
 
 double arMultiGetTransMat(ARMarkerInfo *marker_info, int marker_num,
                           ARMultiMarkerInfoT *config)
 {
+    alloc_work( config );
+
+    if( config->prevF ) {
+        verify_markers( marker_info, marker_num, config );
+    }
+
+    bucket_markers( marker_info, marker_num, config );
+
+    return multi_solve( marker_info, config, NULL );
+}
+
+int arMultiGetTransMatSet(ARMarkerInfo *marker_info, int marker_num,
+                          ARMultiMarkerInfoT **config, int config_num,
+                          double *err, int *visible)
+{
+    arMultiSetArgT        arg;
+    arMultiPoseCacheT     *cache;
+    char                  *buf;
+    int                   *job;
+    int                   job_num;
+    int                   b, i, k;
+
+    if( config == NULL || err == NULL || config_num < 0 || marker_num < 0 ) return -1;
+    if( config_num == 0 ) return 0;
+
+    cache = NULL;
+    job   = NULL;
+    buf   = NULL;
+    if( marker_num > 0 ) {
+        arMalloc(buf, char, marker_num * 4 * (sizeof(arMultiPoseCacheT) + sizeof(int)));
+        cache = (arMultiPoseCacheT *)buf;
+        job   = (int *)(cache + marker_num * 4);
+        for( i = 0; i < marker_num * 4; i++ ) cache[i].width = 0.0;
+    }
+
+    /*
+     * Verification may relabel and turn detections, so it runs board after
+     * board exactly as a sequence of arMultiGetTransMat() calls would; each
+     * board keeps the orientation of its detections as they were when it
+     * was bucketed. Only the pose computations below run in parallel.
+     */
+    job_num = 0;
+    for( b = 0; b < config_num; b++ ) {
+        alloc_work( config[b] );
+        if( config[b]->prevF ) {
+            verify_markers( marker_info, marker_num, config[b] );
+        }
+        bucket_markers( marker_info, marker_num, config[b] );
+
+        for( i = 0; i < config[b]->marker_num; i++ ) {
+            if( (k=config[b]->marker[i].visible) == -1 ) continue;
+            k = k*4 + WORK_WINFO(config[b])[i].vdir;
+            if( cache[k].width != 0.0 ) continue;
+            cache[k].center[0] = config[b]->marker[i].center[0];
+            cache[k].center[1] = config[b]->marker[i].center[1];
+            cache[k].width     = config[b]->marker[i].width;
+            job[job_num++] = k;
+        }
+    }
+
+    arg.marker_info = marker_info;
+    arg.config      = config;
+    arg.cache       = cache;
+    arg.job         = job;
+    arg.err         = err;
+    arThreadPoolRun( arThreadPoolGetDefault(), set_pose_func, &arg, job_num );
+    arThreadPoolRun( arThreadPoolGetDefault(), set_board_func, &arg, config_num );
+
+    if( visible != NULL ) {
+        for( b = 0; b < config_num; b++ ) {
+            visible[b] = 0;
+            for( i = 0; i < config[b]->marker_num; i++ ) {
+                if( config[b]->marker[i].visible >= 0 ) visible[b]++;
+            }
+        }
+    }
+
+    if( buf != NULL ) free(buf);
+
+    return 0;
+}
+
+static void set_pose_func(void *arg, int index)
+{
+    arMultiSetArgT     *sarg = (arMultiSetArgT *)arg;
+    arMultiPoseCacheT  *cache;
+    ARMarkerInfo       marker;
+    int                k;
+
+    k = sarg->job[index];
+    cache = &(sarg->cache[k]);
+    marker = sarg->marker_info[k/4];
+    marker.dir = k % 4;
+    cache->err = arGetTransMat(&marker, cache->center, cache->width, cache->trans);
+}
+
+static void set_board_func(void *arg, int index)
+{
+    arMultiSetArgT     *sarg = (arMultiSetArgT *)arg;
+
+    sarg->err[index] = multi_solve( sarg->marker_info, sarg->config[index], sarg->cache );
+}
+
+/*
+ * Convert a cached single-marker pose to the geometry of another board
+ * marker. The fit is invariant to a scaling of the marker (translation
+ * scales with it) and to a shift of its centre, so no refit is needed.
+ */
+static double get_cached_trans(arMultiPoseCacheT *cache, double center[2], double width,
+                               double conv[3][4])
+{
+    double   t[3], s;
+    int      i, j;
+
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 4; i++ ) conv[j][i] = cache->trans[j][i];
+    }
+    if( width == cache->width && center[0] == cache->center[0] && center[1] == cache->center[1] ) {
+        return cache->err;
+    }
+
+    s = width / cache->width;
+    for( j = 0; j < 3; j++ ) {
+        t[j] = cache->trans[j][3] + cache->trans[j][0] * cache->center[0]
+                                  + cache->trans[j][1] * cache->center[1];
+        conv[j][3] = s * t[j] - conv[j][0] * center[0] - conv[j][1] * center[1];
+    }
+
+    return cache->err;
+}
+
+static double multi_solve(ARMarkerInfo *marker_info, ARMultiMarkerInfoT *config,
+                          arMultiPoseCacheT *cache)
+{
+    arMultiEachMarkerInternalInfoT *winfo;
     double                *pos2d, *pos3d;
     double                rot[3][3], trans1[3][4], trans2[3][4];
     double                err, err2;
@@ -45,25 +232,20 @@ double arMultiGetTransMat(ARMarkerInfo *marker_info, int marker_num,
     int                   dir;
     int                   i, j, k;
 
-    if( config->prevF ) {
-        verify_markers( marker_info, marker_num, config );
-    }
-
+    winfo = WORK_WINFO(config);
     max = -1;
     vnum = 0;
     for( i = 0; i < config->marker_num; i++ ) {
-        k = -1;
-        for( j = 0; j < marker_num; j++ ) {
-            if( marker_info[j].id != config->marker[i].patt_id ) continue;
-            if( marker_info[j].cf < 0.70 ) continue;
+        if( (k=config->marker[i].visible) == -1) continue;
 
-            if( k == -1 ) k = j;
-            else if( marker_info[k].cf < marker_info[j].cf ) k = j;
+        if( cache == NULL ) {
+            err = arGetTransMat(&marker_info[k], config->marker[i].center,
+                                config->marker[i].width, trans1);
+        }
+        else {
+            err = get_cached_trans(&cache[k*4+winfo[i].vdir], config->marker[i].center,
+                                   config->marker[i].width, trans1);
         }
-        if( (config->marker[i].visible=k) == -1) continue;
-
-        err = arGetTransMat(&marker_info[k], config->marker[i].center,
-                            config->marker[i].width, trans1);
 #if debug
 printf("##err = %10.5f %d %10.5f %10.5f\n", err, marker_info[k].dir, marker_info[k].pos[0], marker_info[k].pos[1]);
 #endif
@@ -90,14 +272,14 @@ printf("##err = %10.5f %d %10.5f %10.5f\n", err, marker_info[k].dir, marker_info
         return -1;
     }
 
-    arMalloc(pos2d, double, vnum*4*2);
-    arMalloc(pos3d, double, vnum*4*3);
+    pos2d = WORK_POS2D(config);
+    pos3d = WORK_POS3D(config);
 
     j = 0;
     for( i = 0; i < config->marker_num; i++ ) {
         if( (k=config->marker[i].visible) < 0 ) continue;
 
-        dir = marker_info[k].dir;
+        dir = winfo[i].vdir;
         pos2d[j*8+0] = marker_info[k].vertex[(4-dir)%4][0];
         pos2d[j*8+1] = marker_info[k].vertex[(4-dir)%4][1];
         pos2d[j*8+2] = marker_info[k].vertex[(5-dir)%4][0];
@@ -128,16 +310,17 @@ printf("##err = %10.5f %d %10.5f %10.5f\n", err, marker_info[k].dir, marker_info
             }
         }
         for( i = 0; i < AR_MULTI_GET_TRANS_MAT_MAX_LOOP_COUNT; i++ ) {
-            err = arGetTransMat4( rot, (double (*)[2])pos2d,
-                                       (double (*)[3])pos3d,
-                                        vnum*4, config->trans );
+            err = arGetTransMat5Work( rot, (double (*)[2])pos2d,
+                                           (double (*)[3])pos3d,
+                                            vnum*4, config->trans,
+                                            arParam.dist_factor, arParam.mat,
+                                            (double (*)[2])WORK_WPOS2D(config),
+                                            (double (*)[3])WORK_WPOS3D(config) );
             if( err < AR_MULTI_GET_TRANS_MAT_MAX_FIT_ERROR ) break;
         }
 
         if( err < THRESH_2 ) {
             config->prevF = 1;
-            free(pos3d);
-            free(pos2d);
             return err;
         }
     }
@@ -150,8 +333,10 @@ printf("##err = %10.5f %d %10.5f %10.5f\n", err, marker_info[k].dir, marker_info
     }
 
     for( i = 0; i < AR_MULTI_GET_TRANS_MAT_MAX_LOOP_COUNT; i++ ) {
-        err2 = arGetTransMat4( rot, (double (*)[2])pos2d, (double (*)[3])pos3d,
-                              vnum*4, trans2 );
+        err2 = arGetTransMat5Work( rot, (double (*)[2])pos2d, (double (*)[3])pos3d,
+                                   vnum*4, trans2, arParam.dist_factor, arParam.mat,
+                                   (double (*)[2])WORK_WPOS2D(config),
+                                   (double (*)[3])WORK_WPOS3D(config) );
         if( err2 < AR_MULTI_GET_TRANS_MAT_MAX_FIT_ERROR ) break;
     }
 
@@ -171,11 +356,264 @@ printf("##err = %10.5f %d %10.5f %10.5f\n", err, marker_info[k].dir, marker_info
         config->prevF = 0;
     }
 
-    free(pos3d);
-    free(pos2d);
     return err;
 }
 
+double arMultiGetTransMatRobust(ARMarkerInfo *marker_info, int marker_num,
+                                ARMultiMarkerInfoT *config)
+{
+    arMultiEachMarkerInternalInfoT *winfo;
+    double                *pos2d, *pos3d;
+    double                rot[3][3], trans1[3][4], hyp[3][4], best[3][4];
+    double                err, best_err;
+    int                   hyp_marker[AR_MULTI_ROBUST_MAX_HYPOTHESIS];
+    int                   hyp_num, vnum, inum, best_num;
+    int                   dir;
+    int                   h, i, j, k, l;
+
+    alloc_work( config );
+    winfo = WORK_WINFO(config);
+
+    bucket_markers( marker_info, marker_num, config );
+
+    vnum = 0;
+    for( i = 0; i < config->marker_num; i++ ) {
+        k = config->marker[i].visible;
+        winfo[i].marker = k;
+        winfo[i].inlier = 0;
+        if( k == -1 ) continue;
+        vnum++;
+
+        dir = marker_info[k].dir;
+        for( j = 0; j < 4; j++ ) {
+            if( arFittingMode == AR_FITTING_TO_INPUT ) {
+                arParamIdeal2Observ( arParam.dist_factor,
+                                     marker_info[k].vertex[(4-dir+j)%4][0],
+                                     marker_info[k].vertex[(4-dir+j)%4][1],
+                                     &winfo[i].pos[j][0], &winfo[i].pos[j][1] );
+            }
+            else {
+                winfo[i].pos[j][0] = marker_info[k].vertex[(4-dir+j)%4][0];
+                winfo[i].pos[j][1] = marker_info[k].vertex[(4-dir+j)%4][1];
+            }
+        }
+    }
+    if( vnum == 0 ) {
+        config->prevF = 0;
+        return -1;
+    }
+
+    /* hypotheses are tried from the largest marker down */
+    for( hyp_num = 0; hyp_num < AR_MULTI_ROBUST_MAX_HYPOTHESIS; hyp_num++ ) {
+        k = -1;
+        for( i = 0; i < config->marker_num; i++ ) {
+            if( winfo[i].marker < 0 ) continue;
+            for( j = 0; j < hyp_num; j++ ) if( hyp_marker[j] == i ) break;
+            if( j < hyp_num ) continue;
+            if( k == -1 || marker_info[winfo[i].marker].area > marker_info[winfo[k].marker].area ) k = i;
+        }
+        if( k == -1 ) break;
+        hyp_marker[hyp_num] = k;
+    }
+
+    best_num = 0;
+    best_err = 0.0;
+    for( h = (config->prevF)? -1: 0; h < hyp_num; h++ ) {
+        if( h < 0 ) {
+            for( j = 0; j < 3; j++ ) for( i = 0; i < 4; i++ ) hyp[j][i] = config->trans[j][i];
+        }
+        else {
+            i = hyp_marker[h];
+            err = arGetTransMat(&marker_info[winfo[i].marker], config->marker[i].center,
+                                config->marker[i].width, trans1);
+            if( err < 0 || err > THRESH_1 ) continue;
+            arUtilMatMul( trans1, config->marker[i].itrans, hyp );
+        }
+
+        inum = robust_score( marker_info, config, hyp, &err );
+        if( inum > best_num || (inum == best_num && inum > 0 && err < best_err) ) {
+            best_num = inum;
+            best_err = err;
+            for( j = 0; j < 3; j++ ) for( i = 0; i < 4; i++ ) best[j][i] = hyp[j][i];
+        }
+        if( best_num >= AR_MULTI_ROBUST_STOP_RATIO * vnum ) break;
+    }
+    if( best_num == 0 ) {
+        config->prevF = 0;
+        return -1;
+    }
+
+    pos2d = WORK_POS2D(config);
+    pos3d = WORK_POS3D(config);
+    err = -1;
+    for( l = 0; l < AR_MULTI_ROBUST_REFINE_COUNT; l++ ) {
+        inum = robust_score( marker_info, config, best, &best_err );
+        if( l > 0 && inum <= best_num ) break;
+        best_num = inum;
+
+        j = 0;
+        for( i = 0; i < config->marker_num; i++ ) {
+            if( !winfo[i].inlier ) continue;
+
+            k = winfo[i].marker;
+            dir = marker_info[k].dir;
+            for( h = 0; h < 4; h++ ) {
+                pos2d[j*8+h*2+0] = marker_info[k].vertex[(4-dir+h)%4][0];
+                pos2d[j*8+h*2+1] = marker_info[k].vertex[(4-dir+h)%4][1];
+                pos3d[j*12+h*3+0] = config->marker[i].pos3d[h][0];
+                pos3d[j*12+h*3+1] = config->marker[i].pos3d[h][1];
+                pos3d[j*12+h*3+2] = config->marker[i].pos3d[h][2];
+            }
+            j++;
+        }
+
+        for( k = 0; k < 3; k++ ) {
+            for( i = 0; i < 3; i++ ) rot[k][i] = best[k][i];
+        }
+        for( i = 0; i < AR_MULTI_GET_TRANS_MAT_MAX_LOOP_COUNT; i++ ) {
+            err = arGetTransMat5Work( rot, (double (*)[2])pos2d, (double (*)[3])pos3d,
+                                      j*4, best, arParam.dist_factor, arParam.mat,
+                                      (double (*)[2])WORK_WPOS2D(config),
+                                      (double (*)[3])WORK_WPOS3D(config) );
+            if( err < AR_MULTI_GET_TRANS_MAT_MAX_FIT_ERROR ) break;
+        }
+    }
+    robust_score( marker_info, config, best, &best_err );
+
+    for( i = 0; i < config->marker_num; i++ ) {
+        if( !winfo[i].inlier ) config->marker[i].visible = -1;
+    }
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 4; i++ ) config->trans[j][i] = best[j][i];
+    }
+    config->prevF = ( err >= 0 && err < THRESH_3 )? 1: 0;
+
+    return err;
+}
+
+/*
+ * Reproject every detected board marker with trans and flag the ones whose
+ * RMS corner error is under AR_MULTI_ROBUST_INLIER_THRESH. Returns the
+ * inlier count; *err receives the summed squared error of the inliers.
+ */
+static int robust_score(ARMarkerInfo *marker_info, ARMultiMarkerInfoT *config,
+                        double trans[3][4], double *err)
+{
+    arMultiEachMarkerInternalInfoT *winfo;
+    double                         cmat[3][4];
+    double                         hx, hy, h, dx, dy, e;
+    int                            num;
+    int                            i, j, k;
+
+    winfo = WORK_WINFO(config);
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 4; i++ ) {
+            cmat[j][i] = arParam.mat[j][0] * trans[0][i]
+                       + arParam.mat[j][1] * trans[1][i]
+                       + arParam.mat[j][2] * trans[2][i];
+        }
+        cmat[j][3] += arParam.mat[j][3];
+    }
+
+    num = 0;
+    *err = 0.0;
+    for( i = 0; i < config->marker_num; i++ ) {
+        winfo[i].inlier = 0;
+        if( winfo[i].marker < 0 ) continue;
+
+        e = 0.0;
+        for( k = 0; k < 4; k++ ) {
+            hx = cmat[0][0] * config->marker[i].pos3d[k][0]
+               + cmat[0][1] * config->marker[i].pos3d[k][1]
+               + cmat[0][2] * config->marker[i].pos3d[k][2]
+               + cmat[0][3];
+            hy = cmat[1][0] * config->marker[i].pos3d[k][0]
+               + cmat[1][1] * config->marker[i].pos3d[k][1]
+               + cmat[1][2] * config->marker[i].pos3d[k][2]
+               + cmat[1][3];
+            h  = cmat[2][0] * config->marker[i].pos3d[k][0]
+               + cmat[2][1] * config->marker[i].pos3d[k][1]
+               + cmat[2][2] * config->marker[i].pos3d[k][2]
+               + cmat[2][3];
+            if( h <= 0.0 ) break;
+            dx = hx / h - winfo[i].pos[k][0];
+            dy = hy / h - winfo[i].pos[k][1];
+            e += dx*dx + dy*dy;
+        }
+        if( k < 4 ) continue;
+
+        winfo[i].err = e / 4.0;
+        if( winfo[i].err < AR_MULTI_ROBUST_INLIER_THRESH * AR_MULTI_ROBUST_INLIER_THRESH ) {
+            winfo[i].inlier = 1;
+            *err += winfo[i].err;
+            num++;
+        }
+    }
+
+    return num;
+}
+
+/*
+ * Set config->marker[i].visible to the detection with the highest cf
+ * (at least 0.70) among those carrying the pattern of marker i, -1 if
+ * there is none, and keep its orientation in the work table. The
+ * detections are visited once and dispatched through the pattern id
+ * table built by arMultiReadConfigFile.
+ */
+static void bucket_markers(ARMarkerInfo *marker_info, int marker_num,
+                           ARMultiMarkerInfoT *config)
+{
+    arMultiEachMarkerInternalInfoT *winfo;
+    int                            id;
+    int                            i, j, k;
+
+    winfo = WORK_WINFO(config);
+    if( config->patt_index == NULL ) {
+        for( i = 0; i < config->marker_num; i++ ) {
+            k = -1;
+            for( j = 0; j < marker_num; j++ ) {
+                if( marker_info[j].id != config->marker[i].patt_id ) continue;
+                if( marker_info[j].cf < 0.70 ) continue;
+
+                if( k == -1 ) k = j;
+                else if( marker_info[k].cf < marker_info[j].cf ) k = j;
+            }
+            config->marker[i].visible = k;
+            if( k >= 0 ) winfo[i].vdir = marker_info[k].dir;
+        }
+        return;
+    }
+
+    for( i = 0; i < config->marker_num; i++ ) config->marker[i].visible = -1;
+    for( j = 0; j < marker_num; j++ ) {
+        id = marker_info[j].id;
+        if( id < 0 || id >= config->patt_index_num ) continue;
+        if( marker_info[j].cf < 0.70 ) continue;
+
+        for( i = config->patt_index[id]; i >= 0; i = config->marker[i].patt_next ) {
+            k = config->marker[i].visible;
+            if( k == -1 || marker_info[k].cf < marker_info[j].cf ) config->marker[i].visible = j;
+        }
+    }
+    for( i = 0; i < config->marker_num; i++ ) {
+        if( (k=config->marker[i].visible) >= 0 ) winfo[i].vdir = marker_info[k].dir;
+    }
+}
+
+static void alloc_work(ARMultiMarkerInfoT *config)
+{
+    char    *work;
+
+    if( config->marker_num <= 0 ) return;
+    if( config->work != NULL && config->work_num >= config->marker_num ) return;
+
+    if( config->work != NULL ) free(config->work);
+    arMalloc(work, char, config->marker_num * (sizeof(arMultiEachMarkerInternalInfoT)
+                                              + sizeof(double)*4*(2+3+2+3)));
+    config->work     = work;
+    config->work_num = config->marker_num;
+}
+
 static int verify_markers(ARMarkerInfo *marker_info, int marker_num,
                           ARMultiMarkerInfoT *config)
 {
@@ -189,7 +627,7 @@ static int verify_markers(ARMarkerInfo *marker_info, int marker_num,
     int                            w1, w2;
     int                            i, j, k;
 
-    arMalloc(winfo,arMultiEachMarkerInternalInfoT,config->marker_num);
+    winfo = WORK_WINFO(config);
 
     for( i = 0; i < config->marker_num; i++ ) {
         arUtilMatMul(config->trans, config->marker[i].trans, wtrans);
@@ -318,7 +756,6 @@ printf("%3d<=>%3d, err = %f(%f)\n", i+1, marker2+1, err2, winfo[i].thresh);
 printf("w1,w2 = %d,%d\n", w1, w2);
 #endif
     if( w2 >= w1 ) {
-        free(winfo);
         return -1;
     }
 
@@ -333,7 +770,5 @@ printf("w1,w2 = %d,%d\n", w1, w2);
         }
     }
 
-    free(winfo);
-
     return 0;
 }
@@ -91,6 +91,20 @@ ARMultiMarkerInfoT *arMultiReadConfigFile( const char *filename )
     marker_info->marker     = marker;
     marker_info->marker_num = num;
     marker_info->prevF      = 0;
+    marker_info->work       = NULL;
+    marker_info->work_num   = 0;
+
+    num = 0;
+    for( i = 0; i < marker_info->marker_num; i++ ) {
+        if( marker[i].patt_id >= num ) num = marker[i].patt_id + 1;
+    }
+    marker_info->patt_index_num = num;
+    arMalloc(marker_info->patt_index, int, (num > 0)? num: 1);
+    for( i = 0; i < num; i++ ) marker_info->patt_index[i] = -1;
+    for( i = marker_info->marker_num-1; i >= 0; i-- ) {
+        marker[i].patt_next = marker_info->patt_index[marker[i].patt_id];
+        marker_info->patt_index[marker[i].patt_id] = i;
+    }
 
     return marker_info;
 }
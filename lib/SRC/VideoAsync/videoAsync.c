@@ -0,0 +1,326 @@
+/*
+ *   Revision: 1.0   Date: 2026/10/18
+ *   Asynchronous capture on top of any libARvideo driver.
+ *
+ *   A capture thread takes the frames from the driver and copies them
+ *   into a ring of buffers, so the application never waits on the device.
+ *   Each buffer carries its own state, changed only by compare-and-swap:
+ *
+ *     FREE -> WRITING -> READY -> READING -> FREE
+ *
+ *   The capture thread is the only one to take FREE buffers; the
+ *   application is the only one to take READY buffers for reading.
+ *   When the ring is full and the application asked for the latest
+ *   frame, the capture thread takes back the oldest READY buffer
+ *   (READY -> WRITING); the CAS decides who wins if the application
+ *   goes for the same buffer at that moment.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/arStats.h>
+#include <AR/video.h>
+
+#define   BUFFER_FREE       0
+#define   BUFFER_WRITING    1
+#define   BUFFER_READY      2
+#define   BUFFER_READING    3
+
+#define   MODE_LATEST       0
+#define   MODE_NEXT         1
+
+#define   WAIT_IMAGE_USEC   1000
+#define   WAIT_BUFFER_USEC  500
+
+#define   ar_cas(p,o,n)     __sync_bool_compare_and_swap(p, o, n)
+
+struct _AR2VideoAsyncT {
+    AR2VideoParamT      *vid;           /* NULL: arVideo* stream */
+    int                 xsize;
+    int                 ysize;
+    size_t              size;
+
+    int                 buffer_num;
+    ARUint8             **buffer;
+    volatile int        *state;
+    volatile unsigned long  *seq;
+    volatile double     *time;
+
+    pthread_t           thread;
+    volatile int        running;
+    volatile int        mode;
+
+    /* used by the application thread only */
+    int                 held;
+    unsigned long       last_seq;
+};
+
+static AR2VideoAsyncT   *gAsync = NULL;
+
+static AR2VideoAsyncT  *async_start( AR2VideoParamT *vid, int buffer_num );
+static int             async_stop( AR2VideoAsyncT *async );
+static void            *async_thread( void *arg );
+static int             take_buffer( AR2VideoAsyncT *async );
+static ARUint8         *get_image( AR2VideoAsyncT *async, int mode, ARVideoFrameInfoT *info );
+
+int arVideoCapStartAsync( int buffer_num )
+{
+    if( gAsync != NULL ) {
+        printf("Asynchronous capture has been started!!\n");
+        return -1;
+    }
+    gAsync = async_start( NULL, buffer_num );
+    if( gAsync == NULL ) return -1;
+
+    return 0;
+}
+
+int arVideoCapStopAsync( void )
+{
+    int     ret;
+
+    if( gAsync == NULL ) return -1;
+    ret = async_stop( gAsync );
+    gAsync = NULL;
+
+    return ret;
+}
+
+ARUint8 *arVideoGetLatestImage( ARVideoFrameInfoT *info )
+{
+    if( gAsync == NULL ) return NULL;
+    return get_image( gAsync, MODE_LATEST, info );
+}
+
+ARUint8 *arVideoGetNextImage( ARVideoFrameInfoT *info )
+{
+    if( gAsync == NULL ) return NULL;
+    return get_image( gAsync, MODE_NEXT, info );
+}
+
+/*-------------------------------------------*/
+
+AR2VideoAsyncT *ar2VideoCapStartAsync( AR2VideoParamT *vid, int buffer_num )
+{
+    if( vid == NULL ) return NULL;
+    return async_start( vid, buffer_num );
+}
+
+int ar2VideoCapStopAsync( AR2VideoAsyncT *async )
+{
+    if( async == NULL ) return -1;
+    return async_stop( async );
+}
+
+ARUint8 *ar2VideoGetLatestImage( AR2VideoAsyncT *async, ARVideoFrameInfoT *info )
+{
+    if( async == NULL ) return NULL;
+    return get_image( async, MODE_LATEST, info );
+}
+
+ARUint8 *ar2VideoGetNextImage( AR2VideoAsyncT *async, ARVideoFrameInfoT *info )
+{
+    if( async == NULL ) return NULL;
+    return get_image( async, MODE_NEXT, info );
+}
+
+/*-------------------------------------------*/
+
+static AR2VideoAsyncT *async_start( AR2VideoParamT *vid, int buffer_num )
+{
+    AR2VideoAsyncT  *async;
+    int             ret;
+    int             i;
+
+    if( buffer_num == 0 ) buffer_num = AR_VIDEO_ASYNC_DEFAULT_BUFFER_NUM;
+    if( buffer_num < 3 ) {
+        printf("Asynchronous capture needs at least 3 buffers.\n");
+        return NULL;
+    }
+
+    arMalloc( async, AR2VideoAsyncT, 1 );
+    async->vid = vid;
+    if( vid == NULL ) ret = arVideoInqSize( &async->xsize, &async->ysize );
+    else              ret = ar2VideoInqSize( vid, &async->xsize, &async->ysize );
+    if( ret < 0 ) {
+        free( async );
+        return NULL;
+    }
+    async->size = (size_t)async->xsize * async->ysize * AR_PIX_SIZE_DEFAULT;
+
+    async->buffer_num = buffer_num;
+    arMalloc( async->buffer, ARUint8 *, buffer_num );
+    arMalloc( async->state, int, buffer_num );
+    arMalloc( async->seq, unsigned long, buffer_num );
+    arMalloc( async->time, double, buffer_num );
+    for( i = 0; i < buffer_num; i++ ) {
+        arMalloc( async->buffer[i], ARUint8, async->size );
+        async->state[i] = BUFFER_FREE;
+        async->seq[i]   = 0;
+        async->time[i]  = 0.0;
+    }
+    async->mode     = MODE_NEXT;        /* no drops before the first get */
+    async->held     = -1;
+    async->last_seq = 0;
+
+    if( vid == NULL ) ret = arVideoCapStart();
+    else              ret = ar2VideoCapStart( vid );
+    if( ret < 0 ) goto error;
+
+    async->running = 1;
+    if( pthread_create( &async->thread, NULL, async_thread, async ) != 0 ) {
+        printf("Cannot create the capture thread.\n");
+        if( vid == NULL ) arVideoCapStop();
+        else              ar2VideoCapStop( vid );
+        goto error;
+    }
+
+    return async;
+
+error:
+    for( i = 0; i < buffer_num; i++ ) free( async->buffer[i] );
+    free( async->buffer );
+    free( (void *)async->state );
+    free( (void *)async->seq );
+    free( (void *)async->time );
+    free( async );
+    return NULL;
+}
+
+static int async_stop( AR2VideoAsyncT *async )
+{
+    int     ret;
+    int     i;
+
+    async->running = 0;
+    pthread_join( async->thread, NULL );
+
+    if( async->vid == NULL ) ret = arVideoCapStop();
+    else                     ret = ar2VideoCapStop( async->vid );
+
+    for( i = 0; i < async->buffer_num; i++ ) free( async->buffer[i] );
+    free( async->buffer );
+    free( (void *)async->state );
+    free( (void *)async->seq );
+    free( (void *)async->time );
+    free( async );
+
+    return ret;
+}
+
+static void *async_thread( void *arg )
+{
+    AR2VideoAsyncT  *async = (AR2VideoAsyncT *)arg;
+    ARUint8         *image;
+    unsigned long   seq;
+    double          time;
+    int             i;
+
+    seq = 0;
+    while( async->running ) {
+        if( async->vid == NULL ) image = arVideoGetImage();
+        else                     image = ar2VideoGetImage( async->vid );
+        if( image == NULL ) {
+            usleep( WAIT_IMAGE_USEC );
+            continue;
+        }
+        time = arStatsGetTime() * 1.0e-9;
+        seq++;
+
+        while( (i = take_buffer( async )) < 0 ) {
+            if( !async->running ) return NULL;
+            usleep( WAIT_BUFFER_USEC );
+        }
+
+        memcpy( async->buffer[i], image, async->size );
+        async->seq[i]  = seq;
+        async->time[i] = time;
+        __sync_synchronize();
+        async->state[i] = BUFFER_READY;
+
+        if( async->vid == NULL ) arVideoCapNext();
+        else                     ar2VideoCapNext( async->vid );
+    }
+
+    return NULL;
+}
+
+/*
+ * A FREE buffer if there is one. Otherwise, unless the application wants
+ * every frame, the oldest READY buffer: its frame would be dropped anyway.
+ */
+static int take_buffer( AR2VideoAsyncT *async )
+{
+    unsigned long   min;
+    int             i, j;
+
+    for( i = 0; i < async->buffer_num; i++ ) {
+        if( ar_cas( &async->state[i], BUFFER_FREE, BUFFER_WRITING ) ) return i;
+    }
+    if( async->mode == MODE_NEXT ) return -1;
+
+    j = -1;
+    min = 0;
+    for( i = 0; i < async->buffer_num; i++ ) {
+        if( async->state[i] != BUFFER_READY ) continue;
+        if( j < 0 || async->seq[i] < min ) {
+            min = async->seq[i];
+            j = i;
+        }
+    }
+    if( j >= 0 && ar_cas( &async->state[j], BUFFER_READY, BUFFER_WRITING ) ) return j;
+
+    return -1;
+}
+
+static ARUint8 *get_image( AR2VideoAsyncT *async, int mode, ARVideoFrameInfoT *info )
+{
+    unsigned long   s, best;
+    int             i, j;
+
+    async->mode = mode;
+
+    for(;;) {
+        j = -1;
+        best = 0;
+        for( i = 0; i < async->buffer_num; i++ ) {
+            if( async->state[i] != BUFFER_READY ) continue;
+            __sync_synchronize();
+            s = async->seq[i];
+            if( j < 0 || (mode == MODE_NEXT && s < best) || (mode == MODE_LATEST && s > best) ) {
+                best = s;
+                j = i;
+            }
+        }
+        if( j < 0 ) return NULL;
+        /* the capture thread may have taken it back meanwhile */
+        if( ar_cas( &async->state[j], BUFFER_READY, BUFFER_READING ) ) break;
+    }
+
+    if( mode == MODE_LATEST ) {
+        best = async->seq[j];
+        for( i = 0; i < async->buffer_num; i++ ) {
+            if( i == j || async->state[i] != BUFFER_READY ) continue;
+            if( async->seq[i] < best ) ar_cas( &async->state[i], BUFFER_READY, BUFFER_FREE );
+        }
+    }
+
+    if( async->held >= 0 ) {
+        __sync_synchronize();
+        async->state[async->held] = BUFFER_FREE;
+    }
+    async->held = j;
+
+    if( info != NULL ) {
+        info->seq     = async->seq[j];
+        info->time    = async->time[j];
+        info->dropped = (int)(async->seq[j] - async->last_seq - 1);
+    }
+    async->last_seq = async->seq[j];
+
+    return async->buffer[j];
+}
@@ -0,0 +1,834 @@
+/*
+ *   Revision: 1.0   Date: 2026/10/18
+ *   Video input from recorded frames.
+ *
+ *   Plays back raw frame dumps, YUV4MPEG2 streams and PPM/PGM files
+ *   (single files or numbered sequences) through the usual libARvideo
+ *   API, so that applications can run headless on recorded footage.
+ *   Files are memory mapped; when the frames are already in
+ *   AR_DEFAULT_PIXEL_FORMAT the image pointer points into the mapping
+ *   and no copy is made.
+ */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <AR/config.h>
+#include <AR/ar.h>
+#include <AR/video.h>
+
+#define   DEFAULT_VIDEO_FPS     30.0
+#define   PNM_SEQ_MAX           10000000
+
+static AR2VideoParamT   *gVid = NULL;
+
+static int      pix_size( int format );
+static int      map_file( AR2VideoParamT *vid, char *filename );
+static void     unmap_file( AR2VideoParamT *vid );
+static int      open_raw( AR2VideoParamT *vid );
+static int      open_y4m( AR2VideoParamT *vid );
+static int      open_pnm( AR2VideoParamT *vid );
+static int      read_pnm_header( AR2VideoParamT *vid, char *filename );
+static int      check_seq_path( char *path );
+static ARUint8  *get_frame( AR2VideoParamT *vid, int n );
+static int      is_native( AR2VideoParamT *vid );
+static void     convert_frame( AR2VideoParamT *vid, ARUint8 *src, ARUint8 *dst );
+static void     packed_to_rgb( ARUint8 *src, int format, ARUint8 *rgb, int num );
+static void     y4m_to_rgb( AR2VideoParamT *vid, ARUint8 *frame, int y, ARUint8 *rgb );
+static void     rgb_to_native( ARUint8 *rgb, ARUint8 *dst, int num );
+
+int arVideoDispOption( void )
+{
+    return  ar2VideoDispOption();
+}
+
+int arVideoOpen( char *config )
+{
+    if( gVid != NULL ) {
+        printf("Device has been opened!!\n");
+        return -1;
+    }
+    gVid = ar2VideoOpen( config );
+    if( gVid == NULL ) return -1;
+
+    return 0;
+}
+
+int arVideoClose( void )
+{
+    int result;
+
+    if( gVid == NULL ) return -1;
+
+    result = ar2VideoClose(gVid);
+    gVid = NULL;
+    return (result);
+}
+
+int arVideoInqSize( int *x, int *y )
+{
+    if( gVid == NULL ) return -1;
+
+    return ar2VideoInqSize( gVid, x, y );
+}
+
+ARUint8 *arVideoGetImage( void )
+{
+    if( gVid == NULL ) return NULL;
+
+    return ar2VideoGetImage( gVid );
+}
+
+int arVideoCapStart( void )
+{
+    if( gVid == NULL ) return -1;
+
+    return ar2VideoCapStart( gVid );
+}
+
+int arVideoCapStop( void )
+{
+    if( gVid == NULL ) return -1;
+
+    return ar2VideoCapStop( gVid );
+}
+
+int arVideoCapNext( void )
+{
+    if( gVid == NULL ) return -1;
+
+    return ar2VideoCapNext( gVid );
+}
+
+/*-------------------------------------------*/
+
+int ar2VideoDispOption( void )
+{
+    printf("ARVideo may be configured using one or more of the following options,\n");
+    printf("separated by a space:\n\n");
+    printf("FILE CONTROLS:\n");
+    printf(" -file=filepath\n");
+    printf("    specifies the recording. Its type is taken from the extension:\n");
+    printf("    .y4m (YUV4MPEG2), .ppm/.pgm/.pnm, anything else is raw frames.\n");
+    printf("    A PPM/PGM path containing a printf number (frames/f%%05d.ppm)\n");
+    printf("    is read as a sequence starting from 0 or 1.\n");
+    printf(" -width=N\n");
+    printf("    specifies the width of raw frames.\n");
+    printf(" -height=N\n");
+    printf("    specifies the height of raw frames.\n");
+    printf(" -format=[RGB|BGR|RGBA|BGRA|ABGR|ARGB|MONO|2vuy|yuvs]\n");
+    printf("    specifies the pixel format of raw frames (default: library format).\n");
+    printf("    Frames in the library format are returned without a copy.\n");
+    printf("PLAYBACK CONTROLS:\n");
+    printf(" -loop\n");
+    printf("    restart from the first frame at the end of the file.\n");
+    printf(" -realtime\n");
+    printf("    pace the frames at the frame rate, skipping frames when the\n");
+    printf("    application is slower (default: every frame, as fast as possible).\n");
+    printf(" -fps=N\n");
+    printf("    specifies the frame rate (default: from the Y4M header, or 30).\n");
+    printf(" -debug\n");
+    printf("    print information on the file.\n");
+    printf("\n");
+
+    return 0;
+}
+
+AR2VideoParamT *ar2VideoOpen( char *config_in )
+{
+    AR2VideoParamT   *vid;
+    char             *config, *a, *ext, line[256];
+    int              ret;
+
+    /* If no config string is supplied, we should use the environment variable, otherwise set a sane default */
+    if (!config_in || !(config_in[0])) {
+        /* None suppplied, lets see if the user supplied one from the shell */
+        char *envconf = getenv ("ARTOOLKIT_CONFIG");
+        if (envconf && envconf[0]) {
+            config = envconf;
+            printf ("Using config string from environment [%s].\n", envconf);
+        } else {
+            config = NULL;
+            printf ("No video config string supplied, using defaults.\n");
+        }
+    } else {
+        config = config_in;
+        printf ("Using supplied video config string [%s].\n", config_in);
+    }
+
+    arMalloc( vid, AR2VideoParamT, 1 );
+    memset( vid, 0, sizeof(AR2VideoParamT) );
+    vid->format      = AR_DEFAULT_PIXEL_FORMAT;
+    vid->fps         = 0.0;
+    vid->fd          = -1;
+    vid->map_index   = -1;
+
+    a = config;
+    if( a != NULL) {
+        for(;;) {
+            while( *a == ' ' || *a == '\t' ) a++;
+            if( *a == '\0' ) break;
+            if( strncmp( a, "-file=", 6 ) == 0 ) {
+                sscanf( a, "%s", line );
+                if( sscanf( &line[6], "%255s", vid->file ) != 1 ) {
+                    ar2VideoDispOption();
+                    free( vid );
+                    return 0;
+                }
+            }
+            else if( strncmp( a, "-width=", 7 ) == 0 ) {
+                sscanf( a, "%s", line );
+                if( sscanf( &line[7], "%d", &vid->width ) == 0 ) {
+                    ar2VideoDispOption();
+                    free( vid );
+                    return 0;
+                }
+            }
+            else if( strncmp( a, "-height=", 8 ) == 0 ) {
+                sscanf( a, "%s", line );
+                if( sscanf( &line[8], "%d", &vid->height ) == 0 ) {
+                    ar2VideoDispOption();
+                    free( vid );
+                    return 0;
+                }
+            }
+            else if( strncmp( a, "-fps=", 5 ) == 0 ) {
+                sscanf( a, "%s", line );
+                if( sscanf( &line[5], "%lf", &vid->fps ) == 0 || vid->fps <= 0.0 ) {
+                    ar2VideoDispOption();
+                    free( vid );
+                    return 0;
+                }
+            }
+            else if( strncmp( a, "-format=", 8 ) == 0 ) {
+                if( strncmp( &a[8], "RGBA", 4 ) == 0 )      vid->format = AR_PIXEL_FORMAT_RGBA;
+                else if( strncmp( &a[8], "BGRA", 4 ) == 0 ) vid->format = AR_PIXEL_FORMAT_BGRA;
+                else if( strncmp( &a[8], "ABGR", 4 ) == 0 ) vid->format = AR_PIXEL_FORMAT_ABGR;
+                else if( strncmp( &a[8], "ARGB", 4 ) == 0 ) vid->format = AR_PIXEL_FORMAT_ARGB;
+                else if( strncmp( &a[8], "RGB", 3 ) == 0 )  vid->format = AR_PIXEL_FORMAT_RGB;
+                else if( strncmp( &a[8], "BGR", 3 ) == 0 )  vid->format = AR_PIXEL_FORMAT_BGR;
+                else if( strncmp( &a[8], "MONO", 4 ) == 0 ) vid->format = AR_PIXEL_FORMAT_MONO;
+                else if( strncmp( &a[8], "2vuy", 4 ) == 0 ) vid->format = AR_PIXEL_FORMAT_2vuy;
+                else if( strncmp( &a[8], "yuvs", 4 ) == 0 ) vid->format = AR_PIXEL_FORMAT_yuvs;
+                else {
+                    ar2VideoDispOption();
+                    free( vid );
+                    return 0;
+                }
+            }
+            else if( strncmp( a, "-loop", 5 ) == 0 ) {
+                vid->loop = 1;
+            }
+            else if( strncmp( a, "-realtime", 9 ) == 0 ) {
+                vid->realtime = 1;
+            }
+            else if( strncmp( a, "-debug", 6 ) == 0 ) {
+                vid->debug = 1;
+            }
+            else {
+                ar2VideoDispOption();
+                free( vid );
+                return 0;
+            }
+
+            while( *a != ' ' && *a != '\t' && *a != '\0') a++;
+        }
+    }
+
+    if( vid->file[0] == '\0' ) {
+        printf("arVideoOpen: no file given (-file=filepath).\n");
+        free( vid );
+        return 0;
+    }
+
+    ext = strrchr( vid->file, '.' );
+    if( ext != NULL && strcmp( ext, ".y4m" ) == 0 ) {
+        vid->type = AR_VIDEO_FILE_Y4M;
+        ret = open_y4m( vid );
+    }
+    else if( ext != NULL && (strcmp( ext, ".ppm" ) == 0 || strcmp( ext, ".pgm" ) == 0
+                          || strcmp( ext, ".pnm" ) == 0) ) {
+        vid->type = AR_VIDEO_FILE_PNM;
+        ret = open_pnm( vid );
+    }
+    else {
+        vid->type = AR_VIDEO_FILE_RAW;
+        ret = open_raw( vid );
+    }
+    if( ret < 0 ) {
+        unmap_file( vid );
+        if( vid->frame_offset != NULL ) free( vid->frame_offset );
+        free( vid );
+        return 0;
+    }
+    if( vid->fps <= 0.0 ) vid->fps = DEFAULT_VIDEO_FPS;
+
+    if( !is_native( vid ) ) {
+        arMalloc( vid->videoBuffer, ARUint8, vid->width*vid->height*AR_PIX_SIZE_DEFAULT );
+        arMalloc( vid->rowBuffer, ARUint8, (vid->width+1)*3 );
+    }
+
+    if( vid->debug ) {
+        printf("=== debug info ===\n");
+        printf("  file       =   %s\n", vid->file);
+        printf("  type       =   %s\n", (vid->type == AR_VIDEO_FILE_Y4M)? "Y4M":
+                                        (vid->type == AR_VIDEO_FILE_PNM)? "PPM/PGM": "raw");
+        printf("  size       =   %dx%d\n", vid->width, vid->height);
+        printf("  frames     =   %d\n", vid->frame_num);
+        printf("  fps        =   %f\n", vid->fps);
+        printf("  zero copy  =   %s\n", (vid->videoBuffer == NULL)? "yes": "no");
+    }
+
+    return vid;
+}
+
+int ar2VideoClose( AR2VideoParamT *vid )
+{
+    unmap_file( vid );
+    if( vid->frame_offset != NULL ) free( vid->frame_offset );
+    if( vid->videoBuffer != NULL ) free( vid->videoBuffer );
+    if( vid->rowBuffer != NULL ) free( vid->rowBuffer );
+    free( vid );
+
+    return 0;
+}
+
+int ar2VideoCapStart( AR2VideoParamT *vid )
+{
+    if( vid->status ) {
+        printf("arVideoCapStart has already been called.\n");
+        return -1;
+    }
+
+    vid->status = 1;
+    vid->frame_index = 0;
+    gettimeofday( &vid->start, NULL );
+
+    return 0;
+}
+
+int ar2VideoCapNext( AR2VideoParamT *vid )
+{
+    if( !vid->status ) {
+        printf("arVideoCapStart has never been called.\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int ar2VideoCapStop( AR2VideoParamT *vid )
+{
+    if( !vid->status ) {
+        printf("arVideoCapStart has never been called.\n");
+        return -1;
+    }
+    vid->status = 0;
+
+    return 0;
+}
+
+/*
+ * The image stays valid until the next call. In real-time mode NULL is
+ * returned until the next frame is due, as with a live camera.
+ */
+ARUint8 *ar2VideoGetImage( AR2VideoParamT *vid )
+{
+    struct timeval   now;
+    ARUint8          *frame;
+    int              n;
+
+    if( !vid->status ) {
+        printf("arVideoCapStart has never been called.\n");
+        return NULL;
+    }
+
+    if( vid->realtime ) {
+        gettimeofday( &now, NULL );
+        n = (int)(((now.tv_sec - vid->start.tv_sec) + (now.tv_usec - vid->start.tv_usec) * 0.000001)
+                  * vid->fps);
+        if( n < vid->frame_index ) return NULL;
+    }
+    else {
+        n = vid->frame_index;
+    }
+    if( n >= vid->frame_num ) {
+        if( !vid->loop ) {
+            if( vid->frame_index <= vid->frame_num ) {
+                if( vid->debug ) printf("arVideoGetImage: end of %s\n", vid->file);
+                vid->frame_index = vid->frame_num + 1;
+            }
+            return NULL;
+        }
+    }
+    vid->frame_index = n + 1;
+
+    if( (frame = get_frame( vid, n % vid->frame_num )) == NULL ) return NULL;
+    if( vid->videoBuffer == NULL ) return frame;
+
+    convert_frame( vid, frame, vid->videoBuffer );
+    return vid->videoBuffer;
+}
+
+int ar2VideoInqSize( AR2VideoParamT *vid, int *x, int *y )
+{
+    *x = vid->width;
+    *y = vid->height;
+
+    return 0;
+}
+
+/*-------------------------------------------*/
+
+static int pix_size( int format )
+{
+    switch( format ) {
+      case AR_PIXEL_FORMAT_RGB:
+      case AR_PIXEL_FORMAT_BGR:  return 3;
+      case AR_PIXEL_FORMAT_RGBA:
+      case AR_PIXEL_FORMAT_BGRA:
+      case AR_PIXEL_FORMAT_ABGR:
+      case AR_PIXEL_FORMAT_ARGB: return 4;
+      case AR_PIXEL_FORMAT_MONO: return 1;
+      case AR_PIXEL_FORMAT_2vuy:
+      case AR_PIXEL_FORMAT_yuvs: return 2;
+    }
+    return 0;
+}
+
+static int map_file( AR2VideoParamT *vid, char *filename )
+{
+    struct stat   st;
+
+    unmap_file( vid );
+    if( (vid->fd = open(filename, O_RDONLY)) < 0 ) {
+        printf("video file (%s) open failed\n", filename);
+        return -1;
+    }
+    if( fstat(vid->fd, &st) < 0 || st.st_size == 0 ) {
+        printf("video file (%s) is empty\n", filename);
+        close( vid->fd );
+        vid->fd = -1;
+        return -1;
+    }
+    vid->map_size = (size_t)st.st_size;
+    vid->map = (ARUint8 *)mmap(0, vid->map_size, PROT_READ, MAP_PRIVATE, vid->fd, 0);
+    if( vid->map == (ARUint8 *)MAP_FAILED ) {
+        printf("error: mmap\n");
+        vid->map = NULL;
+        close( vid->fd );
+        vid->fd = -1;
+        return -1;
+    }
+    madvise( vid->map, vid->map_size, MADV_SEQUENTIAL );
+
+    return 0;
+}
+
+static void unmap_file( AR2VideoParamT *vid )
+{
+    if( vid->map != NULL ) munmap( vid->map, vid->map_size );
+    if( vid->fd >= 0 ) close( vid->fd );
+    vid->map = NULL;
+    vid->fd = -1;
+    vid->map_index = -1;
+}
+
+static int open_raw( AR2VideoParamT *vid )
+{
+    int     i;
+
+    if( vid->width <= 0 || vid->height <= 0 ) {
+        printf("arVideoOpen: raw frames need -width and -height.\n");
+        return -1;
+    }
+    if( map_file( vid, vid->file ) < 0 ) return -1;
+
+    vid->frame_size = (size_t)vid->width * vid->height * pix_size(vid->format);
+    vid->frame_num  = (int)(vid->map_size / vid->frame_size);
+    if( vid->frame_num == 0 ) {
+        printf("arVideoOpen: %s holds no complete %dx%d frame.\n", vid->file, vid->width, vid->height);
+        return -1;
+    }
+    arMalloc( vid->frame_offset, size_t, vid->frame_num );
+    for( i = 0; i < vid->frame_num; i++ ) vid->frame_offset[i] = vid->frame_size * i;
+
+    return 0;
+}
+
+/*
+ * YUV4MPEG2: "YUV4MPEG2 W640 H480 F30:1 C420jpeg ..." then frames, each
+ * behind a "FRAME ...\n" line. Frame offsets are found once at open.
+ */
+static int open_y4m( AR2VideoParamT *vid )
+{
+    ARUint8   *p, *end;
+    char      token[64];
+    int       fn, fd, cw, ch, num, i;
+
+    if( map_file( vid, vid->file ) < 0 ) return -1;
+    p   = vid->map;
+    end = vid->map + vid->map_size;
+    if( vid->map_size < 10 || memcmp( p, "YUV4MPEG2 ", 10 ) != 0 ) {
+        printf("arVideoOpen: %s is not a YUV4MPEG2 file.\n", vid->file);
+        return -1;
+    }
+
+    vid->width = vid->height = 0;
+    vid->y4m_chroma = AR_VIDEO_FILE_Y4M_420;
+    p += 9;
+    while( p < end && *p != '\n' ) {
+        while( p < end && *p == ' ' ) p++;
+        for( i = 0; p < end && *p != ' ' && *p != '\n'; p++ ) {
+            if( i < (int)sizeof(token)-1 ) token[i++] = *p;
+        }
+        token[i] = '\0';
+        if( token[0] == 'W' ) vid->width = atoi( &token[1] );
+        else if( token[0] == 'H' ) vid->height = atoi( &token[1] );
+        else if( token[0] == 'F' ) {
+            if( vid->fps <= 0.0 && sscanf( &token[1], "%d:%d", &fn, &fd ) == 2 && fn > 0 && fd > 0 ) {
+                vid->fps = (double)fn / fd;
+            }
+        }
+        else if( token[0] == 'C' ) {
+            if( strncmp( &token[1], "420", 3 ) == 0 )       vid->y4m_chroma = AR_VIDEO_FILE_Y4M_420;
+            else if( strcmp( &token[1], "422" ) == 0 )      vid->y4m_chroma = AR_VIDEO_FILE_Y4M_422;
+            else if( strcmp( &token[1], "444" ) == 0 )      vid->y4m_chroma = AR_VIDEO_FILE_Y4M_444;
+            else if( strcmp( &token[1], "mono" ) == 0 )     vid->y4m_chroma = AR_VIDEO_FILE_Y4M_MONO;
+            else {
+                printf("arVideoOpen: unsupported Y4M colour space %s.\n", token);
+                return -1;
+            }
+        }
+    }
+    if( p >= end || vid->width <= 0 || vid->height <= 0 ) {
+        printf("arVideoOpen: bad Y4M header in %s.\n", vid->file);
+        return -1;
+    }
+    p++;
+
+    cw = (vid->y4m_chroma == AR_VIDEO_FILE_Y4M_444)? vid->width: (vid->width + 1) / 2;
+    ch = (vid->y4m_chroma == AR_VIDEO_FILE_Y4M_420)? (vid->height + 1) / 2: vid->height;
+    vid->frame_size = (size_t)vid->width * vid->height;
+    if( vid->y4m_chroma != AR_VIDEO_FILE_Y4M_MONO ) vid->frame_size += (size_t)cw * ch * 2;
+
+    num = 0;
+    vid->frame_num = 0;
+    while( end - p > 5 && memcmp( p, "FRAME", 5 ) == 0 ) {
+        while( p < end && *p != '\n' ) p++;
+        if( p == end || (size_t)(end - p - 1) < vid->frame_size ) break;
+        p++;
+        if( vid->frame_num == num ) {
+            num += 1024;
+            vid->frame_offset = (size_t *)realloc( vid->frame_offset, num * sizeof(size_t) );
+            if( vid->frame_offset == NULL ) {
+                printf("malloc error!!\n");
+                exit(1);
+            }
+        }
+        vid->frame_offset[vid->frame_num++] = (size_t)(p - vid->map);
+        p += vid->frame_size;
+    }
+    if( vid->frame_num == 0 ) {
+        printf("arVideoOpen: %s holds no complete frame.\n", vid->file);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * A single PPM/PGM is one frame. With a printf number in the path the
+ * files are mapped one at a time, in order, from the first one found.
+ * The path is used as a format, so it must hold exactly one %d
+ * (flags 0 and -, width up to 2 digits) and no other conversion but %%.
+ */
+static int open_pnm( AR2VideoParamT *vid )
+{
+    char     name[512];
+    int      i;
+
+    if( strchr( vid->file, '%' ) == NULL ) {
+        if( read_pnm_header( vid, vid->file ) < 0 ) return -1;
+        vid->frame_num = 1;
+        vid->map_index = 0;
+        return 0;
+    }
+    if( check_seq_path( vid->file ) < 0 ) {
+        printf("arVideoOpen: %s needs exactly one %%d and no other conversion.\n", vid->file);
+        return -1;
+    }
+
+    for( vid->seq_start = 0; vid->seq_start < 2; vid->seq_start++ ) {
+        snprintf( name, sizeof(name), vid->file, vid->seq_start );
+        if( access( name, R_OK ) == 0 ) break;
+    }
+    if( vid->seq_start == 2 ) {
+        printf("arVideoOpen: no file matches %s.\n", vid->file);
+        return -1;
+    }
+    for( i = 0; i < PNM_SEQ_MAX; i++ ) {
+        snprintf( name, sizeof(name), vid->file, vid->seq_start + i );
+        if( access( name, R_OK ) != 0 ) break;
+    }
+    vid->frame_num = i;
+
+    snprintf( name, sizeof(name), vid->file, vid->seq_start );
+    if( read_pnm_header( vid, name ) < 0 ) return -1;
+    vid->map_index = 0;
+
+    return 0;
+}
+
+static int check_seq_path( char *path )
+{
+    char    *p;
+    int     num, width;
+
+    num = 0;
+    for( p = path; *p != '\0'; p++ ) {
+        if( *p != '%' ) continue;
+        p++;
+        if( *p == '%' ) continue;
+        while( *p == '0' || *p == '-' ) p++;
+        for( width = 0; *p >= '0' && *p <= '9'; p++ ) width++;
+        if( width > 2 || *p != 'd' ) return -1;
+        num++;
+    }
+
+    return (num == 1)? 0: -1;
+}
+
+static int read_pnm_int( ARUint8 **p, ARUint8 *end )
+{
+    int     v;
+
+    for(;;) {
+        if( *p >= end ) return -1;
+        if( **p == '#' ) {
+            while( *p < end && **p != '\n' ) (*p)++;
+        }
+        else if( **p == ' ' || **p == '\t' || **p == '\n' || **p == '\r' ) (*p)++;
+        else break;
+    }
+    if( **p < '0' || **p > '9' ) return -1;
+    for( v = 0; *p < end && **p >= '0' && **p <= '9'; (*p)++ ) v = v*10 + (**p - '0');
+
+    return v;
+}
+
+/* maps the file and checks it against the first frame, which sets the size and format */
+static int read_pnm_header( AR2VideoParamT *vid, char *filename )
+{
+    ARUint8   *p, *end;
+    int       w, h, maxval, format;
+
+    if( map_file( vid, filename ) < 0 ) return -1;
+    p   = vid->map;
+    end = vid->map + vid->map_size;
+    if( vid->map_size < 2 || p[0] != 'P' || (p[1] != '5' && p[1] != '6') ) {
+        printf("arVideoOpen: %s is not a binary PPM/PGM file.\n", filename);
+        return -1;
+    }
+    format = (p[1] == '6')? AR_PIXEL_FORMAT_RGB: AR_PIXEL_FORMAT_MONO;
+    p += 2;
+    w      = read_pnm_int( &p, end );
+    h      = read_pnm_int( &p, end );
+    maxval = read_pnm_int( &p, end );
+    if( w <= 0 || h <= 0 || maxval != 255 || p >= end ) {
+        printf("arVideoOpen: unsupported PPM/PGM header in %s.\n", filename);
+        return -1;
+    }
+    p++;
+
+    if( vid->frame_size == 0 ) {
+        vid->width  = w;
+        vid->height = h;
+        vid->format = format;
+        vid->frame_size = (size_t)w * h * pix_size(format);
+    }
+    else if( w != vid->width || h != vid->height || format != vid->format ) {
+        printf("arVideoOpen: %s differs from the first frame.\n", filename);
+        return -1;
+    }
+    if( (size_t)(end - p) < vid->frame_size ) {
+        printf("arVideoOpen: %s is truncated.\n", filename);
+        return -1;
+    }
+    vid->map_offset = (size_t)(p - vid->map);
+
+    return 0;
+}
+
+static ARUint8 *get_frame( AR2VideoParamT *vid, int n )
+{
+    char     name[512];
+
+    if( vid->type != AR_VIDEO_FILE_PNM ) return vid->map + vid->frame_offset[n];
+
+    if( vid->map_index != n ) {
+        snprintf( name, sizeof(name), vid->file, vid->seq_start + n );
+        if( read_pnm_header( vid, name ) < 0 ) return NULL;
+        vid->map_index = n;
+    }
+    return vid->map + vid->map_offset;
+}
+
+static int is_native( AR2VideoParamT *vid )
+{
+    if( vid->type == AR_VIDEO_FILE_Y4M ) {
+        return (vid->y4m_chroma == AR_VIDEO_FILE_Y4M_MONO
+             && AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO);
+    }
+    return (vid->format == AR_DEFAULT_PIXEL_FORMAT);
+}
+
+static void convert_frame( AR2VideoParamT *vid, ARUint8 *src, ARUint8 *dst )
+{
+    ARUint8   *rgb;
+    int       y;
+
+    rgb = vid->rowBuffer;
+    for( y = 0; y < vid->height; y++ ) {
+        if( vid->type == AR_VIDEO_FILE_Y4M ) {
+            y4m_to_rgb( vid, src, y, rgb );
+        }
+        else {
+            packed_to_rgb( src + (size_t)y * vid->width * pix_size(vid->format), vid->format,
+                           rgb, vid->width );
+        }
+        rgb_to_native( rgb, dst + (size_t)y * vid->width * AR_PIX_SIZE_DEFAULT, vid->width );
+    }
+}
+
+#define   CLIP8(v)     (((v) < 0)? 0: ((v) > 255)? 255: (v))
+
+/* BT.601, video range */
+static void yuv_to_rgb( int y, int u, int v, ARUint8 *rgb )
+{
+    int     c, r, g, b;
+
+    c = 298 * (y - 16);
+    u -= 128;
+    v -= 128;
+    r = (c           + 409*v + 128) >> 8;
+    g = (c - 100*u  - 208*v + 128) >> 8;
+    b = (c + 516*u           + 128) >> 8;
+    rgb[0] = CLIP8(r);
+    rgb[1] = CLIP8(g);
+    rgb[2] = CLIP8(b);
+}
+
+static void packed_to_rgb( ARUint8 *src, int format, ARUint8 *rgb, int num )
+{
+    int     i;
+
+    switch( format ) {
+      case AR_PIXEL_FORMAT_RGB:
+        memcpy( rgb, src, num*3 );
+        break;
+      case AR_PIXEL_FORMAT_BGR:
+        for( i = 0; i < num; i++, src += 3, rgb += 3 ) { rgb[0] = src[2]; rgb[1] = src[1]; rgb[2] = src[0]; }
+        break;
+      case AR_PIXEL_FORMAT_RGBA:
+        for( i = 0; i < num; i++, src += 4, rgb += 3 ) { rgb[0] = src[0]; rgb[1] = src[1]; rgb[2] = src[2]; }
+        break;
+      case AR_PIXEL_FORMAT_BGRA:
+        for( i = 0; i < num; i++, src += 4, rgb += 3 ) { rgb[0] = src[2]; rgb[1] = src[1]; rgb[2] = src[0]; }
+        break;
+      case AR_PIXEL_FORMAT_ABGR:
+        for( i = 0; i < num; i++, src += 4, rgb += 3 ) { rgb[0] = src[3]; rgb[1] = src[2]; rgb[2] = src[1]; }
+        break;
+      case AR_PIXEL_FORMAT_ARGB:
+        for( i = 0; i < num; i++, src += 4, rgb += 3 ) { rgb[0] = src[1]; rgb[1] = src[2]; rgb[2] = src[3]; }
+        break;
+      case AR_PIXEL_FORMAT_MONO:
+        for( i = 0; i < num; i++, src++, rgb += 3 ) rgb[0] = rgb[1] = rgb[2] = src[0];
+        break;
+      case AR_PIXEL_FORMAT_2vuy:
+        for( i = 0; i < num; i += 2, src += 4, rgb += 6 ) {
+            yuv_to_rgb( src[1], src[0], src[2], rgb );
+            yuv_to_rgb( src[3], src[0], src[2], rgb+3 );
+        }
+        break;
+      case AR_PIXEL_FORMAT_yuvs:
+        for( i = 0; i < num; i += 2, src += 4, rgb += 6 ) {
+            yuv_to_rgb( src[0], src[1], src[3], rgb );
+            yuv_to_rgb( src[2], src[1], src[3], rgb+3 );
+        }
+        break;
+    }
+}
+
+static void y4m_to_rgb( AR2VideoParamT *vid, ARUint8 *frame, int y, ARUint8 *rgb )
+{
+    ARUint8   *py, *pu, *pv;
+    int       w = vid->width, h = vid->height;
+    int       cw, ch, cy, i;
+
+    py = frame + (size_t)y * w;
+    if( vid->y4m_chroma == AR_VIDEO_FILE_Y4M_MONO ) {
+        for( i = 0; i < w; i++, rgb += 3 ) rgb[0] = rgb[1] = rgb[2] = py[i];
+        return;
+    }
+    cw = (vid->y4m_chroma == AR_VIDEO_FILE_Y4M_444)? w: (w + 1) / 2;
+    ch = (vid->y4m_chroma == AR_VIDEO_FILE_Y4M_420)? (h + 1) / 2: h;
+    cy = (vid->y4m_chroma == AR_VIDEO_FILE_Y4M_420)? y / 2: y;
+    pu = frame + (size_t)w * h + (size_t)cy * cw;
+    pv = pu + (size_t)cw * ch;
+    if( vid->y4m_chroma == AR_VIDEO_FILE_Y4M_444 ) {
+        for( i = 0; i < w; i++, rgb += 3 ) yuv_to_rgb( py[i], pu[i], pv[i], rgb );
+    }
+    else {
+        for( i = 0; i < w; i++, rgb += 3 ) yuv_to_rgb( py[i], pu[i/2], pv[i/2], rgb );
+    }
+}
+
+/* convert packed RGB to AR_DEFAULT_PIXEL_FORMAT */
+static void rgb_to_native( ARUint8 *rgb, ARUint8 *dst, int num )
+{
+    int     i;
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy) || (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
+    int     y0, y1, u, v, r, g, b;
+
+    for( i = 0; i+1 < num; i += 2, rgb += 6, dst += 4 ) {
+        y0 = ( 66*rgb[0] + 129*rgb[1] +  25*rgb[2] + 128) / 256 + 16;
+        y1 = ( 66*rgb[3] + 129*rgb[4] +  25*rgb[5] + 128) / 256 + 16;
+        r  = (rgb[0] + rgb[3]) / 2;
+        g  = (rgb[1] + rgb[4]) / 2;
+        b  = (rgb[2] + rgb[5]) / 2;
+        u  = (-38*r -  74*g + 112*b + 128) / 256 + 128;
+        v  = (112*r -  94*g -  18*b + 128) / 256 + 128;
+#  if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
+        dst[0] = u; dst[1] = y0; dst[2] = v; dst[3] = y1;
+#  else
+        dst[0] = y0; dst[1] = u; dst[2] = y1; dst[3] = v;
+#  endif
+    }
+#else
+    for( i = 0; i < num; i++, rgb += 3, dst += AR_PIX_SIZE_DEFAULT ) {
+#  if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGB)
+        dst[0] = rgb[0]; dst[1] = rgb[1]; dst[2] = rgb[2];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGR)
+        dst[0] = rgb[2]; dst[1] = rgb[1]; dst[2] = rgb[0];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
+        dst[0] = rgb[0]; dst[1] = rgb[1]; dst[2] = rgb[2]; dst[3] = 255;
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA)
+        dst[0] = rgb[2]; dst[1] = rgb[1]; dst[2] = rgb[0]; dst[3] = 255;
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
+        dst[0] = 255; dst[1] = rgb[2]; dst[2] = rgb[1]; dst[3] = rgb[0];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
+        dst[0] = 255; dst[1] = rgb[0]; dst[2] = rgb[1]; dst[3] = rgb[2];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO)
+        dst[0] = (rgb[0] + rgb[1] + rgb[2]) / 3;
+#  else
+#    error Unknown default pixel format defined in config.h
+#  endif
+    }
+#endif
+}
@@ -11,6 +11,7 @@
 #include <AR/config.h>
 #include <AR/ar.h>
 #include <AR/video.h>
+#include <AR/arStats.h>
 
 /* include GLib for GStreamer */
 #include <glib.h>
@@ -18,8 +19,9 @@
 /* include GStreamer itself */
 #include <gst/gst.h>
 
-/* using memcpy */
+/* using strstr, getenv and free */
 #include <string.h>
+#include <stdlib.h>
 
 
 struct _AR2VideoParamT {
@@ -33,20 +35,40 @@ struct _AR2VideoParamT {
 	/* size of the image */
 	int	width, height;
 
-	/* the actual video buffer */
-    ARUint8             *videoBuffer;
+	/* 
+	 * Frames are handed over by reference, not copied. The streaming
+	 * thread leaves the newest buffer in 'pending'; ar2VideoGetImage()
+	 * moves it to 'current', which stays pinned until ar2VideoCapNext().
+	 * Only two buffers are held so that sources with a small buffer pool
+	 * (v4l2src) never run dry.
+	 */
+	GMutex		*lock;
+	GstBuffer	*pending;
+	GstBuffer	*current;
+	ARStatsTime	pending_time;
+	unsigned long	pending_seq;
+	
+	/* frame counters */
+	unsigned long	seq;
+	unsigned long	current_seq;
+	unsigned long	last_seq;
+	double		current_time;
+	int		current_dropped;
+	int		size_warned;
     
 };
 
 
 static AR2VideoParamT *gVid = 0;
 
+static void release_buffers(AR2VideoParamT *vid);
+
 static gboolean
 cb_have_data (GstPad    *pad,
 	      GstBuffer *buffer,
 	      gpointer   u_data)
 {
- 	const GstCaps *caps;
+ 	GstCaps *caps;
 	GstStructure *str;
 	
 	gint width,height;
@@ -54,9 +76,11 @@ cb_have_data (GstPad    *pad,
 	
 	AR2VideoParamT *vid = (AR2VideoParamT*)u_data;
 	
+	GstBuffer *old;
+	
 
 	/* only do initialy for the buffer */
-	if (vid->videoBuffer == 0) 
+	if (vid->width == 0) 
 	{ 
 	
 		/* 
@@ -64,29 +88,46 @@ cb_have_data (GstPad    *pad,
 		 * to extract information about the frame 
 		 */
 		caps=gst_pad_get_negotiated_caps(pad);
+		if (caps == 0) return TRUE;
 		str=gst_caps_get_structure(caps,0);
 
 		/* Get some data about the frame */
 		gst_structure_get_int(str,"width",&width);
 		gst_structure_get_int(str,"height",&height);
 		gst_structure_get_double(str,"framerate",&rate);
+		gst_caps_unref(caps);
 		
 		g_print("libARvideo: GStreamer negotiated %dx%d\n",width,height);
 	
 		vid->width = width;
 		vid->height = height;
-		
-		/* allocate the buffer */
-		vid->videoBuffer = malloc(buffer->size);
-		
-		return TRUE;
-		
 	}
-	else 
+	
+	/* 
+	 * the application reads the frame in place, so it has to be packed:
+	 * a smaller buffer is dropped, never handed out 
+	 */
+	if (GST_BUFFER_SIZE(buffer) < vid->width * vid->height * AR_PIX_SIZE_DEFAULT) 
 	{
-		/* copy the video buffer */
-		memcpy(vid->videoBuffer, buffer->data, buffer->size);
-	}	
+		if (!vid->size_warned) {
+			g_print("libARvideo: GStreamer buffer of %d bytes is too small for %dx%d, check the caps!\n",
+				GST_BUFFER_SIZE(buffer), vid->width, vid->height);
+			vid->size_warned = 1;
+		}
+		return TRUE;
+	}
+	
+	/* keep a reference to the newest frame, replacing an unread one */
+	gst_buffer_ref(buffer);
+
+	g_mutex_lock(vid->lock);
+	old = vid->pending;
+	vid->pending = buffer;
+	vid->pending_seq = ++vid->seq;
+	vid->pending_time = arStatsGetTime();
+	g_mutex_unlock(vid->lock);
+
+	if (old) gst_buffer_unref(old);
 	
 	return TRUE;
 }
@@ -129,12 +170,18 @@ arVideoOpen( char *config ) {
     }
     gVid = ar2VideoOpen( config );
     if( gVid == NULL ) return -1;
+
+    return 0;
 }
 
 int 
 arVideoClose( void )
 {
-	return ar2VideoClose(gVid);
+	int ret;
+
+	ret = ar2VideoClose(gVid);
+	gVid = NULL;
+	return ret;
 }
 
 int
@@ -177,6 +224,12 @@ int arVideoCapNext( void )
 	return 0;
 }
 
+int
+arVideoInqFrameInfo( ARVideoFrameInfoT *info )
+{
+	return ar2VideoInqFrameInfo(gVid, info);
+}
+
 /*---------------------------------------------------------------------------*/
 
 AR2VideoParamT* 
@@ -212,8 +265,15 @@ ar2VideoOpen(char *config_in ) {
 	/* init ART structure */
     arMalloc( vid, AR2VideoParamT, 1 );
 
-	/* initialise buffer */
-	vid->videoBuffer = 0;
+	/* initialise the frame handoff */
+	vid->width = vid->height = 0;
+	vid->lock = g_mutex_new();
+	vid->pending = vid->current = 0;
+	vid->pending_seq = vid->seq = 0;
+	vid->current_seq = vid->last_seq = 0;
+	vid->current_time = 0.0;
+	vid->current_dropped = 0;
+	vid->size_warned = 0;
 	
 	/* report the current version and features */
 	g_print ("libARvideo: %s\n", gst_version_string());
@@ -330,14 +390,42 @@ ar2VideoClose(AR2VideoParamT *vid) {
 	/* free the pipeline handle */
 	gst_object_unref (GST_OBJECT (vid->pipeline));
 
+	/* the streaming thread is gone, drop what it left */
+	release_buffers(vid);
+	g_mutex_free(vid->lock);
+	free(vid);
+
 	return 0;
 }
 
 
 ARUint8* 
 ar2VideoGetImage(AR2VideoParamT *vid) {
-	/* just return the bare video buffer */
-	return vid->videoBuffer;
+
+	GstBuffer *old = 0;
+	
+	g_mutex_lock(vid->lock);
+	
+	/* a newer frame replaces the current one */
+	if (vid->pending) 
+	{
+		old = vid->current;
+		vid->current = vid->pending;
+		vid->pending = 0;
+		vid->current_seq = vid->pending_seq;
+		vid->current_time = vid->pending_time * 1.0e-9;
+		vid->current_dropped = (int)(vid->current_seq - vid->last_seq - 1);
+		vid->last_seq = vid->current_seq;
+	}
+	
+	g_mutex_unlock(vid->lock);
+	
+	if (old) gst_buffer_unref(old);
+
+	/* pinned until ar2VideoCapNext() */
+	if (vid->current == 0 
+	 || GST_BUFFER_SIZE(vid->current) < vid->width * vid->height * AR_PIX_SIZE_DEFAULT) return 0;
+	return GST_BUFFER_DATA(vid->current);
 }
 
 int 
@@ -367,14 +455,29 @@ ar2VideoCapStart(AR2VideoParamT *vid)
 
 int 
 ar2VideoCapStop(AR2VideoParamT *vid) {
+	int ret;
+
 	/* stop pipeline */
-	return gst_element_set_state (vid->pipeline, GST_STATE_NULL);
+	ret = gst_element_set_state (vid->pipeline, GST_STATE_NULL);
+	
+	release_buffers(vid);
+
+	return ret;
 }
 
 int 
 ar2VideoCapNext(AR2VideoParamT *vid)
 {
-	/* gstreamer should */
+	GstBuffer *old;
+	
+	/* unpin the frame handed out by ar2VideoGetImage() */
+	g_mutex_lock(vid->lock);
+	old = vid->current;
+	vid->current = 0;
+	g_mutex_unlock(vid->lock);
+	
+	if (old) gst_buffer_unref(old);
+
 	return TRUE;
 }
 
@@ -385,4 +488,32 @@ ar2VideoInqSize(AR2VideoParamT *vid, int *x, int *y )
    *x = vid->width; // width of your static image
    *y = vid->height; // height of your static image
 
+   return 0;
+}
+
+int
+ar2VideoInqFrameInfo(AR2VideoParamT *vid, ARVideoFrameInfoT *info)
+{
+	if (vid->current == 0) return -1;
+
+	info->seq = vid->current_seq;
+	info->time = vid->current_time;
+	info->dropped = vid->current_dropped;
+
+	return 0;
+}
+
+static void
+release_buffers(AR2VideoParamT *vid)
+{
+	GstBuffer *pending, *current;
+	
+	g_mutex_lock(vid->lock);
+	pending = vid->pending;
+	current = vid->current;
+	vid->pending = vid->current = 0;
+	g_mutex_unlock(vid->lock);
+	
+	if (pending) gst_buffer_unref(pending);
+	if (current) gst_buffer_unref(current);
 }
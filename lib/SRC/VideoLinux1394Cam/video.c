@@ -91,6 +91,7 @@
 #include <AR/config.h>
 #include <AR/ar.h>
 #include <AR/video.h>
+#include <AR/arColorConv.h>
 
 
 
@@ -733,12 +734,6 @@ int ar2VideoInqSize(AR2VideoParamT *vid, int *x,int *y)
 
 ARUint8 *ar2VideoGetImage( AR2VideoParamT *vid )
 {
-    register ARUint8 *buf, *buf2;
-    register int i, j;
-    register int U, V, R, G, B, V2, U5, UV;
-    register int Y0, Y1, Y2, Y3;
-    register ARUint8 r, g, b;
-
     if(vid->status == 0){
         fprintf(stderr, "arVideoCapStart has never been called.\n");
         return NULL;
@@ -829,120 +824,15 @@ ARUint8 *ar2VideoGetImage( AR2VideoParamT *vid )
 	  
 	  
         case MODE_640x480_YUV411:
-          buf  = vid->image;
-          buf2 = (ARUint8 *)vid->camera.capture_buffer;
-          for( i = vid->camera.frame_height * vid->camera.frame_width / 4; i; i--) {
-              U   = ((ARUint8)*buf2++ - 128) * 0.354;
-              U5  = 5*U;
-              Y0  = (ARUint8)*buf2++;
-              Y1  = (ARUint8)*buf2++;
-              V   = ((ARUint8)*buf2++ - 128) * 0.707;
-              V2  = 2*V;
-              Y2  = (ARUint8)*buf2++;
-              Y3  = (ARUint8)*buf2++;
-              UV  = - U - V;
-
-              // Original equations
-              // R = Y           + 1.402 V
-              // G = Y - 0.344 U - 0.714 V
-              // B = Y + 1.772 U
-              R = Y0 + V2;
-              if ((R >> 8) > 0) R = 255; else if (R < 0) R = 0;
-
-              G = Y0 + UV;
-              if ((G >> 8) > 0) G = 255; else if (G < 0) G = 0;
-
-              B = Y0 + U5;
-              if ((B >> 8) > 0) B = 255; else if (B < 0) B = 0;
-     
-              *buf++ = (ARUint8)R;
-              *buf++ = (ARUint8)G;
-              *buf++ = (ARUint8)B;
-
-              //---
-              R = Y1 + V2;
-              if ((R >> 8) > 0) R = 255; else if (R < 0) R = 0;
-
-              G = Y1 + UV;
-              if ((G >> 8) > 0) G = 255; else if (G < 0) G = 0;
-
-              B = Y1 + U5;
-              if ((B >> 8) > 0) B = 255; else if (B < 0) B = 0;
-     
-              *buf++ = (ARUint8)R;
-              *buf++ = (ARUint8)G;
-              *buf++ = (ARUint8)B;
-
-              //---
-              R = Y2 + V2;
-              if ((R >> 8) > 0) R = 255; else if (R < 0) R = 0;
-
-              G = Y2 + UV;
-              if ((G >> 8) > 0) G = 255; else if (G < 0) G = 0;
-
-              B = Y2 + U5;
-              if ((B >> 8) > 0) B = 255; else if (B < 0) B = 0;
-     
-              *buf++ = (ARUint8)R;
-              *buf++ = (ARUint8)G;
-              *buf++ = (ARUint8)B;
-
-              //---
-              R = Y3 + V2;
-              if ((R >> 8) > 0) R = 255; else if (R < 0) R = 0;
-
-              G = Y3 + UV;
-              if ((G >> 8) > 0) G = 255; else if (G < 0) G = 0;
-
-              B = Y3 + U5;
-              if ((B >> 8) > 0) B = 255; else if (B < 0) B = 0;
-     
-              *buf++ = (ARUint8)R;
-              *buf++ = (ARUint8)G;
-              *buf++ = (ARUint8)B;
-          }
+          arColorConvert( (ARUint8 *)vid->camera.capture_buffer, AR_COLOR_YUV411,
+                          vid->camera.frame_width, vid->camera.frame_height,
+                          vid->image, AR_DEFAULT_PIXEL_FORMAT );
           return vid->image;
 
         case MODE_320x240_YUV422:
-          buf  = vid->image;
-          buf2 = (ARUint8 *)vid->camera.capture_buffer;
-          for( i = vid->camera.frame_height * vid->camera.frame_width / 2; i; i-- ) {
-              U   = ((ARUint8)*buf2++ - 128) * 0.354;
-              U5  = 5*U;
-              Y0  = (ARUint8)*buf2++;
-              V   = ((ARUint8)*buf2++ - 128) * 0.707;
-              V2  = 2*V;
-              Y1  = (ARUint8)*buf2++;
-              UV  = - U - V;
-
-              //---
-              R = Y0 + V2;
-              if ((R >> 8) > 0) R = 255; else if (R < 0) R = 0;
-
-              G = Y0 + UV;
-              if ((G >> 8) > 0) G = 255; else if (G < 0) G = 0;
-
-              B = Y0 + U5;
-              if ((B >> 8) > 0) B = 255; else if (B < 0) B = 0;
-      
-              *buf++ = (ARUint8)R;
-              *buf++ = (ARUint8)G;
-              *buf++ = (ARUint8)B;
-
-              //---
-              R = Y1 + V2;
-              if ((R >> 8) > 0) R = 255; else if (R < 0) R = 0;
-
-              G = Y1 + UV;
-              if ((G >> 8) > 0) G = 255; else if (G < 0) G = 0;
-
-              B = Y1 + U5;
-              if ((B >> 8) > 0) B = 255; else if (B < 0) B = 0;
-      
-              *buf++ = (ARUint8)R;
-              *buf++ = (ARUint8)G;
-              *buf++ = (ARUint8)B;
-          }
+          arColorConvert( (ARUint8 *)vid->camera.capture_buffer, AR_COLOR_UYVY,
+                          vid->camera.frame_width, vid->camera.frame_height,
+                          vid->image, AR_DEFAULT_PIXEL_FORMAT );
           return vid->image;
     }
 
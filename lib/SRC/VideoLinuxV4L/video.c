@@ -31,7 +31,7 @@
 #include <AR/config.h>
 #include <AR/ar.h>
 #include <AR/video.h>
-#include "ccvt.h"
+#include <AR/arColorConv.h>
 #ifdef USE_EYETOY
 #include "jpegtorgb.h" 
 #endif
@@ -82,6 +82,20 @@ ARUint8 *arVideoGetImage( void )
     return ar2VideoGetImage( gVid );
 }
 
+ARUint8 *arVideoGetImageYUV( ARUint8 **u, ARUint8 **v )
+{
+    if( gVid == NULL ) return NULL;
+
+    return ar2VideoGetImageYUV( gVid, u, v );
+}
+
+ARUint8 *arVideoConvertImage( void )
+{
+    if( gVid == NULL ) return NULL;
+
+    return ar2VideoConvertImage( gVid );
+}
+
 int arVideoCapStart( void )
 {
     if( gVid == NULL ) return -1;
@@ -188,6 +202,8 @@ AR2VideoParamT *ar2VideoOpen( char *config_in )
     vid->mode       = DEFAULT_VIDEO_MODE;
     vid->debug      = 0;
     vid->videoBuffer=NULL;
+    vid->yuvFrame=NULL;
+    vid->yuvConverted=0;
 
 	a = config;
     if( a != NULL) {
@@ -448,7 +464,7 @@ AR2VideoParamT *ar2VideoOpen( char *config_in )
         return 0;
     }
     if (vid->palette==VIDEO_PALETTE_YUV420P)
-        arMalloc( vid->videoBuffer, ARUint8, vid->width*vid->height*3 );
+        arMalloc( vid->videoBuffer, ARUint8, vid->width*vid->height*AR_PIX_SIZE_DEFAULT );
 
     if( vid->debug ) { 
         if(ioctl(vid->fd, VIDIOCGPICT, &vp)) {
@@ -550,6 +566,7 @@ int ar2VideoCapNext( AR2VideoParamT *vid )
 
     vid->vmm.frame = 1 - vid->vmm.frame;
     ioctl(vid->fd, VIDIOCMCAPTURE, &vid->vmm);
+    vid->yuvFrame = NULL;
 
     return 0;
 }
@@ -565,15 +582,14 @@ int ar2VideoCapStop( AR2VideoParamT *vid )
         return -1;
     }
     vid->video_cont_num = -1;
+    vid->yuvFrame = NULL;
 
     return 0;
 }
 
 
-ARUint8 *ar2VideoGetImage( AR2VideoParamT *vid )
+static ARUint8 *sync_frame( AR2VideoParamT *vid )
 {
-    ARUint8 *buf;
-
     if(vid->video_cont_num < 0){
         printf("arVideoCapStart has never been called.\n");
         return NULL;
@@ -586,17 +602,23 @@ ARUint8 *ar2VideoGetImage( AR2VideoParamT *vid )
     vid->video_cont_num = 1 - vid->video_cont_num;
 
     if(vid->video_cont_num == 0)
-        buf=(vid->map + vid->vm.offsets[1]); 
+        return (vid->map + vid->vm.offsets[1]);
     else
-        buf=(vid->map + vid->vm.offsets[0]);
+        return (vid->map + vid->vm.offsets[0]);
+}
+
+ARUint8 *ar2VideoGetImage( AR2VideoParamT *vid )
+{
+    ARUint8 *buf;
+
+    buf = sync_frame( vid );
+    if( buf == NULL ) return NULL;
 	
     if(vid->palette == VIDEO_PALETTE_YUV420P)
     {
-
-        ccvt_420p_bgr24(vid->width, vid->height, buf, buf+(vid->width*vid->height),
-	 	        buf+(vid->width*vid->height)+(vid->width*vid->height)/4,
-		        vid->videoBuffer);
-        return vid->videoBuffer;
+        vid->yuvFrame = buf;
+        vid->yuvConverted = 0;
+        return ar2VideoConvertImage( vid );
     }
 #ifdef USE_EYETOY
 	buf=JPEGToRGB(buf,vid->width, vid->height);
@@ -606,6 +628,38 @@ ARUint8 *ar2VideoGetImage( AR2VideoParamT *vid )
 
 }
 
+ARUint8 *ar2VideoGetImageYUV( AR2VideoParamT *vid, ARUint8 **u, ARUint8 **v )
+{
+    ARUint8 *buf;
+
+    if(vid->palette != VIDEO_PALETTE_YUV420P) {
+        printf("ar2VideoGetImageYUV needs the YUV420P palette.\n");
+        return NULL;
+    }
+
+    buf = sync_frame( vid );
+    if( buf == NULL ) return NULL;
+
+    vid->yuvFrame = buf;
+    vid->yuvConverted = 0;
+    if( u != NULL ) *u = buf + vid->width*vid->height;
+    if( v != NULL ) *v = buf + vid->width*vid->height*5/4;
+
+    return buf;
+}
+
+ARUint8 *ar2VideoConvertImage( AR2VideoParamT *vid )
+{
+    if( vid->yuvFrame == NULL ) return NULL;
+
+    if( !vid->yuvConverted ) {
+        arColorConvert(vid->yuvFrame, AR_COLOR_YUV420P, vid->width, vid->height,
+                       vid->videoBuffer, AR_DEFAULT_PIXEL_FORMAT);
+        vid->yuvConverted = 1;
+    }
+    return vid->videoBuffer;
+}
+
 int ar2VideoInqSize(AR2VideoParamT *vid, int *x,int *y)
 {
     *x = vid->vmm.width;
@@ -7,24 +7,34 @@
 #include <AR/param.h>
 #include <AR/ar.h>
 #include <AR/arMulti.h>
+#include <AR/arStats.h>
+#include <AR/arPoseStore.h>
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <GL/gl.h>
 #include <GL/glut.h>
 
 char			*vconf = "../Data/WDM_camera_flipV.xml";
 int             xsize, ysize;
 int             thresh = 100;
-int             count = 0;
+volatile int    count = 0;
+volatile int    track_count = 0;
 char           *cparam_name = "../Data/camera_para.dat";
 ARParam         cparam;
 char                *config_name = "../Data/multi/marker.dat";
 ARMultiMarkerInfoT  *config;
 
+/* pose of the board and frames handed from the tracking thread to the rendering one */
+ARPoseStore     *pose_store;
+HANDLE          tracking_thread;
+volatile int    tracking_run = 1;
+
 static void   init(void);
 static void   cleanup(void);
 static void   mainLoop(void);
+static DWORD WINAPI tracking(LPVOID arg);
 static void   draw(double trans1[3][4], double trans2[3][4], int mode);
 static void init(void)
 {
@@ -41,53 +51,28 @@ static void init(void)
 	arImageProcMode = AR_IMAGE_PROC_IN_HALF;
 	argDrawMode = AR_DRAW_BY_TEXTURE_MAPPING;
 	argTexmapMode = AR_DRAW_TEXTURE_HALF_IMAGE;
+	pose_store = arPoseStoreCreate(1, xsize * ysize * AR_PIX_SIZE_DEFAULT);
 }
+/* draws the latest frame tracked, without waiting for the next one */
 static void mainLoop(void)
 {
-	ARUint8         *dataPtr;
-	ARMarkerInfo    *marker_info;
-	int             marker_num;
-	double          err;
+	ARPoseFrame     *frame;
 	int             i;
 
-	/* grab a vide frame */
-	if ((dataPtr = (ARUint8 *)arVideoGetImage()) == NULL) {
+	if (!tracking_run) {
+		cleanup();
+		exit(0);
+	}
+	if ((frame = arPoseStoreGetLatest(pose_store)) == NULL) {
 		arUtilSleep(2);
 		return;
 	}
-	if (count == 0) arUtilTimerReset();
 	count++;
 
-	if (arDetectMarkerLite(dataPtr, thresh, &marker_info, &marker_num) < 0) {
-		cleanup();
-		exit(0);
-	}
-
 	argDrawMode2D();
-	if (!arDebug) {
-		argDispImage(dataPtr, 0, 0);
-	}
-	else {
-		argDispImage(dataPtr, 1, 1);
-		if (arImageProcMode == AR_IMAGE_PROC_IN_HALF)
-			argDispHalfImage(arImage, 0, 0);
-		else
-			argDispImage(arImage, 0, 0);
-
-		glColor3f(1.0, 0.0, 0.0);
-		glLineWidth(1.0);
-		for (i = 0; i < marker_num; i++) {
-			argDrawSquare(marker_info[i].vertex, 0, 0);
-		}
-		glLineWidth(1.0);
-	}
+	argDispImage(frame->image, 0, 0);
 
-	arVideoCapNext();
-	if ((err = arMultiGetTransMat(marker_info, marker_num, config)) < 0) {
-		argSwapBuffers();
-		return;
-	}
-	if (err > 100.0) {
+	if (!frame->pose[0].visible) {
 		argSwapBuffers();
 		return;
 	}
@@ -95,13 +80,59 @@ static void mainLoop(void)
 	argDraw3dCamera(0, 0);
 	glClearDepth(1.0);
 	glClear(GL_DEPTH_BUFFER_BIT);
+	/* the board geometry in config is only read here, never changed */
 	for (i = 0; i < config->marker_num; i++) {
-		draw(config->trans, config->marker[i].trans, 0);
-		//if (config->marker[i].visible >= 0) draw(config->trans, config->marker[i].trans, 0);//ɫ ɼ
-		//else                                 draw(config->trans, config->marker[i].trans, 1);//ɫ ɼ
+		draw(frame->pose[0].conv, config->marker[i].trans, 0);
 	}
 	argSwapBuffers();
 }
+
+/* tracking thread: capture, detection and board pose of every frame */
+static DWORD WINAPI tracking(LPVOID arg)
+{
+	ARUint8         *dataPtr;
+	ARMarkerInfo    *marker_info;
+	ARPoseFrame     *frame;
+	int             marker_num;
+	double          err;
+	int             i, n;
+
+	while (tracking_run) {
+		/* grab a vide frame */
+		if ((dataPtr = (ARUint8 *)arVideoGetImage()) == NULL) {
+			arUtilSleep(2);
+			continue;
+		}
+		track_count++;
+
+		/* the frame is kept with its pose, the driver can go on */
+		frame = arPoseStoreGetBuffer(pose_store);
+		frame->seq = track_count;
+		frame->time = arStatsGetTime() * 1.0e-9;
+		memcpy(frame->image, dataPtr, xsize * ysize * AR_PIX_SIZE_DEFAULT);
+		arVideoCapNext();
+
+		if (arDetectMarkerLite(frame->image, thresh, &marker_info, &marker_num) < 0) {
+			break;
+		}
+
+		if ((err = arMultiGetTransMat(marker_info, marker_num, config)) >= 0 && err <= 100.0) {
+			n = 0;
+			for (i = 0; i < config->marker_num; i++) {
+				if (config->marker[i].visible >= 0) n++;
+			}
+			memcpy(frame->pose[0].conv, config->trans, sizeof(config->trans));
+			frame->pose[0].cf = (double)n / config->marker_num;
+			frame->pose[0].err = err;
+			frame->pose[0].visible = 1;
+		}
+		arPoseStorePublish(pose_store);
+	}
+	tracking_run = 0;
+
+	return 0;
+}
+
 static void draw(double trans1[3][4], double trans2[3][4], int mode)
 {
 	double    gl_para[16];
@@ -153,6 +184,10 @@ static void draw(double trans1[3][4], double trans2[3][4], int mode)
 }
 static void cleanup(void)
 {
+	tracking_run = 0;
+	WaitForSingleObject(tracking_thread, INFINITE);
+	CloseHandle(tracking_thread);
+	arPoseStoreDestroy(pose_store);
 	arVideoCapStop();
 	arVideoClose();
 	argCleanup();
@@ -162,6 +197,9 @@ int main(int argc, char **argv)
 	glutInit(&argc, argv);
 	init();
 	arVideoCapStart();
+	/* detection runs on its own thread, rendering is not held by it */
+	arUtilTimerReset();
+	tracking_thread = CreateThread(NULL, 0, tracking, NULL, 0, NULL);
 	argMainLoop(NULL, NULL, mainLoop);
 	return (0);
 }
@@ -6,15 +6,19 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <GL/glut.h>
 #include <AR/gsub.h>
 #include <AR/video.h>
 #include <AR/param.h>
 #include <AR/ar.h>
+#include <AR/arStats.h>
+#include <AR/arPoseStore.h>
 char *vconf = "../Data/WDM_camera_flipV.xml";
 int             xsize, ysize;
 int             thresh = 100;
-int             count = 0;
+volatile int    count = 0;
+volatile int    track_count = 0;
 char           *cparam_name = "../Data/camera_para.dat";
 ARParam         cparam;
 
@@ -32,7 +36,6 @@ typedef struct {
 	int     visible;
 	double  width;
 	double  center[2];
-	double  trans[3][4];
 } OBJECT_T;
 
 OBJECT_T   object[2] = {
@@ -40,68 +43,112 @@ OBJECT_T   object[2] = {
 	{ OBJ2_PATT_NAME, -1, OBJ2_MODEL_ID, 0, OBJ2_SIZE,{ 0.0,0.0 } }
 };
 
+/* poses (one per object) and frames handed from the tracking thread to the rendering one */
+ARPoseStore     *pose_store;
+HANDLE          tracking_thread;
+volatile int    tracking_run = 1;
+
 static void   init(void);
 static void   cleanup(void);
 static void   mainLoop(void);
+static DWORD WINAPI tracking(LPVOID arg);
 static void   draw(int object, double trans[3][4]);
 int main(int argc, char *argv[])
 {
 	glutInit(&argc, argv);
 	init();
 	arVideoCapStart();
+	/* detection runs on its own thread, rendering is not held by it */
+	arUtilTimerReset();
+	tracking_thread = CreateThread(NULL, 0, tracking, NULL, 0, NULL);
 	argMainLoop(NULL, NULL, mainLoop);
 	return (0);
 }
+/* draws the latest frame tracked, without waiting for the next one */
 static void mainLoop(void)
 {
-	ARUint8         *dataPtr;
-	ARMarkerInfo    *marker_info;
-	int             marker_num;
-	int             i, j, k;
-	if ((dataPtr = (ARUint8 *)arVideoGetImage()) == NULL) {
+	ARPoseFrame     *frame;
+	int             i;
+
+	if (!tracking_run) {
+		cleanup();
+		exit(0);
+	}
+	if ((frame = arPoseStoreGetLatest(pose_store)) == NULL) {
 		arUtilSleep(2);
 		return;
 	}
-	if (count == 0) arUtilTimerReset();
 	count++;
 	argDrawMode2D();
-	argDispImage(dataPtr, 0, 0);
-	if (arDetectMarker(dataPtr, thresh, &marker_info, &marker_num) < 0) {
-		cleanup();
-		exit(0);
-	}
-	arVideoCapNext();
+	argDispImage(frame->image, 0, 0);
 	argDrawMode3D();
 	argDraw3dCamera(0, 0);
 	glClearDepth(1.0);
 	glClear(GL_DEPTH_BUFFER_BIT);
 	for (i = 0; i < 2; i++) {
-		k = -1;
-		for (j = 0; j < marker_num; j++) {
-			if (object[i].patt_id == marker_info[j].id) {
-				if (k == -1) k = j;
-				else if (marker_info[k].cf < marker_info[j].cf) k = j;
-			}
-		}
-		object[i].visible = k;
-		if (k >= 0) {
-			arGetTransMat(&marker_info[k],
-				object[i].center, object[i].width,
-				object[i].trans);
-			draw(object[i].model_id, object[i].trans);
-		}
+		if (frame->pose[i].visible) draw(object[i].model_id, frame->pose[i].conv);
 	}
 	argSwapBuffers();
-	//if (object[0].visible >= 0
-	//	&& object[1].visible >= 0) {
+	//if (frame->pose[0].visible
+	//	&& frame->pose[1].visible) {
 	//	double  wmat1[3][4], wmat2[3][4];
-	//	arUtilMatInv(object[0].trans, wmat1);
-	//	arUtilMatMul(wmat1, object[1].trans, wmat2);
+	//	arUtilMatInv(frame->pose[0].conv, wmat1);
+	//	arUtilMatMul(wmat1, frame->pose[1].conv, wmat2);
 	//	for (j = 0; j < 3; j++) {
 	//		for (i = 0; i < 4; i++) printf("%8.4f ", wmat2[j][i]);
 	//	}
 	//}
 }
+
+/* tracking thread: capture, detection and pose of every object */
+static DWORD WINAPI tracking(LPVOID arg)
+{
+	ARUint8         *dataPtr;
+	ARMarkerInfo    *marker_info;
+	ARPoseFrame     *frame;
+	int             marker_num;
+	int             i, j, k;
+
+	while (tracking_run) {
+		if ((dataPtr = (ARUint8 *)arVideoGetImage()) == NULL) {
+			arUtilSleep(2);
+			continue;
+		}
+		track_count++;
+
+		/* the frame is kept with its poses, the driver can go on */
+		frame = arPoseStoreGetBuffer(pose_store);
+		frame->seq = track_count;
+		frame->time = arStatsGetTime() * 1.0e-9;
+		memcpy(frame->image, dataPtr, xsize * ysize * AR_PIX_SIZE_DEFAULT);
+		arVideoCapNext();
+
+		if (arDetectMarker(frame->image, thresh, &marker_info, &marker_num) < 0) {
+			break;
+		}
+		for (i = 0; i < 2; i++) {
+			k = -1;
+			for (j = 0; j < marker_num; j++) {
+				if (object[i].patt_id == marker_info[j].id) {
+					if (k == -1) k = j;
+					else if (marker_info[k].cf < marker_info[j].cf) k = j;
+				}
+			}
+			object[i].visible = k;
+			if (k >= 0) {
+				frame->pose[i].err = arGetTransMat(&marker_info[k],
+					object[i].center, object[i].width,
+					frame->pose[i].conv);
+				frame->pose[i].cf = marker_info[k].cf;
+				frame->pose[i].visible = 1;
+			}
+		}
+		arPoseStorePublish(pose_store);
+	}
+	tracking_run = 0;
+
+	return 0;
+}
 static void init(void)
 {
 	ARParam  wparam;
@@ -117,10 +164,15 @@ static void init(void)
 		object[i].patt_id = arLoadPatt(object[i].patt_name);
 	}
 	argInit(&cparam, 1.0, 0, 0, 0, 0);
+	pose_store = arPoseStoreCreate(2, xsize * ysize * AR_PIX_SIZE_DEFAULT);
 }
 
 static void cleanup(void)
 {
+	tracking_run = 0;
+	WaitForSingleObject(tracking_thread, INFINITE);
+	CloseHandle(tracking_thread);
+	arPoseStoreDestroy(pose_store);
 	arVideoCapStop();
 	arVideoClose();
 	argCleanup();
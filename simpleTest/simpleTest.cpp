@@ -5,12 +5,16 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <GL/gl.h>
 #include <GL/glut.h>
 #include <AR/gsub.h>
 #include <AR/video.h>
 #include <AR/param.h>
 #include <AR/ar.h>
+#include <AR/arStats.h>
+#include <AR/arPoseStore.h>
+#include <AR/arPosePredict.h>
 //Ĭϲ
 char			*vconf = "../Data/WDM_camera_flipV.xml";
 //
@@ -20,18 +24,29 @@ char           *patt_name = "../Data/patt.hiro";
 
 int             xsize, ysize;
 int             thresh = 100;
-int             count = 0;
+volatile int    count = 0;
+volatile int    track_count = 0;
 ARParam         cparam;
 int             patt_id;
 double          patt_width = 80.0;
 double          patt_center[2] = { 0.0, 0.0 };
-double          patt_trans[3][4];
+
+/* poses and frames handed from the tracking thread to the rendering one */
+ARPoseStore     *pose_store;
+HANDLE          tracking_thread;
+volatile int    tracking_run = 1;
+
+/* pose extrapolated to the time the frame is shown, toggled with 'p' */
+ARPosePredict   *pose_predict;
+int             predict_mode = 0;
+double          display_latency = 0.016;    /* from argSwapBuffers to the screen [s] */
 
 static void   init(void);
 static void   cleanup(void);
 static void   keyEvent(unsigned char key, int x, int y);
 static void   mainLoop(void);
-static void   draw(void);
+static DWORD WINAPI tracking(LPVOID arg);
+static void   draw(double trans[3][4]);
 
 int main(int argc, char **argv)
 {
@@ -41,6 +56,9 @@ int main(int argc, char **argv)
 	init();
 	//
 	arVideoCapStart();
+	/* detection runs on its own thread, rendering is not held by it */
+	arUtilTimerReset();
+	tracking_thread = CreateThread(NULL, 0, tracking, NULL, 0, NULL);
 	//֡ѭ趨Ӧ¼Ϊָ룩
 	//argMainLoop()  ֱ mouseEvent keyEvent mainLoop
 	argMainLoop(NULL, keyEvent, mainLoop);
@@ -49,66 +67,109 @@ int main(int argc, char **argv)
 
 static void   keyEvent(unsigned char key, int x, int y)
 {
+	if (key == 'p') {
+		predict_mode = !predict_mode;
+		printf("*** pose prediction %s\n", (predict_mode) ? "on" : "off");
+	}
 	if (key == 0x1b) {
-		printf("*** %f (frame/sec)\n", (double)count / arUtilTimer());
+		printf("*** %f (frame/sec) rendering, %f (frame/sec) tracking\n",
+			(double)count / arUtilTimer(), (double)track_count / arUtilTimer());
 		cleanup();
 		exit(0);
 	}
 }
 
-/* main loop */
+/* main loop: draws the latest frame tracked, without waiting for the next one */
 static void mainLoop(void)
 {
-	ARUint8         *dataPtr;
-	ARMarkerInfo    *marker_info; //־Ϣstruct
-	int             marker_num;
-	int             j, k;
+	ARPoseFrame     *frame;
+	double          trans[3][4];
 
-	//ȡһ֡ͼ
-	if ((dataPtr = (ARUint8 *)arVideoGetImage()) == NULL) {
-		//ӳ
+	if (!tracking_run) {
+		cleanup();
+		exit(0);
+	}
+	if ((frame = arPoseStoreGetLatest(pose_store)) == NULL) {
 		arUtilSleep(2);
 		return;
 	}
-	if (count == 0) arUtilTimerReset();
 	count++;
+	arPosePredictAddFrame(pose_predict, frame);
 	//ΪȾ2d µǰ
 	argDrawMode2D();
-	argDispImage(dataPtr, 0, 0);
-	//ʶ
-	/*
-	arDetectMarker()Ĳֱ
-	dataPtr ֡
-	thresh  ֵֵ
-	marker_info  ʶϢ
-	marker_num ʶ
-	*/
-	if (arDetectMarker(dataPtr, thresh, &marker_info, &marker_num) < 0) {
-		cleanup();
-		exit(0);
-	}
-	//ÿһ֡Ҫã֧๦ܵ
-	arVideoCapNext();
-
-	k = -1;
-	for (j = 0; j < marker_num; j++) {
-		if (patt_id == marker_info[j].id) {
-			if (k == -1) k = j;
-			else if (marker_info[k].cf < marker_info[j].cf) k = j;
+	argDispImage(frame->image, 0, 0);
+	//ģ͵Ӧλ
+	if (frame->pose[0].visible) {
+		/* predicted, the cube keeps up with the real marker rather than with the video, as old as the pose */
+		if (predict_mode
+		 && arPosePredictGet(pose_predict, 0, arStatsGetTime() * 1.0e-9 + display_latency, trans) == 0) {
+			draw(trans);
+		}
+		else {
+			draw(frame->pose[0].conv);
 		}
 	}
-	if (k == -1) {
-		argSwapBuffers();
-		return;
-	}
-	//ȡλ
-	arGetTransMat(&marker_info[k], patt_center, patt_width, patt_trans);
-	//ģ͵Ӧλ
-	draw();
 
 	argSwapBuffers();
 }
 
+/* tracking thread: capture, detection and pose of every frame */
+static DWORD WINAPI tracking(LPVOID arg)
+{
+	ARUint8         *dataPtr;
+	ARMarkerInfo    *marker_info;
+	ARPoseFrame     *frame;
+	int             marker_num;
+	int             j, k;
+
+	while (tracking_run) {
+		//ȡһ֡ͼ
+		if ((dataPtr = (ARUint8 *)arVideoGetImage()) == NULL) {
+			arUtilSleep(2);
+			continue;
+		}
+		track_count++;
+
+		/* the frame is kept with its pose, the driver can go on */
+		frame = arPoseStoreGetBuffer(pose_store);
+		frame->seq = track_count;
+		frame->time = arStatsGetTime() * 1.0e-9;
+		memcpy(frame->image, dataPtr, xsize * ysize * AR_PIX_SIZE_DEFAULT);
+		//ÿһ֡Ҫã֧๦ܵ
+		arVideoCapNext();
+
+		//ʶ
+		/*
+		arDetectMarker()Ĳֱ
+		dataPtr ֡
+		thresh  ֵֵ
+		marker_info  ʶϢ
+		marker_num ʶ
+		*/
+		if (arDetectMarker(frame->image, thresh, &marker_info, &marker_num) < 0) {
+			break;
+		}
+
+		k = -1;
+		for (j = 0; j < marker_num; j++) {
+			if (patt_id == marker_info[j].id) {
+				if (k == -1) k = j;
+				else if (marker_info[k].cf < marker_info[j].cf) k = j;
+			}
+		}
+		//ȡλ
+		if (k != -1) {
+			frame->pose[0].err = arGetTransMat(&marker_info[k], patt_center, patt_width, frame->pose[0].conv);
+			frame->pose[0].cf = marker_info[k].cf;
+			frame->pose[0].visible = 1;
+		}
+		arPoseStorePublish(pose_store);
+	}
+	tracking_run = 0;
+
+	return 0;
+}
+
 static void init(void)
 {
 	ARParam  wparam;
@@ -127,17 +188,24 @@ static void init(void)
 	patt_id = arLoadPatt(patt_name);
 	//ͼ񴰿
 	argInit(&cparam, 1.0, 0, 0, 0, 0);
+	pose_store = arPoseStoreCreate(1, xsize * ysize * AR_PIX_SIZE_DEFAULT);
+	pose_predict = arPosePredictCreate(1, AR_POSE_PREDICT_CONSTANT_VELOCITY);
 }
 
 //cleanup
 static void cleanup(void)
 {
+	tracking_run = 0;
+	WaitForSingleObject(tracking_thread, INFINITE);
+	CloseHandle(tracking_thread);
+	arPoseStoreDestroy(pose_store);
+	arPosePredictDestroy(pose_predict);
 	arVideoCapStop();
 	arVideoClose();
 	argCleanup();
 }
 //3Dģ opengl
-static void draw(void)
+static void draw(double trans[3][4])
 {
 	double    gl_para[16];
 	GLfloat   mat_ambient[] = { 0.0, 0.0, 1.0, 1.0 };
@@ -154,7 +222,7 @@ static void draw(void)
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LEQUAL);
 	//ת
-	argConvGlpara(patt_trans, gl_para);
+	argConvGlpara(trans, gl_para);
 	glMatrixMode(GL_MODELVIEW);
 	glLoadMatrixd(gl_para);
 	glEnable(GL_LIGHTING);
@@ -0,0 +1,1093 @@
+/*******************************************************
+ *
+ * arBench - headless frame-replay benchmark of the
+ *           tracking pipeline.
+ *
+ * Replays a corpus of frames through arDetectMarker,
+ * arGetTransMat and arMultiGetTransMat under every
+ * detection mode and reports throughput, latency
+ * percentiles and detection counts.
+ *
+ * With -P, measures instead how well the poses of a
+ * recorded sequence are predicted some frames ahead
+ * (see arPosePredict.h). With -B, replays the corpus
+ * under the quality controller of arQuality.h and
+ * reports the settings each frame ran with. With -T,
+ * replays it through the frame pipeline of
+ * arPipeline.h on 1 to n threads and reports the
+ * throughput of each. With -g, compares the poses found
+ * on an arGenScene corpus with its ground truth, in
+ * double and in single precision (arPrecisionMode).
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <AR/ar.h>
+#include <AR/param.h>
+#include <AR/arMulti.h>
+#include <AR/arStats.h>
+#include <AR/arThread.h>
+#include <AR/arPosePredict.h>
+#include <AR/arQuality.h>
+#include <AR/arPipeline.h>
+
+#define   PATT_MAX     16
+#define   FRAME_MAX    100000
+
+/* PCA is left out: the patterns carry no eigenvectors, so it would change nothing */
+typedef struct {
+    char    *name;
+    int     image_proc_mode;
+    int     template_matching_mode;
+} BenchMode;
+
+static BenchMode   mode_table[] = {
+    { "full/color", AR_IMAGE_PROC_IN_FULL, AR_TEMPLATE_MATCHING_COLOR },
+    { "full/bw",    AR_IMAGE_PROC_IN_FULL, AR_TEMPLATE_MATCHING_BW    },
+    { "half/color", AR_IMAGE_PROC_IN_HALF, AR_TEMPLATE_MATCHING_COLOR },
+    { "half/bw",    AR_IMAGE_PROC_IN_HALF, AR_TEMPLATE_MATCHING_BW    }
+};
+#define   MODE_NUM     (int)(sizeof(mode_table)/sizeof(mode_table[0]))
+
+typedef struct {
+    int     frame;
+    int     patt;                   /* index in patt_id, -1 if the pattern is not loaded */
+    double  width;
+    double  trans[3][4];
+    double  corner[4][2];           /* observed image coordinates */
+} TruthMarker;
+
+static char *stage_name[AR_STATS_STAGE_NUM] = {
+    "labeling", "candidate", "contour", "check_square",
+    "get_line", "get_patt", "pattern_match", "pose"
+};
+
+static char               *cparam_name = "data/camera_para.dat";
+static char               *config_name = "data/multi/marker.dat";
+static char               *patt_name[PATT_MAX];
+static int                patt_name_num = 0;
+static int                patt_id[PATT_MAX];
+static int                patt_num = 0;
+static char               *patt_file[PATT_MAX];
+static double             patt_width = 80.0;
+static double             patt_center[2] = {0.0, 0.0};
+static ARMultiMarkerInfoT *config = NULL;
+static int                thresh = 100;
+static int                repeat = 1;
+static int                lite = 0;
+static int                mode_only = -1;
+static int                predict_ahead = 0;
+static double             frame_rate = 30.0;
+static double             budget = 0.0;
+static int                verbose = 0;
+static int                track = 0;
+static int                pipeline_threads = 0;
+static char               *truth_name = NULL;
+static TruthMarker        *truth = NULL;
+static int                truth_num = 0;
+
+static ARUint8            **frame = NULL;
+static int                frame_num = 0;
+static int                xsize = 0, ysize = 0;
+
+static void   usage( char *com );
+static int    load_corpus( char *path, int raw_xsize, int raw_ysize );
+static int    load_pnm( char *filename );
+static int    load_raw( char *filename, int raw_xsize, int raw_ysize );
+static int    add_frame( ARUint8 *image );
+static void   rgb_to_native( ARUint8 *rgb, ARUint8 *dst, int num );
+static int    compare_name( const void *a, const void *b );
+static int    compare_double( const void *a, const void *b );
+static void   run_mode( int m );
+static void   run_predict( int m );
+static void   run_budget( void );
+static void   run_pipeline( int m );
+static void   run_accuracy( int m );
+static int    load_truth( char *filename );
+static double reprojection_error( double trans[3][4], double width, double corner[4][2] );
+static int    pipeline_source( void *arg, ARPipelineFrame *pframe );
+static void   pipeline_sink( void *arg, ARPipelineFrame *pframe );
+static void   pose_error( double a[3][4], double b[3][4], double *trans_err, double *rot_err );
+static int    process_frame( ARUint8 *image, int *identified, int *multi_found );
+
+int main( int argc, char *argv[] )
+{
+    ARParam   wparam, cparam;
+    char      *path = NULL;
+    int       raw_xsize = 0, raw_ysize = 0;
+    int       i, m;
+
+    for( i = 1; i < argc; i++ ) {
+        if( strcmp(argv[i], "-c") == 0 && i+1 < argc )      cparam_name = argv[++i];
+        else if( strcmp(argv[i], "-p") == 0 && i+1 < argc ) {
+            if( patt_name_num < PATT_MAX ) patt_name[patt_name_num++] = argv[++i];
+            else i++;
+        }
+        else if( strcmp(argv[i], "-m") == 0 && i+1 < argc ) config_name = argv[++i];
+        else if( strcmp(argv[i], "-w") == 0 && i+1 < argc ) patt_width = atof(argv[++i]);
+        else if( strcmp(argv[i], "-t") == 0 && i+1 < argc ) thresh = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-r") == 0 && i+1 < argc ) repeat = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-M") == 0 && i+1 < argc ) mode_only = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-P") == 0 && i+1 < argc ) predict_ahead = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-f") == 0 && i+1 < argc ) frame_rate = atof(argv[++i]);
+        else if( strcmp(argv[i], "-B") == 0 && i+1 < argc ) budget = atof(argv[++i]);
+        else if( strcmp(argv[i], "-v") == 0 ) verbose = 1;
+        else if( strcmp(argv[i], "-T") == 0 && i+1 < argc ) pipeline_threads = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-g") == 0 && i+1 < argc ) truth_name = argv[++i];
+        else if( strcmp(argv[i], "-s") == 0 && i+1 < argc ) {
+            if( sscanf(argv[++i], "%dx%d", &raw_xsize, &raw_ysize) != 2 ) usage(argv[0]);
+        }
+        else if( strcmp(argv[i], "-l") == 0 ) lite = 1;
+        else if( strcmp(argv[i], "-y") == 0 ) arLumaMode = AR_LUMA_SHARED;
+        else if( argv[i][0] == '-' || path != NULL ) usage(argv[0]);
+        else path = argv[i];
+    }
+    if( path == NULL || repeat < 1 || mode_only >= MODE_NUM ) usage(argv[0]);
+    if( predict_ahead < 0 || frame_rate <= 0.0 || budget < 0.0 ) usage(argv[0]);
+    if( pipeline_threads < 0 || pipeline_threads > AR_PIPELINE_STAGE_NUM ) usage(argv[0]);
+    if( patt_name_num == 0 ) {
+        patt_name[patt_name_num++] = "data/patt.hiro";
+        patt_name[patt_name_num++] = "data/patt.kanji";
+    }
+
+    if( load_corpus( path, raw_xsize, raw_ysize ) < 0 ) exit(1);
+    printf("Corpus: %d frames of %dx%d\n", frame_num, xsize, ysize);
+
+    if( arParamLoad(cparam_name, 1, &wparam) < 0 ) {
+        printf("Camera parameter load error !! (%s)\n", cparam_name);
+        exit(1);
+    }
+    arParamChangeSize( &wparam, xsize, ysize, &cparam );
+    arInitCparam( &cparam );
+
+    for( i = 0; i < patt_name_num; i++ ) {
+        if( (patt_id[patt_num] = arLoadPatt(patt_name[i])) < 0 ) {
+            printf("Pattern load error, skipped (%s)\n", patt_name[i]);
+            continue;
+        }
+        patt_file[patt_num++] = patt_name[i];
+    }
+    if( (config = arMultiReadConfigFile(config_name)) == NULL ) {
+        printf("Multi-marker config load error, skipped (%s)\n", config_name);
+    }
+    printf("Patterns: %d, multi-marker config: %s, detection: %s%s\n",
+           patt_num, (config)? config_name: "none",
+           (lite)? "arDetectMarkerLite": "arDetectMarker",
+           (arLumaMode == AR_LUMA_SHARED)? " on the luminance": "");
+
+    if( truth_name ) {
+        if( load_truth( truth_name ) < 0 ) exit(1);
+        run_accuracy( (mode_only >= 0)? mode_only: 0 );
+    }
+    else if( predict_ahead > 0 ) {
+        run_predict( (mode_only >= 0)? mode_only: 0 );
+    }
+    else if( budget > 0.0 ) {
+        run_budget();
+    }
+    else if( pipeline_threads > 0 ) {
+        run_pipeline( (mode_only >= 0)? mode_only: 0 );
+    }
+    else {
+        for( m = 0; m < MODE_NUM; m++ ) {
+            if( mode_only >= 0 && m != mode_only ) continue;
+            run_mode( m );
+        }
+    }
+
+    if( config ) arMultiFreeConfig( config );
+    for( i = 0; i < frame_num; i++ ) free( frame[i] );
+    free( frame );
+    free( truth );
+
+    return 0;
+}
+
+static void usage( char *com )
+{
+    printf("Usage: %s [options] <frame directory | image.ppm | frames.raw>\n", com);
+    printf("  -c <file>   camera parameter file (default data/camera_para.dat)\n");
+    printf("  -p <file>   single-marker pattern, may be repeated\n");
+    printf("              (default data/patt.hiro and data/patt.kanji)\n");
+    printf("  -w <width>  single-marker width in mm (default 80)\n");
+    printf("  -m <file>   multi-marker config (default data/multi/marker.dat)\n");
+    printf("  -t <thresh> binarization threshold (default 100)\n");
+    printf("  -r <num>    number of passes over the corpus per mode (default 1)\n");
+    printf("  -M <mode>   run a single mode (0-%d, default all)\n", MODE_NUM-1);
+    printf("  -s <WxH>    frame size of a raw file, frames in the library pixel format\n");
+    printf("  -l          use arDetectMarkerLite\n");
+    printf("  -y          detect on the shared luminance plane (arLumaMode)\n");
+    printf("  -P <num>    measure the pose prediction <num> frames ahead on the\n");
+    printf("              corpus as a sequence, in mode -M (default 0)\n");
+    printf("  -f <fps>    frame rate of the sequence for -P (default 30)\n");
+    printf("  -B <ms>     replay under the quality controller with this frame budget\n");
+    printf("  -v          with -B, report the settings of every frame; with -g,\n");
+    printf("              the errors of every marker\n");
+    printf("  -T <num>    replay through the frame pipeline on 1 to <num> threads\n");
+    printf("              (1-%d), in mode -M\n", AR_PIPELINE_STAGE_NUM);
+    printf("  -g <file>   compare the poses with the ground truth <name>.txt of an\n");
+    printf("              arGenScene corpus, in double and single precision, in mode -M;\n");
+    printf("              the patterns are matched by their -p file names\n");
+    printf("A directory is replayed in name order; its .ppm and .pgm files are used.\n");
+    exit(1);
+}
+
+static void run_mode( int m )
+{
+    ARStats      stats;
+    ARStatsTime  t0, t1, start;
+    double       *latency;
+    double       elapsed;
+    long         markers, identified, multi_found;
+    int          n, total, id, mf;
+    int          i, r;
+
+    arImageProcMode        = mode_table[m].image_proc_mode;
+    arTemplateMatchingMode = mode_table[m].template_matching_mode;
+    arMatchingPCAMode      = AR_MATCHING_WITHOUT_PCA;
+
+    /* warm-up pass, not recorded */
+    arStatsMode = AR_STATS_DISABLE;
+    for( i = 0; i < frame_num; i++ ) process_frame( frame[i], &id, &mf );
+    if( config ) config->prevF = 0;
+
+    total = frame_num * repeat;
+    arMalloc( latency, double, total );
+    markers = identified = multi_found = 0;
+
+    arResetStats();
+    arStatsMode = AR_STATS_ENABLE;
+    start = arStatsGetTime();
+    for( r = n = 0; r < repeat; r++ ) {
+        for( i = 0; i < frame_num; i++, n++ ) {
+            t0 = arStatsGetTime();
+            markers += process_frame( frame[i], &id, &mf );
+            t1 = arStatsGetTime();
+            latency[n] = (t1 - t0) * 1.0e-6;
+            identified  += id;
+            multi_found += mf;
+        }
+    }
+    elapsed = (arStatsGetTime() - start) * 1.0e-9;
+    arStatsMode = AR_STATS_DISABLE;
+
+    qsort( latency, total, sizeof(double), compare_double );
+    printf("\nmode %d %s: %d frames, %.1f fps, frame p50 %.3f p95 %.3f p99 %.3f max %.3f [ms]\n",
+           m, mode_table[m].name, total, total / elapsed,
+           latency[(int)(0.50*(total-1))], latency[(int)(0.95*(total-1))],
+           latency[(int)(0.99*(total-1))], latency[total-1]);
+    printf("    markers %.2f/frame, identified %.2f/frame, multi-marker found in %.1f%% of frames\n",
+           (double)markers / total, (double)identified / total,
+           (config)? 100.0 * multi_found / total: 0.0);
+    free( latency );
+
+    if( arGetStats( &stats ) < 0 ) return;
+    printf("    %-14s %8s %10s %10s %10s %10s\n", "stage", "calls", "p50[us]", "p95[us]", "p99[us]", "max[us]");
+    for( i = 0; i < AR_STATS_STAGE_NUM; i++ ) {
+        if( stats.stage[i].total == 0 ) continue;
+        printf("    %-14s %8lu %10.2f %10.2f %10.2f %10.2f\n", stage_name[i], stats.stage[i].total,
+               stats.stage[i].p50 * 1.0e-3, stats.stage[i].p95 * 1.0e-3,
+               stats.stage[i].p99 * 1.0e-3, stats.stage[i].max * 1.0e-3);
+    }
+    if( stats.counter[AR_STATS_CONTOUR_NO_START] || stats.counter[AR_STATS_CONTOUR_OPEN]
+     || stats.counter[AR_STATS_CONTOUR_TOO_LONG] ) {
+        printf("    contour failures: no start %lu, open %lu, too long %lu\n",
+               stats.counter[AR_STATS_CONTOUR_NO_START], stats.counter[AR_STATS_CONTOUR_OPEN],
+               stats.counter[AR_STATS_CONTOUR_TOO_LONG]);
+    }
+}
+
+/*
+ * Frames replayed with the settings chosen by the quality controller,
+ * detected with arTrackMarker so that the tracked levels take effect.
+ */
+static void run_budget( void )
+{
+    ARQuality        *q;
+    ARQualityFrame   report;
+    ARQualityConfig  *c;
+    double           *latency, *level_time;
+    long             *level_frames, markers, identified, over;
+    int              total, level_num, id, mf;
+    int              i, n, r, l, k;
+
+    if( (q = arQualityCreate( budget, NULL, 0 )) == NULL ) return;
+    for( level_num = 0; arQualityGetConfig(q, level_num) != NULL; level_num++ );
+
+    total = frame_num * repeat;
+    arMalloc( latency, double, total );
+    arMalloc( level_time, double, level_num );
+    arMalloc( level_frames, long, level_num );
+    for( l = 0; l < level_num; l++ ) {
+        level_time[l]   = 0.0;
+        level_frames[l] = 0;
+    }
+    markers = identified = over = 0;
+
+    track = 1;
+    arStatsMode = AR_STATS_DISABLE;
+    printf("\nbudget %.3f ms, %d levels\n", budget, level_num);
+    for( r = n = 0; r < repeat; r++ ) {
+        for( i = 0; i < frame_num; i++, n++ ) {
+            arQualityFrameStart( q );
+            k = process_frame( frame[i], &id, &mf );
+            arQualityFrameEnd( q, &report );
+            latency[n] = report.time;
+            level_time[report.level] += report.time;
+            level_frames[report.level]++;
+            if( report.time > budget ) over++;
+            markers    += k;
+            identified += id;
+            if( verbose ) {
+                printf("    frame %6d level %d %-16s %8.3f ms, %d markers%s\n", n, report.level,
+                       report.config.name, report.time, k,
+                       (report.next != report.level)? ((report.next > report.level)? "  -> down": "  -> up"): "");
+            }
+        }
+    }
+    track = 0;
+
+    qsort( latency, total, sizeof(double), compare_double );
+    printf("    %d frames, frame p50 %.3f p95 %.3f max %.3f [ms], %.1f%% over budget\n",
+           total, latency[(int)(0.50*(total-1))], latency[(int)(0.95*(total-1))],
+           latency[total-1], 100.0 * over / total);
+    printf("    markers %.2f/frame, identified %.2f/frame\n",
+           (double)markers / total, (double)identified / total);
+    printf("    %-5s %-16s %8s %10s\n", "level", "settings", "frames", "mean[ms]");
+    for( l = 0; l < level_num; l++ ) {
+        c = arQualityGetConfig( q, l );
+        printf("    %-5d %-16s %8ld %10.3f\n", l, c->name, level_frames[l],
+               (level_frames[l] > 0)? level_time[l] / level_frames[l]: 0.0);
+    }
+
+    free( latency );
+    free( level_time );
+    free( level_frames );
+    arQualityDestroy( q );
+}
+
+typedef struct {
+    int       next;             /* next corpus frame to capture */
+    int       total;
+    int       *marker_num;      /* results of every frame */
+    ARPose    *pose;
+    double    stage_time[AR_PIPELINE_STAGE_NUM];
+} PipelineRun;
+
+/*
+ * The corpus replayed through the pipeline with 1 to pipeline_threads
+ * threads. The results of every frame are compared with the ones of the
+ * single thread run, which processes the frames one after the other.
+ */
+static void run_pipeline( int m )
+{
+    ARPipeline    *pipe;
+    ARPattSpec    spec[PATT_MAX];
+    PipelineRun   run, ref;
+    ARStatsTime   start;
+    double        elapsed, fps, fps1;
+    long          num;
+    int           diff;
+    int           i, n, t;
+
+    arImageProcMode        = mode_table[m].image_proc_mode;
+    arTemplateMatchingMode = mode_table[m].template_matching_mode;
+    arMatchingPCAMode      = AR_MATCHING_WITHOUT_PCA;
+    arStatsMode            = AR_STATS_DISABLE;
+
+    for( i = 0; i < patt_num; i++ ) {
+        spec[i].center[0] = patt_center[0];
+        spec[i].center[1] = patt_center[1];
+        spec[i].width     = patt_width;
+    }
+    run.total = ref.total = frame_num * repeat;
+    arMalloc( run.marker_num, int, run.total );
+    arMalloc( ref.marker_num, int, run.total );
+    arMalloc( run.pose, ARPose, run.total * patt_num + 1 );
+    arMalloc( ref.pose, ARPose, run.total * patt_num + 1 );
+
+    printf("\nmode %d %s: pipeline over %d frames, %d processors\n",
+           m, mode_table[m].name, run.total, arThreadGetCPUNum());
+    printf("    %-7s %10s %8s %10s %10s %10s %10s   %s\n", "threads", "fps", "speedup",
+           "capture", "label", "identify", "pose", "results");
+    fps1 = 0.0;
+    for( t = 1; t <= pipeline_threads; t++ ) {
+        if( (pipe = arPipelineCreate( t, 0, patt_num, patt_id, spec )) == NULL ) break;
+
+        /* warm-up pass, not recorded */
+        run.next = 0;
+        arPipelineRun( pipe, thresh, pipeline_source, NULL, &run );
+
+        run.next = 0;
+        for( i = 0; i < AR_PIPELINE_STAGE_NUM; i++ ) run.stage_time[i] = 0.0;
+        start = arStatsGetTime();
+        num = arPipelineRun( pipe, thresh, pipeline_source, pipeline_sink, &run );
+        elapsed = (arStatsGetTime() - start) * 1.0e-9;
+        arPipelineDestroy( pipe );
+        if( num != run.total ) break;
+
+        fps = num / elapsed;
+        if( t == 1 ) {
+            fps1 = fps;
+            memcpy( ref.marker_num, run.marker_num, run.total * sizeof(int) );
+            memcpy( ref.pose, run.pose, run.total * patt_num * sizeof(ARPose) );
+        }
+        diff = 0;
+        for( n = 0; n < run.total; n++ ) {
+            if( run.marker_num[n] != ref.marker_num[n] ) { diff++; continue; }
+            for( i = 0; i < patt_num; i++ ) {
+                if( run.pose[n*patt_num+i].visible != ref.pose[n*patt_num+i].visible ) break;
+                if( !run.pose[n*patt_num+i].visible ) continue;
+                if( memcmp( run.pose[n*patt_num+i].conv, ref.pose[n*patt_num+i].conv,
+                            sizeof(run.pose[n*patt_num+i].conv) ) != 0 ) break;
+            }
+            if( i < patt_num ) diff++;
+        }
+        printf("    %-7d %10.1f %8.2f %10.3f %10.3f %10.3f %10.3f   ", t, fps, fps / fps1,
+               run.stage_time[AR_PIPELINE_STAGE_CAPTURE] / num, run.stage_time[AR_PIPELINE_STAGE_LABEL] / num,
+               run.stage_time[AR_PIPELINE_STAGE_IDENTIFY] / num, run.stage_time[AR_PIPELINE_STAGE_POSE] / num);
+        if( t == 1 )        printf("reference\n");
+        else if( diff == 0 ) printf("identical\n");
+        else                printf("%d frames differ\n", diff);
+    }
+    if( t <= pipeline_threads ) printf("    pipeline error with %d threads\n", t);
+    printf("    stage times in ms/frame\n");
+
+    free( run.marker_num );
+    free( ref.marker_num );
+    free( run.pose );
+    free( ref.pose );
+}
+
+/* the capture of a frame: a copy out of the corpus */
+static int pipeline_source( void *arg, ARPipelineFrame *pframe )
+{
+    PipelineRun   *run = (PipelineRun *)arg;
+
+    if( run->next == run->total ) return 0;
+    memcpy( pframe->image, frame[run->next % frame_num], xsize*ysize*AR_PIX_SIZE_DEFAULT );
+    run->next++;
+
+    return 1;
+}
+
+static void pipeline_sink( void *arg, ARPipelineFrame *pframe )
+{
+    PipelineRun   *run = (PipelineRun *)arg;
+    int           i;
+
+    run->marker_num[pframe->seq] = pframe->marker_num;
+    for( i = 0; i < patt_num; i++ ) run->pose[pframe->seq*patt_num+i] = pframe->pose[i];
+    for( i = 0; i < AR_PIPELINE_STAGE_NUM; i++ ) run->stage_time[i] += pframe->stage_time[i];
+}
+
+/*
+ * Poses of the single markers are predicted from the frames up to n to
+ * the capture time of frame n+predict_ahead, and compared with the pose
+ * measured there. "hold" is the pose of frame n drawn unchanged, i.e.
+ * the error latency causes without prediction.
+ */
+static void run_predict( int m )
+{
+    static char     *method_name[3] = { "hold", "constant velocity", "constant acceleration" };
+    ARPosePredict   *pred[2];
+    ARMarkerInfo    *marker_info;
+    ARPose          *pose;
+    double          *trans_err[3], *rot_err[3];
+    double          predicted[3][4];
+    double          time, sum_t, sum_r;
+    int             marker_num, num;
+    int             i, j, k, n, p;
+
+    arImageProcMode        = mode_table[m].image_proc_mode;
+    arTemplateMatchingMode = mode_table[m].template_matching_mode;
+    arMatchingPCAMode      = AR_MATCHING_WITHOUT_PCA;
+    arStatsMode            = AR_STATS_DISABLE;
+    if( patt_num == 0 ) return;
+
+    arMalloc( pose, ARPose, frame_num * patt_num );
+    for( n = 0; n < frame_num; n++ ) {
+        for( i = 0; i < patt_num; i++ ) pose[n*patt_num+i].visible = 0;
+        if( lite ) {
+            if( arDetectMarkerLite(frame[n], thresh, &marker_info, &marker_num) < 0 ) continue;
+        }
+        else {
+            if( arDetectMarker(frame[n], thresh, &marker_info, &marker_num) < 0 ) continue;
+        }
+        for( i = 0; i < patt_num; i++ ) {
+            k = -1;
+            for( j = 0; j < marker_num; j++ ) {
+                if( marker_info[j].id != patt_id[i] ) continue;
+                if( k == -1 || marker_info[j].cf > marker_info[k].cf ) k = j;
+            }
+            if( k == -1 ) continue;
+            arGetTransMat( &marker_info[k], patt_center, patt_width, pose[n*patt_num+i].conv );
+            pose[n*patt_num+i].visible = 1;
+        }
+    }
+
+    pred[0] = arPosePredictCreate( patt_num, AR_POSE_PREDICT_CONSTANT_VELOCITY );
+    pred[1] = arPosePredictCreate( patt_num, AR_POSE_PREDICT_CONSTANT_ACCELERATION );
+    for( k = 0; k < 3; k++ ) {
+        arMalloc( trans_err[k], double, frame_num * patt_num );
+        arMalloc( rot_err[k], double, frame_num * patt_num );
+    }
+    num = 0;
+    for( n = 0; n < frame_num; n++ ) {
+        time = n / frame_rate;
+        for( i = 0; i < patt_num; i++ ) {
+            if( !pose[n*patt_num+i].visible ) continue;
+            arPosePredictAdd( pred[0], i, pose[n*patt_num+i].conv, time );
+            arPosePredictAdd( pred[1], i, pose[n*patt_num+i].conv, time );
+            if( n + predict_ahead >= frame_num ) continue;
+            p = (n + predict_ahead) * patt_num + i;
+            if( !pose[p].visible ) continue;
+
+            pose_error( pose[n*patt_num+i].conv, pose[p].conv, &trans_err[0][num], &rot_err[0][num] );
+            for( k = 0; k < 2; k++ ) {
+                arPosePredictGet( pred[k], i, (n + predict_ahead) / frame_rate, predicted );
+                pose_error( predicted, pose[p].conv, &trans_err[k+1][num], &rot_err[k+1][num] );
+            }
+            num++;
+        }
+    }
+
+    printf("\nmode %d %s: prediction %d frames (%.1f ms) ahead at %.1f fps, %d poses compared\n",
+           m, mode_table[m].name, predict_ahead, 1000.0 * predict_ahead / frame_rate, frame_rate, num);
+    if( num > 0 ) {
+        printf("    %-22s %12s %12s %12s %12s\n", "", "mean[mm]", "p95[mm]", "mean[deg]", "p95[deg]");
+        for( k = 0; k < 3; k++ ) {
+            sum_t = sum_r = 0.0;
+            for( j = 0; j < num; j++ ) {
+                sum_t += trans_err[k][j];
+                sum_r += rot_err[k][j];
+            }
+            qsort( trans_err[k], num, sizeof(double), compare_double );
+            qsort( rot_err[k], num, sizeof(double), compare_double );
+            printf("    %-22s %12.2f %12.2f %12.3f %12.3f\n", method_name[k],
+                   sum_t / num, trans_err[k][(int)(0.95*(num-1))],
+                   sum_r / num, rot_err[k][(int)(0.95*(num-1))]);
+        }
+    }
+
+    for( k = 0; k < 3; k++ ) {
+        free( trans_err[k] );
+        free( rot_err[k] );
+    }
+    arPosePredictDestroy( pred[0] );
+    arPosePredictDestroy( pred[1] );
+    free( pose );
+}
+
+/*
+ * The poses of the markers of an arGenScene corpus, with arPrecisionMode
+ * set to double, then to float, compared with the ground truth. A marker
+ * is found when a marker of its pattern is detected with its center less
+ * than a quarter of the marker size from the true one. The reprojection
+ * error is the mean distance between the true corners and the corners
+ * projected with the pose, through the camera and its distortion.
+ */
+static void run_accuracy( int m )
+{
+    static char     *precision_name[2] = { "double", "float" };
+    static int      precision_mode[2]  = { AR_PRECISION_DOUBLE, AR_PRECISION_FLOAT };
+    ARMarkerInfo    *marker_info;
+    TruthMarker     *t;
+    ARPose          *pose;
+    double          *err[2][3], *diff[2];
+    double          sum[3], cx, cy, d, dmin, size;
+    int             num[2], diff_num, marker_num;
+    int             i, j, k, n, p;
+
+    arImageProcMode        = mode_table[m].image_proc_mode;
+    arTemplateMatchingMode = mode_table[m].template_matching_mode;
+    arMatchingPCAMode      = AR_MATCHING_WITHOUT_PCA;
+    arStatsMode            = AR_STATS_DISABLE;
+
+    arMalloc( pose, ARPose, truth_num * 2 + 1 );
+    for( p = 0; p < 2; p++ ) {
+        for( k = 0; k < 3; k++ ) arMalloc( err[p][k], double, truth_num + 1 );
+        arMalloc( diff[p], double, truth_num + 1 );
+    }
+
+    for( p = 0; p < 2; p++ ) {
+        arPrecisionMode = precision_mode[p];
+        num[p] = 0;
+        for( n = i = 0; n < frame_num; n++ ) {
+            if( lite ) {
+                if( arDetectMarkerLite(frame[n], thresh, &marker_info, &marker_num) < 0 ) marker_num = 0;
+            }
+            else {
+                if( arDetectMarker(frame[n], thresh, &marker_info, &marker_num) < 0 ) marker_num = 0;
+            }
+            for( ; i < truth_num && truth[i].frame == n; i++ ) {
+                t = &truth[i];
+                pose[i*2+p].visible = 0;
+                if( t->patt < 0 ) continue;
+                cx = cy = 0.0;
+                for( j = 0; j < 4; j++ ) {
+                    cx += t->corner[j][0] * 0.25;
+                    cy += t->corner[j][1] * 0.25;
+                }
+                size = sqrt( (t->corner[0][0]-t->corner[2][0]) * (t->corner[0][0]-t->corner[2][0])
+                           + (t->corner[0][1]-t->corner[2][1]) * (t->corner[0][1]-t->corner[2][1]) );
+                k = -1;
+                dmin = size * 0.25;
+                for( j = 0; j < marker_num; j++ ) {
+                    if( marker_info[j].id != patt_id[t->patt] ) continue;
+                    d = sqrt( (marker_info[j].pos[0]-cx) * (marker_info[j].pos[0]-cx)
+                            + (marker_info[j].pos[1]-cy) * (marker_info[j].pos[1]-cy) );
+                    if( d < dmin ) { dmin = d; k = j; }
+                }
+                if( k == -1 ) continue;
+                arGetTransMat( &marker_info[k], patt_center, t->width, pose[i*2+p].conv );
+                pose[i*2+p].visible = 1;
+                pose_error( pose[i*2+p].conv, t->trans, &err[p][0][num[p]], &err[p][1][num[p]] );
+                err[p][2][num[p]] = reprojection_error( pose[i*2+p].conv, t->width, t->corner );
+                num[p]++;
+            }
+        }
+    }
+    arPrecisionMode = DEFAULT_PRECISION_MODE;
+
+    printf("\nmode %d %s: pose accuracy on %d markers of %s\n",
+           m, mode_table[m].name, truth_num, truth_name);
+    if( verbose ) {
+        printf("    %6s %-20s %11s %11s %11s %11s %11s %11s\n", "frame", "pattern",
+               "double[mm]", "[deg]", "[pixel]", "float[mm]", "[deg]", "[pixel]");
+    }
+    diff_num = 0;
+    num[0] = num[1] = 0;
+    for( i = 0; i < truth_num; i++ ) {
+        t = &truth[i];
+        if( verbose ) printf("    %6d %-20s", t->frame, (t->patt >= 0)? patt_file[t->patt]: "(not loaded)");
+        for( p = 0; p < 2; p++ ) {
+            if( !pose[i*2+p].visible ) {
+                if( verbose ) printf(" %11s %11s %11s", "-", "-", "-");
+                continue;
+            }
+            if( verbose ) printf(" %11.3f %11.4f %11.4f", err[p][0][num[p]], err[p][1][num[p]], err[p][2][num[p]]);
+            num[p]++;
+        }
+        if( verbose ) printf("\n");
+        if( pose[i*2+0].visible && pose[i*2+1].visible ) {
+            pose_error( pose[i*2+0].conv, pose[i*2+1].conv, &diff[0][diff_num], &diff[1][diff_num] );
+            diff_num++;
+        }
+    }
+
+    printf("    %-9s %6s %9s %9s %9s %9s %9s %9s %9s %9s\n", "precision", "found",
+           "mean[mm]", "p95[mm]", "max[mm]", "mean[deg]", "p95[deg]", "mean[px]", "p95[px]", "max[px]");
+    for( p = 0; p < 2; p++ ) {
+        printf("    %-9s %6d", precision_name[p], num[p]);
+        if( num[p] == 0 ) {
+            printf("\n");
+            continue;
+        }
+        for( k = 0; k < 3; k++ ) {
+            sum[k] = 0.0;
+            for( j = 0; j < num[p]; j++ ) sum[k] += err[p][k][j];
+            qsort( err[p][k], num[p], sizeof(double), compare_double );
+        }
+        printf(" %9.3f %9.3f %9.3f %9.4f %9.4f %9.4f %9.4f %9.4f\n",
+               sum[0] / num[p], err[p][0][(int)(0.95*(num[p]-1))], err[p][0][num[p]-1],
+               sum[1] / num[p], err[p][1][(int)(0.95*(num[p]-1))],
+               sum[2] / num[p], err[p][2][(int)(0.95*(num[p]-1))], err[p][2][num[p]-1]);
+    }
+    if( diff_num > 0 ) {
+        sum[0] = sum[1] = 0.0;
+        for( j = 0; j < diff_num; j++ ) {
+            sum[0] += diff[0][j];
+            sum[1] += diff[1][j];
+        }
+        qsort( diff[0], diff_num, sizeof(double), compare_double );
+        qsort( diff[1], diff_num, sizeof(double), compare_double );
+        printf("    float vs double on %d markers: mean %.4f max %.4f [mm], mean %.5f max %.5f [deg]\n",
+               diff_num, sum[0] / diff_num, diff[0][diff_num-1], sum[1] / diff_num, diff[1][diff_num-1]);
+    }
+
+    for( p = 0; p < 2; p++ ) {
+        for( k = 0; k < 3; k++ ) free( err[p][k] );
+        free( diff[p] );
+    }
+    free( pose );
+}
+
+/* mean distance of the true corners to the corners of the pose */
+static double reprojection_error( double trans[3][4], double width, double corner[4][2] )
+{
+    double    proj[3][4];
+    double    pos3d[4][2];
+    double    hx, hy, h, ix, iy, ox, oy;
+    double    e;
+    int       i;
+
+    pos3d[0][0] = patt_center[0] - width/2.0;  pos3d[0][1] = patt_center[1] + width/2.0;
+    pos3d[1][0] = patt_center[0] + width/2.0;  pos3d[1][1] = patt_center[1] + width/2.0;
+    pos3d[2][0] = patt_center[0] + width/2.0;  pos3d[2][1] = patt_center[1] - width/2.0;
+    pos3d[3][0] = patt_center[0] - width/2.0;  pos3d[3][1] = patt_center[1] - width/2.0;
+
+    arUtilMatMul( arParam.mat, trans, proj );
+    e = 0.0;
+    for( i = 0; i < 4; i++ ) {
+        hx = proj[0][0] * pos3d[i][0] + proj[0][1] * pos3d[i][1] + proj[0][3];
+        hy = proj[1][0] * pos3d[i][0] + proj[1][1] * pos3d[i][1] + proj[1][3];
+        h  = proj[2][0] * pos3d[i][0] + proj[2][1] * pos3d[i][1] + proj[2][3];
+        ix = hx / h;
+        iy = hy / h;
+        arParamIdeal2Observ( arParam.dist_factor, ix, iy, &ox, &oy );
+        e += sqrt( (ox - corner[i][0]) * (ox - corner[i][0]) + (oy - corner[i][1]) * (oy - corner[i][1]) );
+    }
+
+    return e / 4.0;
+}
+
+/*
+ * Ground truth written by arGenScene, one marker per line, in frame
+ * order. Patterns are matched to the loaded ones by file name.
+ */
+static int load_truth( char *filename )
+{
+    FILE          *fp;
+    TruthMarker   *t;
+    char          buf[1024], name[512];
+    double        *v;
+    int           n, i, k;
+
+    if( (fp = fopen(filename, "r")) == NULL ) {
+        printf("Cannot open %s\n", filename);
+        return -1;
+    }
+    n = 0;
+    while( fgets(buf, sizeof(buf), fp) != NULL ) {
+        if( buf[0] != '#' ) n++;
+    }
+    rewind( fp );
+    arMalloc( truth, TruthMarker, n + 1 );
+
+    truth_num = 0;
+    while( fgets(buf, sizeof(buf), fp) != NULL && truth_num < n ) {
+        if( buf[0] == '#' ) continue;
+        t = &truth[truth_num];
+        v = &(t->trans[0][0]);
+        if( sscanf(buf, "%d %511s %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf %lf"
+                        " %lf %lf %lf %lf %lf %lf %lf %lf",
+                   &t->frame, name, &t->width,
+                   &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9], &v[10], &v[11],
+                   &t->corner[0][0], &t->corner[0][1], &t->corner[1][0], &t->corner[1][1],
+                   &t->corner[2][0], &t->corner[2][1], &t->corner[3][0], &t->corner[3][1]) != 23
+         || (truth_num > 0 && t->frame < truth[truth_num-1].frame) ) {
+            printf("Ground truth format error: %s\n", filename);
+            fclose( fp );
+            return -1;
+        }
+        t->patt = -1;
+        for( i = 0; i < patt_num; i++ ) {
+            if( strcmp(patt_file[i], name) == 0 ) t->patt = i;
+        }
+        if( t->frame < frame_num ) truth_num++;
+    }
+    fclose( fp );
+
+    for( i = k = 0; i < truth_num; i++ ) {
+        if( truth[i].patt >= 0 ) k++;
+    }
+    printf("Ground truth: %d markers, %d of loaded patterns\n", truth_num, k);
+
+    return 0;
+}
+
+/* distance of the pattern origins and angle of the relative rotation */
+static void pose_error( double a[3][4], double b[3][4], double *trans_err, double *rot_err )
+{
+    double    d, c;
+    int       i, j;
+
+    d = c = 0.0;
+    for( i = 0; i < 3; i++ ) {
+        d += (a[i][3] - b[i][3]) * (a[i][3] - b[i][3]);
+        for( j = 0; j < 3; j++ ) c += a[i][j] * b[i][j];
+    }
+    c = (c - 1.0) * 0.5;
+    if( c >  1.0 ) c =  1.0;
+    if( c < -1.0 ) c = -1.0;
+    *trans_err = sqrt( d );
+    *rot_err   = acos( c ) * 180.0 / 3.141592653589793;
+}
+
+/* returns the number of detected squares */
+static int process_frame( ARUint8 *image, int *identified, int *multi_found )
+{
+    ARMarkerInfo   *marker_info;
+    int            marker_num;
+    double         trans[3][4];
+    int            i, j, k;
+
+    *identified  = 0;
+    *multi_found = 0;
+
+    if( track ) {
+        if( arTrackMarker(image, thresh, &marker_info, &marker_num) < 0 ) return 0;
+    }
+    else if( lite ) {
+        if( arDetectMarkerLite(image, thresh, &marker_info, &marker_num) < 0 ) return 0;
+    }
+    else {
+        if( arDetectMarker(image, thresh, &marker_info, &marker_num) < 0 ) return 0;
+    }
+
+    for( i = 0; i < patt_num; i++ ) {
+        k = -1;
+        for( j = 0; j < marker_num; j++ ) {
+            if( marker_info[j].id != patt_id[i] ) continue;
+            if( k == -1 || marker_info[j].cf > marker_info[k].cf ) k = j;
+        }
+        if( k == -1 ) continue;
+        arGetTransMat( &marker_info[k], patt_center, patt_width, trans );
+        (*identified)++;
+    }
+
+    if( config ) {
+        if( arMultiGetTransMat(marker_info, marker_num, config) >= 0 ) *multi_found = 1;
+    }
+
+    return marker_num;
+}
+
+static int load_corpus( char *path, int raw_xsize, int raw_ysize )
+{
+    struct stat     st;
+    DIR             *dir;
+    struct dirent   *ent;
+    char            **name;
+    char            *ext;
+    char            buf[1024];
+    int             name_num;
+    int             i;
+
+    if( stat(path, &st) < 0 ) {
+        printf("Cannot open %s\n", path);
+        return -1;
+    }
+    if( !S_ISDIR(st.st_mode) ) {
+        ext = strrchr( path, '.' );
+        if( ext && (strcmp(ext, ".ppm") == 0 || strcmp(ext, ".pgm") == 0) ) return load_pnm( path );
+        return load_raw( path, raw_xsize, raw_ysize );
+    }
+
+    if( (dir = opendir(path)) == NULL ) {
+        printf("Cannot open %s\n", path);
+        return -1;
+    }
+    arMalloc( name, char *, FRAME_MAX );
+    name_num = 0;
+    while( (ent = readdir(dir)) != NULL && name_num < FRAME_MAX ) {
+        ext = strrchr( ent->d_name, '.' );
+        if( ext == NULL || (strcmp(ext, ".ppm") != 0 && strcmp(ext, ".pgm") != 0) ) continue;
+        arMalloc( name[name_num], char, strlen(ent->d_name)+1 );
+        strcpy( name[name_num], ent->d_name );
+        name_num++;
+    }
+    closedir( dir );
+    qsort( name, name_num, sizeof(char *), compare_name );
+
+    for( i = 0; i < name_num; i++ ) {
+        snprintf( buf, sizeof(buf), "%s/%s", path, name[i] );
+        if( load_pnm( buf ) < 0 ) return -1;
+        free( name[i] );
+    }
+    free( name );
+
+    if( frame_num == 0 ) {
+        printf("No frames in %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+static int read_pnm_int( FILE *fp )
+{
+    int     c, v;
+
+    c = getc(fp);
+    for(;;) {
+        if( c == '#' ) {
+            while( c != '\n' && c != EOF ) c = getc(fp);
+        }
+        else if( c == ' ' || c == '\t' || c == '\n' || c == '\r' ) c = getc(fp);
+        else break;
+    }
+    if( c < '0' || c > '9' ) return -1;
+    for( v = 0; c >= '0' && c <= '9'; c = getc(fp) ) v = v*10 + (c - '0');
+
+    return v;
+}
+
+static int load_pnm( char *filename )
+{
+    FILE      *fp;
+    ARUint8   *rgb, *image;
+    char      magic[2];
+    int       w, h, maxval, chan;
+    int       i, ret;
+
+    if( (fp = fopen(filename, "rb")) == NULL ) {
+        printf("Cannot open %s\n", filename);
+        return -1;
+    }
+    if( fread(magic, 1, 2, fp) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6') ) {
+        printf("Not a binary PPM/PGM file: %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    chan   = (magic[1] == '6')? 3: 1;
+    w      = read_pnm_int( fp );
+    h      = read_pnm_int( fp );
+    maxval = read_pnm_int( fp );
+    if( w <= 0 || h <= 0 || maxval != 255 ) {
+        printf("Unsupported PPM/PGM header: %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    if( frame_num == 0 ) {
+        xsize = w;
+        ysize = h;
+    }
+    else if( w != xsize || h != ysize ) {
+        printf("Frame size mismatch: %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+
+    arMalloc( rgb, ARUint8, w*h*3 );
+    if( fread(rgb, chan, w*h, fp) != (size_t)(w*h) ) {
+        printf("Read error: %s\n", filename);
+        free( rgb );
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    if( chan == 1 ) {
+        for( i = w*h-1; i >= 0; i-- ) rgb[i*3+0] = rgb[i*3+1] = rgb[i*3+2] = rgb[i];
+    }
+
+    arMalloc( image, ARUint8, w*h*AR_PIX_SIZE_DEFAULT );
+    rgb_to_native( rgb, image, w*h );
+    free( rgb );
+
+    ret = add_frame( image );
+    if( ret < 0 ) free( image );
+    return ret;
+}
+
+static int load_raw( char *filename, int raw_xsize, int raw_ysize )
+{
+    FILE      *fp;
+    ARUint8   *image;
+    size_t    size;
+
+    if( raw_xsize <= 0 || raw_ysize <= 0 ) {
+        printf("Frame size of the raw file must be given with -s WxH\n");
+        return -1;
+    }
+    if( (fp = fopen(filename, "rb")) == NULL ) {
+        printf("Cannot open %s\n", filename);
+        return -1;
+    }
+    xsize = raw_xsize;
+    ysize = raw_ysize;
+    size  = (size_t)xsize * ysize * AR_PIX_SIZE_DEFAULT;
+
+    for(;;) {
+        arMalloc( image, ARUint8, size );
+        if( fread(image, 1, size, fp) != size ) {
+            free( image );
+            break;
+        }
+        if( add_frame( image ) < 0 ) {
+            free( image );
+            break;
+        }
+    }
+    fclose(fp);
+
+    if( frame_num == 0 ) {
+        printf("No complete frame in %s\n", filename);
+        return -1;
+    }
+    return 0;
+}
+
+static int add_frame( ARUint8 *image )
+{
+    if( frame_num == FRAME_MAX ) return -1;
+    if( frame == NULL ) arMalloc( frame, ARUint8 *, FRAME_MAX );
+    frame[frame_num++] = image;
+
+    return 0;
+}
+
+/* convert packed RGB to AR_DEFAULT_PIXEL_FORMAT */
+static void rgb_to_native( ARUint8 *rgb, ARUint8 *dst, int num )
+{
+    int     i;
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy) || (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
+    int     y0, y1, u, v, r, g, b;
+
+    for( i = 0; i+1 < num; i += 2, rgb += 6, dst += 4 ) {
+        y0 = ( 66*rgb[0] + 129*rgb[1] +  25*rgb[2] + 128) / 256 + 16;
+        y1 = ( 66*rgb[3] + 129*rgb[4] +  25*rgb[5] + 128) / 256 + 16;
+        r  = (rgb[0] + rgb[3]) / 2;
+        g  = (rgb[1] + rgb[4]) / 2;
+        b  = (rgb[2] + rgb[5]) / 2;
+        u  = (-38*r -  74*g + 112*b + 128) / 256 + 128;
+        v  = (112*r -  94*g -  18*b + 128) / 256 + 128;
+#  if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
+        dst[0] = u; dst[1] = y0; dst[2] = v; dst[3] = y1;
+#  else
+        dst[0] = y0; dst[1] = u; dst[2] = y1; dst[3] = v;
+#  endif
+    }
+#else
+    for( i = 0; i < num; i++, rgb += 3, dst += AR_PIX_SIZE_DEFAULT ) {
+#  if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGB)
+        dst[0] = rgb[0]; dst[1] = rgb[1]; dst[2] = rgb[2];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGR)
+        dst[0] = rgb[2]; dst[1] = rgb[1]; dst[2] = rgb[0];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
+        dst[0] = rgb[0]; dst[1] = rgb[1]; dst[2] = rgb[2]; dst[3] = 255;
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA)
+        dst[0] = rgb[2]; dst[1] = rgb[1]; dst[2] = rgb[0]; dst[3] = 255;
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
+        dst[0] = 255; dst[1] = rgb[2]; dst[2] = rgb[1]; dst[3] = rgb[0];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
+        dst[0] = 255; dst[1] = rgb[0]; dst[2] = rgb[1]; dst[3] = rgb[2];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO)
+        dst[0] = (rgb[0] + rgb[1] + rgb[2]) / 3;
+#  else
+#    error Unknown default pixel format defined in config.h
+#  endif
+    }
+#endif
+}
+
+static int compare_name( const void *a, const void *b )
+{
+    return strcmp( *(char * const *)a, *(char * const *)b );
+}
+
+static int compare_double( const void *a, const void *b )
+{
+    double  da = *(const double *)a;
+    double  db = *(const double *)b;
+
+    return (da > db) - (da < db);
+}
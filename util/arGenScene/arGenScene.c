@@ -0,0 +1,871 @@
+/*******************************************************
+ *
+ * arGenScene - synthetic marker-scene generator.
+ *
+ * Renders frames of square markers in random poses,
+ * projected through a real camera parameter and its
+ * lens distortion, over a cluttered background with
+ * lighting gradient, blur and sensor noise. Writes the
+ * frames in any AR_PIXEL_FORMAT together with the
+ * ground-truth pose and corners of every marker.
+ * With -m the frames form a sequence: the markers keep
+ * moving over a fixed background.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <AR/ar.h>
+#include <AR/param.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define   PATT_MAX         32
+#define   MARKER_MAX       AR_SQUARE_MAX
+#define   SIZE_MAX_X       4096
+#define   SIZE_MAX_Y       4096
+#define   GRID_STEP        4           /* step of the undistortion table [pixel] */
+#define   POSE_TRY_MAX     200
+#define   PAPER_RATIO      0.625       /* half size of the white paper / width  */
+#define   BLACK_LEVEL      20.0
+#define   WHITE_LEVEL      235.0
+#define   MOTION_PERIOD    60.0        /* frames of a swing around the home pose */
+
+typedef struct {
+    char    *name;
+    float   texel[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];    /* R, G, B */
+} ScenePatt;
+
+typedef struct {
+    int     patt;
+    double  trans[3][4];
+    double  hinv[3][3];                 /* ideal image -> marker plane */
+    double  corner[4][2];               /* observed image coordinates */
+    int     x0, y0, x1, y1;             /* bounding box of the paper */
+    double  w[3], v[3];                 /* angular and linear velocity per frame */
+    double  home[3][4];                 /* pose the motion swings around */
+} SceneMarker;
+
+typedef struct {
+    char    *name;
+    int     format;
+    int     pix_size;
+} SceneFormat;
+
+static SceneFormat format_table[] = {
+    { "rgb",  AR_PIXEL_FORMAT_RGB,  3 },
+    { "bgr",  AR_PIXEL_FORMAT_BGR,  3 },
+    { "rgba", AR_PIXEL_FORMAT_RGBA, 4 },
+    { "bgra", AR_PIXEL_FORMAT_BGRA, 4 },
+    { "abgr", AR_PIXEL_FORMAT_ABGR, 4 },
+    { "argb", AR_PIXEL_FORMAT_ARGB, 4 },
+    { "mono", AR_PIXEL_FORMAT_MONO, 1 },
+    { "2vuy", AR_PIXEL_FORMAT_2vuy, 2 },
+    { "uyvy", AR_PIXEL_FORMAT_UYVY, 2 },
+    { "yuvs", AR_PIXEL_FORMAT_yuvs, 2 },
+    { "yuy2", AR_PIXEL_FORMAT_YUY2, 2 }
+};
+#define   FORMAT_NUM       (int)(sizeof(format_table)/sizeof(format_table[0]))
+
+static char          *cparam_name = "data/camera_para.dat";
+static char          *out_name = "scene";
+static ScenePatt     patt[PATT_MAX];
+static int           patt_num = 0;
+static ARParam       cparam;
+static int           xsize = 0, ysize = 0;
+static int           frame_total = 100;
+static int           marker_max = 1;
+static double        marker_width = 80.0;
+static double        dist_min = 200.0, dist_max = 1000.0;
+static double        tilt_max = 60.0;
+static int           clutter_num = 20;
+static double        light = 0.3;
+static double        blur = 0.7;
+static double        noise = 2.0;
+static int           sample = 2;
+static int           write_pnm = 0;
+static SceneFormat   *format = NULL;
+static unsigned long seed = 1;
+static double        motion_rot = 0.0, motion_trans = 0.0;
+
+static float         *ideal = NULL;    /* undistortion table, 2 floats per node */
+static int           grid_x, grid_y;
+
+static void   usage( char *com );
+static int    load_patt( char *filename, ScenePatt *p );
+static void   make_ideal_table( void );
+static void   get_ideal( double ox, double oy, double *ix, double *iy );
+static int    make_marker( SceneMarker *m, SceneMarker *others, int num );
+static int    place_marker( SceneMarker *m, SceneMarker *others, int num );
+static int    move_marker( SceneMarker *m, SceneMarker *others, int num );
+static void   set_velocity( double *vec, double max, double change );
+static void   draw_background( float *image );
+static void   draw_marker( float *image, SceneMarker *m );
+static void   draw_lighting( float *image );
+static void   draw_blur( float *image );
+static void   draw_noise( float *image );
+static void   convert_frame( float *image, ARUint8 *dst );
+static double rnd( void );
+static double rnd_gauss( void );
+static void   mat_inv3( double a[3][3], double b[3][3] );
+
+int main( int argc, char *argv[] )
+{
+    ARParam       wparam;
+    SceneMarker   marker[MARKER_MAX];
+    FILE          *fp_raw = NULL, *fp_gt;
+    float         *image;
+    ARUint8       *out;
+    char          buf[512];
+    unsigned long scene_seed, bg_seed;
+    int           w = 0, h = 0;
+    int           num, num_max, f, i, j;
+
+    for( i = 1; i < argc; i++ ) {
+        if( strcmp(argv[i], "-c") == 0 && i+1 < argc )      cparam_name = argv[++i];
+        else if( strcmp(argv[i], "-o") == 0 && i+1 < argc ) out_name = argv[++i];
+        else if( strcmp(argv[i], "-p") == 0 && i+1 < argc ) {
+            if( patt_num == PATT_MAX || load_patt(argv[++i], &patt[patt_num]) < 0 ) exit(1);
+            patt_num++;
+        }
+        else if( strcmp(argv[i], "-s") == 0 && i+1 < argc ) {
+            if( sscanf(argv[++i], "%dx%d", &w, &h) != 2 ) usage(argv[0]);
+        }
+        else if( strcmp(argv[i], "-n") == 0 && i+1 < argc ) frame_total = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-k") == 0 && i+1 < argc ) marker_max = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-w") == 0 && i+1 < argc ) marker_width = atof(argv[++i]);
+        else if( strcmp(argv[i], "-d") == 0 && i+1 < argc ) {
+            if( sscanf(argv[++i], "%lf,%lf", &dist_min, &dist_max) != 2 ) usage(argv[0]);
+        }
+        else if( strcmp(argv[i], "-T") == 0 && i+1 < argc ) tilt_max = atof(argv[++i]);
+        else if( strcmp(argv[i], "-C") == 0 && i+1 < argc ) clutter_num = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-L") == 0 && i+1 < argc ) light = atof(argv[++i]);
+        else if( strcmp(argv[i], "-B") == 0 && i+1 < argc ) blur = atof(argv[++i]);
+        else if( strcmp(argv[i], "-N") == 0 && i+1 < argc ) noise = atof(argv[++i]);
+        else if( strcmp(argv[i], "-a") == 0 && i+1 < argc ) sample = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-S") == 0 && i+1 < argc ) seed = strtoul(argv[++i], NULL, 10);
+        else if( strcmp(argv[i], "-f") == 0 && i+1 < argc ) {
+            i++;
+            for( j = 0; j < FORMAT_NUM; j++ ) {
+                if( strcmp(argv[i], format_table[j].name) == 0 ) format = &format_table[j];
+            }
+            if( format == NULL ) usage(argv[0]);
+        }
+        else if( strcmp(argv[i], "-P") == 0 ) write_pnm = 1;
+        else if( strcmp(argv[i], "-m") == 0 && i+1 < argc ) {
+            if( sscanf(argv[++i], "%lf,%lf", &motion_rot, &motion_trans) != 2 ) usage(argv[0]);
+            motion_rot *= M_PI / 180.0;
+        }
+        else usage(argv[0]);
+    }
+    if( frame_total < 1 || marker_max < 0 || marker_max > MARKER_MAX || sample < 1
+     || dist_min <= 0.0 || dist_max < dist_min
+     || motion_rot < 0.0 || motion_trans < 0.0 ) usage(argv[0]);
+    if( seed == 0 ) seed = 1;
+    bg_seed = seed;
+    if( format == NULL ) {
+        for( j = 0; j < FORMAT_NUM; j++ ) {
+            if( format_table[j].format == AR_DEFAULT_PIXEL_FORMAT ) format = &format_table[j];
+        }
+    }
+    if( write_pnm && format->format != AR_PIXEL_FORMAT_MONO ) format = &format_table[0];
+
+    if( patt_num == 0 ) {
+        char  *def[] = { "data/patt.hiro", "data/patt.kanji",
+                         "data/multi/patt.a", "data/multi/patt.b", "data/multi/patt.c",
+                         "data/multi/patt.d", "data/multi/patt.f", "data/multi/patt.g" };
+        for( i = 0; i < (int)(sizeof(def)/sizeof(def[0])); i++ ) {
+            if( load_patt(def[i], &patt[patt_num]) < 0 ) exit(1);
+            patt_num++;
+        }
+    }
+
+    if( arParamLoad(cparam_name, 1, &wparam) < 0 ) {
+        printf("Camera parameter load error !! (%s)\n", cparam_name);
+        exit(1);
+    }
+    if( w == 0 ) {
+        w = wparam.xsize;
+        h = wparam.ysize;
+    }
+    if( w < 16 || h < 16 || w > SIZE_MAX_X || h > SIZE_MAX_Y || (w & 1) ) {
+        printf("Frame size must be even and between 16x16 and %dx%d\n", SIZE_MAX_X, SIZE_MAX_Y);
+        exit(1);
+    }
+    arParamChangeSize( &wparam, w, h, &cparam );
+    xsize = w;
+    ysize = h;
+    make_ideal_table();
+
+    arMalloc( image, float, xsize*ysize*3 );
+    arMalloc( out, ARUint8, xsize*ysize*format->pix_size );
+
+    if( !write_pnm ) {
+        sprintf( buf, "%s.raw", out_name );
+        if( (fp_raw = fopen(buf, "wb")) == NULL ) {
+            printf("Cannot open %s\n", buf);
+            exit(1);
+        }
+    }
+    sprintf( buf, "%s.txt", out_name );
+    if( (fp_gt = fopen(buf, "w")) == NULL ) {
+        printf("Cannot open %s\n", buf);
+        exit(1);
+    }
+    fprintf(fp_gt, "# arGenScene %dx%d %s camera %s\n", xsize, ysize, format->name, cparam_name);
+    fprintf(fp_gt, "# frame pattern width trans[3][4] corners[4][2]\n");
+    fprintf(fp_gt, "# corners: observed image coordinates of marker (-w/2,w/2) (w/2,w/2) (w/2,-w/2) (-w/2,-w/2)\n");
+
+    num = num_max = 0;
+    for( f = 0; f < frame_total; f++ ) {
+        if( motion_rot > 0.0 || motion_trans > 0.0 ) {
+            /* markers leaving the frame come back elsewhere */
+            if( f == 0 ) {
+                num_max = (marker_max > 0)? 1 + (int)(rnd() * marker_max): 0;
+                if( num_max > marker_max ) num_max = marker_max;
+            }
+            for( i = j = 0; i < num; i++ ) {
+                if( i != j ) marker[j] = marker[i];
+                if( move_marker( &marker[j], marker, j ) == 0 ) j++;
+            }
+            for( ; j < num_max; j++ ) {
+                if( make_marker( &marker[j], marker, j ) < 0 ) break;
+                set_velocity( marker[j].w, motion_rot, 1.0 );
+                set_velocity( marker[j].v, motion_trans, 1.0 );
+                memcpy( marker[j].home, marker[j].trans, sizeof(marker[j].home) );
+            }
+            num = j;
+        }
+        else {
+            num = (marker_max > 0)? 1 + (int)(rnd() * marker_max): 0;
+            if( num > marker_max ) num = marker_max;
+            for( i = j = 0; i < num; i++ ) {
+                if( make_marker( &marker[j], marker, j ) == 0 ) j++;
+            }
+            num = j;
+        }
+
+        if( motion_rot > 0.0 || motion_trans > 0.0 ) {
+            /* the same background in every frame of a sequence */
+            scene_seed = seed;
+            seed = bg_seed;
+            draw_background( image );
+            seed = scene_seed;
+        }
+        else {
+            draw_background( image );
+        }
+        for( i = 0; i < num; i++ ) draw_marker( image, &marker[i] );
+        draw_lighting( image );
+        draw_blur( image );
+        draw_noise( image );
+        convert_frame( image, out );
+
+        if( write_pnm ) {
+            sprintf( buf, "%s%05d.%s", out_name, f, (format->pix_size == 1)? "pgm": "ppm" );
+            if( (fp_raw = fopen(buf, "wb")) == NULL ) {
+                printf("Cannot open %s\n", buf);
+                exit(1);
+            }
+            fprintf(fp_raw, "P%c\n%d %d\n255\n", (format->pix_size == 1)? '5': '6', xsize, ysize);
+        }
+        if( fwrite(out, format->pix_size, xsize*ysize, fp_raw) != (size_t)(xsize*ysize) ) {
+            printf("Write error\n");
+            exit(1);
+        }
+        if( write_pnm ) fclose( fp_raw );
+
+        for( i = 0; i < num; i++ ) {
+            fprintf(fp_gt, "%d %s %.3f", f, patt[marker[i].patt].name, marker_width);
+            for( j = 0; j < 12; j++ ) fprintf(fp_gt, " %.9f", marker[i].trans[j/4][j%4]);
+            for( j = 0; j < 8; j++ ) fprintf(fp_gt, " %.4f", marker[i].corner[j/2][j%2]);
+            fprintf(fp_gt, "\n");
+        }
+    }
+
+    if( !write_pnm ) fclose( fp_raw );
+    fclose( fp_gt );
+    free( image );
+    free( out );
+    free( ideal );
+
+    return 0;
+}
+
+static void usage( char *com )
+{
+    printf("Usage: %s [options]\n", com);
+    printf("  -c <file>    camera parameter file (default data/camera_para.dat)\n");
+    printf("  -p <file>    pattern file, may be repeated (default data/patt.hiro,\n");
+    printf("               data/patt.kanji and data/multi/patt.a..g)\n");
+    printf("  -s <WxH>     frame size, up to %dx%d (default camera size)\n", SIZE_MAX_X, SIZE_MAX_Y);
+    printf("  -n <num>     number of frames (default 100)\n");
+    printf("  -k <num>     maximum number of markers per frame (default 1)\n");
+    printf("  -w <width>   marker width in mm (default 80)\n");
+    printf("  -d <min,max> marker distance range in mm (default 200,1000)\n");
+    printf("  -T <deg>     maximum marker tilt (default 60)\n");
+    printf("  -C <num>     number of clutter shapes (default 20)\n");
+    printf("  -L <ratio>   lighting gradient strength (default 0.3)\n");
+    printf("  -B <sigma>   blur sigma in pixels (default 0.7)\n");
+    printf("  -N <sigma>   noise sigma in grey levels (default 2.0)\n");
+    printf("  -a <num>     supersampling per axis (default 2)\n");
+    printf("  -f <format>  rgb bgr rgba bgra abgr argb mono 2vuy/uyvy yuvs/yuy2\n");
+    printf("               (default library pixel format)\n");
+    printf("  -S <seed>    random seed (default 1)\n");
+    printf("  -o <name>    output name (default scene): <name>.raw and <name>.txt\n");
+    printf("  -P           write <name>NNNNN.ppm (.pgm if mono) instead of <name>.raw\n");
+    printf("  -m <deg,mm>  sequence of moving markers, with maximum speeds per frame\n");
+    printf("               (default: independent frames)\n");
+    exit(1);
+}
+
+/*
+ * Pattern files hold 4 orientations of AR_PATT_SIZE_Y x AR_PATT_SIZE_X
+ * samples in blue, green and red planes. Orientation 0 is drawn with its
+ * first row along the marker's +Y edge and its first column at -X.
+ */
+static int load_patt( char *filename, ScenePatt *p )
+{
+    FILE    *fp;
+    int     c, x, y, v;
+
+    if( (fp = fopen(filename, "r")) == NULL ) {
+        printf("\"%s\" not found!!\n", filename);
+        return -1;
+    }
+    for( c = 0; c < 3; c++ ) {
+        for( y = 0; y < AR_PATT_SIZE_Y; y++ ) {
+            for( x = 0; x < AR_PATT_SIZE_X; x++ ) {
+                if( fscanf(fp, "%d", &v) != 1 ) {
+                    printf("Pattern Data read error!! (%s)\n", filename);
+                    fclose(fp);
+                    return -1;
+                }
+                p->texel[y][x][2-c] = (float)v;
+            }
+        }
+    }
+    fclose(fp);
+    p->name = filename;
+
+    return 0;
+}
+
+static void make_ideal_table( void )
+{
+    double  ix, iy;
+    int     i, j;
+
+    grid_x = xsize / GRID_STEP + 2;
+    grid_y = ysize / GRID_STEP + 2;
+    arMalloc( ideal, float, grid_x*grid_y*2 );
+    for( j = 0; j < grid_y; j++ ) {
+        for( i = 0; i < grid_x; i++ ) {
+            arParamObserv2Ideal( cparam.dist_factor, i*GRID_STEP, j*GRID_STEP, &ix, &iy );
+            ideal[(j*grid_x+i)*2+0] = (float)ix;
+            ideal[(j*grid_x+i)*2+1] = (float)iy;
+        }
+    }
+}
+
+static void get_ideal( double ox, double oy, double *ix, double *iy )
+{
+    double  fx, fy;
+    float   *p;
+    int     gx, gy;
+
+    fx = ox / GRID_STEP;
+    fy = oy / GRID_STEP;
+    gx = (int)floor(fx);
+    gy = (int)floor(fy);
+    if( gx < 0 ) gx = 0;
+    if( gy < 0 ) gy = 0;
+    if( gx > grid_x-2 ) gx = grid_x-2;
+    if( gy > grid_y-2 ) gy = grid_y-2;
+    fx -= gx;
+    fy -= gy;
+    p = &ideal[(gy*grid_x+gx)*2];
+    *ix = (1-fy)*((1-fx)*p[0] + fx*p[2]) + fy*((1-fx)*p[grid_x*2+0] + fx*p[grid_x*2+2]);
+    *iy = (1-fy)*((1-fx)*p[1] + fx*p[3]) + fy*((1-fx)*p[grid_x*2+1] + fx*p[grid_x*2+3]);
+}
+
+static void project( double trans[3][4], double x, double y, double *ox, double *oy )
+{
+    double  cx, cy, cz, ix, iy;
+
+    cx = trans[0][0]*x + trans[0][1]*y + trans[0][3];
+    cy = trans[1][0]*x + trans[1][1]*y + trans[1][3];
+    cz = trans[2][0]*x + trans[2][1]*y + trans[2][3];
+    ix = (cparam.mat[0][0]*cx + cparam.mat[0][1]*cy + cparam.mat[0][2]*cz) / cz;
+    iy = (cparam.mat[1][1]*cy + cparam.mat[1][2]*cz) / cz;
+    arParamIdeal2Observ( cparam.dist_factor, ix, iy, ox, oy );
+}
+
+/* random pose in front of the camera, fully visible and apart from the others */
+static int make_marker( SceneMarker *m, SceneMarker *others, int num )
+{
+    double  r[3][3], a[3][3];
+    double  ax, ay, tilt, phi, ct, st, cp, sp, z, u, v, yc, s;
+    int     cnt, i, j, k;
+
+    for( cnt = 0; cnt < POSE_TRY_MAX; cnt++ ) {
+        /* marker facing the camera: x right, y up, z towards the camera */
+        phi  = rnd() * 2.0 * M_PI;
+        tilt = rnd() * tilt_max * M_PI / 180.0;
+        s    = rnd() * 2.0 * M_PI;
+        ax = cos(s); ay = sin(s);
+        cp = cos(phi); sp = sin(phi);
+        ct = cos(tilt); st = sin(tilt);
+        a[0][0] = ct + ax*ax*(1-ct); a[0][1] = ax*ay*(1-ct);      a[0][2] = ay*st;
+        a[1][0] = ax*ay*(1-ct);      a[1][1] = ct + ay*ay*(1-ct); a[1][2] = -ax*st;
+        a[2][0] = -ay*st;            a[2][1] = ax*st;             a[2][2] = ct;
+        for( j = 0; j < 3; j++ ) {
+            r[j][0] =  a[j][0]*cp + a[j][1]*sp;
+            r[j][1] =  a[j][0]*sp - a[j][1]*cp;
+            r[j][2] = -a[j][2];
+        }
+
+        z  = dist_min + rnd() * (dist_max - dist_min);
+        u  = rnd() * xsize;
+        v  = rnd() * ysize;
+        yc = (v - cparam.mat[1][2]) / cparam.mat[1][1];
+        for( j = 0; j < 3; j++ ) {
+            for( i = 0; i < 3; i++ ) m->trans[j][i] = r[j][i];
+        }
+        m->trans[0][3] = ((u - cparam.mat[0][2]) / cparam.mat[0][0] - cparam.mat[0][1]*yc/cparam.mat[0][0]) * z;
+        m->trans[1][3] = yc * z;
+        m->trans[2][3] = z;
+        if( place_marker( m, others, num ) < 0 ) continue;
+
+        /* prefer patterns not yet in the frame */
+        m->patt = (int)(rnd() * patt_num);
+        for( i = 0; i < patt_num; i++ ) {
+            for( k = 0; k < num; k++ ) if( others[k].patt == m->patt ) break;
+            if( k == num ) break;
+            m->patt = (m->patt + 1) % patt_num;
+        }
+        return 0;
+    }
+
+    return -1;
+}
+
+/* bounding box, corners and homography of a pose; -1 if out of the frame or on another marker */
+static int place_marker( SceneMarker *m, SceneMarker *others, int num )
+{
+    double  h[3][3];
+    double  hw, pw, ox, oy, s;
+    int     i, j, k;
+
+    hw = marker_width / 2.0;
+    pw = marker_width * PAPER_RATIO;
+
+    /* paper outline, sampled along the edges because of the distortion */
+    m->x0 = xsize; m->y0 = ysize; m->x1 = -1; m->y1 = -1;
+    for( k = 0; k < 32; k++ ) {
+        s = -pw + 2.0*pw*(k%8)/8.0;
+        switch( k/8 ) {
+          case 0: project( m->trans,   s,  pw, &ox, &oy ); break;
+          case 1: project( m->trans,  pw,  -s, &ox, &oy ); break;
+          case 2: project( m->trans,  -s, -pw, &ox, &oy ); break;
+          default: project( m->trans, -pw,   s, &ox, &oy ); break;
+        }
+        if( ox < m->x0 ) m->x0 = (int)floor(ox);
+        if( oy < m->y0 ) m->y0 = (int)floor(oy);
+        if( ox > m->x1 ) m->x1 = (int)ceil(ox);
+        if( oy > m->y1 ) m->y1 = (int)ceil(oy);
+    }
+    m->x0 -= 2; m->y0 -= 2; m->x1 += 2; m->y1 += 2;
+    if( m->x0 < 2 || m->y0 < 2 || m->x1 > xsize-3 || m->y1 > ysize-3 ) return -1;
+    if( m->x1 - m->x0 < 24 || m->y1 - m->y0 < 24 ) return -1;
+    for( k = 0; k < num; k++ ) {
+        if( m->x0 <= others[k].x1 && others[k].x0 <= m->x1
+         && m->y0 <= others[k].y1 && others[k].y0 <= m->y1 ) break;
+    }
+    if( k < num ) return -1;
+
+    project( m->trans, -hw,  hw, &m->corner[0][0], &m->corner[0][1] );
+    project( m->trans,  hw,  hw, &m->corner[1][0], &m->corner[1][1] );
+    project( m->trans,  hw, -hw, &m->corner[2][0], &m->corner[2][1] );
+    project( m->trans, -hw, -hw, &m->corner[3][0], &m->corner[3][1] );
+
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 3; i++ ) {
+            h[j][i] = cparam.mat[j][0]*m->trans[0][(i==2)?3:i]
+                    + cparam.mat[j][1]*m->trans[1][(i==2)?3:i]
+                    + cparam.mat[j][2]*m->trans[2][(i==2)?3:i];
+        }
+    }
+    mat_inv3( h, m->hinv );
+
+    return 0;
+}
+
+/*
+ * one frame of motion: rotation about the marker center and translation,
+ * swinging around the home pose like a hand-held object, with velocities
+ * drifting at random. A marker about to leave the frame, the distance
+ * range or the tilt range turns back at once. -1 if it cannot move at all.
+ */
+static int move_marker( SceneMarker *m, SceneMarker *others, int num )
+{
+    SceneMarker  prev;
+    double       r[3][3], t[3][3], k[3];
+    double       theta, c, s, spring;
+    int          i, j;
+
+    /* pull back towards home: rotation vector of R R_home^T, translation */
+    spring = (2.0 * M_PI / MOTION_PERIOD) * (2.0 * M_PI / MOTION_PERIOD);
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 3; i++ ) {
+            r[j][i] = m->trans[j][0]*m->home[i][0] + m->trans[j][1]*m->home[i][1] + m->trans[j][2]*m->home[i][2];
+        }
+    }
+    c = (r[0][0] + r[1][1] + r[2][2] - 1.0) * 0.5;
+    if( c >  1.0 ) c =  1.0;
+    if( c < -1.0 ) c = -1.0;
+    theta = acos( c );
+    s = (theta > 1.0e-6)? theta / (2.0 * sin(theta)): 0.5;
+    m->w[0] -= spring * s * (r[2][1] - r[1][2]);
+    m->w[1] -= spring * s * (r[0][2] - r[2][0]);
+    m->w[2] -= spring * s * (r[1][0] - r[0][1]);
+    for( j = 0; j < 3; j++ ) m->v[j] -= spring * (m->trans[j][3] - m->home[j][3]);
+
+    set_velocity( m->w, motion_rot, 0.05 );
+    set_velocity( m->v, motion_trans, 0.05 );
+    prev = *m;
+
+    theta = sqrt( m->w[0]*m->w[0] + m->w[1]*m->w[1] + m->w[2]*m->w[2] );
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 3; i++ ) r[j][i] = (i == j)? 1.0: 0.0;
+    }
+    if( theta > 0.0 ) {
+        for( i = 0; i < 3; i++ ) k[i] = m->w[i] / theta;
+        c = cos(theta);
+        s = sin(theta);
+        for( j = 0; j < 3; j++ ) {
+            for( i = 0; i < 3; i++ ) r[j][i] = r[j][i] * c + k[j] * k[i] * (1.0 - c);
+        }
+        r[0][1] -= k[2]*s; r[1][0] += k[2]*s;
+        r[0][2] += k[1]*s; r[2][0] -= k[1]*s;
+        r[1][2] -= k[0]*s; r[2][1] += k[0]*s;
+    }
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 3; i++ ) {
+            t[j][i] = r[j][0]*m->trans[0][i] + r[j][1]*m->trans[1][i] + r[j][2]*m->trans[2][i];
+        }
+    }
+    for( j = 0; j < 3; j++ ) {
+        for( i = 0; i < 3; i++ ) m->trans[j][i] = t[j][i];
+        m->trans[j][3] += m->v[j];
+    }
+
+    if( m->trans[2][3] >= dist_min && m->trans[2][3] <= dist_max
+     && -m->trans[2][2] >= cos(tilt_max * M_PI / 180.0)
+     && place_marker( m, others, num ) == 0 ) return 0;
+
+    *m = prev;
+    for( i = 0; i < 3; i++ ) {
+        m->w[i] = -m->w[i];
+        m->v[i] = -m->v[i];
+    }
+    return place_marker( m, others, num );
+}
+
+/* random velocity of norm at most max; change is the fraction of max it may move by */
+static void set_velocity( double *vec, double max, double change )
+{
+    double  n;
+    int     i;
+
+    for( i = 0; i < 3; i++ ) vec[i] = ((change < 1.0)? vec[i]: 0.0) + change * max * rnd_gauss() / sqrt(3.0);
+    n = sqrt( vec[0]*vec[0] + vec[1]*vec[1] + vec[2]*vec[2] );
+    if( n > max && n > 0.0 ) {
+        for( i = 0; i < 3; i++ ) vec[i] *= max / n;
+    }
+}
+
+static void draw_background( float *image )
+{
+    double  c[3], c2[3], cx, cy, sx, sy, ca, sa, dx, dy, lx, ly;
+    float   *p;
+    int     type, x0, y0, x1, y1;
+    int     n, x, y, k;
+
+    for( k = 0; k < 3; k++ ) {
+        c[k]  = 60.0 + rnd() * 160.0;
+        c2[k] = 60.0 + rnd() * 160.0;
+    }
+    for( y = 0, p = image; y < ysize; y++ ) {
+        for( x = 0; x < xsize; x++, p += 3 ) {
+            for( k = 0; k < 3; k++ ) p[k] = (float)(c[k] + (c2[k] - c[k]) * y / ysize);
+        }
+    }
+
+    /* rectangles, ellipses and bars; dark ones act as false candidates */
+    for( n = 0; n < clutter_num; n++ ) {
+        type = (int)(rnd() * 3);
+        cx = rnd() * xsize;
+        cy = rnd() * ysize;
+        sx = (0.01 + rnd() * 0.12) * ysize;
+        sy = (type == 2)? (1.0 + rnd() * 3.0): (0.01 + rnd() * 0.12) * ysize;
+        ca = cos(rnd() * M_PI);
+        sa = sin(rnd() * M_PI);
+        if( rnd() < 0.4 ) {
+            for( k = 0; k < 3; k++ ) c[k] = rnd() * 50.0;
+        }
+        else {
+            for( k = 0; k < 3; k++ ) c[k] = rnd() * 255.0;
+        }
+        x0 = (int)(cx - sx - sy); x1 = (int)(cx + sx + sy) + 1;
+        y0 = (int)(cy - sx - sy); y1 = (int)(cy + sx + sy) + 1;
+        if( x0 < 0 ) x0 = 0;
+        if( y0 < 0 ) y0 = 0;
+        if( x1 > xsize ) x1 = xsize;
+        if( y1 > ysize ) y1 = ysize;
+        for( y = y0; y < y1; y++ ) {
+            for( x = x0; x < x1; x++ ) {
+                dx = x - cx;
+                dy = y - cy;
+                lx = ( ca*dx + sa*dy) / sx;
+                ly = (-sa*dx + ca*dy) / sy;
+                if( type == 1 ) {
+                    if( lx*lx + ly*ly > 1.0 ) continue;
+                }
+                else {
+                    if( fabs(lx) > 1.0 || fabs(ly) > 1.0 ) continue;
+                }
+                p = &image[(y*xsize+x)*3];
+                for( k = 0; k < 3; k++ ) p[k] = (float)c[k];
+            }
+        }
+    }
+}
+
+static void draw_marker( float *image, SceneMarker *m )
+{
+    ScenePatt   *pt = &patt[m->patt];
+    double      hw, iw, pw, ox, oy, ix, iy, d, mx, my;
+    double      acc[3];
+    float       *p;
+    int         cover, tx, ty;
+    int         x, y, i, j, k;
+
+    hw = marker_width / 2.0;
+    iw = marker_width / 4.0;
+    pw = marker_width * PAPER_RATIO;
+    for( y = m->y0; y <= m->y1; y++ ) {
+        for( x = m->x0; x <= m->x1; x++ ) {
+            acc[0] = acc[1] = acc[2] = 0.0;
+            cover = 0;
+            for( j = 0; j < sample; j++ ) {
+                for( i = 0; i < sample; i++ ) {
+                    ox = x - 0.5 + (i + 0.5) / sample;
+                    oy = y - 0.5 + (j + 0.5) / sample;
+                    get_ideal( ox, oy, &ix, &iy );
+                    d  = m->hinv[2][0]*ix + m->hinv[2][1]*iy + m->hinv[2][2];
+                    mx = (m->hinv[0][0]*ix + m->hinv[0][1]*iy + m->hinv[0][2]) / d;
+                    my = (m->hinv[1][0]*ix + m->hinv[1][1]*iy + m->hinv[1][2]) / d;
+                    if( fabs(mx) >= pw || fabs(my) >= pw ) continue;
+                    cover++;
+                    if( fabs(mx) < iw && fabs(my) < iw ) {
+                        tx = (int)((mx + iw) / (2.0*iw) * AR_PATT_SIZE_X);
+                        ty = (int)((iw - my) / (2.0*iw) * AR_PATT_SIZE_Y);
+                        if( tx >= AR_PATT_SIZE_X ) tx = AR_PATT_SIZE_X-1;
+                        if( ty >= AR_PATT_SIZE_Y ) ty = AR_PATT_SIZE_Y-1;
+                        for( k = 0; k < 3; k++ ) acc[k] += pt->texel[ty][tx][k];
+                    }
+                    else if( fabs(mx) < hw && fabs(my) < hw ) {
+                        for( k = 0; k < 3; k++ ) acc[k] += BLACK_LEVEL;
+                    }
+                    else {
+                        for( k = 0; k < 3; k++ ) acc[k] += WHITE_LEVEL;
+                    }
+                }
+            }
+            if( cover == 0 ) continue;
+            p = &image[(y*xsize+x)*3];
+            for( k = 0; k < 3; k++ ) {
+                p[k] = (float)((acc[k] + p[k] * (sample*sample - cover)) / (sample*sample));
+            }
+        }
+    }
+}
+
+static void draw_lighting( float *image )
+{
+    double  gain, gx, gy, a, g;
+    float   *p;
+    int     x, y, k;
+
+    gain = 1.0 - 0.3 * rnd();
+    a  = rnd() * 2.0 * M_PI;
+    gx = light * cos(a) / xsize;
+    gy = light * sin(a) / ysize;
+    for( y = 0, p = image; y < ysize; y++ ) {
+        for( x = 0; x < xsize; x++, p += 3 ) {
+            g = gain * (1.0 + gx*(x - xsize/2) + gy*(y - ysize/2));
+            for( k = 0; k < 3; k++ ) p[k] = (float)(p[k] * g);
+        }
+    }
+}
+
+static void draw_blur( float *image )
+{
+    float   *tmp, *kernel;
+    double  s, sum;
+    int     r, x, y, i, k, xx, yy;
+
+    if( blur <= 0.0 ) return;
+    r = (int)ceil(blur * 3.0);
+    arMalloc( kernel, float, 2*r+1 );
+    sum = 0.0;
+    for( i = -r; i <= r; i++ ) {
+        kernel[i+r] = (float)exp(-0.5 * i*i / (blur*blur));
+        sum += kernel[i+r];
+    }
+    for( i = 0; i <= 2*r; i++ ) kernel[i] = (float)(kernel[i] / sum);
+
+    arMalloc( tmp, float, xsize*ysize*3 );
+    for( y = 0; y < ysize; y++ ) {
+        for( x = 0; x < xsize; x++ ) {
+            for( k = 0; k < 3; k++ ) {
+                s = 0.0;
+                for( i = -r; i <= r; i++ ) {
+                    xx = x + i;
+                    if( xx < 0 ) xx = 0;
+                    if( xx >= xsize ) xx = xsize-1;
+                    s += kernel[i+r] * image[(y*xsize+xx)*3+k];
+                }
+                tmp[(y*xsize+x)*3+k] = (float)s;
+            }
+        }
+    }
+    for( y = 0; y < ysize; y++ ) {
+        for( x = 0; x < xsize; x++ ) {
+            for( k = 0; k < 3; k++ ) {
+                s = 0.0;
+                for( i = -r; i <= r; i++ ) {
+                    yy = y + i;
+                    if( yy < 0 ) yy = 0;
+                    if( yy >= ysize ) yy = ysize-1;
+                    s += kernel[i+r] * tmp[(yy*xsize+x)*3+k];
+                }
+                image[(y*xsize+x)*3+k] = (float)s;
+            }
+        }
+    }
+    free( tmp );
+    free( kernel );
+}
+
+static void draw_noise( float *image )
+{
+    int     i;
+
+    if( noise <= 0.0 ) return;
+    for( i = 0; i < xsize*ysize*3; i++ ) image[i] += (float)(noise * rnd_gauss());
+}
+
+static int clamp8( double v )
+{
+    if( v < 0.0 ) return 0;
+    if( v > 255.0 ) return 255;
+    return (int)(v + 0.5);
+}
+
+static void convert_frame( float *image, ARUint8 *dst )
+{
+    float   *p;
+    int     r, g, b, r2, g2, b2, y0, y1, u, v;
+    int     i;
+
+    for( i = 0, p = image; i < xsize*ysize; i++, p += 3 ) {
+        r = clamp8(p[0]);
+        g = clamp8(p[1]);
+        b = clamp8(p[2]);
+        switch( format->format ) {
+          case AR_PIXEL_FORMAT_RGB:
+            dst[0] = r; dst[1] = g; dst[2] = b; dst += 3; break;
+          case AR_PIXEL_FORMAT_BGR:
+            dst[0] = b; dst[1] = g; dst[2] = r; dst += 3; break;
+          case AR_PIXEL_FORMAT_RGBA:
+            dst[0] = r; dst[1] = g; dst[2] = b; dst[3] = 255; dst += 4; break;
+          case AR_PIXEL_FORMAT_BGRA:
+            dst[0] = b; dst[1] = g; dst[2] = r; dst[3] = 255; dst += 4; break;
+          case AR_PIXEL_FORMAT_ABGR:
+            dst[0] = 255; dst[1] = b; dst[2] = g; dst[3] = r; dst += 4; break;
+          case AR_PIXEL_FORMAT_ARGB:
+            dst[0] = 255; dst[1] = r; dst[2] = g; dst[3] = b; dst += 4; break;
+          case AR_PIXEL_FORMAT_MONO:
+            dst[0] = (r + g + b) / 3; dst += 1; break;
+          default:
+            /* 4:2:2, one chroma pair per two pixels (BT.601) */
+            i++;
+            p += 3;
+            r2 = clamp8(p[0]);
+            g2 = clamp8(p[1]);
+            b2 = clamp8(p[2]);
+            y0 = (( 66*r  + 129*g  +  25*b  + 128) >> 8) + 16;
+            y1 = (( 66*r2 + 129*g2 +  25*b2 + 128) >> 8) + 16;
+            r = (r + r2) / 2; g = (g + g2) / 2; b = (b + b2) / 2;
+            u = ((-38*r -  74*g + 112*b + 128) >> 8) + 128;
+            v = ((112*r -  94*g -  18*b + 128) >> 8) + 128;
+            if( format->format == AR_PIXEL_FORMAT_2vuy ) {
+                dst[0] = u; dst[1] = y0; dst[2] = v; dst[3] = y1;
+            }
+            else {
+                dst[0] = y0; dst[1] = u; dst[2] = y1; dst[3] = v;
+            }
+            dst += 4;
+            break;
+        }
+    }
+}
+
+/* xorshift, so that a seed gives the same scenes on every platform */
+static double rnd( void )
+{
+    seed ^= (seed << 13) & 0xffffffffUL;
+    seed ^= (seed >> 17);
+    seed ^= (seed << 5) & 0xffffffffUL;
+    seed &= 0xffffffffUL;
+    return (seed & 0xffffffUL) / (double)0x1000000UL;
+}
+
+static double rnd_gauss( void )
+{
+    double  u1, u2;
+
+    do {
+        u1 = rnd();
+    } while( u1 <= 0.0 );
+    u2 = rnd();
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static void mat_inv3( double a[3][3], double b[3][3] )
+{
+    double  d;
+
+    b[0][0] = a[1][1]*a[2][2] - a[1][2]*a[2][1];
+    b[0][1] = a[0][2]*a[2][1] - a[0][1]*a[2][2];
+    b[0][2] = a[0][1]*a[1][2] - a[0][2]*a[1][1];
+    b[1][0] = a[1][2]*a[2][0] - a[1][0]*a[2][2];
+    b[1][1] = a[0][0]*a[2][2] - a[0][2]*a[2][0];
+    b[1][2] = a[0][2]*a[1][0] - a[0][0]*a[1][2];
+    b[2][0] = a[1][0]*a[2][1] - a[1][1]*a[2][0];
+    b[2][1] = a[0][1]*a[2][0] - a[0][0]*a[2][1];
+    b[2][2] = a[0][0]*a[1][1] - a[0][1]*a[1][0];
+    d = a[0][0]*b[0][0] + a[0][1]*b[1][0] + a[0][2]*b[2][0];
+    b[0][0] /= d; b[0][1] /= d; b[0][2] /= d;
+    b[1][0] /= d; b[1][1] /= d; b[1][2] /= d;
+    b[2][0] /= d; b[2][1] /= d; b[2][2] /= d;
+}
@@ -0,0 +1,741 @@
+/*******************************************************
+ *
+ * arKernelBench - microbenchmarks of the libAR kernels.
+ *
+ * Runs each kernel of the detection and pose pipeline
+ * on fixed inputs taken from one frame, with warm-up
+ * and repeated timed samples, and reports the mean and
+ * percentiles per call. Results can also be written as
+ * CSV, to compare runs before and after a change.
+ *
+ * Revision: 1.0
+ * Date: 26/10/18
+ *
+*******************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <AR/ar.h>
+#include <AR/param.h>
+#include <AR/matrix.h>
+#include <AR/arStats.h>
+#include <AR/arColorConv.h>
+#include <AR/arThread.h>
+
+#define   SAMPLE_MAX       100000
+#define   SAMPLE_TIME      20000       /* minimum length of a timed sample [ns] */
+#define   POINT_NUM        64
+#define   INV_DIM          8
+#define   CAND_MAX         100
+
+typedef struct {
+    char    name[32];
+    char    param[32];
+    int     samples;
+    int     batch;
+    double  mean, p50, p95, p99, max;
+} KernelResult;
+
+static char          *cparam_name = "data/camera_para.dat";
+static char          *image_name = NULL;
+static char          *patt_name = "data/patt.hiro";
+static char          *csv_name = NULL;
+static char          *filter = NULL;
+static int           thresh = 100;
+static int           warmup = 20;
+static int           repeat = 200;
+
+static ARParam       cparam;
+static int           xsize, ysize;
+static ARUint8       *image;
+static ARStatsTime   *sample;
+
+/* fixed inputs of the kernels */
+static ARInt16       *limage;
+static int           label_num, *label_ref, *warea, *wclip;
+static double        *wpos;
+static int           contour_label;
+static ARMarkerInfo2 marker2;
+static ARMarkerInfo  marker;
+static double        marker_center[2] = {0.0, 0.0};
+static double        marker_width = 80.0;
+static double        init_rot[3][3], init_trans[3];
+static double        pos3d[4][3], pos2d[4][2];
+static double        point[POINT_NUM][2];
+static float         dist_factorf[4];
+static ARMat         *pca_input, *pca_work, *pca_evec;
+static ARVec         *pca_ev, *pca_mean;
+static ARMat         *inv_input, *inv_work;
+static ARUint8       *conv_src, *conv_dst;
+static int           conv_format;
+static ARMarkerInfo2 *cand;
+static ARMarkerInfo  cand_info[CAND_MAX];
+static int           cand_num;
+
+static FILE          *fp_csv = NULL;
+
+static void   usage( char *com );
+static int    load_image( char *filename );
+static void   make_image( void );
+static int    setup( void );
+static void   bench( char *name, char *param, void (*func)(void) );
+static void   bench_stage( char *name, char *param, void (*func)(void), int stage );
+static void   report( KernelResult *r );
+static void   rgb_to_native( ARUint8 *rgb, ARUint8 *dst, int num );
+static int    compare_time( const void *a, const void *b );
+
+static void   k_labeling( void );
+static void   k_contour( void );
+static void   k_detect2( void );
+static void   k_get_line( void );
+static void   k_get_patt( void );
+static void   k_get_code( void );
+static void   k_trans_mat( void );
+static void   k_modify_matrix( void );
+static void   k_observ2ideal( void );
+static void   k_observ2idealf( void );
+static void   k_pca( void );
+static void   k_self_inv( void );
+static void   k_color_conv( void );
+static void   k_marker_info( void );
+static void   k_marker_info_parallel( void );
+
+int main( int argc, char *argv[] )
+{
+    static int    patt_count[] = { 1, 8, AR_PATT_NUM_MAX };
+    static char   *match_name[] = { "color", "color/pca", "bw", "bw/pca" };
+    static char   *conv_name[] = { "yuv420p", "yuv420i", "yuyv", "uyvy", "yuv411", "yuv444", "mono" };
+    static int    cand_count[] = { 20, 50, CAND_MAX };
+    ARParam       wparam;
+    char          buf[32];
+    int           i, j, k, m;
+
+    for( i = 1; i < argc; i++ ) {
+        if( strcmp(argv[i], "-c") == 0 && i+1 < argc )      cparam_name = argv[++i];
+        else if( strcmp(argv[i], "-i") == 0 && i+1 < argc ) image_name = argv[++i];
+        else if( strcmp(argv[i], "-p") == 0 && i+1 < argc ) patt_name = argv[++i];
+        else if( strcmp(argv[i], "-t") == 0 && i+1 < argc ) thresh = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-w") == 0 && i+1 < argc ) warmup = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-r") == 0 && i+1 < argc ) repeat = atoi(argv[++i]);
+        else if( strcmp(argv[i], "-k") == 0 && i+1 < argc ) filter = argv[++i];
+        else if( strcmp(argv[i], "-o") == 0 && i+1 < argc ) csv_name = argv[++i];
+        else usage(argv[0]);
+    }
+    if( warmup < 0 || repeat < 1 || repeat > SAMPLE_MAX ) usage(argv[0]);
+
+    if( arParamLoad(cparam_name, 1, &wparam) < 0 ) {
+        printf("Camera parameter load error !! (%s)\n", cparam_name);
+        exit(1);
+    }
+    xsize = wparam.xsize;
+    ysize = wparam.ysize;
+    if( image_name != NULL ) {
+        if( load_image(image_name) < 0 ) exit(1);
+    }
+    arParamChangeSize( &wparam, xsize, ysize, &cparam );
+    arInitCparam( &cparam );
+    for( i = 0; i < 4; i++ ) dist_factorf[i] = (float)cparam.dist_factor[i];
+    if( image_name == NULL ) make_image();
+
+    if( arLoadPatt(patt_name) < 0 ) {
+        printf("Pattern load error !! (%s)\n", patt_name);
+        exit(1);
+    }
+    if( setup() < 0 ) exit(1);
+    arMalloc( sample, ARStatsTime, repeat );
+
+    if( csv_name != NULL ) {
+        if( (fp_csv = fopen(csv_name, "w")) == NULL ) {
+            printf("Cannot open %s\n", csv_name);
+            exit(1);
+        }
+        fprintf(fp_csv, "kernel,param,samples,batch,mean_ns,p50_ns,p95_ns,p99_ns,max_ns\n");
+    }
+
+    printf("Input: %s %dx%d, threshold %d, marker contour %d points\n",
+           (image_name != NULL)? image_name: "built-in frame", xsize, ysize, thresh, marker2.coord_num);
+    printf("Warm-up %d, samples %d; times are per call [ns]\n\n", warmup, repeat);
+    printf("%-20s %-12s %8s %7s %11s %11s %11s %11s %11s\n",
+           "kernel", "param", "samples", "batch", "mean", "p50", "p95", "p99", "max");
+
+    arImageProcMode = AR_IMAGE_PROC_IN_HALF;
+    bench( "arLabeling", "half", k_labeling );
+    arImageProcMode = AR_IMAGE_PROC_IN_FULL;
+    bench( "arLabeling", "full", k_labeling );
+
+    /* labeling of the full frame is the input of the contour kernels */
+    limage = arLabeling( image, thresh, &label_num, &warea, &wpos, &wclip, &label_ref );
+    bench( "arGetContour", "full", k_contour );
+    bench_stage( "check_square", "full", k_detect2, AR_STATS_CHECK_SQUARE );
+
+    for( m = AR_PRECISION_DOUBLE; m <= AR_PRECISION_FLOAT; m++ ) {
+        arPrecisionMode = m;
+        sprintf( buf, "%s", (m == AR_PRECISION_DOUBLE)? "double": "float" );
+        bench( "arGetLine", buf, k_get_line );
+        bench( "arGetPatt", buf, k_get_patt );
+        bench( "arGetTransMat", buf, k_trans_mat );
+        bench( "arModifyMatrix", buf, k_modify_matrix );
+    }
+    arPrecisionMode = DEFAULT_PRECISION_MODE;
+
+    for( k = 0; k < (int)(sizeof(patt_count)/sizeof(patt_count[0])); k++ ) {
+        for( i = 0; i < AR_PATT_NUM_MAX; i++ ) arFreePatt( i );
+        for( i = 0; i < patt_count[k]; i++ ) {
+            if( arLoadPatt(patt_name) < 0 ) exit(1);
+        }
+        for( j = 0; j < 4; j++ ) {
+            arTemplateMatchingMode = (j < 2)? AR_TEMPLATE_MATCHING_COLOR: AR_TEMPLATE_MATCHING_BW;
+            arMatchingPCAMode = (j & 1)? AR_MATCHING_WITH_PCA: AR_MATCHING_WITHOUT_PCA;
+            sprintf( buf, "%d/%s", patt_count[k], match_name[j] );
+            bench_stage( "pattern_match", buf, k_get_code, AR_STATS_PATTERN_MATCH );
+        }
+    }
+    arTemplateMatchingMode = DEFAULT_TEMPLATE_MATCHING_MODE;
+    arMatchingPCAMode = DEFAULT_MATCHING_PCA_MODE;
+
+    /* a frame of candidates, all copies of the marker: serial, then on the shared pool */
+    for( i = 0; i < AR_PATT_NUM_MAX; i++ ) arFreePatt( i );
+    if( arLoadPatt(patt_name) < 0 ) exit(1);
+    for( k = 0; k < (int)(sizeof(cand_count)/sizeof(cand_count[0])); k++ ) {
+        cand_num = cand_count[k];
+        sprintf( buf, "%d/serial", cand_num );
+        bench( "arGetMarkerInfo", buf, k_marker_info );
+        sprintf( buf, "%d/%dthreads", cand_num, arThreadPoolGetThreadNum( arThreadPoolGetDefault() ) + 1 );
+        bench( "arGetMarkerInfo", buf, k_marker_info_parallel );
+    }
+
+    bench( "arParamObserv2Ideal", "double", k_observ2ideal );
+    bench( "arParamObserv2Ideal", "float", k_observ2idealf );
+    sprintf( buf, "%dx2", pca_input->row );
+    bench( "arMatrixPCA", buf, k_pca );
+    sprintf( buf, "%dx%d", INV_DIM, INV_DIM );
+    bench( "arMatrixSelfInv", buf, k_self_inv );
+
+    for( i = AR_COLOR_YUV420P; i <= AR_COLOR_MONO; i++ ) {
+        conv_format = i;
+        sprintf( buf, "%s/%s", conv_name[i], arColorConvGetSIMD() );
+        bench( "arColorConvert", buf, k_color_conv );
+    }
+
+    if( fp_csv != NULL ) fclose( fp_csv );
+    free( sample );
+    free( image );
+    free( conv_src );
+    free( conv_dst );
+    free( cand );
+
+    return 0;
+}
+
+static void usage( char *com )
+{
+    printf("Usage: %s [options]\n", com);
+    printf("  -c <file>   camera parameter file (default data/camera_para.dat)\n");
+    printf("  -i <file>   input frame (.ppm), default a built-in frame\n");
+    printf("  -p <file>   pattern of the marker in the frame (default data/patt.hiro)\n");
+    printf("  -t <thresh> binarization threshold (default 100)\n");
+    printf("  -w <num>    warm-up samples per kernel (default 20)\n");
+    printf("  -r <num>    timed samples per kernel (default 200)\n");
+    printf("  -k <name>   run only the kernels whose name contains <name>\n");
+    printf("  -o <file>   also write the results as CSV\n");
+    exit(1);
+}
+
+/*
+ * Each sample times a batch of calls long enough for the clock, and
+ * reports the time per call. The batch size is found after warm-up.
+ */
+static void bench( char *name, char *param, void (*func)(void) )
+{
+    KernelResult   r;
+    ARStatsTime    t;
+    double         sum;
+    int            batch, i, j;
+
+    if( filter != NULL && strstr(name, filter) == NULL ) return;
+
+    for( i = 0; i < warmup; i++ ) (*func)();
+    batch = 1;
+    for(;;) {
+        t = arStatsGetTime();
+        for( j = 0; j < batch; j++ ) (*func)();
+        t = arStatsGetTime() - t;
+        if( t >= SAMPLE_TIME || batch >= (1 << 20) ) break;
+        batch *= 2;
+    }
+
+    for( i = 0; i < repeat; i++ ) {
+        t = arStatsGetTime();
+        for( j = 0; j < batch; j++ ) (*func)();
+        sample[i] = arStatsGetTime() - t;
+    }
+    qsort( sample, repeat, sizeof(ARStatsTime), compare_time );
+
+    strncpy( r.name, name, sizeof(r.name)-1 );   r.name[sizeof(r.name)-1] = '\0';
+    strncpy( r.param, param, sizeof(r.param)-1 ); r.param[sizeof(r.param)-1] = '\0';
+    r.samples = repeat;
+    r.batch = batch;
+    sum = 0.0;
+    for( i = 0; i < repeat; i++ ) sum += (double)sample[i];
+    r.mean = sum / repeat / batch;
+    r.p50  = (double)sample[(int)ceil(0.50 * repeat) - 1] / batch;
+    r.p95  = (double)sample[(int)ceil(0.95 * repeat) - 1] / batch;
+    r.p99  = (double)sample[(int)ceil(0.99 * repeat) - 1] / batch;
+    r.max  = (double)sample[repeat-1] / batch;
+    report( &r );
+}
+
+/*
+ * Kernels that are internal to the library are timed by the per-stage
+ * instrumentation while their caller runs; each sample is then one call.
+ */
+static void bench_stage( char *name, char *param, void (*func)(void), int stage )
+{
+    KernelResult   r;
+    ARStats        stats;
+    int            mode, i;
+
+    if( filter != NULL && strstr(name, filter) == NULL ) return;
+
+    mode = arStatsMode;
+    arStatsMode = AR_STATS_ENABLE;
+    for( i = 0; i < warmup; i++ ) (*func)();
+    arResetStats();
+    for( i = 0; i < repeat; i++ ) (*func)();
+    arStatsMode = mode;
+    if( arGetStats( &stats ) < 0 ) {
+        printf("%-20s %-12s skipped (AR_STATS is not defined in config.h)\n", name, param);
+        return;
+    }
+
+    strncpy( r.name, name, sizeof(r.name)-1 );   r.name[sizeof(r.name)-1] = '\0';
+    strncpy( r.param, param, sizeof(r.param)-1 ); r.param[sizeof(r.param)-1] = '\0';
+    r.samples = stats.stage[stage].count;
+    r.batch = 1;
+    r.mean = stats.stage[stage].mean;
+    r.p50  = stats.stage[stage].p50;
+    r.p95  = stats.stage[stage].p95;
+    r.p99  = stats.stage[stage].p99;
+    r.max  = stats.stage[stage].max;
+    report( &r );
+}
+
+static void report( KernelResult *r )
+{
+    printf("%-20s %-12s %8d %7d %11.1f %11.1f %11.1f %11.1f %11.1f\n",
+           r->name, r->param, r->samples, r->batch, r->mean, r->p50, r->p95, r->p99, r->max);
+    fflush(stdout);
+    if( fp_csv != NULL ) {
+        fprintf(fp_csv, "%s,%s,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f\n",
+                r->name, r->param, r->samples, r->batch, r->mean, r->p50, r->p95, r->p99, r->max);
+    }
+}
+
+static int compare_time( const void *a, const void *b )
+{
+    ARStatsTime   ta = *(const ARStatsTime *)a;
+    ARStatsTime   tb = *(const ARStatsTime *)b;
+
+    return (ta > tb) - (ta < tb);
+}
+
+/*
+ * Derive the fixed inputs from one detection of the marker in the frame.
+ */
+static int setup( void )
+{
+    ARMarkerInfo2   *mi2;
+    ARMarkerInfo    *mi;
+    double          conv[3][4], d, dmin;
+    int             mi2_num, mi_num, dir;
+    int             i, j, k, st, n;
+
+    arImageProcMode = AR_IMAGE_PROC_IN_FULL;
+    if( arDetectMarker(image, thresh, &mi, &mi_num) < 0 ) return -1;
+    k = -1;
+    for( i = 0; i < mi_num; i++ ) {
+        if( mi[i].id == 0 && (k == -1 || mi[i].cf > mi[k].cf) ) k = i;
+    }
+    if( k == -1 ) {
+        printf("Marker %s not found in the frame\n", patt_name);
+        return -1;
+    }
+    marker = mi[k];
+
+    limage = arLabeling( image, thresh, &label_num, &warea, &wpos, &wclip, &label_ref );
+    mi2 = arDetectMarker2( limage, label_num, label_ref, warea, wpos, wclip,
+                           AR_AREA_MAX, AR_AREA_MIN, 1.0, &mi2_num );
+    dmin = -1.0;
+    for( i = 0; i < mi2_num; i++ ) {
+        d = (mi2[i].pos[0] - marker.pos[0]) * (mi2[i].pos[0] - marker.pos[0])
+          + (mi2[i].pos[1] - marker.pos[1]) * (mi2[i].pos[1] - marker.pos[1]);
+        if( dmin < 0.0 || d < dmin ) {
+            dmin = d;
+            marker2 = mi2[i];
+        }
+    }
+    contour_label = 0;
+    for( i = 0; i < label_num; i++ ) {
+        if( warea[i] == marker2.area && wpos[i*2+0] == marker2.pos[0]
+         && wpos[i*2+1] == marker2.pos[1] ) contour_label = i+1;
+    }
+    if( contour_label == 0 ) return -1;
+
+    /* arModifyMatrix starts from the initial pose estimate of arGetTransMat */
+    arGetInitRot( &marker, cparam.mat, init_rot );
+    arGetTransMat( &marker, marker_center, marker_width, conv );
+    for( i = 0; i < 3; i++ ) init_trans[i] = conv[i][3];
+    dir = marker.dir;
+    for( i = 0; i < 4; i++ ) {
+        pos2d[i][0] = marker.vertex[(4-dir+i)%4][0];
+        pos2d[i][1] = marker.vertex[(4-dir+i)%4][1];
+        pos3d[i][0] = ((i == 1 || i == 2)? 1.0: -1.0) * marker_width / 2.0;
+        pos3d[i][1] = ((i < 2)? 1.0: -1.0) * marker_width / 2.0;
+        pos3d[i][2] = 0.0;
+    }
+
+    for( j = 0; j < 8; j++ ) {
+        for( i = 0; i < 8; i++ ) {
+            point[j*8+i][0] = (i + 0.5) * xsize / 8.0;
+            point[j*8+i][1] = (j + 0.5) * ysize / 8.0;
+        }
+    }
+
+    /* one side of the contour, as fitted by arGetLine */
+    st = marker2.vertex[0];
+    n  = marker2.vertex[1] - marker2.vertex[0] + 1;
+    pca_input = arMatrixAlloc( n, 2 );
+    pca_work  = arMatrixAlloc( n, 2 );
+    pca_evec  = arMatrixAlloc( 2, 2 );
+    pca_ev    = arVecAlloc( 2 );
+    pca_mean  = arVecAlloc( 2 );
+    for( j = 0; j < n; j++ ) {
+        arParamObserv2Ideal( cparam.dist_factor, marker2.x_coord[st+j], marker2.y_coord[st+j],
+                             &(pca_input->m[j*2+0]), &(pca_input->m[j*2+1]) );
+    }
+
+    inv_input = arMatrixAlloc( INV_DIM, INV_DIM );
+    inv_work  = arMatrixAlloc( INV_DIM, INV_DIM );
+    for( j = 0; j < INV_DIM; j++ ) {
+        for( i = 0; i < INV_DIM; i++ ) {
+            inv_input->m[j*INV_DIM+i] = 1.0 / (i + j + 1) + ((i == j)? 1.0: 0.0);
+        }
+    }
+
+    arMalloc( cand, ARMarkerInfo2, CAND_MAX );
+    for( i = 0; i < CAND_MAX; i++ ) cand[i] = marker2;
+
+    /* capture formats are at most 3 bytes per pixel; the frame bytes will do */
+    arMalloc( conv_src, ARUint8, xsize * ysize * 3 );
+    arMalloc( conv_dst, ARUint8, xsize * ysize * 4 );
+    for( i = 0; i < xsize * ysize * 3; i++ ) conv_src[i] = image[i % (xsize * ysize * AR_PIX_SIZE_DEFAULT)];
+
+    return 0;
+}
+
+static void k_labeling( void )
+{
+    limage = arLabeling( image, thresh, &label_num, &warea, &wpos, &wclip, &label_ref );
+}
+
+static void k_contour( void )
+{
+    static ARMarkerInfo2   work;
+
+    arGetContour( limage, label_ref, contour_label, &(wclip[(contour_label-1)*4]), &work );
+}
+
+static void k_detect2( void )
+{
+    int     num;
+
+    arDetectMarker2( limage, label_num, label_ref, warea, wpos, wclip,
+                     AR_AREA_MAX, AR_AREA_MIN, 1.0, &num );
+}
+
+static void k_get_line( void )
+{
+    double  line[4][3], v[4][2];
+
+    arGetLine( marker2.x_coord, marker2.y_coord, marker2.coord_num, marker2.vertex, line, v );
+}
+
+static void k_get_patt( void )
+{
+    static ARUint8  ext_pat[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
+
+    arGetPatt( image, marker2.x_coord, marker2.y_coord, marker2.vertex, ext_pat );
+}
+
+static void k_get_code( void )
+{
+    double  cf;
+    int     code, dir;
+
+    arGetCode( image, marker2.x_coord, marker2.y_coord, marker2.vertex, &code, &dir, &cf );
+}
+
+static void k_marker_info( void )
+{
+    int     i, num;
+
+    for( i = 0; i < cand_num; i++ ) {
+        num = 1;
+        arGetMarkerInfo( image, &cand[i], &num );
+    }
+}
+
+static void k_marker_info_parallel( void )
+{
+    int     num;
+
+    num = cand_num;
+    arGetMarkerInfoParallel( image, cand, &num, cand_info );
+}
+
+static void k_trans_mat( void )
+{
+    double  conv[3][4];
+
+    arGetTransMat( &marker, marker_center, marker_width, conv );
+}
+
+static void k_modify_matrix( void )
+{
+    double  rot[3][3], trans[3];
+
+    memcpy( rot, init_rot, sizeof(rot) );
+    memcpy( trans, init_trans, sizeof(trans) );
+    arModifyMatrix( rot, trans, cparam.mat, pos3d, pos2d, 4 );
+}
+
+static void k_observ2ideal( void )
+{
+    static int  n = 0;
+    double      ix, iy;
+
+    arParamObserv2Ideal( cparam.dist_factor, point[n][0], point[n][1], &ix, &iy );
+    n = (n + 1) % POINT_NUM;
+}
+
+static void k_observ2idealf( void )
+{
+    static int  n = 0;
+    float       ix, iy;
+
+    arParamObserv2Idealf( dist_factorf, (float)point[n][0], (float)point[n][1], &ix, &iy );
+    n = (n + 1) % POINT_NUM;
+}
+
+static void k_pca( void )
+{
+    arMatrixDup( pca_work, pca_input );
+    arMatrixPCA( pca_work, pca_evec, pca_ev, pca_mean );
+}
+
+static void k_self_inv( void )
+{
+    arMatrixDup( inv_work, inv_input );
+    arMatrixSelfInv( inv_work );
+}
+
+static void k_color_conv( void )
+{
+    arColorConvert( conv_src, conv_format, xsize, ysize, conv_dst, AR_DEFAULT_PIXEL_FORMAT );
+}
+
+/*
+ * Built-in frame: the marker 400mm in front of the camera, tilted by
+ * 30 degrees, over a grey gradient. Drawn through the lens distortion.
+ */
+static void make_image( void )
+{
+    static float  texel[AR_PATT_SIZE_Y][AR_PATT_SIZE_X][3];
+    double        h[3][3], hinv[3][3], ix, iy, mx, my, d, det;
+    double        ct = cos(30.0 * 3.14159265358979 / 180.0);
+    double        st = sin(30.0 * 3.14159265358979 / 180.0);
+    double        trans[3][4];
+    FILE          *fp;
+    ARUint8       *buf, *p;
+    int           c, x, y, v, tx, ty;
+    float         rgb[3];
+
+    if( (fp = fopen(patt_name, "r")) == NULL ) {
+        printf("\"%s\" not found!!\n", patt_name);
+        exit(1);
+    }
+    for( c = 0; c < 3; c++ ) {
+        for( y = 0; y < AR_PATT_SIZE_Y; y++ ) {
+            for( x = 0; x < AR_PATT_SIZE_X; x++ ) {
+                if( fscanf(fp, "%d", &v) != 1 ) {
+                    printf("Pattern Data read error!! (%s)\n", patt_name);
+                    exit(1);
+                }
+                texel[y][x][2-c] = (float)v;
+            }
+        }
+    }
+    fclose(fp);
+
+    /* rotation about x of a marker facing the camera */
+    trans[0][0] = 1.0; trans[0][1] = 0.0; trans[0][2] = 0.0; trans[0][3] = 10.0;
+    trans[1][0] = 0.0; trans[1][1] = -ct; trans[1][2] =  st; trans[1][3] = -5.0;
+    trans[2][0] = 0.0; trans[2][1] = -st; trans[2][2] = -ct; trans[2][3] = 400.0;
+    for( y = 0; y < 3; y++ ) {
+        for( x = 0; x < 3; x++ ) {
+            c = (x == 2)? 3: x;
+            h[y][x] = cparam.mat[y][0]*trans[0][c] + cparam.mat[y][1]*trans[1][c]
+                    + cparam.mat[y][2]*trans[2][c];
+        }
+    }
+    hinv[0][0] = h[1][1]*h[2][2] - h[1][2]*h[2][1];
+    hinv[0][1] = h[0][2]*h[2][1] - h[0][1]*h[2][2];
+    hinv[0][2] = h[0][1]*h[1][2] - h[0][2]*h[1][1];
+    hinv[1][0] = h[1][2]*h[2][0] - h[1][0]*h[2][2];
+    hinv[1][1] = h[0][0]*h[2][2] - h[0][2]*h[2][0];
+    hinv[1][2] = h[0][2]*h[1][0] - h[0][0]*h[1][2];
+    hinv[2][0] = h[1][0]*h[2][1] - h[1][1]*h[2][0];
+    hinv[2][1] = h[0][1]*h[2][0] - h[0][0]*h[2][1];
+    hinv[2][2] = h[0][0]*h[1][1] - h[0][1]*h[1][0];
+    det = h[0][0]*hinv[0][0] + h[0][1]*hinv[1][0] + h[0][2]*hinv[2][0];
+
+    arMalloc( buf, ARUint8, xsize*ysize*3 );
+    p = buf;
+    for( y = 0; y < ysize; y++ ) {
+        for( x = 0; x < xsize; x++ ) {
+            arParamObserv2Ideal( cparam.dist_factor, x, y, &ix, &iy );
+            d  = (hinv[2][0]*ix + hinv[2][1]*iy + hinv[2][2]) / det;
+            mx = (hinv[0][0]*ix + hinv[0][1]*iy + hinv[0][2]) / det / d;
+            my = (hinv[1][0]*ix + hinv[1][1]*iy + hinv[1][2]) / det / d;
+            rgb[0] = rgb[1] = rgb[2] = (float)(120 + 80 * y / ysize);
+            if( fabs(mx) < marker_width/4 && fabs(my) < marker_width/4 ) {
+                tx = (int)((mx + marker_width/4) / (marker_width/2) * AR_PATT_SIZE_X);
+                ty = (int)((marker_width/4 - my) / (marker_width/2) * AR_PATT_SIZE_Y);
+                if( tx >= AR_PATT_SIZE_X ) tx = AR_PATT_SIZE_X-1;
+                if( ty >= AR_PATT_SIZE_Y ) ty = AR_PATT_SIZE_Y-1;
+                for( c = 0; c < 3; c++ ) rgb[c] = texel[ty][tx][c];
+            }
+            else if( fabs(mx) < marker_width/2 && fabs(my) < marker_width/2 ) {
+                rgb[0] = rgb[1] = rgb[2] = 20.0f;
+            }
+            else if( fabs(mx) < marker_width*0.625 && fabs(my) < marker_width*0.625 ) {
+                rgb[0] = rgb[1] = rgb[2] = 235.0f;
+            }
+            for( c = 0; c < 3; c++ ) *(p++) = (ARUint8)rgb[c];
+        }
+    }
+
+    arMalloc( image, ARUint8, xsize*ysize*AR_PIX_SIZE_DEFAULT );
+    rgb_to_native( buf, image, xsize*ysize );
+    free( buf );
+}
+
+static int read_pnm_int( FILE *fp )
+{
+    int     c, v;
+
+    c = getc(fp);
+    for(;;) {
+        if( c == '#' ) {
+            while( c != '\n' && c != EOF ) c = getc(fp);
+        }
+        else if( c == ' ' || c == '\t' || c == '\n' || c == '\r' ) c = getc(fp);
+        else break;
+    }
+    if( c < '0' || c > '9' ) return -1;
+    for( v = 0; c >= '0' && c <= '9'; c = getc(fp) ) v = v*10 + (c - '0');
+
+    return v;
+}
+
+static int load_image( char *filename )
+{
+    FILE      *fp;
+    ARUint8   *rgb;
+    char      magic[2];
+    int       maxval, chan;
+    int       i;
+
+    if( (fp = fopen(filename, "rb")) == NULL ) {
+        printf("Cannot open %s\n", filename);
+        return -1;
+    }
+    if( fread(magic, 1, 2, fp) != 2 || magic[0] != 'P' || (magic[1] != '5' && magic[1] != '6') ) {
+        printf("Not a binary PPM/PGM file: %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+    chan   = (magic[1] == '6')? 3: 1;
+    xsize  = read_pnm_int( fp );
+    ysize  = read_pnm_int( fp );
+    maxval = read_pnm_int( fp );
+    if( xsize <= 0 || ysize <= 0 || maxval != 255 ) {
+        printf("Unsupported PPM/PGM header: %s\n", filename);
+        fclose(fp);
+        return -1;
+    }
+
+    arMalloc( rgb, ARUint8, xsize*ysize*3 );
+    if( fread(rgb, chan, xsize*ysize, fp) != (size_t)(xsize*ysize) ) {
+        printf("Read error: %s\n", filename);
+        free( rgb );
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    if( chan == 1 ) {
+        for( i = xsize*ysize-1; i >= 0; i-- ) rgb[i*3+0] = rgb[i*3+1] = rgb[i*3+2] = rgb[i];
+    }
+
+    arMalloc( image, ARUint8, xsize*ysize*AR_PIX_SIZE_DEFAULT );
+    rgb_to_native( rgb, image, xsize*ysize );
+    free( rgb );
+
+    return 0;
+}
+
+/* convert packed RGB to AR_DEFAULT_PIXEL_FORMAT */
+static void rgb_to_native( ARUint8 *rgb, ARUint8 *dst, int num )
+{
+    int     i;
+#if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy) || (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_yuvs)
+    int     y0, y1, u, v, r, g, b;
+
+    for( i = 0; i+1 < num; i += 2, rgb += 6, dst += 4 ) {
+        y0 = ( 66*rgb[0] + 129*rgb[1] +  25*rgb[2] + 128) / 256 + 16;
+        y1 = ( 66*rgb[3] + 129*rgb[4] +  25*rgb[5] + 128) / 256 + 16;
+        r  = (rgb[0] + rgb[3]) / 2;
+        g  = (rgb[1] + rgb[4]) / 2;
+        b  = (rgb[2] + rgb[5]) / 2;
+        u  = (-38*r -  74*g + 112*b + 128) / 256 + 128;
+        v  = (112*r -  94*g -  18*b + 128) / 256 + 128;
+#  if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_2vuy)
+        dst[0] = u; dst[1] = y0; dst[2] = v; dst[3] = y1;
+#  else
+        dst[0] = y0; dst[1] = u; dst[2] = y1; dst[3] = v;
+#  endif
+    }
+#else
+    for( i = 0; i < num; i++, rgb += 3, dst += AR_PIX_SIZE_DEFAULT ) {
+#  if (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGB)
+        dst[0] = rgb[0]; dst[1] = rgb[1]; dst[2] = rgb[2];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGR)
+        dst[0] = rgb[2]; dst[1] = rgb[1]; dst[2] = rgb[0];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_RGBA)
+        dst[0] = rgb[0]; dst[1] = rgb[1]; dst[2] = rgb[2]; dst[3] = 255;
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_BGRA)
+        dst[0] = rgb[2]; dst[1] = rgb[1]; dst[2] = rgb[0]; dst[3] = 255;
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ABGR)
+        dst[0] = 255; dst[1] = rgb[2]; dst[2] = rgb[1]; dst[3] = rgb[0];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_ARGB)
+        dst[0] = 255; dst[1] = rgb[0]; dst[2] = rgb[1]; dst[3] = rgb[2];
+#  elif (AR_DEFAULT_PIXEL_FORMAT == AR_PIXEL_FORMAT_MONO)
+        dst[0] = (rgb[0] + rgb[1] + rgb[2]) / 3;
+#  else
+#    error Unknown default pixel format defined in config.h
+#  endif
+    }
+#endif
+}